@@ -1,5 +1,16 @@
+#include <stdatomic.h>
 #include "alloc.h"
 
+/**
+ * Number of successful calls to moviedb_alloc.
+ */
+static atomic_ulong allocations = 0;
+
+/**
+ * Number of successful calls to moviedb_realloc.
+ */
+static atomic_ulong reallocations = 0;
+
 void *moviedb_alloc(
         size_t elem_size,
         size_t elements,
@@ -18,6 +29,8 @@ void *moviedb_alloc(
         error_set_code(error, error_alloc);
         error->data.alloc.elem_size = elem_size;
         error->data.alloc.elements = elements;
+    } else {
+        atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
     }
 
     return mem;
@@ -42,9 +55,21 @@ void *moviedb_realloc(
         error_set_code(error, error_alloc);
         error->data.alloc.elem_size = elem_size;
         error->data.alloc.elements = elements;
+    } else {
+        atomic_fetch_add_explicit(&reallocations, 1, memory_order_relaxed);
     }
 
     return new_mem;
 }
 
+void moviedb_alloc_stats(struct moviedb_alloc_stats *restrict stats_out)
+{
+    stats_out->allocations = atomic_load_explicit(
+            &allocations,
+            memory_order_relaxed);
+    stats_out->reallocations = atomic_load_explicit(
+            &reallocations,
+            memory_order_relaxed);
+}
+
 extern inline void moviedb_free(void *mem);
@@ -9,6 +9,21 @@
  * handled such that a struct error is used.
  */
 
+/**
+ * Counters of the calls to the allocation functions, since the program
+ * started.
+ */
+struct moviedb_alloc_stats {
+    /**
+     * Successful calls to moviedb_alloc.
+     */
+    unsigned long allocations;
+    /**
+     * Successful calls to moviedb_realloc.
+     */
+    unsigned long reallocations;
+};
+
 /**
  * Allocates a memory region of size given by size. If an error happens,
  * NULL is returned and the error parameter is set to allocation error.
@@ -34,6 +49,11 @@ void *moviedb_realloc(
         size_t elements,
         struct error *restrict error);
 
+/**
+ * Reads the allocation counters into stats_out. Counting is thread-safe.
+ */
+void moviedb_alloc_stats(struct moviedb_alloc_stats *restrict stats_out);
+
 /**
  * Frees memory allocated by moviedb_alloc and moviedb_realloc.
  */
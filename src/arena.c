@@ -0,0 +1,184 @@
+#include <stdint.h>
+#include <string.h>
+#include "arena.h"
+#include "alloc.h"
+
+/**
+ * Size of the first chunk of an arena.
+ */
+#define MIN_CHUNK_SIZE 0x10000
+
+/**
+ * Chunks double in size up to this size.
+ */
+#define MAX_CHUNK_SIZE 0x1000000
+
+/**
+ * Alignment of arena_alloc allocations, enough for any type.
+ */
+#define ALIGNMENT _Alignof(max_align_t)
+
+struct arena_chunk {
+    /**
+     * The previously allocated chunk.
+     */
+    struct arena_chunk *next;
+};
+
+/**
+ * Allocates the given size with the given alignment from the arena, making a
+ * new chunk if the current one does not fit it.
+ */
+static void *bump(
+        struct arena *restrict arena,
+        size_t size,
+        size_t alignment,
+        struct error *restrict error);
+
+/**
+ * Makes a new current chunk able to fit at least the given size, with any
+ * alignment padding.
+ */
+static void new_chunk(
+        struct arena *restrict arena,
+        size_t size,
+        struct error *restrict error);
+
+void arena_init(struct arena *restrict arena)
+{
+    arena->chunks = NULL;
+    arena->next = NULL;
+    arena->available = 0;
+    arena->chunk_size = MIN_CHUNK_SIZE;
+    arena->chunk_count = 0;
+    arena->used = 0;
+    arena->reserved = 0;
+}
+
+void *arena_alloc(
+        struct arena *restrict arena,
+        size_t elem_size,
+        size_t elements,
+        struct error *restrict error)
+{
+    void *mem = NULL;
+
+    if (arena == NULL) {
+        mem = moviedb_alloc(elem_size, elements, error);
+    } else if (elem_size == 0
+            || elements <= (SIZE_MAX - ALIGNMENT) / elem_size) {
+        mem = bump(arena, elem_size * elements, ALIGNMENT, error);
+    } else {
+        error_set_code(error, error_alloc);
+        error->data.alloc.elem_size = elem_size;
+        error->data.alloc.elements = elements;
+    }
+
+    return mem;
+}
+
+char *arena_copy_str(
+        struct arena *restrict arena,
+        char const *restrict bytes,
+        size_t length,
+        struct error *restrict error)
+{
+    char *string = NULL;
+
+    if (arena == NULL) {
+        string = moviedb_alloc(sizeof(*string), length + 1, error);
+    } else if (length < SIZE_MAX - ALIGNMENT) {
+        string = bump(arena, length + 1, 1, error);
+    } else {
+        error_set_code(error, error_alloc);
+        error->data.alloc.elem_size = 1;
+        error->data.alloc.elements = length;
+    }
+
+    if (string != NULL) {
+        memcpy(string, bytes, length);
+        string[length] = 0;
+    }
+
+    return string;
+}
+
+void arena_free(struct arena const *arena, void const *mem)
+{
+    if (arena == NULL) {
+        moviedb_free((void *) mem);
+    }
+}
+
+void arena_destroy(struct arena *restrict arena)
+{
+    struct arena_chunk *chunk = arena->chunks;
+    struct arena_chunk *next;
+
+    while (chunk != NULL) {
+        next = chunk->next;
+        moviedb_free(chunk);
+        chunk = next;
+    }
+
+    arena_init(arena);
+}
+
+static void *bump(
+        struct arena *restrict arena,
+        size_t size,
+        size_t alignment,
+        struct error *restrict error)
+{
+    size_t padding = -(uintptr_t) arena->next & (alignment - 1);
+    void *mem = NULL;
+
+    if (arena->chunks == NULL || arena->available < size + padding) {
+        new_chunk(arena, size + alignment, error);
+        padding = -(uintptr_t) arena->next & (alignment - 1);
+    }
+
+    if (error->code == error_none) {
+        mem = arena->next + padding;
+        arena->next += size + padding;
+        arena->available -= size + padding;
+        arena->used += size + padding;
+    }
+
+    return mem;
+}
+
+static void new_chunk(
+        struct arena *restrict arena,
+        size_t size,
+        struct error *restrict error)
+{
+    size_t chunk_size = arena->chunk_size;
+    struct arena_chunk *chunk = NULL;
+
+    /* Large requests get a chunk of their own size. */
+    if (chunk_size < size) {
+        chunk_size = size;
+    }
+
+    if (chunk_size > SIZE_MAX - sizeof(*chunk)) {
+        error_set_code(error, error_alloc);
+        error->data.alloc.elem_size = 1;
+        error->data.alloc.elements = chunk_size;
+    } else {
+        chunk = moviedb_alloc(1, sizeof(*chunk) + chunk_size, error);
+    }
+
+    if (error->code == error_none) {
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+        arena->next = (char *) (chunk + 1);
+        arena->available = chunk_size;
+        arena->chunk_count++;
+        arena->reserved += chunk_size;
+
+        if (arena->chunk_size < MAX_CHUNK_SIZE) {
+            arena->chunk_size *= 2;
+        }
+    }
+}
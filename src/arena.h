@@ -0,0 +1,105 @@
+#ifndef MOVIEDB_ARENA_H
+#define MOVIEDB_ARENA_H 1
+
+#include <stddef.h>
+#include "error.h"
+
+/**
+ * This file provides an arena (bump) allocator, for objects that live as long
+ * as the arena, such as the database's load-time objects. Allocations are
+ * carved from large chunks and are never freed individually; destroying the
+ * arena frees every chunk at once.
+ *
+ * Functions taking an arena accept NULL, meaning the heap: memory then comes
+ * from moviedb_alloc, and must be released with arena_free. This lets data
+ * structures be used both with and without an arena.
+ */
+
+/**
+ * A chunk of memory from which allocations are carved. Only internal arena
+ * code is allowed to touch this.
+ */
+struct arena_chunk;
+
+/**
+ * An arena allocator.
+ */
+struct arena {
+    /**
+     * List of chunks, the current one first. Only internal arena code is
+     * allowed to touch this.
+     */
+    struct arena_chunk *chunks;
+    /**
+     * Next free byte of the current chunk. Only internal arena code is allowed
+     * to touch this.
+     */
+    char *next;
+    /**
+     * How many bytes are free in the current chunk. Only internal arena code is
+     * allowed to touch this.
+     */
+    size_t available;
+    /**
+     * Size of the next chunk to be allocated. Only internal arena code is
+     * allowed to touch this.
+     */
+    size_t chunk_size;
+    /**
+     * How many chunks have been allocated. Reading is fine, only internal
+     * arena code is allowed to update this.
+     */
+    unsigned long chunk_count;
+    /**
+     * How many bytes were requested from the chunks, including alignment
+     * padding. Reading is fine, only internal arena code is allowed to update
+     * this.
+     */
+    size_t used;
+    /**
+     * How many bytes the chunks hold in total. Reading is fine, only internal
+     * arena code is allowed to update this.
+     */
+    size_t reserved;
+};
+
+/**
+ * Initializes an empty arena. No memory is allocated until the first
+ * allocation.
+ */
+void arena_init(struct arena *restrict arena);
+
+/**
+ * Allocates memory for the given number of elements of the given size from
+ * the arena (or the heap, if NULL), suitably aligned for any type. If an error
+ * happens, NULL is returned and the error parameter is set to allocation error.
+ */
+void *arena_alloc(
+        struct arena *restrict arena,
+        size_t elem_size,
+        size_t elements,
+        struct error *restrict error);
+
+/**
+ * Copies the given bytes into a nul-terminated string allocated from the
+ * arena (or the heap, if NULL). If an error happens, NULL is returned and the
+ * error parameter is set to allocation error.
+ */
+char *arena_copy_str(
+        struct arena *restrict arena,
+        char const *restrict bytes,
+        size_t length,
+        struct error *restrict error);
+
+/**
+ * Frees memory allocated with a NULL arena. Memory of an actual arena is only
+ * released when the arena is destroyed, so nothing is done.
+ */
+void arena_free(struct arena const *arena, void const *mem);
+
+/**
+ * Destroys the arena, freeing all memory allocated from it.
+ */
+void arena_destroy(struct arena *restrict arena);
+
+#endif
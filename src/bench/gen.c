@@ -0,0 +1,569 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "workload.h"
+#include "../error.h"
+#include "../alloc.h"
+#include "../database.h"
+
+/**
+ * Generates a synthetic dataset in the format of the MovieLens CSV files, so
+ * the benchmark can run without downloading the real dataset. The same seed
+ * and sizes always generate the same files.
+ */
+
+/**
+ * How many words titles are made of.
+ */
+#define TITLE_WORDS 32
+
+/**
+ * How many adjectives tag names are made of.
+ */
+#define TAG_ADJECTIVES 32
+
+/**
+ * How many nouns tag names are made of.
+ */
+#define TAG_NOUNS 32
+
+/**
+ * Earliest timestamp of ratings and tags: 1995-01-01 00:00:00 UTC.
+ */
+#define FIRST_TIMESTAMP 788918400
+
+/**
+ * Latest timestamp of ratings and tags: 2015-03-31 00:00:00 UTC.
+ */
+#define LAST_TIMESTAMP 1427760000
+
+/**
+ * Words titles are made of.
+ */
+static char const *const title_words[TITLE_WORDS] = {
+    "Dark", "Night", "Love", "Last", "Man", "City", "Dead", "Story",
+    "King", "Blue", "War", "House", "Lost", "Star", "Road", "Secret",
+    "Life", "Girl", "Return", "Shadow", "Time", "River", "Blood", "Dream",
+    "Ghost", "Island", "Summer", "Wild", "Heart", "Fire", "Game", "World"
+};
+
+/**
+ * Adjectives tag names are made of.
+ */
+static char const *const tag_adjectives[TAG_ADJECTIVES] = {
+    "atmospheric", "dark", "funny", "slow", "classic", "quirky", "violent",
+    "beautiful", "boring", "clever", "dystopian", "surreal", "tense", "sad",
+    "romantic", "stylized", "cult", "epic", "gritty", "witty", "bleak",
+    "campy", "dreamlike", "absurd", "haunting", "nostalgic", "original",
+    "predictable", "realistic", "satirical", "weird", "visual"
+};
+
+/**
+ * Nouns tag names are made of.
+ */
+static char const *const tag_nouns[TAG_NOUNS] = {
+    "ending", "soundtrack", "comedy", "drama", "cinematography", "plot",
+    "acting", "dialogue", "thriller", "romance", "humor", "violence",
+    "twist", "characters", "visuals", "story", "music", "atmosphere",
+    "action", "cast", "script", "sci-fi", "horror", "mystery", "animation",
+    "western", "noir", "satire", "fantasy", "documentary", "war", "crime"
+};
+
+/**
+ * Sizes and seed of the dataset to be generated.
+ */
+struct gen_options {
+    /**
+     * Directory in which data/ is created.
+     */
+    char const *dir;
+    /**
+     * How many movies are generated.
+     */
+    uint64_t movies;
+    /**
+     * How many users are generated.
+     */
+    uint64_t users;
+    /**
+     * Mean number of ratings given by each user.
+     */
+    uint64_t user_ratings;
+    /**
+     * How many tag rows are generated.
+     */
+    uint64_t tags;
+    /**
+     * Seed of the pseudo-random number generator.
+     */
+    uint64_t seed;
+};
+
+/**
+ * Movie data the ratings and tags files need.
+ */
+struct gen_movies {
+    /**
+     * IDs of the movies, in increasing order.
+     */
+    uint64_t *ids;
+    /**
+     * Quality of each movie, around which its ratings are drawn.
+     */
+    double *quality;
+    /**
+     * How many movies there are.
+     */
+    size_t length;
+};
+
+/**
+ * Parses the command line arguments into the options. Returns whether the
+ * arguments are valid.
+ */
+static bool parse_args(
+        int argc,
+        char const *argv[],
+        struct gen_options *restrict options);
+
+/**
+ * Prints the command line usage on stderr.
+ */
+static void print_usage(char const *program);
+
+/**
+ * Opens a file of the dataset for writing.
+ */
+static FILE *open_output(char const *path, struct error *restrict error);
+
+/**
+ * Closes a file of the dataset, reporting any write error.
+ */
+static void close_output(
+        FILE *file,
+        char const *path,
+        struct error *restrict error);
+
+/**
+ * Returns a pseudo-random index in [0, length), skewed towards 0 so a few
+ * movies and tags are much more popular than the others, as in the real data.
+ */
+static size_t skewed_index(
+        struct bench_rng *restrict rng,
+        size_t length,
+        unsigned power);
+
+/**
+ * Writes a timestamp between FIRST_TIMESTAMP and LAST_TIMESTAMP.
+ */
+static void write_timestamp(FILE *file, struct bench_rng *restrict rng);
+
+/**
+ * Writes movie.csv and fills the movie data.
+ */
+static void write_movies(
+        struct gen_options const *restrict options,
+        struct bench_rng *restrict rng,
+        struct gen_movies *restrict movies,
+        struct error *restrict error);
+
+/**
+ * Writes rating.csv, grouped by user and sorted by movie ID in each group.
+ */
+static void write_ratings(
+        struct gen_options const *restrict options,
+        struct bench_rng *restrict rng,
+        struct gen_movies const *restrict movies,
+        struct error *restrict error);
+
+/**
+ * Writes tag.csv.
+ */
+static void write_tags(
+        struct gen_options const *restrict options,
+        struct bench_rng *restrict rng,
+        struct gen_movies const *restrict movies,
+        struct error *restrict error);
+
+/**
+ * Compares two movie indices, for sorting.
+ */
+static int compare_index(void const *left_ptr, void const *right_ptr);
+
+int main(int argc, char const *argv[])
+{
+    struct gen_options options;
+    struct gen_movies movies;
+    struct bench_rng rng;
+    struct error error;
+    int exit_code = 0;
+
+    if (!parse_args(argc, argv, &options)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    error_init(&error);
+    bench_rng_init(&rng, options.seed);
+    movies.ids = NULL;
+    movies.quality = NULL;
+    movies.length = 0;
+
+    /* The paths of the CSV files are relative to the dataset directory. */
+    if (chdir(options.dir) < 0
+            || (mkdir("data", 0777) < 0 && errno != EEXIST)) {
+        error_set_code(&error, error_io);
+        error.data.io.sys_errno = errno;
+        error_set_context(&error, options.dir, false);
+    }
+
+    if (error.code == error_none) {
+        write_movies(&options, &rng, &movies, &error);
+    }
+    if (error.code == error_none) {
+        write_ratings(&options, &rng, &movies, &error);
+    }
+    if (error.code == error_none) {
+        write_tags(&options, &rng, &movies, &error);
+    }
+
+    if (error.code == error_none) {
+        printf("Generated %zu movies, %lu users and %lu tags in %s/data\n",
+                movies.length,
+                (unsigned long) options.users,
+                (unsigned long) options.tags,
+                options.dir);
+    } else {
+        error_print(&error);
+        exit_code = 1;
+    }
+
+    moviedb_free(movies.ids);
+    moviedb_free(movies.quality);
+    error_destroy(&error);
+
+    return exit_code;
+}
+
+static bool parse_args(
+        int argc,
+        char const *argv[],
+        struct gen_options *restrict options)
+{
+    int i = 1;
+    bool valid = true;
+
+    options->dir = ".";
+    options->movies = 10000;
+    options->users = 20000;
+    options->user_ratings = 50;
+    options->tags = 20000;
+    options->seed = BENCH_DEFAULT_SEED;
+
+    while (i < argc && valid) {
+        if (i + 1 >= argc) {
+            /* Every option takes an argument. */
+            valid = false;
+        } else if (strcmp(argv[i], "--dir") == 0) {
+            options->dir = argv[i + 1];
+        } else if (strcmp(argv[i], "--movies") == 0) {
+            valid = bench_parse_count(argv[i + 1], &options->movies)
+                && options->movies > 0;
+        } else if (strcmp(argv[i], "--users") == 0) {
+            valid = bench_parse_count(argv[i + 1], &options->users)
+                && options->users > 0;
+        } else if (strcmp(argv[i], "--user-ratings") == 0) {
+            valid = bench_parse_count(argv[i + 1], &options->user_ratings)
+                && options->user_ratings > 0;
+        } else if (strcmp(argv[i], "--tags") == 0) {
+            valid = bench_parse_count(argv[i + 1], &options->tags);
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            valid = bench_parse_count(argv[i + 1], &options->seed);
+        } else {
+            valid = false;
+        }
+        i += 2;
+    }
+
+    return valid;
+}
+
+static void print_usage(char const *program)
+{
+    fprintf(stderr,
+            "Usage:\n    %s [--dir DIR] [--movies N] [--users N] "
+            "[--user-ratings N] [--tags N] [--seed S]\n\n",
+            program);
+    fputs("    --dir DIR          write DIR/data/*.csv (default: .)\n",
+            stderr);
+    fputs("    --movies N         number of movies (default: 10000)\n",
+            stderr);
+    fputs("    --users N          number of users (default: 20000)\n",
+            stderr);
+    fputs("    --user-ratings N   mean ratings per user (default: 50)\n",
+            stderr);
+    fputs("    --tags N           number of tag rows (default: 20000)\n",
+            stderr);
+    fputs("    --seed S           pseudo-random seed\n", stderr);
+}
+
+static FILE *open_output(char const *path, struct error *restrict error)
+{
+    FILE *file = fopen(path, "w");
+
+    if (file == NULL) {
+        error_set_code(error, error_io);
+        error->data.io.sys_errno = errno;
+        error_set_context(error, path, false);
+    }
+
+    return file;
+}
+
+static void close_output(
+        FILE *file,
+        char const *path,
+        struct error *restrict error)
+{
+    bool failed = ferror(file);
+
+    if (fclose(file) != 0 || failed) {
+        if (error->code == error_none) {
+            error_set_code(error, error_io);
+            error->data.io.sys_errno = errno;
+            error_set_context(error, path, false);
+        }
+    }
+}
+
+static size_t skewed_index(
+        struct bench_rng *restrict rng,
+        size_t length,
+        unsigned power)
+{
+    double unit = bench_rng_unit(rng);
+    double skewed = unit;
+    unsigned i;
+
+    for (i = 1; i < power; i++) {
+        skewed *= unit;
+    }
+
+    return skewed * length;
+}
+
+static void write_timestamp(FILE *file, struct bench_rng *restrict rng)
+{
+    time_t timestamp = FIRST_TIMESTAMP
+        + bench_rng_below(rng, LAST_TIMESTAMP - FIRST_TIMESTAMP);
+    struct tm fields;
+    char formatted[32];
+
+    gmtime_r(&timestamp, &fields);
+    strftime(formatted, sizeof(formatted), "%Y-%m-%d %H:%M:%S", &fields);
+    fputs(formatted, file);
+}
+
+static void write_movies(
+        struct gen_options const *restrict options,
+        struct bench_rng *restrict rng,
+        struct gen_movies *restrict movies,
+        struct error *restrict error)
+{
+    char const *path = DATABASE_MOVIES_PATH;
+    FILE *file;
+    uint64_t id = 0;
+    uint64_t genres;
+    size_t i, j, words;
+    bool first_genre;
+    bool quoted;
+
+    movies->ids = moviedb_alloc(sizeof(*movies->ids), options->movies, error);
+    if (error->code == error_none) {
+        movies->quality = moviedb_alloc(
+                sizeof(*movies->quality),
+                options->movies,
+                error);
+    }
+
+    file = NULL;
+    if (error->code == error_none) {
+        file = open_output(path, error);
+    }
+
+    if (error->code == error_none) {
+        fputs("movieId,title,genres\n", file);
+
+        for (i = 0; i < options->movies; i++) {
+            /* IDs are increasing, with gaps as in the real dataset. */
+            id += 1 + bench_rng_below(rng, 3);
+            movies->ids[i] = id;
+            movies->quality[i] = 1.5 + bench_rng_unit(rng) * 3;
+
+            fprintf(file, "%lu,", (unsigned long) id);
+
+            /* One in ten titles has a comma, thus is quoted. */
+            quoted = bench_rng_below(rng, 10) == 0;
+            if (quoted) {
+                fputc('"', file);
+            }
+            words = 1 + bench_rng_below(rng, 3);
+            for (j = 0; j < words; j++) {
+                if (j > 0) {
+                    fputc(' ', file);
+                }
+                fputs(title_words[bench_rng_below(rng, TITLE_WORDS)], file);
+            }
+            if (quoted) {
+                fputs(", The", file);
+            }
+            fprintf(file, " (%u)", 1920 + (unsigned) bench_rng_below(rng, 95));
+            if (quoted) {
+                fputc('"', file);
+            }
+            fputc(',', file);
+
+            /* Some genres, as a set of distinct bits, or none at all. */
+            if (bench_rng_below(rng, 50) == 0) {
+                genres = 0;
+            } else {
+                /* Each genre with a chance of 1/8, about 2.4 per movie. */
+                genres = bench_rng_next(rng) & bench_rng_next(rng)
+                    & bench_rng_next(rng)
+                    & ((UINT64_C(1) << BENCH_GENRES) - 1);
+                if (genres == 0) {
+                    genres = UINT64_C(1) << bench_rng_below(rng, BENCH_GENRES);
+                }
+            }
+
+            first_genre = true;
+            for (j = 0; j < BENCH_GENRES; j++) {
+                if (genres & (UINT64_C(1) << j)) {
+                    if (!first_genre) {
+                        fputc('|', file);
+                    }
+                    fputs(bench_genres[j], file);
+                    first_genre = false;
+                }
+            }
+            if (first_genre) {
+                fputs("(no genres listed)", file);
+            }
+            fputc('\n', file);
+        }
+
+        movies->length = options->movies;
+        close_output(file, path, error);
+    }
+}
+
+static void write_ratings(
+        struct gen_options const *restrict options,
+        struct bench_rng *restrict rng,
+        struct gen_movies const *restrict movies,
+        struct error *restrict error)
+{
+    char const *path = DATABASE_RATINGS_PATH;
+    FILE *file;
+    size_t *indices;
+    size_t count, max_count, i, j;
+    uint64_t user;
+    double value;
+
+    /* Users rate between 1 and twice the mean number of movies. */
+    max_count = options->user_ratings * 2 - 1;
+    if (max_count > movies->length) {
+        max_count = movies->length;
+    }
+
+    indices = moviedb_alloc(sizeof(*indices), max_count, error);
+
+    file = NULL;
+    if (error->code == error_none) {
+        file = open_output(path, error);
+    }
+
+    if (error->code == error_none) {
+        fputs("userId,movieId,rating,timestamp\n", file);
+
+        for (user = 1; user <= options->users; user++) {
+            count = 1 + bench_rng_below(rng, max_count);
+            for (i = 0; i < count; i++) {
+                indices[i] = skewed_index(rng, movies->length, 3);
+            }
+            qsort(indices, count, sizeof(*indices), compare_index);
+
+            for (i = 0; i < count; i++) {
+                j = indices[i];
+                if (i > 0 && j == indices[i - 1]) {
+                    /* A user rates a movie only once. */
+                    continue;
+                }
+
+                /* Half stars, around the quality of the movie. */
+                value = movies->quality[j] + (bench_rng_unit(rng) - 0.5) * 3;
+                value = (long) (value * 2 + 0.5) / 2.0;
+                if (value < 0.5) {
+                    value = 0.5;
+                } else if (value > 5) {
+                    value = 5;
+                }
+
+                fprintf(file,
+                        "%lu,%lu,%.1f,",
+                        (unsigned long) user,
+                        (unsigned long) movies->ids[j],
+                        value);
+                write_timestamp(file, rng);
+                fputc('\n', file);
+            }
+        }
+
+        close_output(file, path, error);
+    }
+
+    moviedb_free(indices);
+}
+
+static void write_tags(
+        struct gen_options const *restrict options,
+        struct bench_rng *restrict rng,
+        struct gen_movies const *restrict movies,
+        struct error *restrict error)
+{
+    char const *path = DATABASE_TAGS_PATH;
+    FILE *file = open_output(path, error);
+    uint64_t i;
+    size_t name;
+
+    if (error->code == error_none) {
+        fputs("userId,movieId,tag,timestamp\n", file);
+
+        for (i = 0; i < options->tags; i++) {
+            name = skewed_index(rng, TAG_ADJECTIVES * TAG_NOUNS, 2);
+            fprintf(file,
+                    "%lu,%lu,%s %s,",
+                    (unsigned long) (1 + bench_rng_below(rng, options->users)),
+                    (unsigned long) movies->ids[
+                        skewed_index(rng, movies->length, 2)],
+                    tag_adjectives[name % TAG_ADJECTIVES],
+                    tag_nouns[name / TAG_ADJECTIVES]);
+            write_timestamp(file, rng);
+            fputc('\n', file);
+        }
+
+        close_output(file, path, error);
+    }
+}
+
+static int compare_index(void const *left_ptr, void const *right_ptr)
+{
+    size_t left = *(size_t const *) left_ptr;
+    size_t right = *(size_t const *) right_ptr;
+
+    return (left > right) - (left < right);
+}
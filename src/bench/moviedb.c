@@ -0,0 +1,1054 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "workload.h"
+#include "../error.h"
+#include "../alloc.h"
+#include "../strbuf.h"
+#include "../hash.h"
+#include "../csv/scan.h"
+#include "../database.h"
+#include "../timing.h"
+#include "../query.h"
+
+/**
+ * Benchmarks loading the database from the CSV files and running each kind of
+ * query over a fixed, pseudo-random workload, printing the results as JSON on
+ * stdout. The workload only depends on the seed and on the data, not on the
+ * build, so results of different builds can be compared.
+ */
+
+/**
+ * How many movies top-N queries ask for.
+ */
+#define TOPN_COUNT 10
+
+/**
+ * How many movies large top-N queries ask for, at most the number of movies,
+ * as in the shell.
+ */
+#define TOPN_LARGE_COUNT 100000
+
+/**
+ * Minimum number of ratings of movies in top-N queries, as in the shell.
+ */
+#define TOPN_MIN_RATINGS 1000
+
+/**
+ * First month windowed top-N queries start at: January of 1995, when the
+ * generated ratings start, counted as in timeline_month.
+ */
+#define TOPN_SINCE_FIRST_MONTH ((1995 - TIMELINE_EPOCH_YEAR) * 12)
+
+/**
+ * How many months windowed top-N queries can start at, up to March of 2015,
+ * when the generated ratings end.
+ */
+#define TOPN_SINCE_MONTHS (20 * 12 + 3)
+
+/**
+ * Longest prefix movie queries search for.
+ */
+#define MOVIE_PREFIX_MAX 8
+
+/**
+ * How many short prefixes there are.
+ */
+#define SHORT_PREFIXES 4
+
+/**
+ * Short prefixes, matching many titles, as the empty prefix matches them all.
+ */
+static char const *const short_prefixes[SHORT_PREFIXES] = {
+    "", "S", "T", "The"
+};
+
+/**
+ * Options of the benchmark.
+ */
+struct bench_options {
+    /**
+     * Directory holding data/, with the CSV files.
+     */
+    char const *dir;
+    /**
+     * How many queries of each kind are run.
+     */
+    uint64_t queries;
+    /**
+     * Seed of the workload.
+     */
+    uint64_t seed;
+    /**
+     * How the database is loaded.
+     */
+    struct database_options database;
+};
+
+/**
+ * Keys the queries pick their arguments from, sorted so the workload does not
+ * depend on the iteration order of the hash tables.
+ */
+struct bench_pool {
+    /**
+     * Every movie, sorted by ID.
+     */
+    struct movie const **movies;
+    /**
+     * How many movies there are.
+     */
+    size_t movies_length;
+    /**
+     * Every user ID, sorted.
+     */
+    moviedb_id_t *users;
+    /**
+     * How many users there are.
+     */
+    size_t users_length;
+    /**
+     * Every tag name, sorted.
+     */
+    char const **tags;
+    /**
+     * How many tags there are.
+     */
+    size_t tags_length;
+};
+
+/**
+ * Statistics of running one kind of query.
+ */
+struct bench_query_stats {
+    /**
+     * How many queries were run.
+     */
+    unsigned long queries;
+    /**
+     * How many rows all of the queries returned together.
+     */
+    unsigned long results;
+    /**
+     * Elapsed (wall-clock) time of all queries, in seconds.
+     */
+    double seconds;
+    /**
+     * Median latency of a query, in seconds.
+     */
+    double p50;
+    /**
+     * 99th percentile latency of a query, in seconds.
+     */
+    double p99;
+};
+
+/**
+ * Runs a single query with pseudo-random arguments from the pool, timing only
+ * the query itself into seconds_out. Returns how many rows the query returned.
+ */
+typedef size_t (*bench_query_fn)(
+        struct database const *restrict database,
+        struct bench_pool const *restrict pool,
+        struct bench_rng *restrict rng,
+        double *restrict seconds_out,
+        struct error *restrict error);
+
+/**
+ * Parses the command line arguments into the options. Returns whether the
+ * arguments are valid.
+ */
+static bool parse_args(
+        int argc,
+        char const *argv[],
+        struct bench_options *restrict options);
+
+/**
+ * Prints the command line usage on stderr.
+ */
+static void print_usage(char const *program);
+
+/**
+ * Fills the pool with the keys of the given database. The pool must be
+ * destroyed even on error.
+ */
+static void pool_init(
+        struct bench_pool *restrict pool,
+        struct database const *restrict database,
+        struct error *restrict error);
+
+/**
+ * Destroys the pool, but not the keys, which belong to the database.
+ */
+static void pool_destroy(struct bench_pool *restrict pool);
+
+/**
+ * Runs the given number of queries of a kind, measuring them into stats_out.
+ * latencies must hold at least count elements.
+ */
+static void run_queries(
+        bench_query_fn query,
+        struct database const *restrict database,
+        struct bench_pool const *restrict pool,
+        struct bench_rng *restrict rng,
+        unsigned long count,
+        double *restrict latencies,
+        struct bench_query_stats *restrict stats_out,
+        struct error *restrict error);
+
+/**
+ * Runs a movie query, for a prefix of a random title.
+ */
+static size_t run_movie_query(
+        struct database const *restrict database,
+        struct bench_pool const *restrict pool,
+        struct bench_rng *restrict rng,
+        double *restrict seconds_out,
+        struct error *restrict error);
+
+/**
+ * Runs a movie query, for a random short prefix.
+ */
+static size_t run_movie_short_query(
+        struct database const *restrict database,
+        struct bench_pool const *restrict pool,
+        struct bench_rng *restrict rng,
+        double *restrict seconds_out,
+        struct error *restrict error);
+
+/**
+ * Runs a complete query, for a random short prefix.
+ */
+static size_t run_complete_short_query(
+        struct database const *restrict database,
+        struct bench_pool const *restrict pool,
+        struct bench_rng *restrict rng,
+        double *restrict seconds_out,
+        struct error *restrict error);
+
+/**
+ * Runs a user query for a random user, iterating over all of its rows.
+ */
+static size_t run_user_query(
+        struct database const *restrict database,
+        struct bench_pool const *restrict pool,
+        struct bench_rng *restrict rng,
+        double *restrict seconds_out,
+        struct error *restrict error);
+
+/**
+ * Runs a raters query for a random movie, iterating over all of its rows.
+ */
+static size_t run_raters_query(
+        struct database const *restrict database,
+        struct bench_pool const *restrict pool,
+        struct bench_rng *restrict rng,
+        double *restrict seconds_out,
+        struct error *restrict error);
+
+/**
+ * Runs a top-N query for a random genre.
+ */
+static size_t run_topn_query(
+        struct database const *restrict database,
+        struct bench_pool const *restrict pool,
+        struct bench_rng *restrict rng,
+        double *restrict seconds_out,
+        struct error *restrict error);
+
+/**
+ * Runs a top-N query for a random genre with a large N, which lists every
+ * movie of the genre with enough ratings.
+ */
+static size_t run_topn_large_query(
+        struct database const *restrict database,
+        struct bench_pool const *restrict pool,
+        struct bench_rng *restrict rng,
+        double *restrict seconds_out,
+        struct error *restrict error);
+
+/**
+ * Runs a top-N query for a random genre over the ratings since a random month.
+ */
+static size_t run_topn_since_query(
+        struct database const *restrict database,
+        struct bench_pool const *restrict pool,
+        struct bench_rng *restrict rng,
+        double *restrict seconds_out,
+        struct error *restrict error);
+
+/**
+ * Runs a top-N query for a random genre, asking for the given count.
+ */
+static size_t run_topn(
+        struct database const *restrict database,
+        struct bench_rng *restrict rng,
+        size_t count,
+        double *restrict seconds_out,
+        struct error *restrict error);
+
+/**
+ * Runs a tags query for one or two random tags.
+ */
+static size_t run_tags_query(
+        struct database const *restrict database,
+        struct bench_pool const *restrict pool,
+        struct bench_rng *restrict rng,
+        double *restrict seconds_out,
+        struct error *restrict error);
+
+/**
+ * Returns the given percentile (nearest rank) of sorted latencies.
+ */
+static double percentile(
+        double const *restrict latencies,
+        unsigned long count,
+        unsigned percent);
+
+/**
+ * Prints the JSON object of a loaded CSV file.
+ */
+static void print_load_stats(
+        char const *name,
+        struct database_file_stats const *restrict stats,
+        bool last);
+
+/**
+ * Prints the JSON object of a kind of query.
+ */
+static void print_query_stats(
+        char const *name,
+        struct bench_query_stats const *restrict stats,
+        bool last);
+
+/**
+ * Returns the rate of count per second, or 0 if no time elapsed.
+ */
+static double per_second(double count, double seconds);
+
+/**
+ * Compares two movies by ID, for sorting.
+ */
+static int compare_movie(void const *left_ptr, void const *right_ptr);
+
+/**
+ * Compares two user IDs, for sorting.
+ */
+static int compare_id(void const *left_ptr, void const *right_ptr);
+
+/**
+ * Compares two tag names, for sorting.
+ */
+static int compare_name(void const *left_ptr, void const *right_ptr);
+
+/**
+ * Compares two latencies, for sorting.
+ */
+static int compare_latency(void const *left_ptr, void const *right_ptr);
+
+int main(int argc, char const *argv[])
+{
+    int exit_code = 0;
+    struct bench_options options;
+    struct database database;
+    struct database_stats stats;
+    struct bench_pool pool;
+    struct bench_rng rng;
+    struct bench_query_stats movie_stats, user_stats, topn_stats, tags_stats;
+    struct bench_query_stats topn_large_stats, movie_short_stats;
+    struct bench_query_stats complete_short_stats, raters_stats;
+    struct bench_query_stats topn_since_stats;
+    struct error error;
+    struct strbuf buf;
+    struct rusage usage;
+    struct trie_stats trie_stats_out;
+    double *latencies = NULL;
+    double load_seconds;
+    double peak_rss = 0;
+
+    if (!parse_args(argc, argv, &options)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    error_init(&error);
+    strbuf_init(&buf);
+
+    /* The paths of the CSV files are relative to the dataset directory. */
+    if (chdir(options.dir) < 0) {
+        error_set_code(&error, error_io);
+        error.data.io.sys_errno = errno;
+        error_set_context(&error, options.dir, false);
+        error_print(&error);
+        strbuf_destroy(&buf);
+        error_destroy(&error);
+        return 1;
+    }
+
+    pool.movies = NULL;
+    pool.users = NULL;
+    pool.tags = NULL;
+
+    database_load(&database, &options.database, &stats, &buf, &error);
+
+    if (error.code == error_none) {
+        pool_init(&pool, &database, &error);
+    }
+
+    if (error.code == error_none) {
+        latencies = moviedb_alloc(sizeof(*latencies), options.queries, &error);
+    }
+
+    if (error.code == error_none) {
+        /* Every kind of query gets the same workload for a given seed. */
+        bench_rng_init(&rng, options.seed);
+        run_queries(run_movie_query, &database, &pool, &rng, options.queries,
+                latencies, &movie_stats, &error);
+    }
+    if (error.code == error_none) {
+        bench_rng_init(&rng, options.seed + 1);
+        run_queries(run_user_query, &database, &pool, &rng, options.queries,
+                latencies, &user_stats, &error);
+    }
+    if (error.code == error_none) {
+        bench_rng_init(&rng, options.seed + 2);
+        run_queries(run_topn_query, &database, &pool, &rng, options.queries,
+                latencies, &topn_stats, &error);
+    }
+    if (error.code == error_none) {
+        bench_rng_init(&rng, options.seed + 3);
+        run_queries(run_tags_query, &database, &pool, &rng, options.queries,
+                latencies, &tags_stats, &error);
+    }
+    if (error.code == error_none) {
+        bench_rng_init(&rng, options.seed + 2);
+        run_queries(run_topn_large_query, &database, &pool, &rng,
+                options.queries, latencies, &topn_large_stats, &error);
+    }
+    if (error.code == error_none) {
+        bench_rng_init(&rng, options.seed + 4);
+        run_queries(run_movie_short_query, &database, &pool, &rng,
+                options.queries, latencies, &movie_short_stats, &error);
+    }
+    if (error.code == error_none) {
+        bench_rng_init(&rng, options.seed + 5);
+        run_queries(run_complete_short_query, &database, &pool, &rng,
+                options.queries, latencies, &complete_short_stats, &error);
+    }
+    if (error.code == error_none) {
+        bench_rng_init(&rng, options.seed + 6);
+        run_queries(run_raters_query, &database, &pool, &rng,
+                options.queries, latencies, &raters_stats, &error);
+    }
+    if (error.code == error_none) {
+        bench_rng_init(&rng, options.seed + 7);
+        run_queries(run_topn_since_query, &database, &pool, &rng,
+                options.queries, latencies, &topn_since_stats, &error);
+    }
+
+    if (error.code == error_none) {
+        if (database.title_index == database_title_trie) {
+            trie_stats(&database.trie_root, &trie_stats_out, &error);
+        } else {
+            trie_stats_out.nodes = 0;
+            trie_stats_out.bytes = titles_bytes(&database.titles);
+        }
+    }
+
+    if (error.code == error_none) {
+        if (getrusage(RUSAGE_SELF, &usage) == 0) {
+            /* Linux reports it in kibibytes. */
+            peak_rss = usage.ru_maxrss / 1024.0;
+        }
+
+        load_seconds = stats.movies.seconds + stats.ratings.seconds
+            + stats.tags.seconds + stats.index_seconds;
+
+        printf("{\n");
+        printf("  \"config\": {\"seed\": %lu, \"queries\": %lu, "
+                "\"threads\": %u, \"mmap\": %s, \"hash\": \"%s\", "
+                "\"csv_scan\": \"%s\", \"titles\": \"%s\"},\n",
+                (unsigned long) options.seed,
+                (unsigned long) options.queries,
+                options.database.threads,
+                options.database.use_mmap ? "true" : "false",
+                MOVIEDB_HASH_MODE,
+                csv_scan_impl,
+                database.title_index == database_title_trie ? "trie" : "dict");
+        printf("  \"dataset\": {\"movies\": %zu, \"users\": %zu, "
+                "\"tags\": %zu},\n",
+                pool.movies_length,
+                pool.users_length,
+                pool.tags_length);
+        printf("  \"load\": {\n");
+        print_load_stats("load_movies", &stats.movies, false);
+        print_load_stats("load_ratings", &stats.ratings, false);
+        print_load_stats("load_tags", &stats.tags, false);
+        printf("    \"index\": {\"seconds\": %.6f},\n",
+                stats.index_seconds);
+        printf("    \"total\": {\"seconds\": %.6f}\n", load_seconds);
+        printf("  },\n");
+        printf("  \"queries\": {\n");
+        print_query_stats("movie_query", &movie_stats, false);
+        print_query_stats("user_query", &user_stats, false);
+        print_query_stats("topn_query", &topn_stats, false);
+        print_query_stats("tags_query", &tags_stats, false);
+        print_query_stats("topn_query_large", &topn_large_stats, false);
+        print_query_stats("movie_query_short", &movie_short_stats, false);
+        print_query_stats("complete_query_short", &complete_short_stats,
+                false);
+        print_query_stats("raters_query", &raters_stats, false);
+        print_query_stats("topn_since_query", &topn_since_stats, true);
+        printf("  },\n");
+        printf("  \"memory\": {\"peak_rss_mib\": %.1f, \"arena_mib\": %.1f, "
+                "\"trie_nodes\": %zu, \"titles_mib\": %.1f, "
+                "\"raters_mib\": %.1f, \"timeline_mib\": %.1f}\n",
+                peak_rss,
+                database.arena.reserved / (1024.0 * 1024.0),
+                trie_stats_out.nodes,
+                trie_stats_out.bytes / (1024.0 * 1024.0),
+                raters_index_bytes(&database.raters) / (1024.0 * 1024.0),
+                timeline_index_bytes(&database.timeline) / (1024.0 * 1024.0));
+        printf("}\n");
+    }
+
+    if (error.code != error_none) {
+        error_print(&error);
+        exit_code = 1;
+    }
+
+    moviedb_free(latencies);
+    pool_destroy(&pool);
+    database_destroy(&database);
+    strbuf_destroy(&buf);
+    error_destroy(&error);
+
+    return exit_code;
+}
+
+static bool parse_args(
+        int argc,
+        char const *argv[],
+        struct bench_options *restrict options)
+{
+    int i = 1;
+    bool valid = true;
+    uint64_t threads;
+
+    options->dir = ".";
+    options->queries = 1000;
+    options->seed = BENCH_DEFAULT_SEED;
+    database_options_init(&options->database);
+    /* Load phases are what is measured, so the snapshot is never used. */
+    options->database.use_snapshot = false;
+
+    while (i < argc && valid) {
+        if (strcmp(argv[i], "--stdio") == 0) {
+            options->database.use_mmap = false;
+        } else if (i + 1 >= argc) {
+            /* Every other option takes an argument. */
+            valid = false;
+        } else if (strcmp(argv[i], "--dir") == 0) {
+            i++;
+            options->dir = argv[i];
+        } else if (strcmp(argv[i], "--queries") == 0) {
+            i++;
+            valid = bench_parse_count(argv[i], &options->queries)
+                && options->queries > 0;
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            i++;
+            valid = bench_parse_count(argv[i], &options->seed);
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            i++;
+            valid = bench_parse_count(argv[i], &threads)
+                && threads > 0
+                && threads <= 1024;
+            options->database.threads = threads;
+        } else if (strcmp(argv[i], "--titles") == 0) {
+            i++;
+            valid = database_parse_title_index(
+                    argv[i],
+                    &options->database.title_index);
+        } else {
+            valid = false;
+        }
+        i++;
+    }
+
+    return valid;
+}
+
+static void print_usage(char const *program)
+{
+    fprintf(stderr,
+            "Usage:\n    %s [--dir DIR] [--queries N] [--seed S] "
+            "[--threads N] [--titles trie|dict] [--stdio]\n\n",
+            program);
+    fputs("    --dir DIR       load DIR/data/*.csv (default: .)\n", stderr);
+    fputs("    --queries N     queries of each kind (default: 1000)\n",
+            stderr);
+    fputs("    --seed S        pseudo-random seed of the workload\n", stderr);
+    fputs("    --threads N     parse ratings with N threads (default: CPUs)\n",
+            stderr);
+    fputs("    --titles KIND   search titles in a trie (default) or a sorted\n"
+            "                    front-coded dictionary (dict)\n",
+            stderr);
+    fputs("    --stdio         read CSV files through stdio instead of mmap\n",
+            stderr);
+}
+
+static void pool_init(
+        struct bench_pool *restrict pool,
+        struct database const *restrict database,
+        struct error *restrict error)
+{
+    struct movies_iter movies_iter_state;
+    struct users_iter users_iter_state;
+    struct tags_iter tags_iter_state;
+    struct movie const *movie;
+    struct user const *user;
+    struct tag const *tag;
+    size_t i;
+
+    pool->movies_length = database->movies.length;
+    pool->users_length = database->users.length;
+    pool->tags_length = database->tags.length;
+
+    pool->movies = moviedb_alloc(
+            sizeof(*pool->movies),
+            pool->movies_length,
+            error);
+    if (error->code == error_none) {
+        pool->users = moviedb_alloc(
+                sizeof(*pool->users),
+                pool->users_length,
+                error);
+    }
+    if (error->code == error_none) {
+        pool->tags = moviedb_alloc(
+                sizeof(*pool->tags),
+                pool->tags_length,
+                error);
+    }
+
+    if (error->code == error_none) {
+        i = 0;
+        movies_iter(&database->movies, &movies_iter_state);
+        while ((movie = movies_next(&movies_iter_state)) != NULL) {
+            pool->movies[i++] = movie;
+        }
+        qsort(pool->movies,
+                pool->movies_length,
+                sizeof(*pool->movies),
+                compare_movie);
+
+        i = 0;
+        users_iter(&database->users, &users_iter_state);
+        while ((user = users_next(&users_iter_state)) != NULL) {
+            pool->users[i++] = user->id;
+        }
+        qsort(pool->users,
+                pool->users_length,
+                sizeof(*pool->users),
+                compare_id);
+
+        i = 0;
+        tags_iter(&database->tags, &tags_iter_state);
+        while ((tag = tags_next(&tags_iter_state)) != NULL) {
+            pool->tags[i++] = tag->name;
+        }
+        qsort(pool->tags, pool->tags_length, sizeof(*pool->tags), compare_name);
+    }
+}
+
+static void pool_destroy(struct bench_pool *restrict pool)
+{
+    moviedb_free(pool->movies);
+    moviedb_free(pool->users);
+    moviedb_free(pool->tags);
+    pool->movies = NULL;
+    pool->users = NULL;
+    pool->tags = NULL;
+}
+
+static void run_queries(
+        bench_query_fn query,
+        struct database const *restrict database,
+        struct bench_pool const *restrict pool,
+        struct bench_rng *restrict rng,
+        unsigned long count,
+        double *restrict latencies,
+        struct bench_query_stats *restrict stats_out,
+        struct error *restrict error)
+{
+    unsigned long i = 0;
+
+    stats_out->queries = 0;
+    stats_out->results = 0;
+    stats_out->seconds = 0;
+
+    while (i < count && error->code == error_none) {
+        stats_out->results += query(database, pool, rng, &latencies[i], error);
+        stats_out->seconds += latencies[i];
+        i++;
+    }
+
+    stats_out->queries = i;
+    qsort(latencies, i, sizeof(*latencies), compare_latency);
+    stats_out->p50 = percentile(latencies, i, 50);
+    stats_out->p99 = percentile(latencies, i, 99);
+}
+
+static size_t run_movie_query(
+        struct database const *restrict database,
+        struct bench_pool const *restrict pool,
+        struct bench_rng *restrict rng,
+        double *restrict seconds_out,
+        struct error *restrict error)
+{
+    struct movie_query_buf query_buf;
+    char prefix[MOVIE_PREFIX_MAX + 1];
+    char const *title;
+    size_t length;
+    size_t results = 0;
+    double then;
+
+    *seconds_out = 0;
+
+    if (pool->movies_length > 0) {
+        /* A prefix of a title between one and MOVIE_PREFIX_MAX bytes long. */
+        title = pool->movies[bench_rng_below(rng, pool->movies_length)]->title;
+        length = 1 + bench_rng_below(rng, MOVIE_PREFIX_MAX);
+        strncpy(prefix, title, length);
+        prefix[length] = 0;
+
+        then = timing_now();
+        movie_query_init(&query_buf);
+        movie_query(database, prefix, &query_buf, error);
+        results = query_buf.length;
+        movie_query_destroy(&query_buf);
+        *seconds_out = timing_now() - then;
+    }
+
+    return results;
+}
+
+static size_t run_movie_short_query(
+        struct database const *restrict database,
+        struct bench_pool const *restrict pool,
+        struct bench_rng *restrict rng,
+        double *restrict seconds_out,
+        struct error *restrict error)
+{
+    struct movie_query_buf query_buf;
+    char const *prefix;
+    size_t results;
+    double then;
+
+    prefix = short_prefixes[bench_rng_below(rng, SHORT_PREFIXES)];
+
+    then = timing_now();
+    movie_query_init(&query_buf);
+    movie_query(database, prefix, &query_buf, error);
+    results = query_buf.length;
+    movie_query_destroy(&query_buf);
+    *seconds_out = timing_now() - then;
+
+    return results;
+}
+
+static size_t run_complete_short_query(
+        struct database const *restrict database,
+        struct bench_pool const *restrict pool,
+        struct bench_rng *restrict rng,
+        double *restrict seconds_out,
+        struct error *restrict error)
+{
+    struct complete_query_buf query_buf;
+    char const *prefix;
+    double then;
+
+    prefix = short_prefixes[bench_rng_below(rng, SHORT_PREFIXES)];
+
+    then = timing_now();
+    complete_query(database, prefix, &query_buf);
+    *seconds_out = timing_now() - then;
+
+    return query_buf.length;
+}
+
+static size_t run_user_query(
+        struct database const *restrict database,
+        struct bench_pool const *restrict pool,
+        struct bench_rng *restrict rng,
+        double *restrict seconds_out,
+        struct error *restrict error)
+{
+    struct user_query_iter iter;
+    struct user_query_row row;
+    moviedb_id_t userid;
+    size_t results = 0;
+    double then;
+
+    *seconds_out = 0;
+
+    if (pool->users_length > 0) {
+        userid = pool->users[bench_rng_below(rng, pool->users_length)];
+
+        then = timing_now();
+        user_query_init(&iter, database, userid);
+        while (user_query_next(&iter, &row)) {
+            results++;
+        }
+        *seconds_out = timing_now() - then;
+    }
+
+    return results;
+}
+
+static size_t run_raters_query(
+        struct database const *restrict database,
+        struct bench_pool const *restrict pool,
+        struct bench_rng *restrict rng,
+        double *restrict seconds_out,
+        struct error *restrict error)
+{
+    struct raters_query_iter iter;
+    struct raters_query_row row;
+    moviedb_id_t movieid;
+    size_t results = 0;
+    double then;
+
+    *seconds_out = 0;
+
+    if (pool->movies_length > 0) {
+        movieid = pool->movies[bench_rng_below(rng, pool->movies_length)]->id;
+
+        then = timing_now();
+        raters_query_init(&iter, database, movieid);
+        while (raters_query_next(&iter, &row)) {
+            results++;
+        }
+        *seconds_out = timing_now() - then;
+    }
+
+    return results;
+}
+
+static size_t run_topn_query(
+        struct database const *restrict database,
+        struct bench_pool const *restrict pool,
+        struct bench_rng *restrict rng,
+        double *restrict seconds_out,
+        struct error *restrict error)
+{
+    return run_topn(database, rng, TOPN_COUNT, seconds_out, error);
+}
+
+static size_t run_topn_large_query(
+        struct database const *restrict database,
+        struct bench_pool const *restrict pool,
+        struct bench_rng *restrict rng,
+        double *restrict seconds_out,
+        struct error *restrict error)
+{
+    size_t count = TOPN_LARGE_COUNT;
+
+    if (count > pool->movies_length) {
+        count = pool->movies_length;
+    }
+
+    return run_topn(database, rng, count, seconds_out, error);
+}
+
+static size_t run_topn_since_query(
+        struct database const *restrict database,
+        struct bench_pool const *restrict pool,
+        struct bench_rng *restrict rng,
+        double *restrict seconds_out,
+        struct error *restrict error)
+{
+    struct topn_since_buf buf;
+    char const *genre;
+    unsigned long month;
+    size_t results = 0;
+    double then;
+
+    genre = bench_genres[bench_rng_below(rng, BENCH_GENRES)];
+    month = TOPN_SINCE_FIRST_MONTH + bench_rng_below(rng, TOPN_SINCE_MONTHS);
+
+    then = timing_now();
+    topn_since_init(&buf, TOPN_COUNT, error);
+    if (error->code == error_none) {
+        topn_since_query(database, genre, TOPN_MIN_RATINGS, month, &buf);
+        results = buf.length;
+        topn_since_destroy(&buf);
+    }
+    *seconds_out = timing_now() - then;
+
+    return results;
+}
+
+static size_t run_topn(
+        struct database const *restrict database,
+        struct bench_rng *restrict rng,
+        size_t count,
+        double *restrict seconds_out,
+        struct error *restrict error)
+{
+    struct topn_query_buf query_buf;
+    char const *genre;
+    size_t results = 0;
+    double then;
+
+    genre = bench_genres[bench_rng_below(rng, BENCH_GENRES)];
+
+    then = timing_now();
+    topn_query_init(&query_buf, count, error);
+    if (error->code == error_none) {
+        topn_query(database, genre, TOPN_MIN_RATINGS, topn_best_rated,
+                &query_buf);
+        results = query_buf.length;
+        topn_query_destroy(&query_buf);
+    }
+    *seconds_out = timing_now() - then;
+
+    return results;
+}
+
+static size_t run_tags_query(
+        struct database const *restrict database,
+        struct bench_pool const *restrict pool,
+        struct bench_rng *restrict rng,
+        double *restrict seconds_out,
+        struct error *restrict error)
+{
+    struct tags_query_input query_input;
+    struct tags_query_buf query_buf;
+    char const *names[2];
+    size_t count, i;
+    size_t results = 0;
+    double then;
+
+    *seconds_out = 0;
+
+    if (pool->tags_length > 0) {
+        count = 1 + bench_rng_below(rng, 2);
+        for (i = 0; i < count; i++) {
+            names[i] = pool->tags[bench_rng_below(rng, pool->tags_length)];
+        }
+
+        then = timing_now();
+        tags_query_input_init(&query_input, 2, error);
+        for (i = 0; i < count && error->code == error_none; i++) {
+            tags_query_input_add(&query_input, database, names[i], error);
+        }
+        if (error->code == error_none) {
+            tags_query_init(&query_buf);
+            tags_query(database, &query_input, &query_buf, error);
+            results = query_buf.length;
+            tags_query_destroy(&query_buf);
+        }
+        tags_query_input_destroy(&query_input);
+        *seconds_out = timing_now() - then;
+    }
+
+    return results;
+}
+
+static double percentile(
+        double const *restrict latencies,
+        unsigned long count,
+        unsigned percent)
+{
+    unsigned long rank;
+    double value = 0;
+
+    if (count > 0) {
+        /* Nearest rank: the smallest value with percent of values up to it. */
+        rank = (count * percent + 99) / 100;
+        if (rank == 0) {
+            rank = 1;
+        }
+        value = latencies[rank - 1];
+    }
+
+    return value;
+}
+
+static void print_load_stats(
+        char const *name,
+        struct database_file_stats const *restrict stats,
+        bool last)
+{
+    printf("    \"%s\": {\"seconds\": %.6f, \"rows\": %lu, "
+            "\"rows_per_second\": %.0f, \"mapped\": %s}%s\n",
+            name,
+            stats->seconds,
+            stats->rows,
+            per_second(stats->rows, stats->seconds),
+            stats->mapped ? "true" : "false",
+            last ? "" : ",");
+}
+
+static void print_query_stats(
+        char const *name,
+        struct bench_query_stats const *restrict stats,
+        bool last)
+{
+    printf("    \"%s\": {\"queries\": %lu, \"results\": %lu, "
+            "\"seconds\": %.6f, \"queries_per_second\": %.0f, "
+            "\"p50_us\": %.3f, \"p99_us\": %.3f}%s\n",
+            name,
+            stats->queries,
+            stats->results,
+            stats->seconds,
+            per_second(stats->queries, stats->seconds),
+            stats->p50 * 1e6,
+            stats->p99 * 1e6,
+            last ? "" : ",");
+}
+
+static double per_second(double count, double seconds)
+{
+    double rate = 0;
+
+    if (seconds > 0) {
+        rate = count / seconds;
+    }
+
+    return rate;
+}
+
+static int compare_movie(void const *left_ptr, void const *right_ptr)
+{
+    struct movie const *left = *(struct movie const *const *) left_ptr;
+    struct movie const *right = *(struct movie const *const *) right_ptr;
+
+    return (left->id > right->id) - (left->id < right->id);
+}
+
+static int compare_id(void const *left_ptr, void const *right_ptr)
+{
+    moviedb_id_t left = *(moviedb_id_t const *) left_ptr;
+    moviedb_id_t right = *(moviedb_id_t const *) right_ptr;
+
+    return (left > right) - (left < right);
+}
+
+static int compare_name(void const *left_ptr, void const *right_ptr)
+{
+    return strcmp(
+            *(char const *const *) left_ptr,
+            *(char const *const *) right_ptr);
+}
+
+static int compare_latency(void const *left_ptr, void const *right_ptr)
+{
+    double left = *(double const *) left_ptr;
+    double right = *(double const *) right_ptr;
+
+    return (left > right) - (left < right);
+}
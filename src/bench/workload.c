@@ -0,0 +1,51 @@
+#include <stdlib.h>
+#include <errno.h>
+#include "workload.h"
+
+char const *const bench_genres[BENCH_GENRES] = {
+    "Action",
+    "Adventure",
+    "Animation",
+    "Children",
+    "Comedy",
+    "Crime",
+    "Documentary",
+    "Drama",
+    "Fantasy",
+    "Film-Noir",
+    "Horror",
+    "IMAX",
+    "Musical",
+    "Mystery",
+    "Romance",
+    "Sci-Fi",
+    "Thriller",
+    "War",
+    "Western"
+};
+
+extern inline void bench_rng_init(
+        struct bench_rng *restrict rng,
+        uint64_t seed);
+
+extern inline uint64_t bench_rng_next(struct bench_rng *restrict rng);
+
+extern inline uint64_t bench_rng_below(
+        struct bench_rng *restrict rng,
+        uint64_t bound);
+
+extern inline double bench_rng_unit(struct bench_rng *restrict rng);
+
+bool bench_parse_count(char const *arg, uint64_t *restrict out)
+{
+    char *end;
+    bool valid;
+
+    errno = 0;
+    *out = strtoull(arg, &end, 10);
+
+    /* strtoull accepts a sign, which makes no sense for a count. */
+    valid = errno == 0 && end != arg && *end == 0 && *arg != '-' && *arg != '+';
+
+    return valid;
+}
@@ -0,0 +1,88 @@
+#ifndef MOVIEDB_BENCH_WORKLOAD_H
+#define MOVIEDB_BENCH_WORKLOAD_H 1
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * This file provides what the benchmark programs share: a seeded
+ * pseudo-random number generator, so workloads and synthetic datasets are
+ * reproducible across runs and machines, and the genres of the dataset.
+ */
+
+/**
+ * Default seed of the benchmark programs.
+ */
+#define BENCH_DEFAULT_SEED 0x5eed
+
+/**
+ * How many genres there are in bench_genres.
+ */
+#define BENCH_GENRES 19
+
+/**
+ * The genres of the MovieLens dataset, which the synthetic dataset uses and
+ * the top-N queries ask for.
+ */
+extern char const *const bench_genres[BENCH_GENRES];
+
+/**
+ * A xorshift64* pseudo-random number generator.
+ */
+struct bench_rng {
+    /**
+     * Current state, never zero. Only internal benchmark code is allowed to
+     * touch this.
+     */
+    uint64_t state;
+};
+
+/**
+ * Initializes the generator with the given seed. Any seed is valid.
+ */
+inline void bench_rng_init(struct bench_rng *restrict rng, uint64_t seed)
+{
+    /* Scrambles the seed, so close seeds diverge and zero is not a state. */
+    rng->state = (seed ^ 0x9e3779b97f4a7c15ULL) * 0xbf58476d1ce4e5b9ULL;
+    if (rng->state == 0) {
+        rng->state = 1;
+    }
+}
+
+/**
+ * Returns the next pseudo-random 64-bit number.
+ */
+inline uint64_t bench_rng_next(struct bench_rng *restrict rng)
+{
+    rng->state ^= rng->state >> 12;
+    rng->state ^= rng->state << 25;
+    rng->state ^= rng->state >> 27;
+
+    return rng->state * 0x2545f4914f6cdd1dULL;
+}
+
+/**
+ * Returns a pseudo-random number in the interval [0, bound). bound must not
+ * be zero.
+ */
+inline uint64_t bench_rng_below(struct bench_rng *restrict rng, uint64_t bound)
+{
+    return bench_rng_next(rng) % bound;
+}
+
+/**
+ * Returns a pseudo-random number in the interval [0, 1).
+ */
+inline double bench_rng_unit(struct bench_rng *restrict rng)
+{
+    return (bench_rng_next(rng) >> 11) / 9007199254740992.0;
+}
+
+/**
+ * Parses a non-negative decimal integer argument into out. Returns whether it
+ * is valid.
+ */
+bool bench_parse_count(char const *arg, uint64_t *restrict out);
+
+#endif
@@ -0,0 +1,1225 @@
+#include <string.h>
+#include "alloc.h"
+#include "bitmap.h"
+
+/**
+ * Mask of the low bits of an ID stored in a container.
+ */
+#define LOW_MASK ((UINT64_C(1) << BITMAP_CHUNK_BITS) - 1)
+
+/**
+ * How many times longer than the other array an array must be for the
+ * intersection to gallop through it instead of walking it.
+ */
+#define GALLOP_RATIO 8
+
+/**
+ * The operations bitmaps can be combined with.
+ */
+enum bitmap_op {
+    bitmap_op_and,
+    bitmap_op_or,
+    bitmap_op_andnot
+};
+
+/**
+ * Combines two bitmaps with the given operation into the output.
+ */
+static void combine(
+        struct bitmap *restrict out,
+        struct bitmap const *restrict left,
+        struct bitmap const *restrict right,
+        enum bitmap_op op,
+        struct error *restrict error);
+
+/**
+ * Combines two containers with the same key with the given operation,
+ * appending the result to the output if it is not empty. Scratch words are
+ * allocated on first use, and must be freed by the caller.
+ */
+static void combine_containers(
+        struct bitmap *restrict out,
+        struct bitmap_container const *restrict left,
+        struct bitmap_container const *restrict right,
+        enum bitmap_op op,
+        uint64_t **restrict scratch,
+        struct error *restrict error);
+
+/**
+ * Intersects two array containers, appending the result to the output.
+ */
+static void intersect_arrays(
+        struct bitmap *restrict out,
+        struct bitmap_container const *restrict left,
+        struct bitmap_container const *restrict right,
+        struct error *restrict error);
+
+/**
+ * Appends to the output an array container with the values of the given array
+ * container which are (if keep is true) or are not (if keep is false) in the
+ * other container.
+ */
+static void filter_array(
+        struct bitmap *restrict out,
+        struct bitmap_container const *restrict array,
+        struct bitmap_container const *restrict other,
+        bool keep,
+        struct error *restrict error);
+
+/**
+ * Appends to the output an array container owning the given values, or frees
+ * them if there is none.
+ */
+static void push_array(
+        struct bitmap *restrict out,
+        uint64_t key,
+        uint16_t *values,
+        uint32_t length,
+        struct error *restrict error);
+
+/**
+ * Appends to the output a copy of the given container.
+ */
+static void push_copy(
+        struct bitmap *restrict out,
+        struct bitmap_container const *restrict container,
+        struct error *restrict error);
+
+/**
+ * Appends the given container to the bitmap, which takes ownership of it. The
+ * container is destroyed on error.
+ */
+static void push(
+        struct bitmap *restrict bitmap,
+        struct bitmap_container *restrict container,
+        struct error *restrict error);
+
+/**
+ * Returns the index of the container with the given key, or of where it
+ * should be inserted.
+ */
+static size_t find(struct bitmap const *restrict bitmap, uint64_t key);
+
+/**
+ * Adds low bits to a container.
+ */
+static void container_add(
+        struct bitmap_container *restrict container,
+        uint16_t low,
+        struct error *restrict error);
+
+/**
+ * Tests whether the container has the given low bits.
+ */
+static bool container_contains(
+        struct bitmap_container const *restrict container,
+        uint16_t low);
+
+/**
+ * Converts the container to kind bitmap_bits.
+ */
+static void container_to_bits(
+        struct bitmap_container *restrict container,
+        struct error *restrict error);
+
+/**
+ * Returns the words of a bitmap equivalent to the container: its own if it is
+ * of kind bitmap_bits, or the given scratch words filled otherwise.
+ */
+static uint64_t const *container_words(
+        struct bitmap_container const *restrict container,
+        uint64_t *restrict scratch);
+
+/**
+ * Initializes a container of the given kind with the bits set in the given
+ * words, whose cardinality and number of runs are given.
+ */
+static void container_from_words(
+        struct bitmap_container *restrict container,
+        uint64_t key,
+        uint64_t const *restrict words,
+        enum bitmap_kind kind,
+        uint32_t cardinality,
+        uint32_t runs,
+        struct error *restrict error);
+
+/**
+ * Frees the storage of the container.
+ */
+static void container_destroy(struct bitmap_container *restrict container);
+
+/**
+ * Counts the bits set in the given words, and the runs they form.
+ */
+static void words_stats(
+        uint64_t const *restrict words,
+        uint32_t *restrict cardinality_out,
+        uint32_t *restrict runs_out);
+
+/**
+ * Returns the kind of container taking the least memory for the given
+ * cardinality and number of runs.
+ */
+static enum bitmap_kind best_kind(uint32_t cardinality, uint32_t runs);
+
+/**
+ * Returns the index of the first of the values, between low (inclusive) and
+ * high (exclusive), not less than the given value.
+ */
+static uint32_t lower_bound(
+        uint16_t const *restrict values,
+        uint32_t low,
+        uint32_t high,
+        uint16_t value);
+
+/**
+ * Like lower_bound, searching from the given start up to the given length, but
+ * first doubles the step until the value is passed, so the cost grows with the
+ * distance skipped, not with the length.
+ */
+static uint32_t gallop(
+        uint16_t const *restrict values,
+        uint32_t start,
+        uint32_t length,
+        uint16_t value);
+
+void bitmap_init(struct bitmap *restrict bitmap)
+{
+    bitmap->containers = NULL;
+    bitmap->length = 0;
+    bitmap->capacity = 0;
+}
+
+void bitmap_add(
+        struct bitmap *restrict bitmap,
+        moviedb_id_t id,
+        struct error *restrict error)
+{
+    uint64_t key = id >> BITMAP_CHUNK_BITS;
+    size_t index = bitmap->length;
+    struct bitmap_container container;
+
+    /* IDs added in order go to the last container, so it is tested first. */
+    if (index > 0 && bitmap->containers[index - 1].key >= key) {
+        index = find(bitmap, key);
+    }
+
+    if (index == bitmap->length || bitmap->containers[index].key != key) {
+        container.key = key;
+        container.kind = bitmap_array;
+        container.cardinality = 0;
+        container.length = 0;
+        container.capacity = 0;
+        container.data.values = NULL;
+
+        push(bitmap, &container, error);
+
+        if (error->code == error_none) {
+            /* Moves the new container from the end to its place. */
+            memmove(&bitmap->containers[index + 1],
+                    &bitmap->containers[index],
+                    sizeof(*bitmap->containers) * (bitmap->length - index - 1));
+            bitmap->containers[index] = container;
+        }
+    }
+
+    if (error->code == error_none) {
+        container_add(&bitmap->containers[index], id & LOW_MASK, error);
+    }
+}
+
+bool bitmap_contains(struct bitmap const *restrict bitmap, moviedb_id_t id)
+{
+    uint64_t key = id >> BITMAP_CHUNK_BITS;
+    size_t index = find(bitmap, key);
+
+    return index < bitmap->length
+        && bitmap->containers[index].key == key
+        && container_contains(&bitmap->containers[index], id & LOW_MASK);
+}
+
+size_t bitmap_cardinality(struct bitmap const *restrict bitmap)
+{
+    size_t i;
+    size_t cardinality = 0;
+
+    for (i = 0; i < bitmap->length; i++) {
+        cardinality += bitmap->containers[i].cardinality;
+    }
+
+    return cardinality;
+}
+
+void bitmap_optimize(
+        struct bitmap *restrict bitmap,
+        struct error *restrict error)
+{
+    size_t i;
+    uint32_t j;
+    uint32_t cardinality;
+    uint32_t runs;
+    enum bitmap_kind kind;
+    uint64_t *words = NULL;
+    uint16_t *values;
+    struct bitmap_container *container;
+    struct bitmap_container converted;
+
+    for (i = 0; i < bitmap->length && error->code == error_none; i++) {
+        container = &bitmap->containers[i];
+
+        /* Counts runs without converting, which is often not needed. */
+        if (container->kind == bitmap_array) {
+            runs = 0;
+            for (j = 0; j < container->length; j++) {
+                if (j == 0 || container->data.values[j - 1] + 1
+                        != container->data.values[j]) {
+                    runs++;
+                }
+            }
+        } else if (container->kind == bitmap_bits) {
+            words_stats(container->data.words, &cardinality, &runs);
+        } else {
+            runs = container->length;
+        }
+
+        kind = best_kind(container->cardinality, runs);
+
+        if (kind != container->kind) {
+            if (words == NULL) {
+                words = moviedb_alloc(sizeof(*words), BITMAP_WORDS, error);
+            }
+
+            if (error->code == error_none) {
+                container_from_words(
+                        &converted,
+                        container->key,
+                        container_words(container, words),
+                        kind,
+                        container->cardinality,
+                        runs,
+                        error);
+            }
+
+            if (error->code == error_none) {
+                container_destroy(container);
+                *container = converted;
+            }
+        } else if (kind == bitmap_array
+                && container->capacity > container->length) {
+            /* Gives back the room left for insertions. */
+            values = moviedb_realloc(
+                    container->data.values,
+                    sizeof(*values),
+                    container->length,
+                    error);
+
+            if (error->code == error_none) {
+                container->data.values = values;
+                container->capacity = container->length;
+            }
+        }
+    }
+
+    moviedb_free(words);
+}
+
+void bitmap_and(
+        struct bitmap *restrict out,
+        struct bitmap const *restrict left,
+        struct bitmap const *restrict right,
+        struct error *restrict error)
+{
+    combine(out, left, right, bitmap_op_and, error);
+}
+
+void bitmap_or(
+        struct bitmap *restrict out,
+        struct bitmap const *restrict left,
+        struct bitmap const *restrict right,
+        struct error *restrict error)
+{
+    combine(out, left, right, bitmap_op_or, error);
+}
+
+void bitmap_andnot(
+        struct bitmap *restrict out,
+        struct bitmap const *restrict left,
+        struct bitmap const *restrict right,
+        struct error *restrict error)
+{
+    combine(out, left, right, bitmap_op_andnot, error);
+}
+
+extern inline void bitmap_iter(
+        struct bitmap const *bitmap,
+        struct bitmap_iter *restrict iter_out);
+
+bool bitmap_next(
+        struct bitmap_iter *restrict iter,
+        moviedb_id_t *restrict id_out)
+{
+    bool found = false;
+    uint32_t low = 0;
+    struct bitmap_container const *container;
+
+    while (!found && iter->container < iter->bitmap->length) {
+        container = &iter->bitmap->containers[iter->container];
+
+        switch (container->kind) {
+            case bitmap_array:
+                if (iter->index < container->length) {
+                    low = container->data.values[iter->index];
+                    iter->index++;
+                    found = true;
+                }
+                break;
+            case bitmap_bits:
+                /* Pending holds the bits left of the word before index. */
+                while (iter->pending == 0 && iter->index < BITMAP_WORDS) {
+                    iter->pending = container->data.words[iter->index];
+                    iter->index++;
+                }
+                if (iter->pending != 0) {
+                    low = (iter->index - 1) * 64
+                        + __builtin_ctzll(iter->pending);
+                    iter->pending &= iter->pending - 1;
+                    found = true;
+                }
+                break;
+            case bitmap_runs:
+                /* Pending holds the next low bits of the run at index. */
+                if (iter->index < container->length) {
+                    low = container->data.runs[iter->index].start
+                        + iter->pending;
+                    if (low == container->data.runs[iter->index].last) {
+                        iter->index++;
+                        iter->pending = 0;
+                    } else {
+                        iter->pending++;
+                    }
+                    found = true;
+                }
+                break;
+        }
+
+        if (found) {
+            *id_out = (container->key << BITMAP_CHUNK_BITS) | low;
+        } else {
+            iter->container++;
+            iter->index = 0;
+            iter->pending = 0;
+        }
+    }
+
+    return found;
+}
+
+extern inline struct bitmap_container const *bitmap_containers(
+        struct bitmap const *restrict bitmap,
+        size_t *restrict length_out);
+
+size_t bitmap_container_bytes(
+        struct bitmap_container const *restrict container)
+{
+    size_t bytes = 0;
+
+    switch (container->kind) {
+        case bitmap_array:
+            bytes = sizeof(*container->data.values) * container->length;
+            break;
+        case bitmap_bits:
+            bytes = sizeof(*container->data.words) * BITMAP_WORDS;
+            break;
+        case bitmap_runs:
+            bytes = sizeof(*container->data.runs) * container->length;
+            break;
+    }
+
+    return bytes;
+}
+
+void const *bitmap_container_data(
+        struct bitmap_container const *restrict container)
+{
+    void const *data = NULL;
+
+    switch (container->kind) {
+        case bitmap_array:
+            data = container->data.values;
+            break;
+        case bitmap_bits:
+            data = container->data.words;
+            break;
+        case bitmap_runs:
+            data = container->data.runs;
+            break;
+    }
+
+    return data;
+}
+
+bool bitmap_container_valid(
+        struct bitmap_container const *restrict container,
+        void const *restrict data,
+        moviedb_id_t bound)
+{
+    uint16_t const *values = data;
+    uint64_t const *words = data;
+    struct bitmap_run const *runs = data;
+    uint32_t i;
+    uint32_t cardinality = 0;
+    uint32_t last = 0;
+    bool valid = container->cardinality > 0
+        && container->key <= bound >> BITMAP_CHUNK_BITS;
+
+    if (valid && container->kind == bitmap_array) {
+        valid = container->length == container->cardinality
+            && container->length <= BITMAP_ARRAY_MAX;
+        for (i = 1; valid && i < container->length; i++) {
+            valid = values[i - 1] < values[i];
+        }
+        if (valid) {
+            last = values[container->length - 1];
+        }
+    } else if (valid && container->kind == bitmap_bits) {
+        valid = container->length == BITMAP_WORDS;
+        for (i = 0; valid && i < BITMAP_WORDS; i++) {
+            if (words[i] != 0) {
+                cardinality += __builtin_popcountll(words[i]);
+                last = i * 64 + 63 - __builtin_clzll(words[i]);
+            }
+        }
+        valid = valid && cardinality == container->cardinality;
+    } else if (valid && container->kind == bitmap_runs) {
+        valid = container->length > 0;
+        /* Runs are sorted, and apart, as bitmap_optimize makes them. */
+        for (i = 0; valid && i < container->length; i++) {
+            valid = runs[i].start <= runs[i].last
+                && (i == 0 || runs[i - 1].last + 1 < runs[i].start);
+            cardinality += runs[i].last - runs[i].start + 1;
+        }
+        valid = valid && cardinality == container->cardinality;
+        if (valid) {
+            last = runs[container->length - 1].last;
+        }
+    } else {
+        valid = false;
+    }
+
+    return valid
+        && ((container->key << BITMAP_CHUNK_BITS) | last) < bound;
+}
+
+void bitmap_append(
+        struct bitmap *restrict bitmap,
+        struct bitmap_container const *restrict container,
+        void const *restrict data,
+        struct error *restrict error)
+{
+    struct bitmap_container copy = *container;
+    size_t bytes = bitmap_container_bytes(container);
+    void *storage = moviedb_alloc(1, bytes, error);
+
+    if (error->code == error_none) {
+        memcpy(storage, data, bytes);
+        copy.capacity = copy.length;
+
+        switch (copy.kind) {
+            case bitmap_array:
+                copy.data.values = storage;
+                break;
+            case bitmap_bits:
+                copy.data.words = storage;
+                break;
+            case bitmap_runs:
+                copy.data.runs = storage;
+                break;
+        }
+
+        push(bitmap, &copy, error);
+    }
+}
+
+void bitmap_destroy(struct bitmap *restrict bitmap)
+{
+    size_t i;
+
+    for (i = 0; i < bitmap->length; i++) {
+        container_destroy(&bitmap->containers[i]);
+    }
+
+    moviedb_free(bitmap->containers);
+    bitmap->containers = NULL;
+    bitmap->length = 0;
+    bitmap->capacity = 0;
+}
+
+static void combine(
+        struct bitmap *restrict out,
+        struct bitmap const *restrict left,
+        struct bitmap const *restrict right,
+        enum bitmap_op op,
+        struct error *restrict error)
+{
+    size_t i = 0, j = 0;
+    uint64_t *scratch = NULL;
+
+    bitmap_destroy(out);
+
+    /* Merges the containers of both bitmaps by key. */
+    while (error->code == error_none
+            && (i < left->length || j < right->length)) {
+        if (j == right->length
+                || (i < left->length
+                    && left->containers[i].key < right->containers[j].key)) {
+            /* Only on the left. */
+            if (op != bitmap_op_and) {
+                push_copy(out, &left->containers[i], error);
+            }
+            i++;
+        } else if (i == left->length
+                || right->containers[j].key < left->containers[i].key) {
+            /* Only on the right. */
+            if (op == bitmap_op_or) {
+                push_copy(out, &right->containers[j], error);
+            }
+            j++;
+        } else {
+            combine_containers(
+                    out,
+                    &left->containers[i],
+                    &right->containers[j],
+                    op,
+                    &scratch,
+                    error);
+            i++;
+            j++;
+        }
+    }
+
+    moviedb_free(scratch);
+}
+
+static void combine_containers(
+        struct bitmap *restrict out,
+        struct bitmap_container const *restrict left,
+        struct bitmap_container const *restrict right,
+        enum bitmap_op op,
+        uint64_t **restrict scratch,
+        struct error *restrict error)
+{
+    size_t i;
+    uint32_t cardinality;
+    uint32_t runs;
+    uint64_t const *left_words;
+    uint64_t const *right_words;
+    uint64_t *out_words;
+    struct bitmap_container container;
+    bool by_words = false;
+
+    if (op == bitmap_op_and
+            && left->kind == bitmap_array
+            && right->kind == bitmap_array) {
+        intersect_arrays(out, left, right, error);
+    } else if (op == bitmap_op_and && left->kind == bitmap_array) {
+        filter_array(out, left, right, true, error);
+    } else if (op == bitmap_op_and && right->kind == bitmap_array) {
+        filter_array(out, right, left, true, error);
+    } else if (op == bitmap_op_andnot && left->kind == bitmap_array) {
+        filter_array(out, left, right, false, error);
+    } else {
+        by_words = true;
+        if (*scratch == NULL) {
+            *scratch = moviedb_alloc(
+                    sizeof(**scratch),
+                    3 * BITMAP_WORDS,
+                    error);
+        }
+    }
+
+    if (by_words && error->code == error_none) {
+        /* Everything else is done a word at a time. */
+        left_words = container_words(left, *scratch);
+        right_words = container_words(right, *scratch + BITMAP_WORDS);
+        out_words = *scratch + 2 * BITMAP_WORDS;
+
+        switch (op) {
+            case bitmap_op_and:
+                for (i = 0; i < BITMAP_WORDS; i++) {
+                    out_words[i] = left_words[i] & right_words[i];
+                }
+                break;
+            case bitmap_op_or:
+                for (i = 0; i < BITMAP_WORDS; i++) {
+                    out_words[i] = left_words[i] | right_words[i];
+                }
+                break;
+            case bitmap_op_andnot:
+                for (i = 0; i < BITMAP_WORDS; i++) {
+                    out_words[i] = left_words[i] & ~right_words[i];
+                }
+                break;
+        }
+
+        words_stats(out_words, &cardinality, &runs);
+
+        if (cardinality > 0) {
+            container_from_words(
+                    &container,
+                    left->key,
+                    out_words,
+                    best_kind(cardinality, runs),
+                    cardinality,
+                    runs,
+                    error);
+
+            if (error->code == error_none) {
+                push(out, &container, error);
+            }
+        }
+    }
+}
+
+static void intersect_arrays(
+        struct bitmap *restrict out,
+        struct bitmap_container const *restrict left,
+        struct bitmap_container const *restrict right,
+        struct error *restrict error)
+{
+    uint32_t i;
+    uint32_t index = 0;
+    uint32_t length = 0;
+    uint16_t *values;
+    struct bitmap_container const *small = left;
+    struct bitmap_container const *large = right;
+    bool gallops;
+
+    if (small->length > large->length) {
+        small = right;
+        large = left;
+    }
+
+    gallops = large->length / GALLOP_RATIO > small->length;
+    values = moviedb_alloc(sizeof(*values), small->length, error);
+
+    for (i = 0; error->code == error_none
+            && i < small->length
+            && index < large->length; i++) {
+        if (gallops) {
+            index = gallop(
+                    large->data.values,
+                    index,
+                    large->length,
+                    small->data.values[i]);
+        } else {
+            /* Close in size, so walking both arrays is cheapest. */
+            while (index < large->length
+                    && large->data.values[index] < small->data.values[i]) {
+                index++;
+            }
+        }
+
+        if (index < large->length
+                && large->data.values[index] == small->data.values[i]) {
+            values[length] = small->data.values[i];
+            length++;
+            index++;
+        }
+    }
+
+    if (error->code == error_none) {
+        push_array(out, left->key, values, length, error);
+    }
+}
+
+static void filter_array(
+        struct bitmap *restrict out,
+        struct bitmap_container const *restrict array,
+        struct bitmap_container const *restrict other,
+        bool keep,
+        struct error *restrict error)
+{
+    uint32_t i;
+    uint32_t length = 0;
+    uint16_t *values;
+
+    values = moviedb_alloc(sizeof(*values), array->length, error);
+
+    if (error->code == error_none) {
+        for (i = 0; i < array->length; i++) {
+            if (container_contains(other, array->data.values[i]) == keep) {
+                values[length] = array->data.values[i];
+                length++;
+            }
+        }
+
+        push_array(out, array->key, values, length, error);
+    }
+}
+
+static void push_array(
+        struct bitmap *restrict out,
+        uint64_t key,
+        uint16_t *values,
+        uint32_t length,
+        struct error *restrict error)
+{
+    struct bitmap_container container;
+
+    if (length > 0) {
+        container.key = key;
+        container.kind = bitmap_array;
+        container.cardinality = length;
+        container.length = length;
+        container.capacity = length;
+        container.data.values = values;
+
+        push(out, &container, error);
+    } else {
+        moviedb_free(values);
+    }
+}
+
+static void push_copy(
+        struct bitmap *restrict out,
+        struct bitmap_container const *restrict container,
+        struct error *restrict error)
+{
+    struct bitmap_container copy = *container;
+
+    switch (container->kind) {
+        case bitmap_array:
+            copy.capacity = copy.length;
+            copy.data.values = moviedb_alloc(
+                    sizeof(*copy.data.values),
+                    copy.length,
+                    error);
+            if (error->code == error_none) {
+                memcpy(copy.data.values,
+                        container->data.values,
+                        sizeof(*copy.data.values) * copy.length);
+            }
+            break;
+        case bitmap_bits:
+            copy.data.words = moviedb_alloc(
+                    sizeof(*copy.data.words),
+                    BITMAP_WORDS,
+                    error);
+            if (error->code == error_none) {
+                memcpy(copy.data.words,
+                        container->data.words,
+                        sizeof(*copy.data.words) * BITMAP_WORDS);
+            }
+            break;
+        case bitmap_runs:
+            copy.capacity = copy.length;
+            copy.data.runs = moviedb_alloc(
+                    sizeof(*copy.data.runs),
+                    copy.length,
+                    error);
+            if (error->code == error_none) {
+                memcpy(copy.data.runs,
+                        container->data.runs,
+                        sizeof(*copy.data.runs) * copy.length);
+            }
+            break;
+    }
+
+    if (error->code == error_none) {
+        push(out, &copy, error);
+    }
+}
+
+static void push(
+        struct bitmap *restrict bitmap,
+        struct bitmap_container *restrict container,
+        struct error *restrict error)
+{
+    size_t new_cap;
+    struct bitmap_container *new_containers;
+
+    if (bitmap->length == bitmap->capacity) {
+        /* Doubles capacity, handles the case where capacity == 0. */
+        new_cap = bitmap->capacity * 2;
+        if (new_cap == 0) {
+            new_cap = 4;
+        }
+
+        new_containers = moviedb_realloc(
+                bitmap->containers,
+                sizeof(*new_containers),
+                new_cap,
+                error);
+
+        if (error->code == error_none) {
+            bitmap->containers = new_containers;
+            bitmap->capacity = new_cap;
+        }
+    }
+
+    if (error->code == error_none) {
+        bitmap->containers[bitmap->length] = *container;
+        bitmap->length++;
+    } else {
+        container_destroy(container);
+    }
+}
+
+static size_t find(struct bitmap const *restrict bitmap, uint64_t key)
+{
+    size_t low = 0;
+    size_t high = bitmap->length;
+    size_t mid;
+
+    while (low < high) {
+        mid = low + (high - low) / 2;
+        if (bitmap->containers[mid].key < key) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+static void container_add(
+        struct bitmap_container *restrict container,
+        uint16_t low,
+        struct error *restrict error)
+{
+    uint32_t index = 0;
+    uint32_t new_cap;
+    uint16_t *new_values;
+    uint64_t *word;
+
+    if (container->kind == bitmap_array) {
+        index = lower_bound(container->data.values, 0, container->length, low);
+        if (index < container->length && container->data.values[index] == low) {
+            /* Already there. */
+            index = UINT32_MAX;
+        } else if (container->cardinality == BITMAP_ARRAY_MAX) {
+            container_to_bits(container, error);
+        }
+    } else if (container->kind == bitmap_runs) {
+        /* Runs are only made by bitmap_optimize, so this is rare. */
+        container_to_bits(container, error);
+    }
+
+    if (error->code == error_none
+            && container->kind == bitmap_array
+            && index != UINT32_MAX) {
+        if (container->length == container->capacity) {
+            /* Doubles capacity, handles the case where capacity == 0. */
+            new_cap = container->capacity * 2;
+            if (new_cap == 0) {
+                new_cap = 4;
+            }
+
+            new_values = moviedb_realloc(
+                    container->data.values,
+                    sizeof(*new_values),
+                    new_cap,
+                    error);
+
+            if (error->code == error_none) {
+                container->data.values = new_values;
+                container->capacity = new_cap;
+            }
+        }
+
+        if (error->code == error_none) {
+            memmove(&container->data.values[index + 1],
+                    &container->data.values[index],
+                    sizeof(*new_values) * (container->length - index));
+            container->data.values[index] = low;
+            container->length++;
+            container->cardinality++;
+        }
+    } else if (error->code == error_none
+            && container->kind == bitmap_bits) {
+        word = &container->data.words[low / 64];
+        if ((*word & (UINT64_C(1) << (low % 64))) == 0) {
+            *word |= UINT64_C(1) << (low % 64);
+            container->cardinality++;
+        }
+    }
+}
+
+static bool container_contains(
+        struct bitmap_container const *restrict container,
+        uint16_t low)
+{
+    uint32_t index;
+    uint32_t high;
+    uint32_t mid;
+    bool found = false;
+
+    switch (container->kind) {
+        case bitmap_array:
+            index = lower_bound(
+                    container->data.values,
+                    0,
+                    container->length,
+                    low);
+            found = index < container->length
+                && container->data.values[index] == low;
+            break;
+        case bitmap_bits:
+            found = (container->data.words[low / 64] >> (low % 64)) & 1;
+            break;
+        case bitmap_runs:
+            /* Finds the first run not ending before the low bits. */
+            index = 0;
+            high = container->length;
+            while (index < high) {
+                mid = index + (high - index) / 2;
+                if (container->data.runs[mid].last < low) {
+                    index = mid + 1;
+                } else {
+                    high = mid;
+                }
+            }
+            found = index < container->length
+                && container->data.runs[index].start <= low;
+            break;
+    }
+
+    return found;
+}
+
+static void container_to_bits(
+        struct bitmap_container *restrict container,
+        struct error *restrict error)
+{
+    uint64_t *words = moviedb_alloc(sizeof(*words), BITMAP_WORDS, error);
+
+    if (error->code == error_none) {
+        container_words(container, words);
+        container_destroy(container);
+        container->kind = bitmap_bits;
+        container->length = BITMAP_WORDS;
+        container->capacity = BITMAP_WORDS;
+        container->data.words = words;
+    }
+}
+
+static uint64_t const *container_words(
+        struct bitmap_container const *restrict container,
+        uint64_t *restrict scratch)
+{
+    uint32_t i;
+    uint32_t first, last;
+    uint64_t const *words = scratch;
+
+    if (container->kind == bitmap_bits) {
+        words = container->data.words;
+    } else {
+        memset(scratch, 0, sizeof(*scratch) * BITMAP_WORDS);
+    }
+
+    if (container->kind == bitmap_array) {
+        for (i = 0; i < container->length; i++) {
+            first = container->data.values[i];
+            scratch[first / 64] |= UINT64_C(1) << (first % 64);
+        }
+    } else if (container->kind == bitmap_runs) {
+        for (i = 0; i < container->length; i++) {
+            first = container->data.runs[i].start;
+            last = container->data.runs[i].last;
+
+            /* Fills the first word, the whole words between, and the last. */
+            if (first / 64 == last / 64) {
+                scratch[first / 64] |= (~UINT64_C(0) << (first % 64))
+                    & (~UINT64_C(0) >> (63 - last % 64));
+            } else {
+                scratch[first / 64] |= ~UINT64_C(0) << (first % 64);
+                memset(&scratch[first / 64 + 1],
+                        0xff,
+                        sizeof(*scratch) * (last / 64 - first / 64 - 1));
+                scratch[last / 64] |= ~UINT64_C(0) >> (63 - last % 64);
+            }
+        }
+    }
+
+    return words;
+}
+
+static void container_from_words(
+        struct bitmap_container *restrict container,
+        uint64_t key,
+        uint64_t const *restrict words,
+        enum bitmap_kind kind,
+        uint32_t cardinality,
+        uint32_t runs,
+        struct error *restrict error)
+{
+    uint32_t i;
+    uint32_t length = 0, ends = 0;
+    uint64_t word, starts_bits, ends_bits, carry = 0, next;
+
+    container->key = key;
+    container->kind = kind;
+    container->cardinality = cardinality;
+
+    switch (kind) {
+        case bitmap_array:
+            container->length = cardinality;
+            container->data.values = moviedb_alloc(
+                    sizeof(*container->data.values),
+                    cardinality,
+                    error);
+            for (i = 0; error->code == error_none && i < BITMAP_WORDS; i++) {
+                word = words[i];
+                while (word != 0) {
+                    container->data.values[length] =
+                        i * 64 + __builtin_ctzll(word);
+                    length++;
+                    word &= word - 1;
+                }
+            }
+            break;
+        case bitmap_bits:
+            container->length = BITMAP_WORDS;
+            container->data.words = moviedb_alloc(
+                    sizeof(*container->data.words),
+                    BITMAP_WORDS,
+                    error);
+            if (error->code == error_none) {
+                memcpy(container->data.words,
+                        words,
+                        sizeof(*words) * BITMAP_WORDS);
+            }
+            break;
+        case bitmap_runs:
+            container->length = runs;
+            container->data.runs = moviedb_alloc(
+                    sizeof(*container->data.runs),
+                    runs,
+                    error);
+            /*
+             * A run starts at a set bit whose previous bit is clear, and ends
+             * at a set bit whose next bit is clear. Starts and ends alternate.
+             */
+            for (i = 0; error->code == error_none && i < BITMAP_WORDS; i++) {
+                word = words[i];
+                next = i + 1 < BITMAP_WORDS ? words[i + 1] & 1 : 0;
+                starts_bits = word & ~((word << 1) | carry);
+                ends_bits = word & ~((word >> 1) | (next << 63));
+                carry = word >> 63;
+
+                while (starts_bits != 0) {
+                    container->data.runs[length].start =
+                        i * 64 + __builtin_ctzll(starts_bits);
+                    length++;
+                    starts_bits &= starts_bits - 1;
+                }
+                while (ends_bits != 0) {
+                    container->data.runs[ends].last =
+                        i * 64 + __builtin_ctzll(ends_bits);
+                    ends++;
+                    ends_bits &= ends_bits - 1;
+                }
+            }
+            break;
+    }
+
+    container->capacity = container->length;
+}
+
+static void container_destroy(struct bitmap_container *restrict container)
+{
+    switch (container->kind) {
+        case bitmap_array:
+            moviedb_free(container->data.values);
+            break;
+        case bitmap_bits:
+            moviedb_free(container->data.words);
+            break;
+        case bitmap_runs:
+            moviedb_free(container->data.runs);
+            break;
+    }
+}
+
+static void words_stats(
+        uint64_t const *restrict words,
+        uint32_t *restrict cardinality_out,
+        uint32_t *restrict runs_out)
+{
+    size_t i;
+    uint64_t carry = 0;
+
+    *cardinality_out = 0;
+    *runs_out = 0;
+
+    for (i = 0; i < BITMAP_WORDS; i++) {
+        *cardinality_out += __builtin_popcountll(words[i]);
+        /* Counts the set bits whose previous bit is clear. */
+        *runs_out += __builtin_popcountll(
+                words[i] & ~((words[i] << 1) | carry));
+        carry = words[i] >> 63;
+    }
+}
+
+static enum bitmap_kind best_kind(uint32_t cardinality, uint32_t runs)
+{
+    enum bitmap_kind kind = bitmap_bits;
+    size_t size = sizeof(uint64_t) * BITMAP_WORDS;
+
+    if (cardinality <= BITMAP_ARRAY_MAX
+            && sizeof(uint16_t) * cardinality < size) {
+        kind = bitmap_array;
+        size = sizeof(uint16_t) * cardinality;
+    }
+
+    if (sizeof(struct bitmap_run) * runs < size) {
+        kind = bitmap_runs;
+    }
+
+    return kind;
+}
+
+static uint32_t lower_bound(
+        uint16_t const *restrict values,
+        uint32_t low,
+        uint32_t high,
+        uint16_t value)
+{
+    uint32_t mid;
+
+    while (low < high) {
+        mid = low + (high - low) / 2;
+        if (values[mid] < value) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+static uint32_t gallop(
+        uint16_t const *restrict values,
+        uint32_t start,
+        uint32_t length,
+        uint16_t value)
+{
+    uint32_t step = 1;
+    uint32_t low = start;
+    uint32_t high = length;
+
+    /* Values up to low are all less than the value. */
+    while (step < length - start && values[start + step] < value) {
+        low = start + step;
+        step *= 2;
+    }
+
+    /* Only the values up to the last step are left to search. */
+    if (step < length - start) {
+        high = start + step + 1;
+    }
+
+    return lower_bound(values, low, high, value);
+}
@@ -0,0 +1,293 @@
+#ifndef MOVIEDB_BITMAP_H
+#define MOVIEDB_BITMAP_H 1
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "error.h"
+#include "id/def.h"
+
+/**
+ * This file provides compressed bitmaps of IDs, in the style of roaring
+ * bitmaps. IDs are split by their high bits into chunks of 65536 IDs, and the
+ * low bits of each chunk are stored in a container of whichever kind is the
+ * smallest: a sorted array for sparse chunks, a plain bitmap for dense chunks,
+ * or a list of runs for chunks of consecutive IDs. Bitmaps are combined with
+ * AND, OR and AND NOT one chunk at a time, mostly as bitwise operations over
+ * 64-bit words.
+ */
+
+/**
+ * How many low bits of an ID are stored in a container.
+ */
+#define BITMAP_CHUNK_BITS 16
+
+/**
+ * How many 64-bit words a container of kind bitmap_bits has.
+ */
+#define BITMAP_WORDS ((1 << BITMAP_CHUNK_BITS) / 64)
+
+/**
+ * Maximum cardinality of a container of kind bitmap_array. Past this, an array
+ * takes more memory than a bitmap.
+ */
+#define BITMAP_ARRAY_MAX 4096
+
+/**
+ * The kind of a container.
+ */
+enum bitmap_kind {
+    /**
+     * A sorted array of the low bits of the IDs.
+     */
+    bitmap_array,
+    /**
+     * A bitmap, with a bit for each possible low bits.
+     */
+    bitmap_bits,
+    /**
+     * A sorted array of runs of consecutive low bits.
+     */
+    bitmap_runs
+};
+
+/**
+ * A run of consecutive low bits, in a container of kind bitmap_runs.
+ */
+struct bitmap_run {
+    /**
+     * The first low bits of the run.
+     */
+    uint16_t start;
+    /**
+     * The last low bits of the run, inclusive.
+     */
+    uint16_t last;
+};
+
+/**
+ * A container, holding the IDs of a chunk.
+ */
+struct bitmap_container {
+    /**
+     * The high bits shared by all IDs of the container. Only internal bitmap
+     * code is allowed to touch this.
+     */
+    uint64_t key;
+    /**
+     * How the IDs are stored. Only internal bitmap code is allowed to touch
+     * this.
+     */
+    enum bitmap_kind kind;
+    /**
+     * How many IDs the container has. Only internal bitmap code is allowed to
+     * touch this.
+     */
+    uint32_t cardinality;
+    /**
+     * How many values or runs are stored, for arrays and runs. Only internal
+     * bitmap code is allowed to touch this.
+     */
+    uint32_t length;
+    /**
+     * How many values or runs can be stored, for arrays and runs. Only
+     * internal bitmap code is allowed to touch this.
+     */
+    uint32_t capacity;
+    /**
+     * The storage, depending on the kind. Only internal bitmap code is allowed
+     * to touch this.
+     */
+    union {
+        uint16_t *values;
+        uint64_t *words;
+        struct bitmap_run *runs;
+    } data;
+};
+
+/**
+ * A compressed bitmap of IDs.
+ */
+struct bitmap {
+    /**
+     * Array of containers, sorted by key. Only internal bitmap code is allowed
+     * to touch this.
+     */
+    struct bitmap_container *containers;
+    /**
+     * How many containers there are. Only internal bitmap code is allowed to
+     * touch this.
+     */
+    size_t length;
+    /**
+     * How many containers can be stored. Only internal bitmap code is allowed
+     * to touch this.
+     */
+    size_t capacity;
+};
+
+/**
+ * Iterator over the IDs of a bitmap, in ascending order.
+ */
+struct bitmap_iter {
+    /**
+     * The bitmap being iterated over. Only internal bitmap code is allowed to
+     * touch this.
+     */
+    struct bitmap const *bitmap;
+    /**
+     * Index of the current container. Only internal bitmap code is allowed to
+     * touch this.
+     */
+    size_t container;
+    /**
+     * Index of the next value, word or run of the current container. Only
+     * internal bitmap code is allowed to touch this.
+     */
+    uint32_t index;
+    /**
+     * The bits of the current word not returned yet, for bitmaps, or the next
+     * low bits of the current run, for runs. Only internal bitmap code is
+     * allowed to touch this.
+     */
+    uint64_t pending;
+};
+
+/**
+ * Initializes an empty bitmap. No memory is allocated until an ID is added.
+ */
+void bitmap_init(struct bitmap *restrict bitmap);
+
+/**
+ * Adds an ID to the bitmap. Does nothing if it is there already. Adding IDs in
+ * ascending order is the fastest.
+ */
+void bitmap_add(
+        struct bitmap *restrict bitmap,
+        moviedb_id_t id,
+        struct error *restrict error);
+
+/**
+ * Tests whether the given ID is in the bitmap.
+ */
+bool bitmap_contains(struct bitmap const *restrict bitmap, moviedb_id_t id);
+
+/**
+ * Returns how many IDs are in the bitmap.
+ */
+size_t bitmap_cardinality(struct bitmap const *restrict bitmap);
+
+/**
+ * Converts every container to the kind that takes the least memory. Meant to
+ * be called once all IDs are added.
+ */
+void bitmap_optimize(
+        struct bitmap *restrict bitmap,
+        struct error *restrict error);
+
+/**
+ * Replaces the contents of the output with the IDs in both bitmaps. The output
+ * must be initialized, and must not be one of the inputs.
+ */
+void bitmap_and(
+        struct bitmap *restrict out,
+        struct bitmap const *restrict left,
+        struct bitmap const *restrict right,
+        struct error *restrict error);
+
+/**
+ * Replaces the contents of the output with the IDs in any of the bitmaps. The
+ * output must be initialized, and must not be one of the inputs.
+ */
+void bitmap_or(
+        struct bitmap *restrict out,
+        struct bitmap const *restrict left,
+        struct bitmap const *restrict right,
+        struct error *restrict error);
+
+/**
+ * Replaces the contents of the output with the IDs in the left bitmap but not
+ * in the right one. The output must be initialized, and must not be one of the
+ * inputs.
+ */
+void bitmap_andnot(
+        struct bitmap *restrict out,
+        struct bitmap const *restrict left,
+        struct bitmap const *restrict right,
+        struct error *restrict error);
+
+/**
+ * Initializes an iterator over the given bitmap.
+ */
+inline void bitmap_iter(
+        struct bitmap const *bitmap,
+        struct bitmap_iter *restrict iter_out)
+{
+    iter_out->bitmap = bitmap;
+    iter_out->container = 0;
+    iter_out->index = 0;
+    iter_out->pending = 0;
+}
+
+/**
+ * Finds the next ID of the bitmap, using the given iterator. Returns whether
+ * there was an ID. If there was, it is placed in id_out.
+ */
+bool bitmap_next(
+        struct bitmap_iter *restrict iter,
+        moviedb_id_t *restrict id_out);
+
+/**
+ * Returns the containers of the bitmap, sorted by key, writing how many there
+ * are into length_out, e.g. to write them into a snapshot.
+ */
+inline struct bitmap_container const *bitmap_containers(
+        struct bitmap const *restrict bitmap,
+        size_t *restrict length_out)
+{
+    *length_out = bitmap->length;
+    return bitmap->containers;
+}
+
+/**
+ * Returns how many bytes the storage of the given container takes, as given by
+ * its kind and length, or zero if its kind is unknown.
+ */
+size_t bitmap_container_bytes(
+        struct bitmap_container const *restrict container);
+
+/**
+ * Returns the storage of the given container, of bitmap_container_bytes bytes.
+ */
+void const *bitmap_container_data(
+        struct bitmap_container const *restrict container);
+
+/**
+ * Tests whether the given container, read back e.g. from a snapshot, with the
+ * given storage in place of its own, is well formed: its kind, length and
+ * cardinality agree with the storage, its values are sorted, and it holds no ID
+ * from the given bound on. The storage must have bitmap_container_bytes bytes,
+ * aligned for the values of the kind.
+ */
+bool bitmap_container_valid(
+        struct bitmap_container const *restrict container,
+        void const *restrict data,
+        moviedb_id_t bound);
+
+/**
+ * Appends to the bitmap a copy of the given well formed container, with the
+ * given storage in place of its own. Its key must be greater than the keys of
+ * the containers in the bitmap.
+ */
+void bitmap_append(
+        struct bitmap *restrict bitmap,
+        struct bitmap_container const *restrict container,
+        void const *restrict data,
+        struct error *restrict error);
+
+/**
+ * Destroys the bitmap, freeing all memory.
+ */
+void bitmap_destroy(struct bitmap *restrict bitmap);
+
+#endif
@@ -1,8 +1,16 @@
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 #include "io.h"
 #include "csv.h"
 #include "alloc.h"
+#include "csv/scan.h"
+
+/**
+ * Maximum number of digits of a decimal parsed without strtod. Both the digits
+ * as an integer and the power of ten dividing them are exact doubles up to it.
+ */
+#define SHORT_DECIMAL_DIGITS 15
 
 /**
  * Given a character (symbol) read from a file, updates line and column
@@ -10,10 +18,66 @@
  */
 static void update_line_column(struct csv_parser *restrict parser, int symbol);
 
+/**
+ * Reads the next symbol from the parser's source, either its file or its data
+ * in memory. Returns EOF at the end of the source.
+ */
+static inline int read_symbol(
+        struct csv_parser *restrict parser,
+        struct error *restrict error);
+
+/**
+ * Feeds a symbol to the parser: updates line and column, performs the
+ * transition and sets a CSV error if the parser ended in the error state.
+ * Returns whether the current field is done.
+ */
+static bool step(
+        struct csv_parser *restrict parser,
+        int symbol,
+        struct strbuf *restrict out,
+        struct error *restrict error);
+
+/**
+ * Parses a short decimal (spaces, digits with an optional point, spaces) with
+ * at most SHORT_DECIMAL_DIGITS digits from the given bytes. Returns whether the
+ * bytes had this form; if so, the value is written into value_out, correctly
+ * rounded, just as strtod would.
+ */
+static bool parse_short_decimal(
+        char const *restrict bytes,
+        size_t length,
+        double *restrict value_out);
+
+/**
+ * When reading from memory and inside a field, appends the run of bytes up to
+ * the next byte the automaton must handle (a delimiter, quote, backslash or
+ * line break) onto the output buffer, skipping the automaton for them.
+ */
+static void copy_run(
+        struct csv_parser *restrict parser,
+        struct strbuf *restrict out,
+        struct error *restrict error);
+
+/**
+ * Tries to parse the next field without copying it, directly from the
+ * parser's data. Returns whether it succeeded. If it did not, the parser was
+ * left untouched, and the field must be parsed by the regular state machine.
+ */
+static bool parse_field_in_place(
+        struct csv_parser *restrict parser,
+        struct strbuf *restrict scratch,
+        struct csv_field *restrict field_out,
+        struct error *restrict error);
+
 extern inline void csv_parser_init(
         struct csv_parser *restrict parser,
         FILE *csv_file);
 
+extern inline void csv_parser_init_mem(
+        struct csv_parser *restrict parser,
+        char const *data,
+        size_t length);
+
 extern inline bool csv_is_error(struct csv_parser const *restrict parser);
 
 extern inline bool csv_is_row_boundary(
@@ -74,6 +138,24 @@ double csv_parse_double(
     return value;
 }
 
+double csv_field_parse_double(
+        struct csv_field const *restrict field,
+        struct strbuf *buf,
+        struct error *restrict error)
+{
+    double value = 0.0;
+    char const *string;
+
+    if (!parse_short_decimal(field->ptr, field->length, &value)) {
+        /* Unusual input, such as exponents or signs. */
+        string = csv_field_make_cstr(field, buf, error);
+        if (error->code == error_none) {
+            value = csv_parse_double(string, error);
+        }
+    }
+
+    return value;
+}
 
 void csv_parse_field(
         struct csv_parser *restrict parser,
@@ -86,27 +168,280 @@ void csv_parse_field(
     out->length = 0;
 
     while (!done) {
-        symbol = input_file_read(parser->file, error);
+        if (parser->file == NULL) {
+            /* Copies plain runs in bulk, the automaton handles delimiters. */
+            copy_run(parser, out, error);
+        }
+        symbol = read_symbol(parser, error);
         if (error->code == error_none) {
-            /* Updates line and column for errors. */
-            update_line_column(parser, symbol);
-            /* Makes the automaton's transition. */
-            transition(parser, symbol, out, error);
+            done = step(parser, symbol, out, error);
+        } else {
+            done = true;
         }
+    }
+}
 
-        if (error->code != error_none) {
-            done = true;
-        } else if (parser->state == csv_error) {
-            /* Sets the error with line and column. */
-            error_set_code(error, error_csv);
-            error->data.csv.line = parser->line;
-            error->data.csv.column = parser->column;
-            done = true;
+void csv_parse_field_slice(
+        struct csv_parser *restrict parser,
+        struct strbuf *restrict scratch,
+        struct csv_field *restrict field_out,
+        struct error *restrict error)
+{
+    bool in_place = false;
+
+    if (parser->file == NULL) {
+        in_place = parse_field_in_place(parser, scratch, field_out, error);
+    }
+
+    if (!in_place) {
+        /* Falls back to the state machine, copying into the scratch buffer. */
+        csv_parse_field(parser, scratch, error);
+        field_out->ptr = scratch->ptr;
+        field_out->length = scratch->length;
+    }
+}
+
+bool csv_field_equals(
+        struct csv_field const *restrict field,
+        char const *restrict string)
+{
+    size_t length = strlen(string);
+    return field->length == length
+        && memcmp(field->ptr, string, length) == 0;
+}
+
+char *csv_field_copy_cstr(
+        struct csv_field const *restrict field,
+        struct error *restrict error)
+{
+    char *cstr = moviedb_alloc(sizeof(*cstr), field->length + 1, error);
+
+    if (error->code == error_none) {
+        memcpy(cstr, field->ptr, field->length);
+        cstr[field->length] = 0;
+    }
+
+    return cstr;
+}
+
+char const *csv_field_make_cstr(
+        struct csv_field const *restrict field,
+        struct strbuf *buf,
+        struct error *restrict error)
+{
+    size_t length = field->length;
+
+    if (field->ptr != buf->ptr) {
+        /* The field lives in the parser's data, copy it. */
+        buf->length = 0;
+        if (buf->capacity < length + 1) {
+            strbuf_reserve(buf, length + 1 - buf->capacity, error);
+        }
+        if (error->code == error_none) {
+            memcpy(buf->ptr, field->ptr, length);
+        }
+    }
+
+    if (error->code == error_none) {
+        buf->length = length;
+        strbuf_push(buf, 0, error);
+    }
+
+    return buf->ptr;
+}
+
+static inline int read_symbol(
+        struct csv_parser *restrict parser,
+        struct error *restrict error)
+{
+    int symbol = EOF;
+
+    if (parser->file != NULL) {
+        symbol = input_file_read(parser->file, error);
+    } else if (parser->position < parser->length) {
+        symbol = (unsigned char) parser->data[parser->position];
+        parser->position++;
+    }
+
+    return symbol;
+}
+
+static bool step(
+        struct csv_parser *restrict parser,
+        int symbol,
+        struct strbuf *restrict out,
+        struct error *restrict error)
+{
+    bool done;
+
+    /* Updates line and column for errors. */
+    update_line_column(parser, symbol);
+    /* Makes the automaton's transition. */
+    transition(parser, symbol, out, error);
+
+    if (error->code != error_none) {
+        done = true;
+    } else if (parser->state == csv_error) {
+        /* Sets the error with line and column. */
+        error_set_code(error, error_csv);
+        error->data.csv.line = parser->line;
+        error->data.csv.column = parser->column;
+        done = true;
+    } else {
+        /* Otherwise test if filed is at the end. */
+        done = parser->state == csv_comma;
+        done = done || csv_is_row_boundary(parser);
+    }
+
+    return done;
+}
+
+static bool parse_field_in_place(
+        struct csv_parser *restrict parser,
+        struct strbuf *restrict scratch,
+        struct csv_field *restrict field_out,
+        struct error *restrict error)
+{
+    char const *data = parser->data;
+    size_t start = parser->position;
+    size_t end = start;
+    bool in_place = false;
+    int symbol;
+
+    switch (parser->state) {
+        case csv_initial:
+        case csv_comma:
+        case csv_linefeed:
+        case csv_crlf:
+        case csv_car_return:
+            break;
+        default:
+            /* Not at the beginning of a field, leave it to the automaton. */
+            return false;
+    }
+
+    if (start < parser->length && data[start] == '"') {
+        /* Quoted field: finds the closing quote, rejects escapes/newlines. */
+        end = start + 1;
+        end += csv_scan_quoted(data + end, parser->length - end);
+
+        in_place = end < parser->length && data[end] == '"';
+        if (in_place && end + 1 < parser->length) {
+            /* A quote or backslash after the quote is an escape. */
+            in_place = data[end + 1] != '"' && data[end + 1] != '\\';
+        }
+
+        if (in_place) {
+            field_out->ptr = data + start + 1;
+            field_out->length = end - start - 1;
+            /* Accounts both quotes, and leaves the closing one behind. */
+            parser->column += end - start + 1;
+            parser->position = end + 1;
+            parser->state = csv_prev_quote;
+        }
+    } else {
+        /* Unquoted field: finds the delimiter that ends it. */
+        end += csv_scan_unquoted(data + end, parser->length - end);
+
+        /* Empty fields and misplaced quotes are left to the automaton. */
+        in_place = end > start && (end == parser->length || data[end] != '"');
+
+        if (in_place) {
+            field_out->ptr = data + start;
+            field_out->length = end - start;
+            parser->column += end - start;
+            parser->position = end;
+            parser->state = csv_unquoted;
+        }
+    }
+
+    if (in_place) {
+        /* Consumes the delimiter through the automaton. */
+        symbol = read_symbol(parser, error);
+        step(parser, symbol, scratch, error);
+    }
+
+    return in_place;
+}
+
+static bool parse_short_decimal(
+        char const *restrict bytes,
+        size_t length,
+        double *restrict value_out)
+{
+    static double const powers_of_ten[SHORT_DECIMAL_DIGITS + 1] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+        1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15
+    };
+    size_t i = 0;
+    uint64_t mantissa = 0;
+    unsigned digits = 0;
+    unsigned decimals = 0;
+    bool point = false;
+    bool valid = true;
+
+    while (i < length && bytes[i] == ' ') {
+        i++;
+    }
+
+    while (i < length && valid && bytes[i] != ' ') {
+        if (bytes[i] >= '0' && bytes[i] <= '9') {
+            mantissa = mantissa * 10 + (bytes[i] - '0');
+            digits++;
+            decimals += point;
+            valid = digits <= SHORT_DECIMAL_DIGITS;
+        } else if (bytes[i] == '.' && !point) {
+            point = true;
         } else {
-            /* Otherwise test if filed is at the end. */
-            done = parser->state == csv_comma;
-            done = done || csv_is_row_boundary(parser);
-            done = done || error->code != error_none;
+            valid = false;
+        }
+        i++;
+    }
+
+    while (i < length && bytes[i] == ' ') {
+        i++;
+    }
+
+    valid = valid && digits > 0 && i == length;
+
+    if (valid) {
+        /*
+         * Both operands are exact, so the division is rounded only once, which
+         * gives the same result as strtod.
+         */
+        *value_out = mantissa / powers_of_ten[decimals];
+    }
+
+    return valid;
+}
+
+static void copy_run(
+        struct csv_parser *restrict parser,
+        struct strbuf *restrict out,
+        struct error *restrict error)
+{
+    char const *start = parser->data + parser->position;
+    size_t remaining = parser->length - parser->position;
+    size_t run = 0;
+
+    switch (parser->state) {
+        case csv_unquoted:
+            run = csv_scan_unquoted(start, remaining);
+            break;
+        case csv_quoted:
+            run = csv_scan_quoted(start, remaining);
+            break;
+        default:
+            /* Other states need the automaton for the next byte. */
+            break;
+    }
+
+    if (run > 0) {
+        strbuf_append(out, start, run, error);
+        if (error->code == error_none) {
+            /* Runs have no line breaks, only columns are advanced. */
+            parser->position += run;
+            parser->column += run;
         }
     }
 }
@@ -164,6 +499,10 @@ static void transition(
                 case '\n':
                     parser->state = csv_linefeed;
                     break;
+                case ',':
+                    /* Empty field. */
+                    parser->state = csv_comma;
+                    break;
                 case EOF:
                     parser->state = csv_end_of_file;
                     break;
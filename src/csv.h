@@ -84,11 +84,27 @@ enum csv_state {
  */
 struct csv_parser { 
     /**
-     * The file from which the parser is reading. While the parser is being
-     * used, only CSV parser internal code is allowed to touch this, * including
-     * reading from this file pointer.
+     * The file from which the parser is reading, or NULL if the parser reads
+     * from memory. While the parser is being used, only CSV parser internal
+     * code is allowed to touch this, * including reading from this file
+     * pointer.
      */
     FILE *file;
+    /**
+     * The bytes from which the parser is reading, when it does not read from a
+     * file. Only CSV parser internal code is allowed to touch this.
+     */
+    char const *data;
+    /**
+     * How many bytes there are in data. Only CSV parser internal code is
+     * allowed to touch this.
+     */
+    size_t length;
+    /**
+     * Position of the next byte to be read from data. Only CSV parser internal
+     * code is allowed to touch this.
+     */
+    size_t position;
     /**
      * Current line of the file, starting from 1. This can be read, but only
      * CSV parser internal code is allowed to update this.
@@ -106,6 +122,21 @@ struct csv_parser {
     enum csv_state state;
 };
 
+/**
+ * A field parsed by csv_parse_field_slice. The field is not nul-terminated.
+ */
+struct csv_field {
+    /**
+     * Start of the field's contents. Points either into the parser's data or
+     * into the scratch buffer given to the parser.
+     */
+    char const *ptr;
+    /**
+     * Length of the field's contents.
+     */
+    size_t length;
+};
+
 /**
  * Initializes a parser from the given FILE object. The given FILE must be
  * readable, and the caller should not use the FILE while using the parser.
@@ -113,6 +144,27 @@ struct csv_parser {
 inline void csv_parser_init(struct csv_parser *restrict parser, FILE *csv_file)
 {
     parser->file = csv_file;
+    parser->data = NULL;
+    parser->length = 0;
+    parser->position = 0;
+    parser->line = 1;
+    parser->column = 1;
+    parser->state = csv_initial;
+}
+
+/**
+ * Initializes a parser over the given bytes in memory, such as a mapped file.
+ * The bytes must outlive the parser and the fields it produces.
+ */
+inline void csv_parser_init_mem(
+        struct csv_parser *restrict parser,
+        char const *data,
+        size_t length)
+{
+    parser->file = NULL;
+    parser->data = data;
+    parser->length = length;
+    parser->position = 0;
     parser->line = 1;
     parser->column = 1;
     parser->state = csv_initial;
@@ -166,6 +218,47 @@ void csv_parse_field(
         struct strbuf *restrict out,
         struct error *restrict error);
 
+/**
+ * Parses a field from the CSV file, without copying it when possible. When the
+ * parser reads from memory, unquoted fields and quoted fields without escapes
+ * are handed out as slices of the parser's data. Otherwise, the field is
+ * written into the scratch buffer and the slice points to it. Either way, the
+ * slice is only valid until the next field is parsed.
+ *
+ * End of file is handled as in csv_parse_field. Possible errors are allocation
+ * error and IO errors.
+ */
+void csv_parse_field_slice(
+        struct csv_parser *restrict parser,
+        struct strbuf *restrict scratch,
+        struct csv_field *restrict field_out,
+        struct error *restrict error);
+
+/**
+ * Tests whether the given field has exactly the contents of the given C
+ * string.
+ */
+bool csv_field_equals(
+        struct csv_field const *restrict field,
+        char const *restrict string);
+
+/**
+ * Copies the given field into a new heap-allocated C string.
+ */
+char *csv_field_copy_cstr(
+        struct csv_field const *restrict field,
+        struct error *restrict error);
+
+/**
+ * Makes a nul-terminated version of the field in the given buffer, and returns
+ * a pointer to it. The field might point to the buffer itself. The returned
+ * string is only valid until the buffer is changed.
+ */
+char const *csv_field_make_cstr(
+        struct csv_field const *restrict field,
+        struct strbuf *buf,
+        struct error *restrict error);
+
 /**
  * Parses a double precision floating point number. Intended to be used when
  * parsing CSV, but can be used with anything.
@@ -174,4 +267,16 @@ double csv_parse_double(
         char const *restrict string,
         struct error *restrict error);
 
+/**
+ * Parses a double precision floating point number from a CSV field, which need
+ * not be nul-terminated. Short decimals, such as ratings, are parsed directly
+ * from the field's bytes; anything else is converted into a C string in the
+ * given buffer and parsed by csv_parse_double. Either way, results and errors
+ * are the same as csv_parse_double's.
+ */
+double csv_field_parse_double(
+        struct csv_field const *restrict field,
+        struct strbuf *buf,
+        struct error *restrict error);
+
 #endif
@@ -6,27 +6,25 @@
 
 void movie_parser_init(
         struct movie_parser *restrict parser,
-        FILE *file,
+        struct csv_parser const *restrict csv_parser,
         struct strbuf *restrict buf,
         struct error *restrict error)
 {
+    struct csv_field field;
     bool found_id = false, found_title = false, found_genres = false;
     bool found_all;
     bool row_boundary;
     size_t column = 0;
 
-    csv_parser_init(&parser->csv_parser, file);
+    parser->csv_parser = *csv_parser;
+    strbuf_init(&parser->title);
+    strbuf_init(&parser->genres);
 
     do {
-        csv_parse_field(&parser->csv_parser, buf, error);
+        csv_parse_field_slice(&parser->csv_parser, buf, &field, error);
 
-        /* Converts the string buffer into a C String. */
         if (error->code == error_none) {
-            strbuf_make_cstr(buf, error);
-        }
-
-        if (error->code == error_none) {
-            if (strcmp(buf->ptr, "movieId") == 0) {
+            if (csv_field_equals(&field, "movieId")) {
                 /* Registers movieId column number, does not allow repeat. */
                 if (found_id) {
                     error_set_code(error, error_csv_header);
@@ -34,7 +32,7 @@ void movie_parser_init(
                     found_id = true;
                     parser->id_column = column;
                 }
-            } else if (strcmp(buf->ptr, "title") == 0) {
+            } else if (csv_field_equals(&field, "title")) {
                 /* Registers title column number, does not allow repeat. */
                 if (found_title) {
                     error_set_code(error, error_csv_header);
@@ -42,7 +40,7 @@ void movie_parser_init(
                     found_title = true;
                     parser->title_column = column;
                 }
-            } else if (strcmp(buf->ptr, "genres") == 0) {
+            } else if (csv_field_equals(&field, "genres")) {
                 /* Registers genres column number, does not allow repeat. */
                 if (found_genres) {
                     error_set_code(error, error_csv_header);
@@ -77,6 +75,7 @@ bool movie_row_parse(
     size_t column = 0;
     bool end_of_file = false;
     bool row_boundary = false;
+    struct csv_field field;
 
     row_out->id = 0;
     row_out->title = NULL;
@@ -87,7 +86,7 @@ bool movie_row_parse(
      * no eof).
      */
     while (column < COLUMNS && error->code == error_none && !end_of_file) {
-        csv_parse_field(&parser->csv_parser, buf, error);
+        csv_parse_field_slice(&parser->csv_parser, buf, &field, error);
         end_of_file = csv_is_end_of_file(&parser->csv_parser) && column == 0;
         if (!end_of_file && error->code == error_none) {
             row_boundary = csv_is_row_boundary(&parser->csv_parser);
@@ -97,16 +96,22 @@ bool movie_row_parse(
                 error->data.csv_movie.line = parser->csv_parser.line - 1;
             } else if (column == parser->id_column) {
                 /* Parses an ID. */
-                strbuf_make_cstr(buf, error);
-                if (error->code == error_none) {
-                    row_out->id = moviedb_id_parse(buf->ptr, error);
-                }
+                row_out->id = moviedb_id_parse_bytes(
+                        field.ptr,
+                        field.length,
+                        error);
             } else if (column == parser->title_column) {
                 /* Copies the title. */
-                row_out->title = strbuf_copy_cstr(buf, error);
+                row_out->title = csv_field_make_cstr(
+                        &field,
+                        &parser->title,
+                        error);
             } else if (column == parser->genres_column) {
                 /* Copies the genres. */
-                row_out->genres = strbuf_copy_cstr(buf, error);
+                row_out->genres = csv_field_make_cstr(
+                        &field,
+                        &parser->genres,
+                        error);
             }
         }
         column++;
@@ -120,24 +125,20 @@ bool movie_row_parse(
         error->data.csv_movie.line = parser->csv_parser.line;
     }
 
-    /* If error, destroys row data. */
-    if (error->code != error_none) {
-        movie_row_destroy(row_out);
-        if (error->code == error_id) {
-            /* Gets the line for an ID error. */
-            error->data.id.has_line = true;
-            if (csv_is_row_boundary(&parser->csv_parser)) {
-                error->data.id.line = parser->csv_parser.line - 1;
-            } else {
-                error->data.id.line = parser->csv_parser.line;
-            }
+    if (error->code == error_id) {
+        /* Gets the line for an ID error. */
+        error->data.id.has_line = true;
+        if (csv_is_row_boundary(&parser->csv_parser)) {
+            error->data.id.line = parser->csv_parser.line - 1;
+        } else {
+            error->data.id.line = parser->csv_parser.line;
         }
     }
     return !end_of_file && error->code == error_none;
 }
 
-void movie_row_destroy(struct movie_csv_row *restrict row)
+void movie_parser_destroy(struct movie_parser *restrict parser)
 {
-    moviedb_free((void *) (void const *) row->title);
-    moviedb_free((void *) (void const *) row->genres);
+    strbuf_destroy(&parser->title);
+    strbuf_destroy(&parser->genres);
 }
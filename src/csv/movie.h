@@ -19,11 +19,13 @@ struct movie_csv_row {
      */
     moviedb_id_t id;
     /**
-     * Title of the movie. Should be heap allocated.
+     * Title of the movie. Owned by the parser, valid until the next row is
+     * parsed.
      */
     char const *title;
     /**
-     * Genres of the movie. Should be heap allocated.
+     * Genres of the movie. Owned by the parser, valid until the next row is
+     * parsed.
      */
     char const *genres;
 };
@@ -52,15 +54,27 @@ struct movie_parser {
      * allowed to touch this.
      */
     unsigned char genres_column;
+    /**
+     * Buffer holding the title of the last parsed row. Only movie parser
+     * internal code is allowed to touch this.
+     */
+    struct strbuf title;
+    /**
+     * Buffer holding the genres of the last parsed row. Only movie parser
+     * internal code is allowed to touch this.
+     */
+    struct strbuf genres;
 };
 
 /**
- * Initializes the movie parser. The file is usable after you are finished with
- * the parser.
+ * Initializes the movie parser over the given, freshly initialized CSV parser,
+ * which is copied, and parses the header. The CSV parser's source is usable
+ * until you are finished with the movie parser. The parser must be destroyed
+ * with movie_parser_destroy, even on error.
  */
 void movie_parser_init(
         struct movie_parser *restrict parser,
-        FILE *file,
+        struct csv_parser const *restrict csv_parser,
         struct strbuf *restrict buf,
         struct error *restrict error);
 
@@ -75,8 +89,9 @@ bool movie_row_parse(
         struct error *restrict error);
 
 /**
- * Destroy the contents of a movie row.
+ * Destroys the movie parser, freeing its buffers. Rows it parsed must not be
+ * used after this.
  */
-void movie_row_destroy(struct movie_csv_row *restrict row);
+void movie_parser_destroy(struct movie_parser *restrict parser);
 
 #endif
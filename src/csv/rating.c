@@ -1,15 +1,41 @@
 #include "../alloc.h"
 #include "rating.h"
+#include "../rating.h"
 #include <string.h>
 
 #define COLUMNS 4
 
+/**
+ * Layout of a timestamp written as a date and time in UTC, where each 0 is a
+ * digit.
+ */
+#define DATETIME_LAYOUT "0000-00-00 00:00:00"
+
+/**
+ * Parses a timestamp straight from the field, either written as a date and
+ * time in UTC, as in DATETIME_LAYOUT, or as the seconds since the Unix epoch.
+ * It must fit in 32 bits as the seconds since the epoch. Returns whether it was
+ * valid.
+ */
+static bool parse_timestamp(
+        struct csv_field const *restrict field,
+        uint32_t *restrict timestamp_out);
+
+/**
+ * Parses a timestamp written as a date and time in UTC, as in DATETIME_LAYOUT,
+ * into the seconds since the Unix epoch. Returns whether it was valid.
+ */
+static bool parse_datetime(
+        struct csv_field const *restrict field,
+        uint_least64_t *restrict timestamp_out);
+
 void rating_parser_init(
         struct rating_parser *restrict parser,
-        FILE *file,
+        struct csv_parser const *restrict csv_parser,
         struct strbuf *restrict buf,
         struct error *restrict error)
 {
+    struct csv_field field;
     bool found_userid = false;
     bool found_movieid = false;
     bool found_value = false;
@@ -18,18 +44,13 @@ void rating_parser_init(
     bool row_boundary;
     size_t column = 0;
 
-    csv_parser_init(&parser->csv_parser, file);
+    parser->csv_parser = *csv_parser;
 
     do {
-        csv_parse_field(&parser->csv_parser, buf, error);
+        csv_parse_field_slice(&parser->csv_parser, buf, &field, error);
 
-        /* Converts the string buffer into a C String. */
         if (error->code == error_none) {
-            strbuf_make_cstr(buf, error);
-        }
-
-        if (error->code == error_none) {
-            if (strcmp(buf->ptr, "userId") == 0) {
+            if (csv_field_equals(&field, "userId")) {
                 /* Registers userId column number, does not allow repeat. */
                 if (found_userid) {
                     error_set_code(error, error_csv_header);
@@ -37,7 +58,7 @@ void rating_parser_init(
                     found_userid = true;
                     parser->userid_column = column;
                 }
-            } else if (strcmp(buf->ptr, "movieId") == 0) {
+            } else if (csv_field_equals(&field, "movieId")) {
                 /* Registers movieId column number, does not allow repeat. */
                 if (found_movieid) {
                     error_set_code(error, error_csv_header);
@@ -45,7 +66,7 @@ void rating_parser_init(
                     found_movieid = true;
                     parser->movieid_column = column;
                 }
-            } else if (strcmp(buf->ptr, "rating") == 0) {
+            } else if (csv_field_equals(&field, "rating")) {
                 /* Registers rating column number, does not allow repeat. */
                 if (found_value) {
                     error_set_code(error, error_csv_header);
@@ -53,11 +74,8 @@ void rating_parser_init(
                     found_value = true;
                     parser->value_column = column;
                 }
-            } else if (strcmp(buf->ptr, "timestamp") == 0) {
-                /*
-                 * Registers timestamp column number, does not allow repeat.
-                 * Timestamp is not actually used.
-                 */
+            } else if (csv_field_equals(&field, "timestamp")) {
+                /* Registers timestamp column number, does not allow repeat. */
                 if (found_timestamp) {
                     error_set_code(error, error_csv_header);
                 } else {
@@ -91,17 +109,20 @@ bool rating_row_parse(
     size_t column = 0;
     bool end_of_file = false;
     bool row_boundary = false;
+    bool valid_timestamp = true;
+    struct csv_field field;
 
     row_out->movieid = 0;
     row_out->userid = 0;
     row_out->value = 0.0;
+    row_out->timestamp = 0;
 
     /*
      * Loops while minimum column number has not been reached (and no error and
      * no eof).
      */
     while (column < COLUMNS && error->code == error_none && !end_of_file) {
-        csv_parse_field(&parser->csv_parser, buf, error);
+        csv_parse_field_slice(&parser->csv_parser, buf, &field, error);
         end_of_file = csv_is_end_of_file(&parser->csv_parser) && column == 0;
         if (!end_of_file && error->code == error_none) {
             row_boundary = csv_is_row_boundary(&parser->csv_parser);
@@ -109,22 +130,25 @@ bool rating_row_parse(
                 /* Error if row boundary is found to early. */
                 error_set_code(error, error_rating);
                 error->data.csv_movie.line = parser->csv_parser.line - 1;
-            } else if (column != parser->timestamp_column) {
-                /* We will ignore timestamp! */
-                strbuf_make_cstr(buf, error);
-            }
-
-            if (error->code == error_none) {
-                if (column == parser->userid_column) {
-                    /* Parses an ID. */
-                    row_out->userid = moviedb_id_parse(buf->ptr, error);
-                } else if (column == parser->movieid_column) {
-                    /* Parses an ID. */
-                    row_out->movieid = moviedb_id_parse(buf->ptr, error);
-                } else if (column == parser->value_column) {
-                    /* Parses a double. */
-                    row_out->value = csv_parse_double(buf->ptr, error);
-                }
+            } else if (column == parser->userid_column) {
+                /* Parses an ID straight from the field. */
+                row_out->userid = moviedb_id_parse_bytes(
+                        field.ptr,
+                        field.length,
+                        error);
+            } else if (column == parser->movieid_column) {
+                /* Parses an ID straight from the field. */
+                row_out->movieid = moviedb_id_parse_bytes(
+                        field.ptr,
+                        field.length,
+                        error);
+            } else if (column == parser->value_column) {
+                /* Parses a double, usually straight from the field. */
+                row_out->value = csv_field_parse_double(&field, buf, error);
+            } else if (column == parser->timestamp_column) {
+                valid_timestamp = parse_timestamp(
+                        &field,
+                        &row_out->timestamp);
             }
         }
         column++;
@@ -138,6 +162,17 @@ bool rating_row_parse(
         error->data.csv_movie.line = parser->csv_parser.line;
     }
 
+    /*
+     * Ratings are stored as half stars, so no other value is accepted, and
+     * timestamps are stored in 32 bits.
+     */
+    if (error->code == error_none
+            && !end_of_file
+            && (!rating_is_valid(row_out->value) || !valid_timestamp)) {
+        error_set_code(error, error_rating);
+        error->data.csv_rating.line = parser->csv_parser.line - 1;
+    }
+
     /* Gets the line for an ID error. */
     if (error->code == error_id) {
         error->data.id.has_line = true;
@@ -149,3 +184,93 @@ bool rating_row_parse(
     }
     return !end_of_file && error->code == error_none;
 }
+
+static bool parse_timestamp(
+        struct csv_field const *restrict field,
+        uint32_t *restrict timestamp_out)
+{
+    uint_least64_t timestamp = 0;
+    size_t i = 0;
+    bool valid = field->length > 0;
+
+    if (field->length == sizeof(DATETIME_LAYOUT) - 1) {
+        valid = parse_datetime(field, &timestamp)
+            && timestamp <= UINT32_MAX;
+    } else {
+        /* Seconds since the epoch, checking overflow at every digit. */
+        while (valid && i < field->length) {
+            valid = field->ptr[i] >= '0' && field->ptr[i] <= '9';
+            if (valid) {
+                timestamp = timestamp * 10 + (field->ptr[i] - '0');
+                valid = timestamp <= UINT32_MAX;
+            }
+            i++;
+        }
+    }
+
+    if (valid) {
+        *timestamp_out = timestamp;
+    }
+
+    return valid;
+}
+
+static bool parse_datetime(
+        struct csv_field const *restrict field,
+        uint_least64_t *restrict timestamp_out)
+{
+    /* Year, month, day, hour, minute and second, in this order. */
+    unsigned long parts[6] = { 0, 0, 0, 0, 0, 0 };
+    unsigned long year;
+    unsigned long era;
+    unsigned long year_of_era;
+    unsigned long day_of_year;
+    unsigned long day_of_era;
+    unsigned long days;
+    size_t part = 0;
+    size_t i;
+    bool valid = true;
+
+    for (i = 0; valid && i < field->length; i++) {
+        if (DATETIME_LAYOUT[i] == '0') {
+            valid = field->ptr[i] >= '0' && field->ptr[i] <= '9';
+            parts[part] = parts[part] * 10 + (field->ptr[i] - '0');
+        } else {
+            valid = field->ptr[i] == DATETIME_LAYOUT[i];
+            part++;
+        }
+    }
+
+    valid = valid
+        && parts[0] >= 1970
+        && parts[1] >= 1 && parts[1] <= 12
+        && parts[2] >= 1 && parts[2] <= 31
+        && parts[3] < 24
+        && parts[4] < 60
+        && parts[5] < 60;
+
+    if (valid) {
+        /*
+         * Counts days since the epoch in a calendar whose years start in
+         * March, so leap days are at the end of a year. Eras are the 400
+         * years after which the Gregorian calendar repeats.
+         */
+        year = parts[1] <= 2 ? parts[0] - 1 : parts[0];
+        era = year / 400;
+        year_of_era = year - era * 400;
+        day_of_year = (153 * (parts[1] > 2 ? parts[1] - 3 : parts[1] + 9) + 2)
+            / 5 + parts[2] - 1;
+        day_of_era = year_of_era * 365
+            + year_of_era / 4
+            - year_of_era / 100
+            + day_of_year;
+        days = era * 146097 + day_of_era - 719468;
+
+        *timestamp_out = (uint_least64_t) days * 86400
+            + parts[3] * 3600
+            + parts[4] * 60
+            + parts[5];
+    }
+
+    return valid;
+}
@@ -17,6 +17,10 @@ struct rating_csv_row {
     moviedb_id_t userid;
     moviedb_id_t movieid;
     double value;
+    /**
+     * Unix timestamp of when the rating was made.
+     */
+    uint32_t timestamp;
 };
 
 struct rating_parser {
@@ -29,7 +33,7 @@ struct rating_parser {
 
 void rating_parser_init(
         struct rating_parser *restrict parser,
-        FILE *file,
+        struct csv_parser const *restrict csv_parser,
         struct strbuf *restrict buf,
         struct error *restrict error);
 
@@ -0,0 +1,242 @@
+#include <stdint.h>
+#include <string.h>
+#include "scan.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * A 64-bit word with all bytes set to 0x01.
+ */
+#define SWAR_ONES 0x0101010101010101ULL
+
+/**
+ * A 64-bit word with all bytes set to 0x7f.
+ */
+#define SWAR_LOW7 0x7f7f7f7f7f7f7f7fULL
+
+/**
+ * A 64-bit word with all bytes set to 0x80.
+ */
+#define SWAR_HIGH 0x8080808080808080ULL
+
+/**
+ * Returns a word whose bytes have the high bit set exactly where the bytes of
+ * word equal the byte repeated in pattern, and are zero elsewhere.
+ */
+static inline uint64_t swar_match(uint64_t word, uint64_t pattern);
+
+/**
+ * Returns the index of the first byte among the given four delimiters, or
+ * length, testing 8 bytes at once.
+ */
+static inline size_t scan_swar(
+        char const *data,
+        size_t length,
+        char first,
+        char second,
+        char third,
+        char fourth);
+
+#if defined(__SSE2__) || defined(__AVX2__)
+/**
+ * Returns the index of the first byte among the given four delimiters, or
+ * length, testing 16 bytes at once.
+ */
+static inline size_t scan_sse2(
+        char const *data,
+        size_t length,
+        char first,
+        char second,
+        char third,
+        char fourth);
+#endif
+
+#if defined(__AVX2__)
+/**
+ * Returns the index of the first byte among the given four delimiters, or
+ * length, testing 32 bytes at once.
+ */
+static inline size_t scan_avx2(
+        char const *data,
+        size_t length,
+        char first,
+        char second,
+        char third,
+        char fourth);
+
+#define scan_best scan_avx2
+
+char const *const csv_scan_impl = "avx2";
+#elif defined(__SSE2__)
+#define scan_best scan_sse2
+
+char const *const csv_scan_impl = "sse2";
+#else
+#define scan_best scan_swar
+
+char const *const csv_scan_impl = "swar";
+#endif
+
+size_t csv_scan_unquoted(char const *data, size_t length)
+{
+    return scan_best(data, length, ',', '"', '\r', '\n');
+}
+
+size_t csv_scan_quoted(char const *data, size_t length)
+{
+    return scan_best(data, length, '"', '\\', '\r', '\n');
+}
+
+size_t csv_scan_unquoted_swar(char const *data, size_t length)
+{
+    return scan_swar(data, length, ',', '"', '\r', '\n');
+}
+
+size_t csv_scan_quoted_swar(char const *data, size_t length)
+{
+    return scan_swar(data, length, '"', '\\', '\r', '\n');
+}
+
+static inline uint64_t swar_match(uint64_t word, uint64_t pattern)
+{
+    uint64_t zeroes = word ^ pattern;
+
+    /*
+     * Adding 0x7f to the low 7 bits sets the high bit of every non-zero byte
+     * without carrying into the next byte; so, only the zero bytes (the
+     * matches) end up with the high bit clear.
+     */
+    return ~(((zeroes & SWAR_LOW7) + SWAR_LOW7) | zeroes) & SWAR_HIGH;
+}
+
+static inline size_t scan_swar(
+        char const *data,
+        size_t length,
+        char first,
+        char second,
+        char third,
+        char fourth)
+{
+    size_t i = 0;
+    uint64_t word;
+    uint64_t matches = 0;
+
+    while (matches == 0 && i + sizeof(word) <= length) {
+        /* Unaligned load, compiled to a single instruction where possible. */
+        memcpy(&word, data + i, sizeof(word));
+        matches = swar_match(word, (unsigned char) first * SWAR_ONES)
+            | swar_match(word, (unsigned char) second * SWAR_ONES)
+            | swar_match(word, (unsigned char) third * SWAR_ONES)
+            | swar_match(word, (unsigned char) fourth * SWAR_ONES);
+
+        if (matches == 0) {
+            i += sizeof(word);
+        }
+    }
+
+    if (matches != 0) {
+        /* The first byte in memory order is the lowest on little endian. */
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        i += __builtin_clzll(matches) / 8;
+#else
+        i += __builtin_ctzll(matches) / 8;
+#endif
+    } else {
+        /* Tail shorter than a word. */
+        while (i < length
+                && data[i] != first
+                && data[i] != second
+                && data[i] != third
+                && data[i] != fourth) {
+            i++;
+        }
+    }
+
+    return i;
+}
+
+#if defined(__SSE2__) || defined(__AVX2__)
+static inline size_t scan_sse2(
+        char const *data,
+        size_t length,
+        char first,
+        char second,
+        char third,
+        char fourth)
+{
+    size_t i = 0;
+    __m128i block;
+    __m128i matches;
+    int mask = 0;
+
+    while (mask == 0 && i + sizeof(block) <= length) {
+        block = _mm_loadu_si128((__m128i const *) (data + i));
+        matches = _mm_or_si128(
+                _mm_or_si128(
+                    _mm_cmpeq_epi8(block, _mm_set1_epi8(first)),
+                    _mm_cmpeq_epi8(block, _mm_set1_epi8(second))),
+                _mm_or_si128(
+                    _mm_cmpeq_epi8(block, _mm_set1_epi8(third)),
+                    _mm_cmpeq_epi8(block, _mm_set1_epi8(fourth))));
+        mask = _mm_movemask_epi8(matches);
+
+        if (mask == 0) {
+            i += sizeof(block);
+        }
+    }
+
+    if (mask != 0) {
+        i += __builtin_ctz(mask);
+    } else {
+        /* Tail shorter than a block. */
+        i += scan_swar(data + i, length - i, first, second, third, fourth);
+    }
+
+    return i;
+}
+#endif
+
+#if defined(__AVX2__)
+static inline size_t scan_avx2(
+        char const *data,
+        size_t length,
+        char first,
+        char second,
+        char third,
+        char fourth)
+{
+    size_t i = 0;
+    __m256i block;
+    __m256i matches;
+    unsigned mask = 0;
+
+    while (mask == 0 && i + sizeof(block) <= length) {
+        block = _mm256_loadu_si256((__m256i const *) (data + i));
+        matches = _mm256_or_si256(
+                _mm256_or_si256(
+                    _mm256_cmpeq_epi8(block, _mm256_set1_epi8(first)),
+                    _mm256_cmpeq_epi8(block, _mm256_set1_epi8(second))),
+                _mm256_or_si256(
+                    _mm256_cmpeq_epi8(block, _mm256_set1_epi8(third)),
+                    _mm256_cmpeq_epi8(block, _mm256_set1_epi8(fourth))));
+        mask = _mm256_movemask_epi8(matches);
+
+        if (mask == 0) {
+            i += sizeof(block);
+        }
+    }
+
+    if (mask != 0) {
+        i += __builtin_ctz(mask);
+    } else {
+        /* Tail shorter than a block. */
+        i += scan_sse2(data + i, length - i, first, second, third, fourth);
+    }
+
+    return i;
+}
+#endif
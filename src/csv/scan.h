@@ -0,0 +1,45 @@
+#ifndef MOVIEDB_CSV_SCAN_H
+#define MOVIEDB_CSV_SCAN_H 1
+
+#include <stddef.h>
+
+/**
+ * This file provides scanners that find the next byte the CSV automaton must
+ * handle itself, so plain runs of field contents can be skipped in bulk.
+ *
+ * The scanners test 32 bytes at once with AVX2, or 16 bytes with SSE2, when the
+ * build targets them (e.g. ARCH_CFLAGS=-march=native), and 8 bytes at once
+ * through SWAR (SIMD within a register) otherwise.
+ */
+
+/**
+ * Name of the scanner implementation selected at build time: "avx2", "sse2" or
+ * "swar".
+ */
+extern char const *const csv_scan_impl;
+
+/**
+ * Returns the index of the first byte ending a run of an unquoted field, i.e.
+ * a comma, a quote, a carriage return (CR) or a linefeed (LF). Returns length
+ * if there is no such byte.
+ */
+size_t csv_scan_unquoted(char const *data, size_t length);
+
+/**
+ * Returns the index of the first byte ending a run of a quoted field, i.e. a
+ * quote, a backslash, a carriage return (CR) or a linefeed (LF). Returns
+ * length if there is no such byte.
+ */
+size_t csv_scan_quoted(char const *data, size_t length);
+
+/**
+ * Portable SWAR version of csv_scan_unquoted, regardless of the build target.
+ */
+size_t csv_scan_unquoted_swar(char const *data, size_t length);
+
+/**
+ * Portable SWAR version of csv_scan_quoted, regardless of the build target.
+ */
+size_t csv_scan_quoted_swar(char const *data, size_t length);
+
+#endif
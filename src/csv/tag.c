@@ -6,10 +6,11 @@
 
 void tag_parser_init(
         struct tag_parser *restrict parser,
-        FILE *file,
+        struct csv_parser const *restrict csv_parser,
         struct strbuf *restrict buf,
         struct error *restrict error)
 {
+    struct csv_field field;
     bool found_userid = false;
     bool found_movieid = false;
     bool found_name = false;
@@ -18,18 +19,14 @@ void tag_parser_init(
     bool row_boundary;
     size_t column = 0;
 
-    csv_parser_init(&parser->csv_parser, file);
+    parser->csv_parser = *csv_parser;
+    strbuf_init(&parser->name);
 
     do {
-        csv_parse_field(&parser->csv_parser, buf, error);
+        csv_parse_field_slice(&parser->csv_parser, buf, &field, error);
 
-        /* Converts the string buffer into a C String. */
         if (error->code == error_none) {
-            strbuf_make_cstr(buf, error);
-        }
-
-        if (error->code == error_none) {
-            if (strcmp(buf->ptr, "userId") == 0) {
+            if (csv_field_equals(&field, "userId")) {
                 /*
                  * Registers userId column number, does not allow repeat.
                  * userId is not actually used.
@@ -40,7 +37,7 @@ void tag_parser_init(
                     found_userid = true;
                     parser->userid_column = column;
                 }
-            } else if (strcmp(buf->ptr, "movieId") == 0) {
+            } else if (csv_field_equals(&field, "movieId")) {
                 /* Registers movieId column number, does not allow repeat. */
                 if (found_movieid) {
                     error_set_code(error, error_csv_header);
@@ -48,7 +45,7 @@ void tag_parser_init(
                     found_movieid = true;
                     parser->movieid_column = column;
                 }
-            } else if (strcmp(buf->ptr, "tag") == 0) {
+            } else if (csv_field_equals(&field, "tag")) {
                 /* Registers tag movieId column number, does not allow repeat. */
                 if (found_name) {
                     error_set_code(error, error_csv_header);
@@ -56,7 +53,7 @@ void tag_parser_init(
                     found_name = true;
                     parser->name_column = column;
                 }
-            } else if (strcmp(buf->ptr, "timestamp") == 0) {
+            } else if (csv_field_equals(&field, "timestamp")) {
                 /*
                  * Registers timestamp column number, does not allow repeat.
                  * Timestamp is not actually used.
@@ -94,6 +91,7 @@ bool tag_row_parse(
     size_t column = 0;
     bool end_of_file = false;
     bool row_boundary = false;
+    struct csv_field field;
 
     row_out->name = NULL;
     row_out->movieid = 0;
@@ -103,7 +101,7 @@ bool tag_row_parse(
      * no eof).
      */
     while (column < COLUMNS && error->code == error_none && !end_of_file) {
-        csv_parse_field(&parser->csv_parser, buf, error);
+        csv_parse_field_slice(&parser->csv_parser, buf, &field, error);
         end_of_file = csv_is_end_of_file(&parser->csv_parser) && column == 0;
         if (!end_of_file && error->code == error_none) {
             row_boundary = csv_is_row_boundary(&parser->csv_parser);
@@ -113,13 +111,16 @@ bool tag_row_parse(
                 error->data.csv_tag.line = parser->csv_parser.line - 1;
             } else if (column == parser->movieid_column) {
                 /* Parses an ID. */
-                strbuf_make_cstr(buf, error);
-                if (error->code == error_none) {
-                    row_out->movieid = moviedb_id_parse(buf->ptr, error);
-                }
+                row_out->movieid = moviedb_id_parse_bytes(
+                        field.ptr,
+                        field.length,
+                        error);
             } else if (column == parser->name_column) {
                 /* Copies a tag name. */
-                row_out->name = strbuf_copy_cstr(buf, error);
+                row_out->name = csv_field_make_cstr(
+                        &field,
+                        &parser->name,
+                        error);
             }
             /* userid and timestamp ignored */
         }
@@ -134,24 +135,20 @@ bool tag_row_parse(
         error->data.csv_movie.line = parser->csv_parser.line;
     }
 
-    /* If error, destroys row data. */
-    if (error->code != error_none) {
-        tag_row_destroy(row_out);
-        if (error->code == error_id) {
-            /* Gets the line for an ID error. */
-            error->data.id.has_line = true;
-            if (csv_is_row_boundary(&parser->csv_parser)) {
-                error->data.id.line = parser->csv_parser.line - 1;
-            } else {
-                error->data.id.line = parser->csv_parser.line;
-            }
+    if (error->code == error_id) {
+        /* Gets the line for an ID error. */
+        error->data.id.has_line = true;
+        if (csv_is_row_boundary(&parser->csv_parser)) {
+            error->data.id.line = parser->csv_parser.line - 1;
+        } else {
+            error->data.id.line = parser->csv_parser.line;
         }
     }
 
     return !end_of_file && error->code == error_none;
 }
 
-void tag_row_destroy(struct tag_csv_row *restrict row)
+void tag_parser_destroy(struct tag_parser *restrict parser)
 {
-    moviedb_free((void *) (void const *) row->name);
+    strbuf_destroy(&parser->name);
 }
@@ -19,7 +19,8 @@ struct tag_csv_row {
      */
     moviedb_id_t movieid;
     /**
-     * Content of the tag. Should be heap allocated.
+     * Content of the tag. Owned by the parser, valid until the next row is
+     * parsed.
      */
     char const *name;
 };
@@ -53,15 +54,22 @@ struct tag_parser {
      * allowed to touch this.
      */
     unsigned char timestamp_column;
+    /**
+     * Buffer holding the name of the last parsed row. Only tag parser internal
+     * code is allowed to touch this.
+     */
+    struct strbuf name;
 };
 
 /**
- * Initializes the tag parser. The file is usable after you are finished with
- * the parser.
+ * Initializes the tag parser over the given, freshly initialized CSV parser,
+ * which is copied, and parses the header. The CSV parser's source is usable
+ * until you are finished with the tag parser. The parser must be destroyed with
+ * tag_parser_destroy, even on error.
  */
 void tag_parser_init(
         struct tag_parser *restrict parser,
-        FILE *file,
+        struct csv_parser const *restrict csv_parser,
         struct strbuf *restrict buf,
         struct error *restrict error);
 
@@ -76,8 +84,9 @@ bool tag_row_parse(
         struct error *restrict error);
 
 /**
- * Destroy the names of a tag row.
+ * Destroys the tag parser, freeing its buffer. Rows it parsed must not be used
+ * after this.
  */
-void tag_row_destroy(struct tag_csv_row *restrict row);
+void tag_parser_destroy(struct tag_parser *restrict parser);
 
 #endif
@@ -1,16 +1,75 @@
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "database.h"
+#include "database/ratings.h"
+#include "database/snapshot.h"
+#include "database/estimate.h"
 #include "io.h"
+#include "timing.h"
 #include "csv/movie.h"
 #include "csv/rating.h"
 #include "csv/tag.h"
 
 #define IO_BUF_SIZE 0x10000
 
+/**
+ * A CSV file being loaded, either memory-mapped or read through stdio.
+ */
+struct load_source {
+    /**
+     * The mapping of the file, if mapped.
+     */
+    struct input_map map;
+    /**
+     * The stdio file, if not mapped.
+     */
+    FILE *file;
+    /**
+     * Whether the file was mapped.
+     */
+    bool mapped;
+};
+
+/**
+ * Opens a CSV file for loading, mapping it if the options allow and the file
+ * can be mapped, or opening it through stdio otherwise. Initializes the given
+ * CSV parser over the opened file.
+ */
+static void source_open(
+        struct load_source *restrict source_out,
+        char const *restrict path,
+        struct database_options const *restrict options,
+        char *file_buf,
+        struct csv_parser *restrict csv_parser_out,
+        struct error *restrict error);
+
+/**
+ * Closes a CSV file opened by source_open.
+ */
+static void source_close(struct load_source *restrict source);
+
+/**
+ * Stamps the source CSV files of the database. Returns whether all of them
+ * could be stamped; if not, the snapshot cannot be trusted.
+ */
+static bool stamp_sources(struct database *restrict database);
+
+/**
+ * Presizes the tables for the rows the CSV files are estimated to hold, so
+ * they are not resized while loading. The files must be stamped already.
+ */
+static void presize(
+        struct database *restrict database,
+        struct error *restrict error);
+
 /**
  * Loads the data from the movie.csv file.
  */
 static void load_movies(
         struct database *restrict database,
+        struct database_options const *restrict options,
+        struct database_file_stats *restrict stats_out,
         struct strbuf *restrict buf,
         char *file_buf,
         struct error *restrict error);
@@ -20,6 +79,8 @@ static void load_movies(
  */
 static void load_ratings(
         struct database *restrict database,
+        struct database_options const *restrict options,
+        struct database_file_stats *restrict stats_out,
         struct strbuf *restrict buf,
         char *file_buf,
         struct error *restrict error);
@@ -29,20 +90,82 @@ static void load_ratings(
  */
 static void load_tags(
         struct database *restrict database,
+        struct database_options const *restrict options,
+        struct database_file_stats *restrict stats_out,
         struct strbuf *restrict buf,
         char *file_buf,
         struct error *restrict error);
 
+/**
+ * Inserts a parsed tag into the tags table. A tag of a movie not in the movies
+ * table is still created, only without the movie, so that queries for it find
+ * no movies instead of ignoring it.
+ */
+static void insert_tag(
+        struct database *restrict database,
+        struct tag_csv_row const *restrict row,
+        struct error *restrict error);
+
+/**
+ * Scores a movie for title completions by how many ratings it has. The context
+ * is the movies table.
+ */
+static size_t movie_popularity(void const *context, moviedb_id_t movie);
+
+void database_options_init(struct database_options *restrict options)
+{
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+    options->use_mmap = true;
+    options->use_snapshot = true;
+    options->title_index = database_title_trie;
+    options->threads = 1;
+    if (processors > 1) {
+        options->threads = processors;
+    }
+}
+
+bool database_parse_title_index(
+        char const *restrict name,
+        enum database_title_index *restrict index_out)
+{
+    bool valid = true;
+
+    if (strcmp(name, "trie") == 0) {
+        *index_out = database_title_trie;
+    } else if (strcmp(name, "dict") == 0) {
+        *index_out = database_title_dict;
+    } else {
+        valid = false;
+    }
+
+    return valid;
+}
+
 void database_load(
         struct database *restrict database_out,
+        struct database_options const *restrict options,
+        struct database_stats *restrict stats_out,
         struct strbuf *restrict buf,
         struct error *restrict error)
 {
     char *file_buf;
+    bool stamped;
+    double then;
+
+    stats_out->from_snapshot = false;
+    stats_out->snapshot_seconds = 0;
+    stats_out->index_seconds = 0;
 
+    arena_init(&database_out->arena);
     trie_root_init(&database_out->trie_root);
+    titles_init(&database_out->titles);
+    database_out->title_index = options->title_index;
+    genres_index_init(&database_out->genres);
+    raters_index_init(&database_out->raters);
+    timeline_index_init(&database_out->timeline);
     /* Initializes movies to capacity 2003. */
-    movies_init(&database_out->movies, 2003, error);
+    movies_init(&database_out->movies, 2003, &database_out->arena, error);
 
     if (error->code == error_none) {
         /* Initializes users to capacity 2003. */
@@ -51,66 +174,291 @@ void database_load(
 
     if (error->code == error_none) {
         /* Initializes tags to capacity 2003. */
-        tags_init(&database_out->tags, 2003, error);
+        tags_init(&database_out->tags, 2003, &database_out->arena, error);
     }
 
-    if (error->code == error_none) {
+    /* Stamps before loading, so changes made while loading are detected. */
+    stamped = stamp_sources(database_out);
+
+    if (error->code == error_none && stamped && options->use_snapshot) {
+        then = timing_now();
+        stats_out->from_snapshot = database_snapshot_read(
+                database_out,
+                DATABASE_SNAPSHOT_PATH,
+                error);
+        stats_out->snapshot_seconds = timing_now() - then;
+    }
+
+    if (error->code == error_none && !stats_out->from_snapshot) {
+        presize(database_out, error);
+    }
+
+    if (error->code == error_none && !stats_out->from_snapshot) {
         /* Allocates the buffer for file buffering. */
         file_buf = moviedb_alloc(sizeof(*file_buf), IO_BUF_SIZE, error);
     }
 
     /* Actually loads everything, if no error. */
-    if (error->code == error_none)  {
-        load_movies(database_out, buf, file_buf, error);
+    if (error->code == error_none && !stats_out->from_snapshot)  {
+        load_movies(
+                database_out,
+                options,
+                &stats_out->movies,
+                buf,
+                file_buf,
+                error);
 
         if (error->code == error_none)  {
-            load_ratings(database_out, buf, file_buf, error);
+            load_ratings(
+                    database_out,
+                    options,
+                    &stats_out->ratings,
+                    buf,
+                    file_buf,
+                    error);
         }
 
         if (error->code == error_none)  {
-            load_tags(database_out, buf, file_buf, error);
+            load_tags(
+                    database_out,
+                    options,
+                    &stats_out->tags,
+                    buf,
+                    file_buf,
+                    error);
         }
 
         moviedb_free(file_buf);
     }
+
+    if (error->code == error_none) {
+        /*
+         * Only now the rating histograms are final, so the mean ratings the
+         * index is sorted by can be computed, and all tags are known.
+         */
+        then = timing_now();
+        movies_seal(&database_out->movies);
+        genres_index_build(
+                &database_out->genres,
+                &database_out->movies,
+                error);
+
+        if (error->code == error_none) {
+            tags_seal(&database_out->tags, error);
+        }
+
+        if (error->code == error_none) {
+            users_seal(&database_out->users, error);
+        }
+
+        if (error->code == error_none) {
+            raters_index_build(
+                    &database_out->raters,
+                    &database_out->users,
+                    database_out->movies.length,
+                    error);
+        }
+
+        if (error->code == error_none) {
+            timeline_index_build(
+                    &database_out->timeline,
+                    &database_out->users,
+                    database_out->movies.length,
+                    error);
+        }
+
+        /* A snapshot restores the title index as it was sealed or ranked. */
+        if (error->code == error_none
+                && !stats_out->from_snapshot
+                && database_out->title_index == database_title_dict) {
+            titles_seal(
+                    &database_out->titles,
+                    &database_out->movies,
+                    error);
+        }
+
+        if (error->code == error_none
+                && !stats_out->from_snapshot
+                && database_out->title_index == database_title_trie) {
+            /* Rating counts are final too, so completions can be ranked. */
+            trie_rank(
+                    &database_out->trie_root,
+                    movie_popularity,
+                    &database_out->movies,
+                    &database_out->arena,
+                    error);
+        }
+
+        stats_out->index_seconds = timing_now() - then;
+    }
+}
+
+void database_write_snapshot(
+        struct database const *restrict database,
+        struct error *restrict error)
+{
+    database_snapshot_write(database, DATABASE_SNAPSHOT_PATH, error);
 }
 
 void database_destroy(struct database *restrict database)
 {
-    trie_destroy(&database->trie_root);
+    trie_destroy(&database->trie_root, &database->arena);
+    titles_destroy(&database->titles);
     movies_destroy(&database->movies);
     users_destroy(&database->users);
     tags_destroy(&database->tags);
+    genres_index_destroy(&database->genres);
+    raters_index_destroy(&database->raters);
+    timeline_index_destroy(&database->timeline);
+    /* Only after the tables, which still read from it when destroyed. */
+    arena_destroy(&database->arena);
+}
+
+static bool stamp_sources(struct database *restrict database)
+{
+    char const *paths[DATABASE_SOURCES] = {
+        DATABASE_MOVIES_PATH,
+        DATABASE_RATINGS_PATH,
+        DATABASE_TAGS_PATH
+    };
+    struct stat status;
+    size_t i;
+    bool stamped = true;
+
+    for (i = 0; i < DATABASE_SOURCES; i++) {
+        database->sources[i].size = 0;
+        database->sources[i].mtime_sec = 0;
+        database->sources[i].mtime_nsec = 0;
+
+        if (stat(paths[i], &status) == 0 && S_ISREG(status.st_mode)) {
+            database->sources[i].size = status.st_size;
+            database->sources[i].mtime_sec = status.st_mtim.tv_sec;
+            database->sources[i].mtime_nsec = status.st_mtim.tv_nsec;
+        } else {
+            stamped = false;
+        }
+    }
+
+    return stamped;
+}
+
+static void presize(
+        struct database *restrict database,
+        struct error *restrict error)
+{
+    struct database_estimate estimate;
+
+    if (database_estimate(
+                DATABASE_MOVIES_PATH,
+                database->sources[0].size,
+                &estimate)) {
+        movies_reserve(&database->movies, estimate.rows, error);
+    }
+
+    /*
+     * Users are only presized if the ratings look grouped by user; otherwise,
+     * the estimate would be closer to the number of ratings.
+     */
+    if (error->code == error_none
+            && database_estimate(
+                DATABASE_RATINGS_PATH,
+                database->sources[1].size,
+                &estimate)
+            && estimate.keys <= estimate.rows / 2) {
+        users_reserve(&database->users, estimate.keys, error);
+    }
+
+    /*
+     * Tags are not presized: tag.csv is grouped by user, and there is no
+     * cheap estimate of how many distinct tags it has.
+     */
+}
+
+static void source_open(
+        struct load_source *restrict source_out,
+        char const *restrict path,
+        struct database_options const *restrict options,
+        char *file_buf,
+        struct csv_parser *restrict csv_parser_out,
+        struct error *restrict error)
+{
+    source_out->mapped = false;
+    source_out->file = NULL;
+
+    if (options->use_mmap) {
+        source_out->mapped = input_map_open(path, &source_out->map, error);
+    }
+
+    if (source_out->mapped) {
+        csv_parser_init_mem(
+                csv_parser_out,
+                source_out->map.data,
+                source_out->map.length);
+    } else if (error->code == error_none) {
+        /* Falls back to stdio, e.g. for pipes. */
+        source_out->file = input_file_open(path, error);
+
+        if (error->code == error_none) {
+            input_file_setbuf(source_out->file, file_buf, IO_BUF_SIZE, error);
+            if (error->code == error_none) {
+                csv_parser_init(csv_parser_out, source_out->file);
+            } else {
+                input_file_close(source_out->file);
+                source_out->file = NULL;
+            }
+        }
+    }
+}
+
+static void source_close(struct load_source *restrict source)
+{
+    if (source->mapped) {
+        input_map_close(&source->map);
+    } else if (source->file != NULL) {
+        input_file_close(source->file);
+    }
 }
 
 static void load_movies(
         struct database *restrict database,
+        struct database_options const *restrict options,
+        struct database_file_stats *restrict stats_out,
         struct strbuf *restrict buf,
         char *file_buf,
         struct error *restrict error)
 {
-    char const *path = "data/movie.csv";
-    FILE *file;
+    char const *path = DATABASE_MOVIES_PATH;
+    struct load_source source;
+    struct csv_parser csv_parser;
     struct movie_parser parser;
     struct movie_csv_row row;
     bool has_data = true;
+    double then = timing_now();
 
-    file = input_file_open(path, error);
+    stats_out->rows = 0;
 
-    if (error->code == error_none) {
-        input_file_setbuf(file, file_buf, IO_BUF_SIZE, error);
+    source_open(&source, path, options, file_buf, &csv_parser, error);
 
-        if (error->code == error_none) {
-            /* Initializes the CSV parser. */
-            movie_parser_init(&parser, file, buf, error);
-        }
+    if (error->code == error_none) {
+        /* Initializes the row parser, which reads the header. */
+        movie_parser_init(&parser, &csv_parser, buf, error);
 
         has_data = error->code == error_none;
         while (has_data) {
             has_data = movie_row_parse(&parser, buf, &row, error);
             if (has_data) {
-                /* Inserts into the trie. */
-                trie_insert(&database->trie_root, row.title, row.id, error);
+                if (database->title_index == database_title_trie) {
+                    /* Inserts into the trie. */
+                    trie_insert(
+                            &database->trie_root,
+                            row.title,
+                            row.id,
+                            &database->arena,
+                            error);
+                } else {
+                    /* The dictionary is sorted once all titles are known. */
+                    titles_add(&database->titles, row.id, error);
+                }
 
                 if (error->code == error_dup_movie_title) {
                     /* Ignore duplicated movie title error. */
@@ -120,24 +468,23 @@ static void load_movies(
                 if (error->code == error_none) {
                     /* Inserts into the movie table. */
                     movies_insert(&database->movies, &row, error);
-                } 
-                if (error->code != error_none) {
-                    /*
-                     * Destroys the row memory if an error happens.
-                     *
-                     * Normally, movie table would get the ownership of the
-                     * heap-allocated fields of the row.
-                     */
-                    movie_row_destroy(&row);
+                }
+
+                if (error->code == error_none) {
+                    stats_out->rows++;
                 }
 
                 has_data = error->code == error_none;
             }
         }
 
-        input_file_close(file);
+        /* The row's strings are borrowed from the parser, freed here. */
+        movie_parser_destroy(&parser);
+        source_close(&source);
     }
 
+    stats_out->seconds = timing_now() - then;
+    stats_out->mapped = source.mapped;
 
     if (error->code != error_none) {
         error_set_context(error, path, false);
@@ -147,49 +494,56 @@ static void load_movies(
 
 static void load_ratings(
         struct database *restrict database,
+        struct database_options const *restrict options,
+        struct database_file_stats *restrict stats_out,
         struct strbuf *restrict buf,
         char *file_buf,
         struct error *restrict error)
 {
-    char const *path = "data/rating.csv";
-    FILE *file;
+    char const *path = DATABASE_RATINGS_PATH;
+    struct load_source source;
+    struct csv_parser csv_parser;
     struct rating_parser parser;
     struct rating_csv_row row;
     bool has_data = true;
+    double then = timing_now();
 
-    file = input_file_open(path, error);
+    stats_out->rows = 0;
+
+    source_open(&source, path, options, file_buf, &csv_parser, error);
 
     if (error->code == error_none) {
-        input_file_setbuf(file, file_buf, IO_BUF_SIZE, error);
+        /* Initializes the row parser, which reads the header. */
+        rating_parser_init(&parser, &csv_parser, buf, error);
 
-        if (error->code == error_none) {
-            /* Initializes the CSV parser. */
-            rating_parser_init(&parser, file, buf, error);
+        has_data = error->code == error_none;
+        if (has_data && source.mapped && options->threads > 1) {
+            /* Parses in parallel, only possible with a mapped file. */
+            stats_out->rows = database_load_ratings_parallel(
+                    database,
+                    &parser,
+                    options->threads,
+                    error);
+            has_data = false;
         }
 
-        has_data = error->code == error_none;
         while (has_data) {
             has_data = rating_row_parse(&parser, buf, &row, error);
 
             if (has_data) {
-                /* Inserts into the user table. */
-                users_insert_rating(&database->users, &row, error);
-
+                database_insert_rating(database, &row, error);
                 if (error->code == error_none) {
-                    /* Adds this rating to the respective movie. */
-                    movies_add_rating(
-                            &database->movies,
-                            row.movieid,
-                            row.value);
+                    stats_out->rows++;
                 }
-
                 has_data = error->code == error_none;
             }
         }
 
-        input_file_close(file);
+        source_close(&source);
     }
 
+    stats_out->seconds = timing_now() - then;
+    stats_out->mapped = source.mapped;
 
     if (error->code != error_none) {
         error_set_context(error, path, false);
@@ -198,25 +552,27 @@ static void load_ratings(
 
 static void load_tags(
         struct database *restrict database,
+        struct database_options const *restrict options,
+        struct database_file_stats *restrict stats_out,
         struct strbuf *restrict buf,
         char *file_buf,
         struct error *restrict error)
 {
-    char const *path = "data/tag.csv";
-    FILE *file;
+    char const *path = DATABASE_TAGS_PATH;
+    struct load_source source;
+    struct csv_parser csv_parser;
     struct tag_parser parser;
     struct tag_csv_row row;
     bool has_data = true;
+    double then = timing_now();
 
-    file = input_file_open(path, error);
+    stats_out->rows = 0;
 
-    if (error->code == error_none) {
-        input_file_setbuf(file, file_buf, IO_BUF_SIZE, error);
+    source_open(&source, path, options, file_buf, &csv_parser, error);
 
-        if (error->code == error_none) {
-            /* Initializes the CSV parser. */
-            tag_parser_init(&parser, file, buf, error);
-        }
+    if (error->code == error_none) {
+        /* Initializes the row parser, which reads the header. */
+        tag_parser_init(&parser, &csv_parser, buf, error);
 
         has_data = error->code == error_none;
         while (has_data) {
@@ -224,19 +580,52 @@ static void load_tags(
 
             if (has_data) {
                 /* Inserts into the tag table. */
-                tags_insert(&database->tags, &row, error);
+                insert_tag(database, &row, error);
                 if (error->code == error_dup_movie_id) {
                     /* Ignore duplicated movie ID error. */
                     error_set_code(error, error_none);
                 }
+                if (error->code == error_none) {
+                    stats_out->rows++;
+                }
                 has_data = error->code == error_none;
             }
         }
 
-        input_file_close(file);
+        tag_parser_destroy(&parser);
+        source_close(&source);
     }
 
+    stats_out->seconds = timing_now() - then;
+    stats_out->mapped = source.mapped;
+
     if (error->code != error_none) {
         error_set_context(error, path, false);
     }
 }
+
+static void insert_tag(
+        struct database *restrict database,
+        struct tag_csv_row const *restrict row,
+        struct error *restrict error)
+{
+    moviedb_index_t movie;
+
+    if (movies_index(&database->movies, row->movieid, &movie)) {
+        tags_insert(&database->tags, row, movie, error);
+    } else {
+        tags_insert_empty(&database->tags, row->name, 1, error);
+    }
+}
+
+static size_t movie_popularity(void const *context, moviedb_id_t movie)
+{
+    struct movie const *found = movies_search(context, movie);
+    size_t ratings = 0;
+
+    if (found != NULL) {
+        ratings = found->ratings;
+    }
+
+    return ratings;
+}
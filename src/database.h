@@ -1,18 +1,82 @@
 #ifndef MOVIEDB_DB_H
 #define MOVIEDB_DB_H 1
 
+#include <stdint.h>
 #include "error.h"
 #include "alloc.h"
 #include "strbuf.h"
 #include "trie.h"
+#include "titles.h"
 #include "movies.h"
 #include "users.h"
 #include "tags.h"
+#include "genres.h"
+#include "raters.h"
+#include "timeline.h"
+#include "arena.h"
 
 /**
  * This file exports items to operate on the whole movie database.
  */
 
+/**
+ * Path of the movies CSV file.
+ */
+#define DATABASE_MOVIES_PATH "data/movie.csv"
+
+/**
+ * Path of the ratings CSV file.
+ */
+#define DATABASE_RATINGS_PATH "data/rating.csv"
+
+/**
+ * Path of the tags CSV file.
+ */
+#define DATABASE_TAGS_PATH "data/tag.csv"
+
+/**
+ * Path of the binary snapshot of the database.
+ */
+#define DATABASE_SNAPSHOT_PATH "data/moviedb.snapshot"
+
+/**
+ * How many source CSV files a database is loaded from.
+ */
+#define DATABASE_SOURCES 3
+
+/**
+ * Size and modification time of a source CSV file, used to tell whether a
+ * snapshot is up to date with the sources.
+ */
+struct database_stamp {
+    /**
+     * Size of the file in bytes.
+     */
+    uint64_t size;
+    /**
+     * Seconds part of the modification time.
+     */
+    int64_t mtime_sec;
+    /**
+     * Nanoseconds part of the modification time.
+     */
+    int64_t mtime_nsec;
+};
+
+/**
+ * Which index movie titles are searched by.
+ */
+enum database_title_index {
+    /**
+     * The radix trie.
+     */
+    database_title_trie,
+    /**
+     * The front-coded dictionary of sorted titles.
+     */
+    database_title_dict
+};
+
 /**
  * All data structures of the movie database.
  */
@@ -21,6 +85,16 @@ struct database {
      * The trie mapping movie name -> movie id.
      */
     struct trie_node trie_root;
+    /**
+     * The dictionary mapping movie name -> movie id, built once the movies are
+     * loaded.
+     */
+    struct titles_dict titles;
+    /**
+     * Which of trie_root and titles holds the titles; the other one is empty.
+     * Reading is fine, only internal database code is allowed to update this.
+     */
+    enum database_title_index title_index;
     /**
      * The hash table mapping movie id -> movie data.
      */
@@ -33,17 +107,148 @@ struct database {
      * The hash table mapping user tag name -> tag data (associated movies).
      */
     struct tags_table tags;
+    /**
+     * The index mapping genre name -> movies sorted by mean rating, built once
+     * the ratings are loaded.
+     */
+    struct genres_index genres;
+    /**
+     * The index mapping movie index -> users that rated it and how, built once
+     * the ratings are loaded.
+     */
+    struct raters_index raters;
+    /**
+     * The index mapping movie index -> ratings by month they were made in,
+     * built once the ratings are loaded.
+     */
+    struct timeline_index timeline;
+    /**
+     * Stamps of the source CSV files (movies, ratings and tags, in this order),
+     * taken right before loading. Only internal database code is allowed to
+     * touch this.
+     */
+    struct database_stamp sources[DATABASE_SOURCES];
+    /**
+     * Arena holding the strings of movies, the tags, their names and the trie
+     * nodes, all of which live until the database is destroyed. Reading is
+     * fine, only internal database code is allowed to update this.
+     */
+    struct arena arena;
 };
 
+/**
+ * Options on how to load the database.
+ */
+struct database_options {
+    /**
+     * Whether CSV files should be memory-mapped and parsed in place. Files that
+     * cannot be mapped, such as pipes, are read through stdio regardless.
+     */
+    bool use_mmap;
+    /**
+     * How many threads parse the ratings CSV file. Only memory-mapped files
+     * are parsed in parallel; 1 means serial loading.
+     */
+    unsigned threads;
+    /**
+     * Whether the database should be restored from the snapshot when it is up
+     * to date with the CSV files.
+     */
+    bool use_snapshot;
+    /**
+     * Which index movie titles are searched by.
+     */
+    enum database_title_index title_index;
+};
+
+/**
+ * Statistics of loading a single CSV file.
+ */
+struct database_file_stats {
+    /**
+     * Elapsed (wall-clock) time spent loading the file, in seconds.
+     */
+    double seconds;
+    /**
+     * How many rows of the file were loaded into the database.
+     */
+    unsigned long rows;
+    /**
+     * Whether the file was memory-mapped, rather than read through stdio.
+     */
+    bool mapped;
+};
+
+/**
+ * Statistics of loading a database.
+ */
+struct database_stats {
+    /**
+     * Statistics of loading movie.csv.
+     */
+    struct database_file_stats movies;
+    /**
+     * Statistics of loading rating.csv.
+     */
+    struct database_file_stats ratings;
+    /**
+     * Statistics of loading tag.csv.
+     */
+    struct database_file_stats tags;
+    /**
+     * Whether the database was restored from the snapshot instead of parsing
+     * the CSV files. If so, the CSV file statistics are meaningless.
+     */
+    bool from_snapshot;
+    /**
+     * Elapsed (wall-clock) time spent restoring the snapshot, in seconds.
+     */
+    double snapshot_seconds;
+    /**
+     * Elapsed (wall-clock) time spent summarizing the rating histograms of
+     * movies, building the genres index, sealing the movie sets of tags and
+     * the ratings of users, and building the raters and timeline indices,
+     * after either loading the CSV files or restoring the snapshot, and then
+     * either sealing the title dictionary or ranking the completions of the
+     * trie, which a snapshot restores, in seconds.
+     */
+    double index_seconds;
+};
+
+/**
+ * Initializes the database options to the defaults: memory-mapping and
+ * snapshots enabled, one thread per online processor, and titles in the trie.
+ */
+void database_options_init(struct database_options *restrict options);
+
+/**
+ * Parses the name of a title index, "trie" or "dict", as given in the command
+ * line. Returns whether the name is valid.
+ */
+bool database_parse_title_index(
+        char const *restrict name,
+        enum database_title_index *restrict index_out);
+
 /**
  * Initializes and loads a database. database_out should not be initialized, but
- * buf and error should.
+ * buf and error should. Statistics of the load are written into stats_out.
  */
 void database_load(
         struct database *restrict database_out,
+        struct database_options const *restrict options,
+        struct database_stats *restrict stats_out,
         struct strbuf *restrict buf,
         struct error *restrict error);
 
+/**
+ * Writes a snapshot of the given loaded database, stamped with its source
+ * files, so the next load can skip parsing the CSV files. The file is replaced
+ * atomically.
+ */
+void database_write_snapshot(
+        struct database const *restrict database,
+        struct error *restrict error);
+
 /**
  * Destroys the database, by destroying every data structure it holds.
  */
@@ -0,0 +1,117 @@
+#include <string.h>
+#include "estimate.h"
+#include "../alloc.h"
+#include "../io.h"
+
+/**
+ * Counts the rows of the given sample and the runs of rows with the same first
+ * field, then extrapolates them to the given file size.
+ */
+static bool count_sample(
+        char const *sample,
+        size_t length,
+        uint64_t size,
+        struct database_estimate *restrict estimate_out);
+
+bool database_estimate(
+        char const *restrict path,
+        uint64_t size,
+        struct database_estimate *restrict estimate_out)
+{
+    struct error error;
+    FILE *file;
+    char *sample = NULL;
+    size_t length = 0;
+    bool estimated = false;
+
+    error_init(&error);
+    file = input_file_open(path, &error);
+
+    if (error.code == error_none) {
+        sample = moviedb_alloc(
+                sizeof(*sample),
+                DATABASE_ESTIMATE_SAMPLE,
+                &error);
+
+        if (error.code == error_none) {
+            length = fread(sample, 1, DATABASE_ESTIMATE_SAMPLE, file);
+        }
+
+        input_file_close(file);
+    }
+
+    if (error.code == error_none) {
+        estimated = count_sample(sample, length, size, estimate_out);
+    }
+
+    moviedb_free(sample);
+    error_destroy(&error);
+
+    return estimated;
+}
+
+static bool count_sample(
+        char const *sample,
+        size_t length,
+        uint64_t size,
+        struct database_estimate *restrict estimate_out)
+{
+    /* The whole file was read, so the counts are exact. */
+    bool whole = length >= size;
+    char const *newline;
+    char const *comma;
+    char const *key = NULL;
+    size_t key_length = 0;
+    size_t prev_length = 0;
+    size_t first_row;
+    size_t rows_end;
+    size_t start;
+    size_t end;
+    size_t rows = 0;
+    size_t runs = 0;
+    double scale;
+
+    /* Skips the header. */
+    newline = memchr(sample, '\n', length);
+    start = newline == NULL ? length : newline - sample + 1;
+    first_row = start;
+    rows_end = start;
+
+    while (start < length) {
+        newline = memchr(sample + start, '\n', length - start);
+        end = newline == NULL ? length : newline - sample;
+
+        /* A row cut by the end of the sample is not counted. */
+        if (newline != NULL || whole) {
+            comma = memchr(sample + start, ',', end - start);
+            prev_length = key_length;
+            key_length = comma == NULL ? end - start : comma - sample - start;
+
+            if (key == NULL
+                    || key_length != prev_length
+                    || memcmp(key, sample + start, key_length) != 0) {
+                runs++;
+            }
+
+            key = sample + start;
+            rows++;
+            rows_end = end + 1;
+        }
+
+        start = end + 1;
+    }
+
+    if (rows > 0) {
+        estimate_out->rows = rows;
+        estimate_out->keys = runs;
+
+        if (!whole) {
+            /* Extrapolates from the average length of the sampled rows. */
+            scale = (double) (size - first_row) / (rows_end - first_row);
+            estimate_out->rows = rows * scale;
+            estimate_out->keys = runs * scale;
+        }
+    }
+
+    return rows > 0;
+}
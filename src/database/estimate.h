@@ -0,0 +1,51 @@
+#ifndef MOVIEDB_DATABASE_ESTIMATE_H
+#define MOVIEDB_DATABASE_ESTIMATE_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * This file provides estimates of how many rows and keys a CSV file holds,
+ * from a sample of its beginning, so tables can be presized before loading it.
+ * Only internal database code is allowed to touch this.
+ */
+
+/**
+ * How many bytes are sampled from the beginning of a file.
+ */
+#define DATABASE_ESTIMATE_SAMPLE 0x10000
+
+/**
+ * Estimated counts of a CSV file.
+ */
+struct database_estimate {
+    /**
+     * Estimated number of rows, not counting the header.
+     */
+    size_t rows;
+    /**
+     * Estimated number of distinct values in the first column, assuming rows
+     * are grouped by it (e.g. ratings grouped by user). If they are not, this
+     * is an overestimate, up to the number of rows.
+     */
+    size_t keys;
+};
+
+/**
+ * Estimates the counts of the CSV file at the given path, with the given size
+ * in bytes: the average length of the rows in the sample gives the number of
+ * rows, and the average length of the runs of rows with the same first field
+ * gives the number of keys. The counts are exact if the whole file fits in the
+ * sample.
+ *
+ * Returns whether the estimate could be made; a file that cannot be read, or
+ * whose sample has no complete row, yields no estimate. No error is reported,
+ * since an estimate is never required for loading.
+ */
+bool database_estimate(
+        char const *restrict path,
+        uint64_t size,
+        struct database_estimate *restrict estimate_out);
+
+#endif
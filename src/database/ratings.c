@@ -0,0 +1,355 @@
+#include <pthread.h>
+#include <string.h>
+#include "ratings.h"
+#include "../alloc.h"
+
+/**
+ * How many bytes of the file a worker parses at once. The actual block is
+ * extended to the end of the row.
+ */
+#define BLOCK_SIZE 0x400000
+
+/**
+ * A block of the ratings file, parsed by a worker thread.
+ */
+struct rating_block {
+    /**
+     * Parser over the block's bytes only. Lines are counted from 1 at the
+     * start of the block.
+     */
+    struct rating_parser parser;
+    /**
+     * Scratch buffer of the worker.
+     */
+    struct strbuf buf;
+    /**
+     * Rows parsed from this block, in file order.
+     */
+    struct rating_csv_row *rows;
+    /**
+     * How many rows were parsed.
+     */
+    size_t length;
+    /**
+     * How many rows can be stored without reallocating.
+     */
+    size_t capacity;
+    /**
+     * Error found while parsing this block, if any.
+     */
+    struct error error;
+    /**
+     * The worker thread parsing this block.
+     */
+    pthread_t thread;
+    /**
+     * Whether the block is being parsed by a worker thread that must be joined.
+     */
+    bool running;
+};
+
+/**
+ * A round of blocks, one per worker thread.
+ */
+struct rating_round {
+    /**
+     * The blocks of this round.
+     */
+    struct rating_block *blocks;
+    /**
+     * How many blocks are in use in this round.
+     */
+    unsigned length;
+};
+
+/**
+ * Worker thread's entry point. Parses all the rows of the given block.
+ */
+static void *parse_block(void *block_ptr);
+
+/**
+ * Appends a row to the block's rows.
+ */
+static void block_append(
+        struct rating_block *restrict block,
+        struct rating_csv_row const *restrict row);
+
+/**
+ * Splits the next blocks from the data, starting at position, and starts
+ * parsing them. Returns the position after the last started block.
+ */
+static size_t round_start(
+        struct rating_round *restrict round,
+        struct rating_parser const *restrict parser,
+        size_t position,
+        unsigned threads);
+
+/**
+ * Waits for all the blocks of a round to be parsed.
+ */
+static void round_join(struct rating_round *restrict round);
+
+/**
+ * Merges the blocks of a round into the database, in order. Accounts lines of
+ * the merged blocks into line_offset, in order to locate errors, and merged
+ * rows into rows.
+ */
+static void round_merge(
+        struct rating_round *restrict round,
+        struct database *restrict database,
+        unsigned long *restrict line_offset,
+        unsigned long *restrict rows,
+        struct error *restrict error);
+
+void database_insert_rating(
+        struct database *restrict database,
+        struct rating_csv_row const *restrict row,
+        struct error *restrict error)
+{
+    moviedb_index_t movie;
+
+    if (movies_index(&database->movies, row->movieid, &movie)) {
+        users_insert_rating(&database->users, row, movie, error);
+
+        if (error->code == error_none) {
+            movies_add_rating(
+                    &database->movies,
+                    movie,
+                    rating_encode(row->value));
+        }
+    }
+}
+
+unsigned long database_load_ratings_parallel(
+        struct database *restrict database,
+        struct rating_parser const *restrict parser,
+        unsigned threads,
+        struct error *restrict error)
+{
+    /* Two rounds: one being merged while the other is being parsed. */
+    struct rating_round rounds[2];
+    size_t position = parser->csv_parser.position;
+    /* Lines before the first block, i.e. the header. */
+    unsigned long line_offset = parser->csv_parser.line - 1;
+    unsigned long rows = 0;
+    unsigned current = 0;
+    unsigned i, j;
+
+    rounds[0].blocks = moviedb_alloc(sizeof(*rounds[0].blocks), threads, error);
+    rounds[0].length = 0;
+
+    if (error->code == error_none) {
+        rounds[1].blocks = moviedb_alloc(
+                sizeof(*rounds[1].blocks),
+                threads,
+                error);
+        rounds[1].length = 0;
+
+        if (error->code != error_none) {
+            moviedb_free(rounds[0].blocks);
+        }
+    }
+
+    if (error->code == error_none) {
+        for (i = 0; i < 2; i++) {
+            for (j = 0; j < threads; j++) {
+                strbuf_init(&rounds[i].blocks[j].buf);
+                error_init(&rounds[i].blocks[j].error);
+                rounds[i].blocks[j].rows = NULL;
+                rounds[i].blocks[j].capacity = 0;
+                rounds[i].blocks[j].running = false;
+            }
+        }
+
+        position = round_start(&rounds[current], parser, position, threads);
+
+        while (rounds[current].length > 0) {
+            round_join(&rounds[current]);
+            /* Parses the next round while this one is merged. */
+            if (error->code == error_none) {
+                position = round_start(
+                        &rounds[1 - current],
+                        parser,
+                        position,
+                        threads);
+            } else {
+                rounds[1 - current].length = 0;
+            }
+
+            if (error->code == error_none) {
+                round_merge(
+                        &rounds[current],
+                        database,
+                        &line_offset,
+                        &rows,
+                        error);
+            }
+
+            current = 1 - current;
+        }
+
+        for (i = 0; i < 2; i++) {
+            for (j = 0; j < threads; j++) {
+                strbuf_destroy(&rounds[i].blocks[j].buf);
+                error_destroy(&rounds[i].blocks[j].error);
+                moviedb_free(rounds[i].blocks[j].rows);
+            }
+            moviedb_free(rounds[i].blocks);
+        }
+    }
+
+    return rows;
+}
+
+static void *parse_block(void *block_ptr)
+{
+    struct rating_block *block = block_ptr;
+    struct rating_csv_row row;
+    bool has_data = true;
+
+    block->length = 0;
+
+    while (has_data) {
+        has_data = rating_row_parse(
+                &block->parser,
+                &block->buf,
+                &row,
+                &block->error);
+
+        if (has_data) {
+            block_append(block, &row);
+            has_data = block->error.code == error_none;
+        }
+    }
+
+    return NULL;
+}
+
+static void block_append(
+        struct rating_block *restrict block,
+        struct rating_csv_row const *restrict row)
+{
+    struct rating_csv_row *new_rows;
+    size_t new_cap;
+
+    if (block->length == block->capacity) {
+        /* Doubles capacity, handles the case where capacity == 0. */
+        new_cap = block->capacity * 2;
+        if (new_cap == 0) {
+            new_cap = 1024;
+        }
+        new_rows = moviedb_realloc(
+                block->rows,
+                sizeof(*new_rows),
+                new_cap,
+                &block->error);
+
+        if (block->error.code == error_none) {
+            block->rows = new_rows;
+            block->capacity = new_cap;
+        }
+    }
+
+    if (block->error.code == error_none) {
+        block->rows[block->length] = *row;
+        block->length++;
+    }
+}
+
+static size_t round_start(
+        struct rating_round *restrict round,
+        struct rating_parser const *restrict parser,
+        size_t position,
+        unsigned threads)
+{
+    char const *data = parser->csv_parser.data;
+    size_t length = parser->csv_parser.length;
+    char const *newline;
+    size_t end;
+    struct rating_block *block;
+
+    round->length = 0;
+
+    while (round->length < threads && position < length) {
+        block = &round->blocks[round->length];
+
+        /* Extends the block up to the end of the row. */
+        end = position + BLOCK_SIZE;
+        if (end >= length) {
+            end = length;
+        } else {
+            newline = memchr(data + end, '\n', length - end);
+            if (newline == NULL) {
+                end = length;
+            } else {
+                end = newline - data + 1;
+            }
+        }
+
+        block->parser = *parser;
+        csv_parser_init_mem(&block->parser.csv_parser, data + position,
+                end - position);
+
+        /* If a thread cannot be created, parses in the calling thread. */
+        block->running = pthread_create(
+                &block->thread,
+                NULL,
+                parse_block,
+                block) == 0;
+        if (!block->running) {
+            parse_block(block);
+        }
+
+        round->length++;
+        position = end;
+    }
+
+    return position;
+}
+
+static void round_join(struct rating_round *restrict round)
+{
+    unsigned i;
+
+    for (i = 0; i < round->length; i++) {
+        if (round->blocks[i].running) {
+            pthread_join(round->blocks[i].thread, NULL);
+            round->blocks[i].running = false;
+        }
+    }
+}
+
+static void round_merge(
+        struct rating_round *restrict round,
+        struct database *restrict database,
+        unsigned long *restrict line_offset,
+        unsigned long *restrict rows,
+        struct error *restrict error)
+{
+    unsigned i = 0;
+    size_t j;
+    struct rating_block *block;
+
+    while (i < round->length && error->code == error_none) {
+        block = &round->blocks[i];
+
+        /* Rows before a block's error are valid, as in the serial loader. */
+        j = 0;
+        while (j < block->length && error->code == error_none) {
+            database_insert_rating(database, &block->rows[j], error);
+            if (error->code == error_none) {
+                (*rows)++;
+            }
+            j++;
+        }
+
+        if (error->code == error_none && block->error.code != error_none) {
+            /* Makes the block's lines relative to the whole file. */
+            error_add_line_offset(&block->error, *line_offset);
+            error_move(error, &block->error);
+        }
+
+        *line_offset += block->parser.csv_parser.line - 1;
+        i++;
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef MOVIEDB_DATABASE_RATINGS_H
+#define MOVIEDB_DATABASE_RATINGS_H 1
+
+#include "../database.h"
+#include "../csv/rating.h"
+
+/**
+ * This file provides a multi-threaded loader for the ratings CSV file, and the
+ * insertion of rows shared with the serial loader. Only internal database code
+ * is allowed to touch this.
+ */
+
+/**
+ * Inserts a parsed rating into the users table, and adds it to the rated
+ * movie. Ratings of movies not in the movies table are skipped, since the user
+ * query could never show them.
+ */
+void database_insert_rating(
+        struct database *restrict database,
+        struct rating_csv_row const *restrict row,
+        struct error *restrict error);
+
+/**
+ * Loads the remaining rows of the given rating parser into the database, using
+ * the given number of worker threads. The parser must read from memory and
+ * must have parsed the header already.
+ *
+ * The data is split into blocks aligned on row boundaries, which are parsed in
+ * parallel. Parsed blocks are merged into the database in file order while
+ * the next blocks are being parsed, so the result is identical to loading the
+ * rows serially. Errors report the same lines as the serial loader.
+ *
+ * Returns how many rows were inserted into the database.
+ */
+unsigned long database_load_ratings_parallel(
+        struct database *restrict database,
+        struct rating_parser const *restrict parser,
+        unsigned threads,
+        struct error *restrict error);
+
+#endif
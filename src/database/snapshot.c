@@ -0,0 +1,1287 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "snapshot.h"
+#include "../io.h"
+
+/**
+ * Magic bytes at the start of every snapshot.
+ */
+#define SNAPSHOT_MAGIC "MOVIEDB\x1a"
+
+/**
+ * Written as a 32-bit integer, tells whether the snapshot was written on a
+ * machine with the same byte order.
+ */
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+
+/**
+ * Every section starts at a multiple of this many bytes, so its records are
+ * aligned when the snapshot is mapped.
+ */
+#define SNAPSHOT_ALIGN 8
+
+/**
+ * Header of a snapshot. Counts are numbers of records of each section, except
+ * for the container storage, the title dictionary bytes and the strings, which
+ * are sizes in bytes.
+ */
+struct snapshot_header {
+    /**
+     * Should be SNAPSHOT_MAGIC.
+     */
+    char magic[8];
+    /**
+     * Should be SNAPSHOT_VERSION.
+     */
+    uint32_t version;
+    /**
+     * Should be SNAPSHOT_BYTE_ORDER.
+     */
+    uint32_t byte_order;
+    /**
+     * Should be MOVIEDB_HASH_MODE, padded with NUL bytes, since hash tables
+     * are written with their entries where this build probes for them.
+     */
+    char hash_mode[8];
+    /**
+     * Should be sizeof(size_t), the size of offsets.
+     */
+    uint32_t word_size;
+    /**
+     * Which index the titles are written for, see database_title_index.
+     */
+    uint32_t title_index;
+    /**
+     * Stamps of the source CSV files this snapshot was loaded from.
+     */
+    struct database_stamp sources[DATABASE_SOURCES];
+    /**
+     * Number of movie records.
+     */
+    uint64_t movies;
+    /**
+     * Capacity of the movies hash table.
+     */
+    uint64_t movies_capacity;
+    /**
+     * Number of users.
+     */
+    uint64_t users;
+    /**
+     * Capacity of the users hash table.
+     */
+    uint64_t users_capacity;
+    /**
+     * Number of ratings.
+     */
+    uint64_t ratings;
+    /**
+     * Number of tag records.
+     */
+    uint64_t tags;
+    /**
+     * Capacity of the tags hash table.
+     */
+    uint64_t tags_capacity;
+    /**
+     * Number of bitmap containers of the movie sets of tags.
+     */
+    uint64_t containers;
+    /**
+     * Size of the storage of the containers in bytes, padded.
+     */
+    uint64_t container_bytes;
+    /**
+     * Number of trie nodes.
+     */
+    uint64_t trie_nodes;
+    /**
+     * Size of the trie labels in bytes.
+     */
+    uint64_t trie_labels;
+    /**
+     * Number of trie completions.
+     */
+    uint64_t trie_completions;
+    /**
+     * Number of titles in the title dictionary.
+     */
+    uint64_t titles;
+    /**
+     * Size of the front-coded title dictionary in bytes.
+     */
+    uint64_t titles_bytes;
+    /**
+     * Size of the string pool in bytes.
+     */
+    uint64_t strings;
+};
+
+/**
+ * A movie in a snapshot, by index. Strings are offsets into the string pool.
+ */
+struct snapshot_movie {
+    uint64_t id;
+    struct rating_histogram histogram;
+    uint64_t title;
+    uint64_t genres;
+};
+
+/**
+ * A tag in a snapshot, in the order of the hash table entries. The name is an
+ * offset into the string pool. Its containers follow the ones of the previous
+ * tag in the containers section.
+ */
+struct snapshot_tag {
+    uint64_t slot;
+    uint64_t hash;
+    uint64_t name;
+    uint64_t containers;
+};
+
+/**
+ * The sections of a mapped snapshot.
+ */
+struct snapshot_view {
+    struct snapshot_header const *header;
+    struct snapshot_movie const *movies;
+    struct movies_entry const *movie_entries;
+    unsigned char const *movie_fingerprints;
+    moviedb_id_t const *users;
+    size_t const *offsets;
+    struct user_rating const *ratings;
+    struct users_entry const *user_entries;
+    unsigned char const *user_fingerprints;
+    struct snapshot_tag const *tags;
+    struct bitmap_container const *containers;
+    char const *container_data;
+    struct trie_flat trie;
+    struct titles_flat titles;
+    char const *strings;
+};
+
+/**
+ * Splits the mapped snapshot into its sections, validating the header against
+ * the given database's source stamps and title index, and validating the
+ * sections with the check functions. Returns whether the snapshot is valid and
+ * up to date.
+ */
+static bool view_init(
+        struct snapshot_view *restrict view_out,
+        struct input_map const *restrict map,
+        struct database const *restrict database);
+
+/**
+ * Takes a section of count records of the given size from the start of the
+ * remaining bytes, advancing them. Returns NULL if there are not enough bytes.
+ */
+static void const *view_take(
+        char const **cursor,
+        size_t *restrict remaining,
+        uint64_t count,
+        size_t size);
+
+/**
+ * Tests whether a hash table of the given capacity holding the given number of
+ * entries could have been written by this build: its capacity is one
+ * moviedb_hash_capacity returns, below the maximum load, and exactly that many
+ * entries are occupied.
+ */
+static bool check_table(
+        unsigned char const *restrict fingerprints,
+        uint64_t capacity,
+        uint64_t length);
+
+/**
+ * Tests whether the string pool ends with a terminator, so every offset into
+ * it is safe to read a string from.
+ */
+static bool check_strings(struct snapshot_view const *restrict view);
+
+/**
+ * Tests whether the movie records point into the string pool, and whether the
+ * ID of every movie is found in the hash table at its own index, which also
+ * rules out duplicate IDs.
+ */
+static bool check_movies(struct snapshot_view const *restrict view);
+
+/**
+ * Tests whether the offsets split the ratings among the users, whether the
+ * ratings are sorted by movie and refer to movies there are, and whether the ID
+ * of every user is found in the hash table at its own index.
+ */
+static bool check_users(struct snapshot_view const *restrict view);
+
+/**
+ * Tests whether the tag records are in distinct entries of the hash table,
+ * where probing for their names, with their hashes, finds them, and whether
+ * their containers are well formed, sorted and hold only movies there are.
+ */
+static bool check_tags(struct snapshot_view const *restrict view);
+
+/**
+ * Finds the record of the tag in the given entry of the hash table, by binary
+ * search. Returns the number of tags if the entry is empty.
+ */
+static uint64_t find_tag(
+        struct snapshot_view const *restrict view,
+        uint64_t slot);
+
+/**
+ * Tests whether the title index written is the given database's, and can be
+ * searched safely, the other one being empty.
+ */
+static bool check_titles(
+        struct snapshot_view const *restrict view,
+        struct database const *restrict database);
+
+/**
+ * Restores the movies and their hash table from the snapshot.
+ */
+static void restore_movies(
+        struct database *restrict database,
+        struct snapshot_view const *restrict view,
+        struct error *restrict error);
+
+/**
+ * Restores the users, their ratings and their hash table from the snapshot.
+ */
+static void restore_users(
+        struct database *restrict database,
+        struct snapshot_view const *restrict view,
+        struct error *restrict error);
+
+/**
+ * Restores the tags, their hash table and their movies from the snapshot.
+ */
+static void restore_tags(
+        struct database *restrict database,
+        struct snapshot_view const *restrict view,
+        struct error *restrict error);
+
+/**
+ * Restores the trie or the title dictionary from the snapshot.
+ */
+static void restore_titles(
+        struct database *restrict database,
+        struct snapshot_view const *restrict view,
+        struct error *restrict error);
+
+/**
+ * Writes the given bytes into the file, unless an error already happened.
+ */
+static void write_bytes(
+        FILE *file,
+        void const *data,
+        size_t size,
+        struct error *restrict error);
+
+/**
+ * Writes zeros after a section of the given size, up to SNAPSHOT_ALIGN.
+ */
+static void write_padding(
+        FILE *file,
+        uint64_t size,
+        struct error *restrict error);
+
+/**
+ * Writes the given bytes as a whole section, padded.
+ */
+static void write_section(
+        FILE *file,
+        void const *data,
+        size_t size,
+        struct error *restrict error);
+
+/**
+ * Writes the movie records and the hash table, counting them and the string
+ * pool bytes into the header.
+ */
+static void write_movies(
+        FILE *file,
+        struct database const *restrict database,
+        struct snapshot_header *restrict header,
+        struct error *restrict error);
+
+/**
+ * Writes the user IDs, the offsets and packed ratings, and the hash table,
+ * counting them into the header.
+ */
+static void write_users(
+        FILE *file,
+        struct database const *restrict database,
+        struct snapshot_header *restrict header,
+        struct error *restrict error);
+
+/**
+ * Writes the tag records, their containers and their storage, counting them
+ * and the string pool bytes into the header.
+ */
+static void write_tags(
+        FILE *file,
+        struct database const *restrict database,
+        struct snapshot_header *restrict header,
+        struct error *restrict error);
+
+/**
+ * Writes the flattened trie, or the arrays of the title dictionary, counting
+ * them into the header.
+ */
+static void write_titles(
+        FILE *file,
+        struct database const *restrict database,
+        struct snapshot_header *restrict header,
+        struct error *restrict error);
+
+/**
+ * Writes the string pool, in the same order as the records were written.
+ */
+static void write_strings(
+        FILE *file,
+        struct database const *restrict database,
+        struct error *restrict error);
+
+bool database_snapshot_read(
+        struct database *restrict database,
+        char const *restrict path,
+        struct error *restrict error)
+{
+    struct input_map map;
+    struct snapshot_view view;
+    bool mapped;
+    bool restored = false;
+
+    mapped = input_map_open(path, &map, error);
+
+    if (error->code != error_none) {
+        /* A missing or unreadable snapshot is simply not used. */
+        error_set_code(error, error_none);
+        mapped = false;
+    }
+
+    if (mapped) {
+        if (view_init(&view, &map, database)) {
+            restore_movies(database, &view, error);
+
+            if (error->code == error_none) {
+                restore_users(database, &view, error);
+            }
+
+            if (error->code == error_none) {
+                restore_tags(database, &view, error);
+            }
+
+            if (error->code == error_none) {
+                restore_titles(database, &view, error);
+            }
+
+            if (error->code != error_none) {
+                error_set_context(error, path, false);
+            }
+
+            restored = true;
+        }
+
+        input_map_close(&map);
+    }
+
+    return restored;
+}
+
+void database_snapshot_write(
+        struct database const *restrict database,
+        char const *restrict path,
+        struct error *restrict error)
+{
+    size_t path_length = strlen(path);
+    char *tmp_path;
+    FILE *file = NULL;
+    struct snapshot_header header;
+
+    tmp_path = moviedb_alloc(sizeof(*tmp_path), path_length + 5, error);
+
+    if (error->code == error_none) {
+        memcpy(tmp_path, path, path_length);
+        memcpy(tmp_path + path_length, ".tmp", 5);
+
+        file = fopen(tmp_path, "wb");
+        if (file == NULL) {
+            error_set_code(error, error_io);
+            error->data.io.sys_errno = errno;
+        }
+    }
+
+    if (error->code == error_none) {
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+        header.version = SNAPSHOT_VERSION;
+        header.byte_order = SNAPSHOT_BYTE_ORDER;
+        memcpy(header.hash_mode,
+                MOVIEDB_HASH_MODE,
+                strlen(MOVIEDB_HASH_MODE));
+        header.word_size = sizeof(size_t);
+        header.title_index = database->title_index;
+        memcpy(header.sources, database->sources, sizeof(header.sources));
+
+        /* Reserves room for the header, rewritten once the counts are known. */
+        write_bytes(file, &header, sizeof(header), error);
+        write_movies(file, database, &header, error);
+        write_users(file, database, &header, error);
+        write_tags(file, database, &header, error);
+        write_titles(file, database, &header, error);
+        write_strings(file, database, error);
+
+        if (error->code == error_none && fseek(file, 0, SEEK_SET) != 0) {
+            error_set_code(error, error_io);
+            error->data.io.sys_errno = errno;
+        }
+        write_bytes(file, &header, sizeof(header), error);
+
+        if (fclose(file) != 0 && error->code == error_none) {
+            error_set_code(error, error_io);
+            error->data.io.sys_errno = errno;
+        }
+
+        if (error->code == error_none && rename(tmp_path, path) != 0) {
+            error_set_code(error, error_io);
+            error->data.io.sys_errno = errno;
+        }
+
+        if (error->code != error_none) {
+            remove(tmp_path);
+        }
+    }
+
+    moviedb_free(tmp_path);
+
+    if (error->code != error_none) {
+        error_set_context(error, path, false);
+    }
+}
+
+static bool view_init(
+        struct snapshot_view *restrict view_out,
+        struct input_map const *restrict map,
+        struct database const *restrict database)
+{
+    char const *cursor = map->data;
+    size_t remaining = map->length;
+    struct snapshot_header const *header;
+    struct database_stamp const *stamp;
+    char hash_mode[sizeof(header->hash_mode)] = {0};
+    uint64_t i;
+    bool valid;
+
+    memcpy(hash_mode, MOVIEDB_HASH_MODE, strlen(MOVIEDB_HASH_MODE));
+
+    header = view_take(&cursor, &remaining, 1, sizeof(*header));
+    valid = header != NULL
+        && memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) == 0
+        && header->version == SNAPSHOT_VERSION
+        && header->byte_order == SNAPSHOT_BYTE_ORDER
+        && memcmp(header->hash_mode, hash_mode, sizeof(hash_mode)) == 0
+        && header->word_size == sizeof(size_t)
+        && header->title_index == database->title_index;
+
+    /* Checks whether the source files changed since the snapshot. */
+    for (i = 0; valid && i < DATABASE_SOURCES; i++) {
+        stamp = &header->sources[i];
+        valid = stamp->size == database->sources[i].size
+            && stamp->mtime_sec == database->sources[i].mtime_sec
+            && stamp->mtime_nsec == database->sources[i].mtime_nsec;
+    }
+
+    if (valid) {
+        /* Indices of movies and users must fit in a moviedb_index_t. */
+        valid = header->movies <= MOVIEDB_INDEX_MAX
+            && header->users <= MOVIEDB_INDEX_MAX
+            && header->titles <= SIZE_MAX - TITLES_BUCKET;
+    }
+
+    if (valid) {
+        view_out->header = header;
+        view_out->movies = view_take(
+                &cursor,
+                &remaining,
+                header->movies,
+                sizeof(*view_out->movies));
+        view_out->movie_entries = view_take(
+                &cursor,
+                &remaining,
+                header->movies_capacity,
+                sizeof(*view_out->movie_entries));
+        view_out->movie_fingerprints = view_take(
+                &cursor,
+                &remaining,
+                header->movies_capacity,
+                sizeof(*view_out->movie_fingerprints));
+        view_out->users = view_take(
+                &cursor,
+                &remaining,
+                header->users,
+                sizeof(*view_out->users));
+        view_out->offsets = view_take(
+                &cursor,
+                &remaining,
+                header->users + 1,
+                sizeof(*view_out->offsets));
+        view_out->ratings = view_take(
+                &cursor,
+                &remaining,
+                header->ratings,
+                sizeof(*view_out->ratings));
+        view_out->user_entries = view_take(
+                &cursor,
+                &remaining,
+                header->users_capacity,
+                sizeof(*view_out->user_entries));
+        view_out->user_fingerprints = view_take(
+                &cursor,
+                &remaining,
+                header->users_capacity,
+                sizeof(*view_out->user_fingerprints));
+        view_out->tags = view_take(
+                &cursor,
+                &remaining,
+                header->tags,
+                sizeof(*view_out->tags));
+        view_out->containers = view_take(
+                &cursor,
+                &remaining,
+                header->containers,
+                sizeof(*view_out->containers));
+        view_out->container_data = view_take(
+                &cursor,
+                &remaining,
+                header->container_bytes,
+                1);
+        view_out->trie.nodes = view_take(
+                &cursor,
+                &remaining,
+                header->trie_nodes,
+                sizeof(*view_out->trie.nodes));
+        view_out->trie.length = header->trie_nodes;
+        view_out->trie.labels = view_take(
+                &cursor,
+                &remaining,
+                header->trie_labels,
+                1);
+        view_out->trie.labels_length = header->trie_labels;
+        view_out->trie.completions = view_take(
+                &cursor,
+                &remaining,
+                header->trie_completions,
+                sizeof(*view_out->trie.completions));
+        view_out->trie.completions_length = header->trie_completions;
+        view_out->titles.bytes = view_take(
+                &cursor,
+                &remaining,
+                header->titles_bytes,
+                1);
+        view_out->titles.bytes_length = header->titles_bytes;
+        view_out->titles.buckets = view_take(
+                &cursor,
+                &remaining,
+                (header->titles + TITLES_BUCKET - 1) / TITLES_BUCKET,
+                sizeof(*view_out->titles.buckets));
+        view_out->titles.movies = view_take(
+                &cursor,
+                &remaining,
+                header->titles,
+                sizeof(*view_out->titles.movies));
+        view_out->titles.length = header->titles;
+        view_out->strings = cursor;
+
+        valid = view_out->movies != NULL
+            && view_out->movie_entries != NULL
+            && view_out->movie_fingerprints != NULL
+            && view_out->users != NULL
+            && view_out->offsets != NULL
+            && view_out->ratings != NULL
+            && view_out->user_entries != NULL
+            && view_out->user_fingerprints != NULL
+            && view_out->tags != NULL
+            && view_out->containers != NULL
+            && view_out->container_data != NULL
+            && view_out->trie.nodes != NULL
+            && view_out->trie.labels != NULL
+            && view_out->trie.completions != NULL
+            && view_out->titles.bytes != NULL
+            && view_out->titles.buckets != NULL
+            && view_out->titles.movies != NULL
+            && remaining == header->strings;
+    }
+
+    /*
+     * Anything that does not match what this build would have written makes
+     * the snapshot stale, so the CSV files are loaded instead.
+     */
+    return valid
+        && check_strings(view_out)
+        && check_movies(view_out)
+        && check_users(view_out)
+        && check_tags(view_out)
+        && check_titles(view_out, database);
+}
+
+static void const *view_take(
+        char const **cursor,
+        size_t *restrict remaining,
+        uint64_t count,
+        size_t size)
+{
+    void const *section = NULL;
+    size_t bytes;
+
+    if (count <= *remaining / size) {
+        /* Sections are padded up to the alignment of the next one. */
+        bytes = count * size;
+        bytes += (SNAPSHOT_ALIGN - bytes % SNAPSHOT_ALIGN) % SNAPSHOT_ALIGN;
+
+        if (bytes <= *remaining) {
+            section = *cursor;
+            *cursor += bytes;
+            *remaining -= bytes;
+        }
+    }
+
+    return section;
+}
+
+static bool check_table(
+        unsigned char const *restrict fingerprints,
+        uint64_t capacity,
+        uint64_t length)
+{
+    uint64_t i;
+    uint64_t occupied = 0;
+    bool valid;
+
+    /*
+     * Below the maximum load, probing always reaches an empty entry, so
+     * searches for IDs that are not in the table end.
+     */
+    valid = capacity > 0
+        && moviedb_hash_capacity(capacity) == capacity
+        && length < capacity / 2;
+
+    for (i = 0; valid && i < capacity; i++) {
+        if (fingerprints[i] != 0) {
+            occupied++;
+        }
+    }
+
+    return valid && occupied == length;
+}
+
+static bool check_strings(struct snapshot_view const *restrict view)
+{
+    /*
+     * Strings are read up to their terminator, so the pool must end with one
+     * for every offset into it to be safe.
+     */
+    return view->header->strings == 0
+        || view->strings[view->header->strings - 1] == 0;
+}
+
+static bool check_movies(struct snapshot_view const *restrict view)
+{
+    struct snapshot_header const *header = view->header;
+    struct snapshot_movie const *record;
+    moviedb_hash_t hash;
+    moviedb_hash_t attempt;
+    size_t slot;
+    unsigned char fingerprint;
+    uint64_t i;
+    bool valid;
+
+    valid = check_table(
+            view->movie_fingerprints,
+            header->movies_capacity,
+            header->movies);
+
+    for (i = 0; valid && i < header->movies; i++) {
+        record = &view->movies[i];
+        valid = record->title < header->strings
+            && record->genres < header->strings;
+
+        /* Probes for the ID as movies_search does. */
+        hash = moviedb_id_hash(record->id);
+        fingerprint = moviedb_hash_fingerprint(hash);
+        attempt = 0;
+        slot = moviedb_hash_to_index(hash, attempt, header->movies_capacity);
+        while (valid
+                && view->movie_fingerprints[slot] != 0
+                && (view->movie_fingerprints[slot] != fingerprint
+                    || view->movie_entries[slot].id != record->id)) {
+            attempt++;
+            slot = moviedb_hash_to_index(
+                    hash,
+                    attempt,
+                    header->movies_capacity);
+        }
+
+        valid = valid
+            && view->movie_fingerprints[slot] != 0
+            && view->movie_entries[slot].index == i;
+    }
+
+    return valid;
+}
+
+static bool check_users(struct snapshot_view const *restrict view)
+{
+    struct snapshot_header const *header = view->header;
+    moviedb_hash_t hash;
+    moviedb_hash_t attempt;
+    size_t slot;
+    unsigned char fingerprint;
+    uint64_t i;
+    uint64_t j;
+    bool valid;
+
+    valid = check_table(
+            view->user_fingerprints,
+            header->users_capacity,
+            header->users)
+        && view->offsets[0] == 0
+        && view->offsets[header->users] == header->ratings;
+
+    for (i = 0; valid && i < header->users; i++) {
+        valid = view->offsets[i] <= view->offsets[i + 1]
+            && view->offsets[i + 1] <= header->ratings;
+
+        /* Ratings of each user are sorted by movie, as users_seal leaves. */
+        for (j = view->offsets[i]; valid && j < view->offsets[i + 1]; j++) {
+            valid = view->ratings[j].movie < header->movies
+                && view->ratings[j].code < RATING_CODES
+                && (j == view->offsets[i]
+                    || view->ratings[j - 1].movie <= view->ratings[j].movie);
+        }
+
+        /* Probes for the ID as users_search does. */
+        hash = moviedb_id_hash(view->users[i]);
+        fingerprint = moviedb_hash_fingerprint(hash);
+        attempt = 0;
+        slot = moviedb_hash_to_index(hash, attempt, header->users_capacity);
+        while (valid
+                && view->user_fingerprints[slot] != 0
+                && (view->user_fingerprints[slot] != fingerprint
+                    || view->user_entries[slot].id != view->users[i])) {
+            attempt++;
+            slot = moviedb_hash_to_index(
+                    hash,
+                    attempt,
+                    header->users_capacity);
+        }
+
+        valid = valid
+            && view->user_fingerprints[slot] != 0
+            && view->user_entries[slot].index == i;
+    }
+
+    return valid;
+}
+
+static bool check_tags(struct snapshot_view const *restrict view)
+{
+    struct snapshot_header const *header = view->header;
+    struct snapshot_tag const *record;
+    struct bitmap_container const *container;
+    char const *name;
+    moviedb_hash_t attempt;
+    size_t slot;
+    size_t bytes;
+    uint64_t found;
+    uint64_t i;
+    uint64_t j;
+    uint64_t containers = 0;
+    uint64_t data = 0;
+    bool valid;
+
+    /* Tags have no fingerprints of their own, they are made from the hashes. */
+    valid = header->tags_capacity > 0
+        && moviedb_hash_capacity(header->tags_capacity)
+            == header->tags_capacity
+        && header->tags < header->tags_capacity / 2;
+
+    for (i = 0; valid && i < header->tags; i++) {
+        record = &view->tags[i];
+        valid = record->slot < header->tags_capacity
+            && (i == 0 || view->tags[i - 1].slot < record->slot)
+            && record->name < header->strings
+            && record->containers <= header->containers - containers;
+        containers += record->containers;
+    }
+
+    valid = valid && containers == header->containers;
+    containers = 0;
+
+    for (i = 0; valid && i < header->tags; i++) {
+        record = &view->tags[i];
+        name = view->strings + record->name;
+        valid = record->hash == moviedb_hash_str(name);
+
+        /*
+         * Probes for the name as tags_search does. Every entry on the way
+         * must be occupied, by another tag.
+         */
+        attempt = 0;
+        slot = moviedb_hash_to_index(
+                record->hash,
+                attempt,
+                header->tags_capacity);
+        while (valid && slot != record->slot) {
+            found = find_tag(view, slot);
+            valid = found < header->tags
+                && (view->tags[found].hash != record->hash
+                    || strcmp(view->strings + view->tags[found].name, name)
+                        != 0);
+            attempt++;
+            slot = moviedb_hash_to_index(
+                    record->hash,
+                    attempt,
+                    header->tags_capacity);
+        }
+
+        for (j = 0; valid && j < record->containers; j++) {
+            container = &view->containers[containers + j];
+            bytes = bitmap_container_bytes(container);
+            valid = bytes > 0
+                && bytes <= header->container_bytes - data
+                && (j == 0 || container[-1].key < container->key)
+                && bitmap_container_valid(
+                        container,
+                        view->container_data + data,
+                        header->movies);
+
+            if (valid) {
+                /* Storage of every container is padded, as sections are. */
+                bytes += (SNAPSHOT_ALIGN - bytes % SNAPSHOT_ALIGN)
+                    % SNAPSHOT_ALIGN;
+                valid = bytes <= header->container_bytes - data;
+                data += bytes;
+            }
+        }
+
+        containers += record->containers;
+    }
+
+    return valid && data == header->container_bytes;
+}
+
+static uint64_t find_tag(
+        struct snapshot_view const *restrict view,
+        uint64_t slot)
+{
+    uint64_t start = 0;
+    uint64_t end = view->header->tags;
+    uint64_t middle;
+    uint64_t found = view->header->tags;
+
+    while (start < end && found == view->header->tags) {
+        middle = start + (end - start) / 2;
+        if (view->tags[middle].slot < slot) {
+            start = middle + 1;
+        } else if (view->tags[middle].slot > slot) {
+            end = middle;
+        } else {
+            found = middle;
+        }
+    }
+
+    return found;
+}
+
+static bool check_titles(
+        struct snapshot_view const *restrict view,
+        struct database const *restrict database)
+{
+    struct snapshot_header const *header = view->header;
+    bool valid;
+
+    if (database->title_index == database_title_trie) {
+        valid = header->titles == 0
+            && header->titles_bytes == 0
+            && trie_flat_valid(&view->trie);
+    } else {
+        valid = header->trie_nodes == 0
+            && header->trie_labels == 0
+            && header->trie_completions == 0
+            && titles_flat_valid(&view->titles);
+    }
+
+    return valid;
+}
+
+static void restore_movies(
+        struct database *restrict database,
+        struct snapshot_view const *restrict view,
+        struct error *restrict error)
+{
+    uint64_t i;
+    struct snapshot_movie const *record;
+    struct movie_csv_row row;
+
+    movies_reserve(&database->movies, view->header->movies, error);
+
+    /* Movies are appended by index, which the hash table entries refer to. */
+    for (i = 0; error->code == error_none && i < view->header->movies; i++) {
+        record = &view->movies[i];
+        /* The table copies the strings out of the pool. */
+        row.id = record->id;
+        row.title = view->strings + record->title;
+        row.genres = view->strings + record->genres;
+
+        movies_restore_movie(
+                &database->movies,
+                &row,
+                &record->histogram,
+                error);
+    }
+
+    if (error->code == error_none) {
+        movies_restore_entries(
+                &database->movies,
+                view->movie_entries,
+                view->movie_fingerprints,
+                view->header->movies_capacity,
+                error);
+    }
+}
+
+static void restore_users(
+        struct database *restrict database,
+        struct snapshot_view const *restrict view,
+        struct error *restrict error)
+{
+    users_restore(
+            &database->users,
+            view->users,
+            view->header->users,
+            view->offsets,
+            view->ratings,
+            view->user_entries,
+            view->user_fingerprints,
+            view->header->users_capacity,
+            error);
+}
+
+static void restore_tags(
+        struct database *restrict database,
+        struct snapshot_view const *restrict view,
+        struct error *restrict error)
+{
+    uint64_t i;
+    uint64_t j;
+    struct snapshot_tag const *record;
+    struct bitmap_container const *container = view->containers;
+    char const *data = view->container_data;
+    struct tag_movie_set *movies;
+    size_t bytes;
+
+    tags_restore(&database->tags, view->header->tags_capacity, error);
+
+    for (i = 0; error->code == error_none && i < view->header->tags; i++) {
+        record = &view->tags[i];
+        movies = tags_restore_tag(
+                &database->tags,
+                record->slot,
+                record->hash,
+                view->strings + record->name,
+                error);
+
+        for (j = 0; error->code == error_none && j < record->containers; j++) {
+            tag_movies_restore(movies, container, data, error);
+            bytes = bitmap_container_bytes(container);
+            data += bytes + (SNAPSHOT_ALIGN - bytes % SNAPSHOT_ALIGN)
+                % SNAPSHOT_ALIGN;
+            container++;
+        }
+    }
+}
+
+static void restore_titles(
+        struct database *restrict database,
+        struct snapshot_view const *restrict view,
+        struct error *restrict error)
+{
+    if (database->title_index == database_title_trie) {
+        trie_restore(
+                &database->trie_root,
+                &view->trie,
+                &database->arena,
+                error);
+    } else {
+        titles_restore(&database->titles, &view->titles, error);
+    }
+}
+
+static void write_bytes(
+        FILE *file,
+        void const *data,
+        size_t size,
+        struct error *restrict error)
+{
+    if (error->code == error_none && fwrite(data, 1, size, file) != size) {
+        error_set_code(error, error_io);
+        error->data.io.sys_errno = errno;
+    }
+}
+
+static void write_padding(
+        FILE *file,
+        uint64_t size,
+        struct error *restrict error)
+{
+    char const padding[SNAPSHOT_ALIGN] = {0};
+
+    write_bytes(
+            file,
+            padding,
+            (SNAPSHOT_ALIGN - size % SNAPSHOT_ALIGN) % SNAPSHOT_ALIGN,
+            error);
+}
+
+static void write_section(
+        FILE *file,
+        void const *data,
+        size_t size,
+        struct error *restrict error)
+{
+    write_bytes(file, data, size, error);
+    write_padding(file, size, error);
+}
+
+static void write_movies(
+        FILE *file,
+        struct database const *restrict database,
+        struct snapshot_header *restrict header,
+        struct error *restrict error)
+{
+    struct movie const *movie;
+    struct snapshot_movie record;
+    struct movies_entry const *entries;
+    unsigned char const *fingerprints;
+    size_t capacity;
+    size_t i;
+
+    for (i = 0; error->code == error_none && i < database->movies.length; i++) {
+        movie = movies_at(&database->movies, i);
+        memset(&record, 0, sizeof(record));
+        record.id = movie->id;
+        record.histogram = movie->histogram;
+        record.title = header->strings;
+        header->strings += strlen(movie->title) + 1;
+        record.genres = header->strings;
+        header->strings += strlen(movie->genres) + 1;
+
+        write_bytes(file, &record, sizeof(record), error);
+        header->movies++;
+    }
+
+    /* The hash table is written as is, to be copied back. */
+    entries = movies_entries(&database->movies, &fingerprints, &capacity);
+    write_section(file, entries, sizeof(*entries) * capacity, error);
+    write_section(file, fingerprints, capacity, error);
+    header->movies_capacity = capacity;
+}
+
+static void write_users(
+        FILE *file,
+        struct database const *restrict database,
+        struct snapshot_header *restrict header,
+        struct error *restrict error)
+{
+    struct user const *user;
+    struct user_rating const *ratings;
+    struct users_entry const *entries;
+    unsigned char const *fingerprints;
+    size_t capacity;
+    size_t length;
+    size_t offset = 0;
+    size_t i;
+
+    for (i = 0; error->code == error_none && i < database->users.length; i++) {
+        user = users_at(&database->users, i);
+        write_bytes(file, &user->id, sizeof(user->id), error);
+        header->users++;
+    }
+
+    /* Offsets are the ones of the packed ratings, total at the end. */
+    for (i = 0; error->code == error_none && i < database->users.length; i++) {
+        users_ratings(&database->users, users_at(&database->users, i), &length);
+        write_bytes(file, &offset, sizeof(offset), error);
+        offset += length;
+    }
+    write_section(file, &offset, sizeof(offset), error);
+
+    for (i = 0; error->code == error_none && i < database->users.length; i++) {
+        ratings = users_ratings(
+                &database->users,
+                users_at(&database->users, i),
+                &length);
+        write_bytes(file, ratings, sizeof(*ratings) * length, error);
+        header->ratings += length;
+    }
+    write_padding(file, header->ratings * sizeof(*ratings), error);
+
+    entries = users_entries(&database->users, &fingerprints, &capacity);
+    write_section(file, entries, sizeof(*entries) * capacity, error);
+    write_section(file, fingerprints, capacity, error);
+    header->users_capacity = capacity;
+}
+
+static void write_tags(
+        FILE *file,
+        struct database const *restrict database,
+        struct snapshot_header *restrict header,
+        struct error *restrict error)
+{
+    struct tags_entry const *entries;
+    unsigned char const *fingerprints;
+    struct bitmap_container const *containers;
+    struct bitmap_container container;
+    struct snapshot_tag record;
+    size_t capacity;
+    size_t length;
+    size_t bytes;
+    size_t i;
+    size_t j;
+
+    entries = tags_entries(&database->tags, &fingerprints, &capacity);
+    header->tags_capacity = capacity;
+
+    /* Tags are written in the order of the entries they are restored into. */
+    for (i = 0; error->code == error_none && i < capacity; i++) {
+        if (fingerprints[i] != 0) {
+            bitmap_containers(&entries[i].tag->movies.bitmap, &length);
+            record.slot = i;
+            record.hash = entries[i].hash;
+            record.name = header->strings;
+            record.containers = length;
+            header->strings += strlen(entries[i].tag->name) + 1;
+            write_bytes(file, &record, sizeof(record), error);
+            header->tags++;
+        }
+    }
+
+    /* Containers are written in the same order as the tags. */
+    for (i = 0; error->code == error_none && i < capacity; i++) {
+        if (fingerprints[i] != 0) {
+            containers = bitmap_containers(
+                    &entries[i].tag->movies.bitmap,
+                    &length);
+            for (j = 0; j < length; j++) {
+                /* Storage pointers are meaningless in the file. */
+                container = containers[j];
+                memset(&container.data, 0, sizeof(container.data));
+                write_bytes(file, &container, sizeof(container), error);
+            }
+            header->containers += length;
+        }
+    }
+
+    /* And so is their storage, each padded so the next one is aligned. */
+    for (i = 0; error->code == error_none && i < capacity; i++) {
+        if (fingerprints[i] != 0) {
+            containers = bitmap_containers(
+                    &entries[i].tag->movies.bitmap,
+                    &length);
+            for (j = 0; j < length; j++) {
+                bytes = bitmap_container_bytes(&containers[j]);
+                write_section(
+                        file,
+                        bitmap_container_data(&containers[j]),
+                        bytes,
+                        error);
+                header->container_bytes += bytes
+                    + (SNAPSHOT_ALIGN - bytes % SNAPSHOT_ALIGN)
+                        % SNAPSHOT_ALIGN;
+            }
+        }
+    }
+}
+
+static void write_titles(
+        FILE *file,
+        struct database const *restrict database,
+        struct snapshot_header *restrict header,
+        struct error *restrict error)
+{
+    struct trie_flat trie;
+    struct titles_flat titles;
+    size_t buckets;
+
+    /* Only the index in use is written, the other one's sections are empty. */
+    if (database->title_index == database_title_trie) {
+        if (error->code == error_none) {
+            trie_flatten(&database->trie_root, &trie, error);
+        }
+
+        if (error->code == error_none) {
+            write_section(
+                    file,
+                    trie.nodes,
+                    sizeof(*trie.nodes) * trie.length,
+                    error);
+            write_section(file, trie.labels, trie.labels_length, error);
+            write_section(
+                    file,
+                    trie.completions,
+                    sizeof(*trie.completions) * trie.completions_length,
+                    error);
+            header->trie_nodes = trie.length;
+            header->trie_labels = trie.labels_length;
+            header->trie_completions = trie.completions_length;
+            trie_flat_destroy(&trie);
+        }
+    } else {
+        titles_flat(&database->titles, &titles);
+        buckets = (titles.length + TITLES_BUCKET - 1) / TITLES_BUCKET;
+        write_section(file, titles.bytes, titles.bytes_length, error);
+        write_section(
+                file,
+                titles.buckets,
+                sizeof(*titles.buckets) * buckets,
+                error);
+        write_section(
+                file,
+                titles.movies,
+                sizeof(*titles.movies) * titles.length,
+                error);
+        header->titles = titles.length;
+        header->titles_bytes = titles.bytes_length;
+    }
+}
+
+static void write_strings(
+        FILE *file,
+        struct database const *restrict database,
+        struct error *restrict error)
+{
+    struct movie const *movie;
+    struct tags_entry const *entries;
+    unsigned char const *fingerprints;
+    size_t capacity;
+    size_t i;
+
+    for (i = 0; error->code == error_none && i < database->movies.length; i++) {
+        movie = movies_at(&database->movies, i);
+        write_bytes(file, movie->title, strlen(movie->title) + 1, error);
+        write_bytes(file, movie->genres, strlen(movie->genres) + 1, error);
+    }
+
+    entries = tags_entries(&database->tags, &fingerprints, &capacity);
+
+    for (i = 0; error->code == error_none && i < capacity; i++) {
+        if (fingerprints[i] != 0) {
+            write_bytes(
+                    file,
+                    entries[i].tag->name,
+                    strlen(entries[i].tag->name) + 1,
+                    error);
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef MOVIEDB_DATABASE_SNAPSHOT_H
+#define MOVIEDB_DATABASE_SNAPSHOT_H 1
+
+#include "../database.h"
+
+/**
+ * This file provides a binary snapshot format of the database, so restarts can
+ * skip parsing the CSV files. Only internal database code is allowed to touch
+ * this.
+ *
+ * A snapshot is a native-endian dump of the tables as they are in memory once
+ * sealed: a versioned header holding the stamps of the source files and the
+ * section sizes, followed by the movies by index and the entries and
+ * fingerprints of their hash table, the user IDs, rating offsets, packed
+ * ratings and hash table of the users, the tags in the order of their hash
+ * table entries with the bitmap containers of their movie sets, the flattened
+ * trie or the arrays of the title dictionary, and finally a pool of
+ * NUL-terminated strings the records point into. Restoring copies the arrays
+ * back instead of inserting every row again.
+ */
+
+/**
+ * Bumped whenever the layout of the snapshot changes. Snapshots of other
+ * versions are ignored.
+ */
+#define SNAPSHOT_VERSION 6
+
+/**
+ * Reads the snapshot at the given path into the given database, whose tables
+ * must be initialized and empty. Returns whether the database was restored.
+ *
+ * A missing snapshot, or one that does not match the database's source stamps
+ * and title index, this version, this machine's byte order and word size or
+ * this build's hash table capacities, or that fails any validation (e.g. a
+ * duplicate ID), is stale: this function returns false without touching the
+ * database or setting an error, so the caller can fall back to the CSV files.
+ * Errors while restoring (i.e. allocation) are written into the error out
+ * parameter.
+ */
+bool database_snapshot_read(
+        struct database *restrict database,
+        char const *restrict path,
+        struct error *restrict error);
+
+/**
+ * Writes a snapshot of the given database into the given path. The snapshot is
+ * written to a temporary file first, which is then renamed over the path.
+ */
+void database_snapshot_write(
+        struct database const *restrict database,
+        char const *restrict path,
+        struct error *restrict error);
+
+#endif
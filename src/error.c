@@ -47,6 +47,12 @@ void error_set_code(struct error *restrict error, enum error_code code)
                 moviedb_free((void *) (void const *) ptr);
             }
             break;
+        case error_date:
+            if (error->data.date.free_string) {
+                ptr = error->data.date.string;
+                moviedb_free((void *) (void const *) ptr);
+            }
+            break;
         default:
             break;
     }
@@ -66,6 +72,43 @@ void error_set_context(
     error->free_context = free_context;
 }
 
+void error_move(struct error *restrict dest, struct error *restrict src)
+{
+    error_destroy(dest);
+    *dest = *src;
+    error_init(src);
+}
+
+void error_add_line_offset(struct error *restrict error, unsigned long offset)
+{
+    switch (error->code) {
+        case error_csv:
+            error->data.csv.line += offset;
+            break;
+        case error_movie:
+            error->data.csv_movie.line += offset;
+            break;
+        case error_rating:
+            error->data.csv_rating.line += offset;
+            break;
+        case error_tag:
+            error->data.csv_tag.line += offset;
+            break;
+        case error_id:
+            if (error->data.id.has_line) {
+                error->data.id.line += offset;
+            }
+            break;
+        case error_double:
+            if (error->data.double_f.has_line) {
+                error->data.double_f.line += offset;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
 void error_destroy(struct error *restrict error)
 {
     error_set_code(error, error_none);
@@ -188,6 +231,12 @@ void error_print(struct error const *restrict error)
             error_print_quote(error->data.open_quote.string);
             fputs(" is not a valid number\n", stderr);
             break;
+
+        case error_date:
+            fputs("date ", stderr);
+            error_print_quote(error->data.date.string);
+            fputs(" is not a valid YYYY-MM-DD date\n", stderr);
+            break;
     }
 }
 
@@ -88,6 +88,11 @@ enum error_code {
      * Error that happens when an N in topN is not a valid number.
      */
     error_topn_count,
+    /**
+     * Error that happens when a date in shell mode is not a valid YYYY-MM-DD
+     * date.
+     */
+    error_date,
 };
 
 /**
@@ -274,6 +279,20 @@ struct topn_count_error {
     bool free_string;
 };
 
+/**
+ * Invalid date error's data.
+ */
+struct date_error {
+    /**
+     * The given string.
+     */
+    char const *string;
+    /**
+     * Whether to free the string.
+     */
+    bool free_string;
+};
+
 /**
  * Union that might be any error's data.
  */
@@ -334,6 +353,10 @@ union error_data {
      * Data of topN bad count error.
      */
     struct topn_count_error topn_count;
+    /**
+     * Data of invalid date error.
+     */
+    struct date_error date;
 };
 
 /**
@@ -385,6 +408,18 @@ void error_set_context(
         char const *context,
         bool free_context);
 
+/**
+ * Moves the source error into the destination error, destroying whatever the
+ * destination held. The source is left initialized with no error.
+ */
+void error_move(struct error *restrict dest, struct error *restrict src);
+
+/**
+ * Adds the given offset to the line of errors that carry a line of a CSV file.
+ * Used when a file is parsed in pieces, each of them counting lines from 1.
+ */
+void error_add_line_offset(struct error *restrict error, unsigned long offset);
+
 /**
  * Frees error data and context.
  */
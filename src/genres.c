@@ -0,0 +1,247 @@
+#include <stdlib.h>
+#include <string.h>
+#include "alloc.h"
+#include "genres.h"
+
+/**
+ * Frees the genres of the index and empties it.
+ */
+static void clear(struct genres_index *restrict index);
+
+/**
+ * Appends a movie to the given genre, and adds its index to the genre's bitmap.
+ */
+static void genre_append(
+        struct genre *restrict genre,
+        struct movie const *movie,
+        moviedb_index_t movie_index,
+        struct error *restrict error);
+
+/**
+ * Compares two movies of a genre: the best rated first, and then by ID.
+ */
+static int compare_movies(void const *left_ptr, void const *right_ptr);
+
+/**
+ * Compares two movies of a genre: the most controversial first, and then by
+ * ID.
+ */
+static int compare_controversy(void const *left_ptr, void const *right_ptr);
+
+/**
+ * Copies the sorted movies of the genre into its controversial movies, and
+ * sorts them by controversy.
+ */
+static void genre_sort_controversial(
+        struct genre *restrict genre,
+        struct error *restrict error);
+
+void genres_index_init(struct genres_index *restrict index)
+{
+    index->genres = NULL;
+    index->length = 0;
+    index->movies = NULL;
+}
+
+void genres_index_build(
+        struct genres_index *restrict index,
+        struct movies_table const *restrict movies,
+        struct error *restrict error)
+{
+    struct movie const *movie;
+    moviedb_index_t movie_index = 0;
+    uint64_t mask;
+    unsigned id;
+    size_t i;
+
+    clear(index);
+    index->movies = movies;
+    index->genres = moviedb_alloc(
+            sizeof(*index->genres),
+            movies->genres.length,
+            error);
+
+    if (error->code == error_none) {
+        index->length = movies->genres.length;
+        for (i = 0; i < index->length; i++) {
+            index->genres[i].name = movies->genres.names[i];
+            index->genres[i].movies = NULL;
+            index->genres[i].controversial = NULL;
+            index->genres[i].length = 0;
+            index->genres[i].capacity = 0;
+            bitmap_init(&index->genres[i].movie_indices);
+        }
+    }
+
+    /* Movies are visited by index, so bitmaps are built in order. */
+    while (movie_index < movies->length && error->code == error_none) {
+        movie = movies_at(movies, movie_index);
+
+        /* Visits each bit set in the mask, lowest first. */
+        mask = movie->genre_set.mask;
+        while (mask != 0 && error->code == error_none) {
+            id = __builtin_ctzll(mask);
+            genre_append(&index->genres[id], movie, movie_index, error);
+            mask &= mask - 1;
+        }
+
+        for (i = 0; i < movie->genre_set.overflow_length; i++) {
+            if (error->code == error_none) {
+                id = movie->genre_set.overflow[i];
+                genre_append(&index->genres[id], movie, movie_index, error);
+            }
+        }
+
+        movie_index++;
+    }
+
+    for (i = 0; i < index->length && error->code == error_none; i++) {
+        qsort(index->genres[i].movies,
+                index->genres[i].length,
+                sizeof(*index->genres[i].movies),
+                compare_movies);
+        genre_sort_controversial(&index->genres[i], error);
+        if (error->code == error_none) {
+            bitmap_optimize(&index->genres[i].movie_indices, error);
+        }
+    }
+
+    if (error->code != error_none) {
+        clear(index);
+    }
+}
+
+struct genre const *genres_index_search(
+        struct genres_index const *restrict index,
+        char const *restrict name)
+{
+    unsigned id = GENRE_NONE;
+    struct genre const *genre = NULL;
+
+    if (index->movies != NULL) {
+        id = movies_genre(index->movies, name);
+    }
+
+    /* Genres interned after the index was built are not in it. */
+    if (id < index->length) {
+        genre = &index->genres[id];
+    }
+
+    return genre;
+}
+
+void genres_index_destroy(struct genres_index *restrict index)
+{
+    clear(index);
+}
+
+static void clear(struct genres_index *restrict index)
+{
+    size_t i;
+
+    for (i = 0; i < index->length; i++) {
+        moviedb_free(index->genres[i].movies);
+        moviedb_free(index->genres[i].controversial);
+        bitmap_destroy(&index->genres[i].movie_indices);
+    }
+
+    moviedb_free(index->genres);
+    index->genres = NULL;
+    index->length = 0;
+    index->movies = NULL;
+}
+
+static void genre_append(
+        struct genre *restrict genre,
+        struct movie const *movie,
+        moviedb_index_t movie_index,
+        struct error *restrict error)
+{
+    size_t new_cap;
+    struct genre_movie *new_movies;
+
+    if (genre->length == genre->capacity) {
+        /* Doubles capacity, handles the case where capacity == 0. */
+        new_cap = genre->capacity * 2;
+        if (new_cap == 0) {
+            new_cap = 16;
+        }
+
+        new_movies = moviedb_realloc(
+                genre->movies,
+                sizeof(*new_movies),
+                new_cap,
+                error);
+
+        if (error->code == error_none) {
+            genre->movies = new_movies;
+            genre->capacity = new_cap;
+        }
+    }
+
+    if (error->code == error_none) {
+        genre->movies[genre->length].mean_rating = movie->mean_rating;
+        genre->movies[genre->length].rating_variance = movie->rating_variance;
+        genre->movies[genre->length].ratings = movie->ratings;
+        genre->movies[genre->length].movie = movie;
+        genre->length++;
+        bitmap_add(&genre->movie_indices, movie_index, error);
+    }
+}
+
+static int compare_movies(void const *left_ptr, void const *right_ptr)
+{
+    struct genre_movie const *left = left_ptr;
+    struct genre_movie const *right = right_ptr;
+    int order;
+
+    if (left->mean_rating > right->mean_rating) {
+        order = -1;
+    } else if (left->mean_rating < right->mean_rating) {
+        order = 1;
+    } else {
+        order = (left->movie->id > right->movie->id)
+            - (left->movie->id < right->movie->id);
+    }
+
+    return order;
+}
+
+static int compare_controversy(void const *left_ptr, void const *right_ptr)
+{
+    struct genre_movie const *left = left_ptr;
+    struct genre_movie const *right = right_ptr;
+    int order;
+
+    if (left->rating_variance > right->rating_variance) {
+        order = -1;
+    } else if (left->rating_variance < right->rating_variance) {
+        order = 1;
+    } else {
+        order = (left->movie->id > right->movie->id)
+            - (left->movie->id < right->movie->id);
+    }
+
+    return order;
+}
+
+static void genre_sort_controversial(
+        struct genre *restrict genre,
+        struct error *restrict error)
+{
+    genre->controversial = moviedb_alloc(
+            sizeof(*genre->controversial),
+            genre->length,
+            error);
+
+    /* The movies of an empty genre are NULL, which memcpy must not get. */
+    if (error->code == error_none && genre->length > 0) {
+        memcpy(genre->controversial,
+                genre->movies,
+                sizeof(*genre->movies) * genre->length);
+        qsort(genre->controversial,
+                genre->length,
+                sizeof(*genre->controversial),
+                compare_controversy);
+    }
+}
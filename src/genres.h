@@ -0,0 +1,130 @@
+#ifndef MOVIEDB_GENRES_H
+#define MOVIEDB_GENRES_H 1
+
+#include "movies.h"
+#include "bitmap.h"
+
+/**
+ * This file exports items related to the genres index, which lists the movies
+ * of each genre from the best to the worst rated, and from the most to the
+ * least controversial, so top-N queries do not need to scan the whole movies
+ * table.
+ */
+
+/**
+ * A movie of a genre, with a copy of its ratings so scanning the genre does
+ * not need to read the movie.
+ */
+struct genre_movie {
+    /**
+     * Mean of the ratings of the movie. Only internal genres index code is
+     * allowed to update this, reading is fine.
+     */
+    double mean_rating;
+    /**
+     * Variance of the ratings of the movie. Only internal genres index code is
+     * allowed to update this, reading is fine.
+     */
+    double rating_variance;
+    /**
+     * How many ratings were done on the movie. Only internal genres index code
+     * is allowed to update this, reading is fine.
+     */
+    unsigned long ratings;
+    /**
+     * The movie itself. Only internal genres index code is allowed to update
+     * this, reading is fine.
+     */
+    struct movie const *movie;
+};
+
+/**
+ * A genre's data.
+ */
+struct genre {
+    /**
+     * Name of this genre, owned by the genre dictionary of the movies table.
+     * Only internal genres index code is allowed to update this, reading is
+     * fine.
+     */
+    char const *name;
+    /**
+     * Movies of this genre, sorted by mean rating in descending order, and
+     * then by ID. Only internal genres index code is allowed to update this,
+     * reading is fine.
+     */
+    struct genre_movie *movies;
+    /**
+     * The same movies, sorted by variance of the ratings in descending order,
+     * i.e. the most controversial first, and then by ID. Only internal genres
+     * index code is allowed to update this, reading is fine.
+     */
+    struct genre_movie *controversial;
+    /**
+     * How many movies this genre has. Only internal genres index code is
+     * allowed to update this, reading is fine.
+     */
+    size_t length;
+    /**
+     * How many movies can be stored. Only internal genres index code is
+     * allowed to touch this.
+     */
+    size_t capacity;
+    /**
+     * Indices of the movies of this genre in the movies table, so the genre can
+     * be combined with other sets of movies, such as the movies of a tag. Only
+     * internal genres index code is allowed to update this, reading is fine.
+     */
+    struct bitmap movie_indices;
+};
+
+/**
+ * The index of genres, with a genre for each ID of the genre dictionary of the
+ * movies table.
+ */
+struct genres_index {
+    /**
+     * Array of genres, indexed by genre ID. Only internal genres index code is
+     * allowed to update this, reading is fine.
+     */
+    struct genre *genres;
+    /**
+     * How many genres there are. Only internal genres index code is allowed to
+     * update this, reading is fine.
+     */
+    size_t length;
+    /**
+     * The movies table the index was built from, whose genre dictionary maps
+     * names to IDs. Only internal genres index code is allowed to touch this.
+     */
+    struct movies_table const *movies;
+};
+
+/**
+ * Initializes an empty index.
+ */
+void genres_index_init(struct genres_index *restrict index);
+
+/**
+ * Builds the index from every movie of the given table, replacing what the
+ * index held. Must be called after the table is sealed; the index is not
+ * updated if the movies change later. The table must outlive the index.
+ */
+void genres_index_build(
+        struct genres_index *restrict index,
+        struct movies_table const *restrict movies,
+        struct error *restrict error);
+
+/**
+ * Search for the genre with the given name. Returns NULL if not found.
+ */
+struct genre const *genres_index_search(
+        struct genres_index const *restrict index,
+        char const *restrict name);
+
+/**
+ * Destroys the given index, freeing the memory of every genre.
+ */
+void genres_index_destroy(struct genres_index *restrict index);
+
+#endif
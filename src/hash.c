@@ -1,10 +1,33 @@
 #include "hash.h"
+#include "prime.h"
 
 extern inline size_t moviedb_hash_to_index(
         moviedb_hash_t hash,
         moviedb_hash_t attempt,
         size_t size);
 
+extern inline unsigned char moviedb_hash_fingerprint(moviedb_hash_t hash);
+
+size_t moviedb_hash_capacity(size_t min_capacity)
+{
+#ifdef MOVIEDB_HASH_POW2
+    size_t capacity = 2;
+
+    if (min_capacity > SIZE_MAX / 2 + 1) {
+        /* No power of two fits. */
+        capacity = SIZE_MAX;
+    }
+
+    while (capacity < min_capacity) {
+        capacity *= 2;
+    }
+
+    return capacity;
+#else
+    return next_prime(min_capacity);
+#endif
+}
+
 moviedb_hash_t moviedb_hash_uint64(uint_fast64_t integer)
 {
     uint_fast64_t hash = integer;
@@ -6,11 +6,32 @@
 
 typedef uint_fast64_t moviedb_hash_t;
 
+/**
+ * Hash tables either have prime capacities, indexed by modulo with quadratic
+ * probing (the default), or power-of-two capacities, indexed by a mask with
+ * triangular probing, if built with MOVIEDB_HASH_POW2 defined (e.g. with
+ * HASH_CAPACITY=pow2 in make).
+ */
+#ifdef MOVIEDB_HASH_POW2
+#define MOVIEDB_HASH_MODE "pow2"
+#else
+#define MOVIEDB_HASH_MODE "prime"
+#endif
+
 inline size_t moviedb_hash_to_index(
         moviedb_hash_t hash,
         moviedb_hash_t attempt,
         size_t size)
 {
+#ifdef MOVIEDB_HASH_POW2
+    /*
+     * Triangular probing, which visits every entry of a power-of-two table.
+     * The high half is folded in, since the mask only keeps the low bits.
+     */
+    moviedb_hash_t folded = hash ^ (hash >> 32);
+
+    return (folded + attempt * (attempt + 1) / 2) & (size - 1);
+#else
     /* quadratic probing */
     moviedb_hash_t term0 = hash % size;
     moviedb_hash_t term1 = attempt % size;
@@ -21,6 +42,25 @@ inline size_t moviedb_hash_to_index(
 
     /* linear probing */
     /* return (hash % size + attempt % size) % size; */
+#endif
+}
+
+/**
+ * Finds the smallest capacity a hash table can have such that capacity >=
+ * min_capacity: a prime, or a power of two, depending on the build. Returns
+ * SIZE_MAX if there is no such capacity.
+ */
+size_t moviedb_hash_capacity(size_t min_capacity);
+
+/**
+ * Fingerprint of a hash, stored by hash tables in a byte array parallel to
+ * their entries, so most probes that miss never read the entry itself. Made
+ * from the high bits of the hash, which indexing barely uses, and never zero,
+ * so zero can mark an empty entry.
+ */
+inline unsigned char moviedb_hash_fingerprint(moviedb_hash_t hash)
+{
+    return 0x80 | (unsigned char) (hash >> 57);
 }
 
 moviedb_hash_t moviedb_hash_uint64(uint_fast64_t integer);
@@ -5,38 +5,45 @@
 moviedb_id_t moviedb_id_parse(
         char const *restrict string,
         struct error *restrict error)
+{
+    return moviedb_id_parse_bytes(string, strlen(string), error);
+}
+
+moviedb_id_t moviedb_id_parse_bytes(
+        char const *restrict bytes,
+        size_t length,
+        struct error *restrict error)
 {
     size_t i = 0;
     moviedb_id_t id = 0;
+    unsigned digit = 0;
     char *error_string;
 
-    while (string[i] != 0 && error->code == error_none) {
-        if (id * 10 >= id && string[i] >= '0' && string[i] <= '9') {
+    /* Stops at the first byte that is not a digit, or that would overflow. */
+    while (i < length && digit <= 9) {
+        digit = (unsigned char) bytes[i] - '0';
+        if (digit <= 9 && id <= (MOVIEDB_ID_MAX - digit) / 10) {
             /* Accounts the digit. */
-            id *= 10;
-            id += string[i] - '0';
+            id = id * 10 + digit;
             i++;
         } else {
-            if (error->code == error_none) {
-                error_string = moviedb_alloc(
-                        sizeof(*error_string),
-                        strlen(string) + 1,
-                        error);
-
-                if (error->code == error_none) {
-                    /* Copies the input string to an error. */
-                    strcpy(error_string, string);
-                    error_set_code(error, error_id);
-                    error->data.id.has_line = false;
-                    error->data.id.string = error_string;
-                    error->data.id.free_string = true;
-                }
-            }
+            digit = 10;
         }
     }
 
-    /* Empty string is an error. */
-    if (i == 0 && error->code == error_none) {
+    if (i < length) {
+        error_string = moviedb_alloc(sizeof(*error_string), length + 1, error);
+        if (error->code == error_none) {
+            /* Copies the input bytes to an error. */
+            memcpy(error_string, bytes, length);
+            error_string[length] = 0;
+            error_set_code(error, error_id);
+            error->data.id.has_line = false;
+            error->data.id.string = error_string;
+            error->data.id.free_string = true;
+        }
+    } else if (length == 0) {
+        /* Empty string is an error. */
         error_set_code(error, error_id);
         error->data.id.has_line = false;
         error->data.id.string = "";
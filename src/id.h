@@ -19,6 +19,11 @@
  */
 #define MOVIEDB_ID_DIGITS 20
 
+/**
+ * Greatest value of an ID.
+ */
+#define MOVIEDB_ID_MAX UINT_LEAST64_MAX
+
 /**
  * Parses an ID from a given string buffer.
  */
@@ -26,6 +31,15 @@ moviedb_id_t moviedb_id_parse(
         char const *restrict string,
         struct error *restrict error);
 
+/**
+ * Parses an ID from the given bytes, which need not be nul-terminated, e.g. a
+ * CSV field. Errors are the same as moviedb_id_parse's.
+ */
+moviedb_id_t moviedb_id_parse_bytes(
+        char const *restrict bytes,
+        size_t length,
+        struct error *restrict error);
+
 /**
  * Converts an ID to a string, using decimal digits. Returns the index where the
  * ID string starts on the buffer. It is recommended to reserve as much as
@@ -4,7 +4,8 @@
 #include <stdint.h>
 
 /**
- * This file just defines an ID. Used to break cyclic header dependency.
+ * This file just defines an ID and an index. Used to break cyclic header
+ * dependency.
  */
 
 /**
@@ -12,4 +13,15 @@
  */
 typedef uint_least64_t moviedb_id_t;
 
+/**
+ * The type of a dense index, assigned to movies and users in the order they
+ * are loaded, so their data can be stored in arrays.
+ */
+typedef uint32_t moviedb_index_t;
+
+/**
+ * Greatest value of an index.
+ */
+#define MOVIEDB_INDEX_MAX UINT32_MAX
+
 #endif
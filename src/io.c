@@ -1,3 +1,7 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "io.h"
 
 extern inline FILE *input_file_open(
@@ -13,3 +17,55 @@ extern inline void input_file_setbuf(
 extern inline int input_file_read(FILE *file, struct error *restrict error);
 
 extern inline void input_file_close(FILE *file);
+
+bool input_map_open(
+        char const *restrict path,
+        struct input_map *restrict map_out,
+        struct error *restrict error)
+{
+    int fd;
+    struct stat status;
+    void *data;
+    bool mapped = false;
+
+    fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        error_set_code(error, error_io);
+        error->data.io.sys_errno = errno;
+    } else if (fstat(fd, &status) < 0) {
+        error_set_code(error, error_io);
+        error->data.io.sys_errno = errno;
+    } else if (S_ISREG(status.st_mode)) {
+        /* Only regular files are mapped, pipes and such are left to stdio. */
+        map_out->length = status.st_size;
+        map_out->data = NULL;
+        mapped = true;
+
+        if (map_out->length > 0) {
+            data = mmap(NULL, map_out->length, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (data == MAP_FAILED) {
+                /* Some file systems do not support mapping, use stdio. */
+                mapped = false;
+            } else {
+                /* The parsers walk the files from start to end. */
+                madvise(data, map_out->length, MADV_SEQUENTIAL);
+                map_out->data = data;
+            }
+        }
+    }
+
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    return mapped;
+}
+
+void input_map_close(struct input_map *restrict map)
+{
+    if (map->data != NULL) {
+        munmap((void *) (void const *) map->data, map->length);
+    }
+}
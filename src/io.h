@@ -3,6 +3,7 @@
 
 #include <stdio.h>
 #include <errno.h>
+#include <stdbool.h>
 #include "error.h"
 #include "strbuf.h"
 
@@ -98,4 +99,36 @@ inline void input_file_close(FILE *file)
     fclose(file);
 }
 
+/**
+ * A whole input file mapped read-only into memory.
+ */
+struct input_map {
+    /**
+     * The mapped bytes of the file. Might be NULL if the file is empty. Reading
+     * is fine, only IO internal code is allowed to update this.
+     */
+    char const *data;
+    /**
+     * Length of the file in bytes. Reading is fine, only IO internal code is
+     * allowed to update this.
+     */
+    size_t length;
+};
+
+/**
+ * Maps the input file at the given path into memory. Returns whether the file
+ * was mapped. Files that cannot be mapped, such as pipes, make this function
+ * return false without setting an error, so the caller can fall back to
+ * input_file_open. Other failures are written into the error out parameter.
+ */
+bool input_map_open(
+        char const *restrict path,
+        struct input_map *restrict map_out,
+        struct error *restrict error);
+
+/**
+ * Unmaps the given input file mapping.
+ */
+void input_map_close(struct input_map *restrict map);
+
 #endif
@@ -1,6 +1,8 @@
 #include <stdio.h>
 #include <stdbool.h>
-#include <time.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/resource.h>
 #include "error.h"
 #include "alloc.h"
 #include "strbuf.h"
@@ -9,29 +11,94 @@
 #include "csv/rating.h"
 #include "csv/tag.h"
 #include "database.h"
+#include "timing.h"
 #include "shell.h"
 
+/**
+ * Parses the command line arguments into the database options. Returns whether
+ * the arguments are valid.
+ */
+static bool parse_args(
+        int argc,
+        char const *argv[],
+        struct database_options *restrict options);
+
+/**
+ * Prints the command line usage on stderr.
+ */
+static void print_usage(char const *program);
+
+/**
+ * Prints how many allocations were made, how much the database's arena holds,
+ * and the peak resident set size so far.
+ */
+static void print_memory_stats(struct database const *restrict database);
+
+/**
+ * Prints the statistics of loading a CSV file.
+ */
+static void print_file_stats(
+        char const *path,
+        struct database_file_stats const *restrict stats);
+
 int main(int argc, char const *argv[])
 {
     int exit_code = 0;
     struct database database;
+    struct database_options options;
+    struct database_stats stats;
     struct error error;
     struct strbuf buf;
-    clock_t then, now;
     double secs;
+    double then;
+
+    database_options_init(&options);
+
+    if (!parse_args(argc, argv, &options)) {
+        print_usage(argv[0]);
+        return 1;
+    }
 
     puts("Loading data...");
 
     error_init(&error);
     strbuf_init(&buf);
 
-    then = clock();
-    database_load(&database, &buf, &error);
-    now = clock();
+    database_load(&database, &options, &stats, &buf, &error);
 
-    if (error.code == error_none) {
-        secs = (now - then) / (double) CLOCKS_PER_SEC;
+    if (error.code == error_none && stats.from_snapshot) {
+        secs = stats.snapshot_seconds;
+        printf("Loaded %s in %.3lf seconds (snapshot)\n",
+                DATABASE_SNAPSHOT_PATH,
+                secs);
+        printf("Data loaded in %.3lf seconds\n", secs);
+    } else if (error.code == error_none) {
+        print_file_stats(DATABASE_MOVIES_PATH, &stats.movies);
+        print_file_stats(DATABASE_RATINGS_PATH, &stats.ratings);
+        print_file_stats(DATABASE_TAGS_PATH, &stats.tags);
+        secs = stats.movies.seconds + stats.ratings.seconds
+            + stats.tags.seconds;
         printf("Data loaded in %.3lf seconds\n", secs);
+
+        if (options.use_snapshot) {
+            then = timing_now();
+            database_write_snapshot(&database, &error);
+
+            if (error.code == error_none) {
+                printf("Snapshot written in %.3lf seconds\n",
+                        timing_now() - then);
+            } else {
+                /* Not being able to write a snapshot is not fatal. */
+                fputs("Snapshot could not be written: ", stderr);
+                error_print(&error);
+                error_destroy(&error);
+                error_init(&error);
+            }
+        }
+    }
+
+    if (error.code == error_none) {
+        print_memory_stats(&database);
         puts("Entering in shell/console mode...");
 
         shell_run(&database, &buf, &error);
@@ -47,3 +114,98 @@ int main(int argc, char const *argv[])
 
     return exit_code;
 }
+
+static bool parse_args(
+        int argc,
+        char const *argv[],
+        struct database_options *restrict options)
+{
+    int i = 1;
+    bool valid = true;
+    unsigned long threads;
+    char *end;
+
+    while (i < argc && valid) {
+        if (strcmp(argv[i], "--stdio") == 0) {
+            /* Reads the CSV files through stdio instead of mapping them. */
+            options->use_mmap = false;
+        } else if (strcmp(argv[i], "--no-snapshot") == 0) {
+            /* Neither reads nor writes the binary snapshot. */
+            options->use_snapshot = false;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            /* Number of threads parsing the ratings. */
+            i++;
+            threads = strtoul(argv[i], &end, 10);
+            valid = *end == 0 && threads > 0 && threads <= 1024;
+            options->threads = threads;
+        } else if (strcmp(argv[i], "--titles") == 0 && i + 1 < argc) {
+            /* Index movie titles are searched by. */
+            i++;
+            valid = database_parse_title_index(
+                    argv[i],
+                    &options->title_index);
+        } else {
+            valid = false;
+        }
+        i++;
+    }
+
+    return valid;
+}
+
+static void print_usage(char const *program)
+{
+    fprintf(stderr,
+            "Usage:\n    %s [--stdio] [--threads N] [--no-snapshot] "
+            "[--titles trie|dict]\n\n",
+            program);
+    fputs("    --stdio         read CSV files through stdio instead of mmap\n",
+            stderr);
+    fputs("    --threads N     parse ratings with N threads (default: CPUs)\n",
+            stderr);
+    fputs("    --no-snapshot   always load from the CSV files\n", stderr);
+    fputs("    --titles KIND   search titles in a trie (default) or a sorted\n"
+            "                    front-coded dictionary (dict)\n",
+            stderr);
+}
+
+static void print_file_stats(
+        char const *path,
+        struct database_file_stats const *restrict stats)
+{
+    char const *method;
+
+    if (stats->mapped) {
+        method = "mmap";
+    } else {
+        method = "stdio";
+    }
+
+    printf("Loaded %s in %.3lf seconds (%s, %lu rows)\n",
+            path,
+            stats->seconds,
+            method,
+            stats->rows);
+}
+
+static void print_memory_stats(struct database const *restrict database)
+{
+    struct moviedb_alloc_stats alloc_stats;
+    struct rusage usage;
+    double peak_rss = 0;
+
+    moviedb_alloc_stats(&alloc_stats);
+
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        /* Linux reports it in kibibytes. */
+        peak_rss = usage.ru_maxrss / 1024.0;
+    }
+
+    printf("Memory: %lu allocations, %lu reallocations, arena %.1lf MiB in "
+            "%lu chunks, peak RSS %.1lf MiB\n",
+            alloc_stats.allocations,
+            alloc_stats.reallocations,
+            database->arena.reserved / (1024.0 * 1024.0),
+            database->arena.chunk_count,
+            peak_rss);
+}
@@ -1,10 +1,36 @@
 #include <ctype.h>
+#include <string.h>
 #include "movies.h"
 #include "alloc.h"
-#include "prime.h"
 
 #define MAX_LOAD 0.5
 
+/**
+ * Makes room in the array of movies for at least the given number of movies.
+ */
+static void reserve_movies(
+        struct movies_table *restrict table,
+        size_t min_capacity,
+        struct error *restrict error);
+
+/**
+ * Appends a movie CSV row to the array of movies, copying its title and genres,
+ * without touching the hash table. Returns the movie, with an empty histogram,
+ * or NULL on error (error_max_capacity if it would not fit an index).
+ */
+static struct movie *append(
+        struct movies_table *restrict table,
+        struct movie_csv_row const *restrict movie_row,
+        struct error *restrict error);
+
+/**
+ * Allocates the entries and fingerprints of the given table for its capacity,
+ * marking every entry as empty.
+ */
+static void alloc_entries(
+        struct movies_table *restrict table,
+        struct error *restrict error);
+
 /**
  * Probes the given table until the place where the given movie ID should be
  * stored, given its hash. Returns the index of this place.
@@ -21,99 +47,63 @@ static void resize(
         struct movies_table *restrict table,
         struct error *restrict error);
 
-bool movie_has_genre(
-        struct movie const *restrict movie,
-        char const *restrict genre)
-{
-    bool has_genre = false;
-    /* Iterates over the movie's genre list. */
-    size_t i = 0;
-    /* Iterates over the input genre. */
-    size_t j;
-    bool searching;
-    char const *restrict list = movie->genres;
-
-    /*
-     * Loops until it is confirmed that this movie has the given genre, or until
-     * that all movie's genres have been tested.
-     */
-    while (!has_genre && list[i] != 0) {
-        searching = true;
-        j = 0;
-
-        /*
-         * Loops until either the end of one string is found or until characters
-         * don't match.
-         */
-        while (!has_genre && searching) {
-            /* End of the current genre in list AND end of input genre? */
-            has_genre = (list[i] == 0 || list[i] == '|') && genre[j] == 0;
-
-            /* NOT et the end of current genre AND NOT end of input genre? */
-            searching = list[i] != 0 && list[i] != '|' && genre[j] != 0;
-            /* ALSO, are characters at both strings equals? */
-            searching = searching && list[i] == genre[j];
-
-            /* Only advance if there is a next iteration again. */
-            if (!has_genre && searching) {
-                i++;
-                j++;
-            }
-        }
-
-        if (!has_genre) {
-            /*
-             * Skips the remaining characters in the current genre of the genre
-             * list, so we test the next genre in the next attempt.
-             */
-            while (list[i] != 0 && list[i] != '|') {
-                i++;
-            }
-
-            /*
-             * Also skips the separator if the end of the string has not been
-             * reached.
-             */
-            if (list[i] == '|') {
-                i++;
-            }
-        }
-    }
+/**
+ * Moves the entries of the table into new arrays with at least the given
+ * capacity.
+ */
+static void rehash(
+        struct movies_table *restrict table,
+        size_t min_capacity,
+        struct error *restrict error);
 
-    return has_genre;
-}
+extern inline bool movie_has_genre(
+        struct movie const *restrict movie,
+        unsigned genre);
 
 void movies_init(
         struct movies_table *restrict table,
         size_t initial_capacity,
+        struct arena *arena,
         struct error *restrict error)
 {
-    size_t i;
-
+    table->arena = arena;
+    genre_dict_init(&table->genres, arena);
+    table->movies = NULL;
+    table->movies_capacity = 0;
     table->length = 0;
-    table->capacity = next_prime(initial_capacity);
-    table->entries = moviedb_alloc(
-            sizeof(*table->entries),
-            table->capacity,
-            error);
+    table->capacity = moviedb_hash_capacity(initial_capacity);
+    alloc_entries(table, error);
+}
 
-    if (error->code == error_none) {
-        /* Initializes all entries to NULL. */
-        for (i = 0; i < table->capacity; i++) {
-            table->entries[i] = NULL;
-        }
+void movies_reserve(
+        struct movies_table *restrict table,
+        size_t entries,
+        struct error *restrict error)
+{
+    /* Capacity needed to keep that many entries below maximum load. */
+    size_t min_capacity = SIZE_MAX;
+
+    if (entries < SIZE_MAX / 4) {
+        min_capacity = (size_t) (entries / MAX_LOAD) + 1;
+    }
+
+    if (min_capacity > table->capacity) {
+        rehash(table, min_capacity, error);
+    }
+
+    if (error->code == error_none && entries > table->movies_capacity) {
+        reserve_movies(table, entries, error);
     }
 }
 
 void movies_insert(
         struct movies_table *restrict table,
-        struct movie_csv_row *restrict movie_row,
+        struct movie_csv_row const *restrict movie_row,
         struct error *restrict error)
 {
     double load;
     moviedb_hash_t hash;
     size_t index;
-    struct movie *movie = NULL;
 
     load = (table->length + 1) / (double) table->capacity;
 
@@ -125,59 +115,123 @@ void movies_insert(
     if (error->code == error_none) {
         hash = moviedb_id_hash(movie_row->id);
         index = probe_index(table, movie_row->id, hash);
-        if (table->entries[index] == NULL) {
-            /* Allocates a movie to be inserted. */
-            movie = moviedb_alloc(sizeof(*movie), 1, error);
-        } else {
+        if (table->fingerprints[index] != 0) {
             /* Duplicated movie ID error. */
             error_set_code(error, error_dup_movie_id);
             error->data.dup_movie_id.id = movie_row->id;
         }
+    }
 
-        if (error->code == error_none) {
-            /* Finally inserts the movie. */
-            movie->id = movie_row->id;
-            movie->title = movie_row->title;
-            movie->genres = movie_row->genres;
-            movie->ratings = 0;
-            movie->mean_rating = 0.0;
-            table->entries[index] = movie;
-            table->length++;
-        }
+    if (error->code == error_none) {
+        /* The movie goes at the end of the array, and copies strings. */
+        append(table, movie_row, error);
+    }
+
+    if (error->code == error_none) {
+        table->entries[index].id = movie_row->id;
+        table->entries[index].index = table->length - 1;
+        table->fingerprints[index] = moviedb_hash_fingerprint(hash);
+    }
+}
+
+void movies_restore_movie(
+        struct movies_table *restrict table,
+        struct movie_csv_row const *restrict movie_row,
+        struct rating_histogram const *restrict histogram,
+        struct error *restrict error)
+{
+    struct movie *movie = append(table, movie_row, error);
+
+    if (error->code == error_none) {
+        movie->histogram = *histogram;
     }
 }
 
-void movies_add_rating(
+void movies_restore_entries(
         struct movies_table *restrict table,
+        struct movies_entry const *restrict entries,
+        unsigned char const *restrict fingerprints,
+        size_t capacity,
+        struct error *restrict error)
+{
+    struct movies_table new_table;
+
+    new_table.capacity = capacity;
+    alloc_entries(&new_table, error);
+
+    if (error->code == error_none) {
+        memcpy(new_table.entries, entries, sizeof(*entries) * capacity);
+        memcpy(new_table.fingerprints,
+                fingerprints,
+                sizeof(*fingerprints) * capacity);
+
+        moviedb_free(table->fingerprints);
+        moviedb_free(table->entries);
+        table->capacity = new_table.capacity;
+        table->entries = new_table.entries;
+        table->fingerprints = new_table.fingerprints;
+    }
+}
+
+extern inline struct movies_entry const *movies_entries(
+        struct movies_table const *restrict table,
+        unsigned char const **restrict fingerprints_out,
+        size_t *restrict capacity_out);
+
+extern inline void movies_add_rating(
+        struct movies_table *restrict table,
+        moviedb_index_t movie,
+        uint8_t code);
+
+void movies_seal(struct movies_table *restrict table)
+{
+    struct movie *movie;
+    size_t i;
+
+    for (i = 0; i < table->length; i++) {
+        movie = &table->movies[i];
+        movie->ratings = rating_histogram_count(&movie->histogram);
+        movie->mean_rating = rating_histogram_mean(&movie->histogram);
+        movie->rating_variance = rating_histogram_variance(&movie->histogram);
+    }
+}
+
+extern inline unsigned movies_genre(
+        struct movies_table const *restrict table,
+        char const *restrict name);
+
+bool movies_index(
+        struct movies_table const *restrict table,
         moviedb_id_t movieid,
-        double rating)
+        moviedb_index_t *restrict index_out)
 {
-    unsigned long ratings;
-    double sum;
     moviedb_hash_t hash = moviedb_id_hash(movieid);
-    /* Index of the movie. */
     size_t index = probe_index(table, movieid, hash);
+    bool found = table->fingerprints[index] != 0;
 
-    if (table->entries[index] != NULL) {
-        /* The given movie is present. */
-        ratings = table->entries[index]->ratings;
-        /* Sum of ratings. */
-        sum = table->entries[index]->mean_rating * ratings + rating;
-        /* Increase previous number of ratings. */
-        ratings++;
-        /* Registers new mean and saves current number of ratings. */
-        table->entries[index]->mean_rating = sum / ratings;
-        table->entries[index]->ratings = ratings;
+    if (found) {
+        *index_out = table->entries[index].index;
     }
+
+    return found;
 }
 
+extern inline struct movie const *movies_at(
+        struct movies_table const *restrict table,
+        moviedb_index_t index);
+
 struct movie const *movies_search(
         struct movies_table const *restrict table,
         moviedb_id_t movieid)
 {
-    moviedb_hash_t hash = moviedb_id_hash(movieid);
-    size_t index = probe_index(table, movieid, hash);
-    return table->entries[index];
+    moviedb_index_t index;
+    struct movie const *movie = NULL;
+
+    if (movies_index(table, movieid, &index)) {
+        movie = movies_at(table, index);
+    }
+
+    return movie;
 }
 
 extern inline void movies_iter(
@@ -188,12 +242,8 @@ struct movie const *movies_next(struct movies_iter *restrict iter)
 {
     struct movie const *movie = NULL;
 
-    /*
-     * Moves the iterator to the next position while entries are NULL and there
-     * are entries left.
-     */
-    while (iter->current < iter->table->capacity && movie == NULL) {
-        movie = iter->table->entries[iter->current];
+    if (iter->current < iter->table->length) {
+        movie = &iter->table->movies[iter->current];
         iter->current++;
     }
 
@@ -203,19 +253,135 @@ struct movie const *movies_next(struct movies_iter *restrict iter)
 void movies_destroy(struct movies_table *restrict table)
 {
     size_t i;
+    struct movie *movie;
 
-    /* Iterates through all entries to free their movie's memories. */
-    for (i = 0; i < table->capacity; i++) {
-        if (table->entries[i] != NULL) {
-            moviedb_free((void *) (void const *) table->entries[i]->title);
-            moviedb_free((void *) (void const *) table->entries[i]->genres);
-            moviedb_free(table->entries[i]);
-        }
+    /* Frees the strings of every movie, unless the arena owns them. */
+    for (i = 0; table->arena == NULL && i < table->length; i++) {
+        movie = &table->movies[i];
+        moviedb_free((void *) (void const *) movie->title);
+        moviedb_free((void *) (void const *) movie->genres);
+        genre_set_destroy(&movie->genre_set, table->arena);
     }
 
+    genre_dict_destroy(&table->genres);
+    moviedb_free(table->movies);
+    moviedb_free(table->fingerprints);
     moviedb_free(table->entries);
 }
 
+static struct movie *append(
+        struct movies_table *restrict table,
+        struct movie_csv_row const *restrict movie_row,
+        struct error *restrict error)
+{
+    size_t new_cap;
+    struct movie *movie = NULL;
+    char const *title = NULL;
+    char const *genres = NULL;
+
+    if (table->length >= MOVIEDB_INDEX_MAX) {
+        /* The index of the movie would not fit. */
+        error_set_code(error, error_max_capacity);
+        error->data.max_capacity.capacity = table->length;
+    }
+
+    if (error->code == error_none
+            && table->length == table->movies_capacity) {
+        /* Doubles capacity, handles the case where capacity == 0. */
+        new_cap = table->movies_capacity * 2;
+        if (new_cap == 0) {
+            new_cap = 16;
+        }
+        reserve_movies(table, new_cap, error);
+    }
+
+    if (error->code == error_none) {
+        movie = &table->movies[table->length];
+        title = arena_copy_str(
+                table->arena,
+                movie_row->title,
+                strlen(movie_row->title),
+                error);
+    }
+
+    if (error->code == error_none) {
+        genres = arena_copy_str(
+                table->arena,
+                movie_row->genres,
+                strlen(movie_row->genres),
+                error);
+    }
+
+    if (error->code == error_none) {
+        genre_set_init(
+                &movie->genre_set,
+                &table->genres,
+                genres,
+                table->arena,
+                error);
+    }
+
+    if (error->code != error_none) {
+        arena_free(table->arena, genres);
+        arena_free(table->arena, title);
+        movie = NULL;
+    } else {
+        /* Finally appends the movie. */
+        movie->id = movie_row->id;
+        movie->title = title;
+        movie->genres = genres;
+        rating_histogram_init(&movie->histogram);
+        movie->ratings = 0;
+        movie->mean_rating = 0.0;
+        movie->rating_variance = 0.0;
+        table->length++;
+    }
+
+    return movie;
+}
+
+static void reserve_movies(
+        struct movies_table *restrict table,
+        size_t min_capacity,
+        struct error *restrict error)
+{
+    struct movie *new_movies = moviedb_realloc(
+            table->movies,
+            sizeof(*new_movies),
+            min_capacity,
+            error);
+
+    if (error->code == error_none) {
+        table->movies = new_movies;
+        table->movies_capacity = min_capacity;
+    }
+}
+
+static void alloc_entries(
+        struct movies_table *restrict table,
+        struct error *restrict error)
+{
+    table->entries = moviedb_alloc(
+            sizeof(*table->entries),
+            table->capacity,
+            error);
+
+    if (error->code == error_none) {
+        table->fingerprints = moviedb_alloc(
+                sizeof(*table->fingerprints),
+                table->capacity,
+                error);
+
+        if (error->code == error_none) {
+            /* Initializes all entries to empty. */
+            memset(table->fingerprints, 0, table->capacity);
+        } else {
+            moviedb_free(table->entries);
+            table->entries = NULL;
+        }
+    }
+}
+
 static size_t probe_index(
         struct movies_table const *restrict table,
         moviedb_id_t movieid,
@@ -223,21 +389,24 @@ static size_t probe_index(
 {
     moviedb_hash_t attempt;
     size_t index;
-    struct movie *movie;
+    unsigned char fingerprint = moviedb_hash_fingerprint(hash);
 
     attempt = 0;
     index = moviedb_hash_to_index(hash, attempt, table->capacity);
-    movie = table->entries[index];
 
-    /* Iterates while there is a movie and it is not our target. */
-    while (movie != NULL && movie->id != movieid) {
+    /*
+     * Iterates while the entry is occupied and it is not our target. The ID is
+     * only compared if the fingerprint matches.
+     */
+    while (table->fingerprints[index] != 0
+            && (table->fingerprints[index] != fingerprint
+                || table->entries[index].id != movieid)) {
         /*
          * If we reached here, the condition failed, and we need to get the
          * next attempt.
          */
         attempt++;
         index = moviedb_hash_to_index(hash, attempt, table->capacity);
-        movie = table->entries[index];
     }
 
     return index;
@@ -246,53 +415,55 @@ static size_t probe_index(
 static void resize(
         struct movies_table *restrict table,
         struct error *restrict error)
+{
+    size_t min_capacity = SIZE_MAX;
+
+    /* Asks for double capacity, unless it would overflow. */
+    if (table->capacity <= SIZE_MAX / 2) {
+        min_capacity = table->capacity * 2;
+    }
+
+    rehash(table, min_capacity, error);
+}
+
+static void rehash(
+        struct movies_table *restrict table,
+        size_t min_capacity,
+        struct error *restrict error)
 {
     size_t i;
     moviedb_hash_t hash;
     size_t index;
     struct movies_table new_table;
 
-    /*
-     * Checks if there is a next prime with at least double capacity, in first
-     * place.
-     */
-    if (SIZE_MAX / 2 < table->capacity) {
-        new_table.capacity = SIZE_MAX;
-    } else {
-        new_table.capacity = next_prime(table->capacity * 2);
-    }
+    new_table.capacity = moviedb_hash_capacity(min_capacity);
 
-    /* Sets an error if no prime available. */
+    /* Sets an error if no capacity available. */
     if (new_table.capacity == SIZE_MAX) {
         error_set_code(error, error_max_capacity);
         error->data.max_capacity.capacity = table->capacity;
     }
 
     if (error->code == error_none) {
-        new_table.entries = moviedb_alloc(
-                sizeof(*new_table.entries),
-                new_table.capacity,
-                error);
+        alloc_entries(&new_table, error);
     }
 
     if (error->code == error_none) {
-        /* Initializes the new table's entries. */
-        for (i = 0; i < new_table.capacity; i++) {
-            new_table.entries[i] = NULL;
-        }
-
         /* Reinserts entries from old table into the new table. */
         for (i = 0; i < table->capacity; i++) {
-            if (table->entries[i] != NULL) {
-                hash = moviedb_id_hash(table->entries[i]->id);
-                index = probe_index(&new_table, table->entries[i]->id, hash);
+            if (table->fingerprints[i] != 0) {
+                hash = moviedb_id_hash(table->entries[i].id);
+                index = probe_index(&new_table, table->entries[i].id, hash);
                 new_table.entries[index] = table->entries[i];
+                new_table.fingerprints[index] = table->fingerprints[i];
             }
         }
 
         /* Frees the old table. */
+        moviedb_free(table->fingerprints);
         moviedb_free(table->entries);
         table->capacity = new_table.capacity;
         table->entries = new_table.entries;
+        table->fingerprints = new_table.fingerprints;
     }
 }
@@ -3,11 +3,15 @@
 
 #include "error.h"
 #include "id.h"
+#include "arena.h"
+#include "rating.h"
 #include "csv/movie.h"
+#include "movies/genres.h"
 
 /**
  * This file exports items related to movie storage. More specifically, it
- * provides a hash table whose keys are movie IDs and data is movie data.
+ * provides an array of movies, indexed by dense indices given in the order
+ * movies are inserted, and a hash table mapping movie IDs to these indices.
  */
 
 /**
@@ -20,45 +24,103 @@ struct movie {
      */
     moviedb_id_t id;
     /**
-     * Title of the movie. Heap-allocated. Only internal movies hash table code
-     * is allowed to update this, reading is fine.
+     * Title of the movie. Allocated from the table's arena. Only internal
+     * movies hash table code is allowed to update this, reading is fine.
      */
     char const *title;
     /**
-     * Genres of the movie. Heap-allocated.  Only internal movies hash table
-     * code is allowed to update this, reading is fine.
+     * Genres of the movie. Allocated from the table's arena. Only internal
+     * movies hash table code is allowed to update this, reading is fine.
      */
     char const *genres;
     /**
-     * How many ratings were done on this movie.
+     * IDs of the genres of the movie, interned into the table's genre
+     * dictionary. Only internal movies hash table code is allowed to update
+     * this, reading is fine.
+     */
+    struct genre_set genre_set;
+    /**
+     * How many ratings of each value were done on this movie. Only internal
+     * movies hash table code is allowed to update this, reading is fine.
+     */
+    struct rating_histogram histogram;
+    /**
+     * How many ratings were done on this movie. Only meaningful once the table
+     * is sealed.
      */
     unsigned long ratings;
     /**
-     * Mean of the ratings.
+     * Mean of the ratings. Only meaningful once the table is sealed.
      */
     double mean_rating;
+    /**
+     * Variance of the ratings. Only meaningful once the table is sealed.
+     */
+    double rating_variance;
+};
+
+/**
+ * An entry of the movies hash table, keeping the movie ID inline so probing
+ * does not need to read the movie.
+ */
+struct movies_entry {
+    /**
+     * ID of the movie. Only internal movie hash table code is allowed to touch
+     * this.
+     */
+    moviedb_id_t id;
+    /**
+     * Index of the movie in the array of movies. Only internal movie hash
+     * table code is allowed to touch this.
+     */
+    moviedb_index_t index;
 };
 
 /**
- * A hash table mapping movies' IDs to movies' data.
+ * An array of movies, with a hash table mapping movies' IDs to their indices.
  */
 struct movies_table {
     /**
-     * Array of pointers to movie data. The entries of the table. Only internal
-     * movie hash table code is allowed to touch this.
+     * Array of movies, by index. Only internal movie hash table code is
+     * allowed to touch this.
+     */
+    struct movie *movies;
+    /**
+     * Array of entries of the table. Only meaningful where the fingerprint is
+     * not zero. Only internal movie hash table code is allowed to touch this.
      */
-    struct movie **entries;
+    struct movies_entry *entries;
     /**
-     * How many movies are stored in this hash table. The entries of the table.
-     * Only internal movie hash table code is allowed to write to this. Reading
-     * is fine.
+     * Array of fingerprints of the entries' hashes, zero for empty entries.
+     * Only internal movie hash table code is allowed to touch this.
+     */
+    unsigned char *fingerprints;
+    /**
+     * How many movies are stored in this table, all of their indices being
+     * below it. Only internal movie hash table code is allowed to write to
+     * this. Reading is fine.
      */
     size_t length;
     /**
-     * How many movies can be stored in this hash table. The entries of the
-     * table. Only internal movie hash table code is allowed to touch this.
+     * How many entries the hash table has. Only internal movie hash table code
+     * is allowed to touch this.
      */
     size_t capacity;
+    /**
+     * How many movies the array can store. Only internal movie hash table code
+     * is allowed to touch this.
+     */
+    size_t movies_capacity;
+    /**
+     * Arena from which the strings of the movies are allocated, or NULL for
+     * the heap. Only internal movie hash table code is allowed to touch this.
+     */
+    struct arena *arena;
+    /**
+     * Dictionary of the genres of all movies in the table. Only internal movie
+     * hash table code is allowed to update this. Reading is fine.
+     */
+    struct genre_dict genres;
 };
 
 /**
@@ -71,46 +133,142 @@ struct movies_iter {
      */
     struct movies_table const *table;
     /**
-     * The current entry being checked. Only internal movies hash table code is
-     * allowed to touch this.
+     * Index of the next movie. Only internal movies hash table code is allowed
+     * to touch this.
      */
     size_t current;
 };
 
 /**
- * Tests if a given movie has the given genre.
+ * Tests if a given movie has the genre with the given ID, as returned by
+ * movies_genre.
  */
-bool movie_has_genre(
-        struct movie const *restrict movie,
-        char const *restrict genre);
+inline bool movie_has_genre(struct movie const *restrict movie, unsigned genre)
+{
+    return genre_set_has(&movie->genre_set, genre);
+}
 
 /**
- * Initializes the hash table. Initial capacity is rounded to the smallest prime
- * such that actual_initial_capacity >= initial_capacity.
+ * Initializes the table. Initial capacity is rounded up with
+ * moviedb_hash_capacity (to a prime or a power of two). Strings of the movies
+ * are allocated from the given arena, which must outlive the table, or from the
+ * heap if it is NULL.
  */
 void movies_init(
         struct movies_table *restrict table,
         size_t initial_capacity,
+        struct arena *arena,
         struct error *restrict error);
 
 /**
- * Inserts a movie CSV row in the table. Title and genres of the CSV row should
- * be heap-allocated, since the table will free them. If movie ID is duplicated,
- * an error is set (error_dup_movie_id). The given movie_row should not be used
- * after this function is called.
+ * Makes room for the given total number of movies, so the table is not resized
+ * until it holds more than that. Does nothing if there is room already.
+ */
+void movies_reserve(
+        struct movies_table *restrict table,
+        size_t entries,
+        struct error *restrict error);
+
+/**
+ * Inserts a movie CSV row in the table, copying its title and genres. Its index
+ * is the number of movies inserted before it. If movie ID is duplicated, an
+ * error is set (error_dup_movie_id), and if there are MOVIEDB_INDEX_MAX movies
+ * already, error_max_capacity is set. Movies might move when inserting, so
+ * pointers to them are only stable once the table is loaded.
  */
 void movies_insert(
         struct movies_table *restrict table,
-        struct movie_csv_row *restrict movie_row,
+        struct movie_csv_row const *restrict movie_row,
         struct error *restrict error);
 
 /**
- * Adds a rating for a movie. If not found, rating is not added.
+ * Counts a rating, given by its code, into the histogram of the movie with the
+ * given index, which must be in the table.
  */
-void movies_add_rating(
+inline void movies_add_rating(
         struct movies_table *restrict table,
+        moviedb_index_t movie,
+        uint8_t code)
+{
+    rating_histogram_add(&table->movies[movie].histogram, code);
+}
+
+/**
+ * Appends a movie restored e.g. from a snapshot, with the given histogram, like
+ * movies_insert does but without adding it to the hash table, which must be
+ * restored afterwards with movies_restore_entries. If there are
+ * MOVIEDB_INDEX_MAX movies already, error_max_capacity is set.
+ */
+void movies_restore_movie(
+        struct movies_table *restrict table,
+        struct movie_csv_row const *restrict movie_row,
+        struct rating_histogram const *restrict histogram,
+        struct error *restrict error);
+
+/**
+ * Replaces the hash table with copies of the given entries and fingerprints,
+ * e.g. when restoring a snapshot, mapping the IDs of the movies appended with
+ * movies_restore_movie to their indices. The capacity must be one
+ * moviedb_hash_capacity returns.
+ */
+void movies_restore_entries(
+        struct movies_table *restrict table,
+        struct movies_entry const *restrict entries,
+        unsigned char const *restrict fingerprints,
+        size_t capacity,
+        struct error *restrict error);
+
+/**
+ * Returns the entries of the hash table, writing their fingerprints, zero for
+ * empty entries, into fingerprints_out, and how many entries there are into
+ * capacity_out, e.g. to write the table into a snapshot.
+ */
+inline struct movies_entry const *movies_entries(
+        struct movies_table const *restrict table,
+        unsigned char const **restrict fingerprints_out,
+        size_t *restrict capacity_out)
+{
+    *fingerprints_out = table->fingerprints;
+    *capacity_out = table->capacity;
+    return table->entries;
+}
+
+/**
+ * Seals the ratings of the table: computes the rating count, mean and variance
+ * of every movie from its histogram. Must be called once all ratings are
+ * added, and again if more are added later.
+ */
+void movies_seal(struct movies_table *restrict table);
+
+/**
+ * Returns the ID of the genre with the given name, or GENRE_NONE if no movie
+ * of the table has it.
+ */
+inline unsigned movies_genre(
+        struct movies_table const *restrict table,
+        char const *restrict name)
+{
+    return genre_dict_find(&table->genres, name);
+}
+
+/**
+ * Searches for the index of the movie with the given ID. Returns whether it was
+ * found, and if so, writes the index in index_out.
+ */
+bool movies_index(
+        struct movies_table const *restrict table,
         moviedb_id_t movieid,
-        double rating);
+        moviedb_index_t *restrict index_out);
+
+/**
+ * Returns the movie with the given index, which must be in the table.
+ */
+inline struct movie const *movies_at(
+        struct movies_table const *restrict table,
+        moviedb_index_t index)
+{
+    return &table->movies[index];
+}
 
 /**
  * Search for the movie with the given ID. Returns NULL if not found.
@@ -131,8 +289,8 @@ inline void movies_iter(
 }
 
 /**
- * Finds the next entry in the movies table using the given iterator. Returns
- * NULL if all movies have been returned by the iterator.
+ * Finds the next movie in the table using the given iterator, in index order.
+ * Returns NULL if all movies have been returned by the iterator.
  */
 struct movie const *movies_next(struct movies_iter *restrict iter);
 
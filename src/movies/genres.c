@@ -0,0 +1,208 @@
+#include <stdlib.h>
+#include <string.h>
+#include "genres.h"
+#include "../alloc.h"
+
+/**
+ * Returns the ID of the genre named by the given bytes, or GENRE_NONE if it is
+ * not in the dictionary.
+ */
+static unsigned find_bytes(
+        struct genre_dict const *restrict dict,
+        char const *restrict name,
+        size_t length);
+
+/**
+ * Compares two genre IDs, for sorting.
+ */
+static int compare_ids(void const *left_ptr, void const *right_ptr);
+
+void genre_dict_init(struct genre_dict *restrict dict, struct arena *arena)
+{
+    dict->names = NULL;
+    dict->length = 0;
+    dict->capacity = 0;
+    dict->arena = arena;
+}
+
+unsigned genre_dict_intern(
+        struct genre_dict *restrict dict,
+        char const *restrict name,
+        size_t length,
+        struct error *restrict error)
+{
+    unsigned id = find_bytes(dict, name, length);
+    size_t new_cap;
+    char const **new_names;
+    char *name_copy;
+
+    if (id == GENRE_NONE && dict->length == dict->capacity) {
+        /* Doubles capacity, handles the case where capacity == 0. */
+        new_cap = dict->capacity * 2;
+        if (new_cap == 0) {
+            new_cap = 32;
+        }
+
+        new_names = moviedb_realloc(
+                dict->names,
+                sizeof(*new_names),
+                new_cap,
+                error);
+
+        if (error->code == error_none) {
+            dict->names = new_names;
+            dict->capacity = new_cap;
+        }
+    }
+
+    if (id == GENRE_NONE && error->code == error_none) {
+        name_copy = arena_copy_str(dict->arena, name, length, error);
+
+        if (error->code == error_none) {
+            id = dict->length;
+            dict->names[id] = name_copy;
+            dict->length++;
+        }
+    }
+
+    return id;
+}
+
+unsigned genre_dict_find(
+        struct genre_dict const *restrict dict,
+        char const *restrict name)
+{
+    return find_bytes(dict, name, strlen(name));
+}
+
+void genre_dict_destroy(struct genre_dict *restrict dict)
+{
+    size_t i;
+
+    for (i = 0; i < dict->length; i++) {
+        arena_free(dict->arena, dict->names[i]);
+    }
+
+    moviedb_free(dict->names);
+    dict->names = NULL;
+    dict->length = 0;
+    dict->capacity = 0;
+}
+
+void genre_set_init(
+        struct genre_set *restrict set,
+        struct genre_dict *restrict dict,
+        char const *restrict list,
+        struct arena *arena,
+        struct error *restrict error)
+{
+    char const *start = list;
+    size_t length;
+    unsigned id;
+    unsigned overflow = 0;
+    unsigned i, j;
+
+    set->mask = 0;
+    set->overflow = NULL;
+    set->overflow_length = 0;
+
+    /* Each genre of the list ends at a '|' or at the end of the list. */
+    while (*start != 0 && error->code == error_none) {
+        length = strcspn(start, "|");
+
+        if (length > 0) {
+            id = genre_dict_intern(dict, start, length, error);
+            if (id < GENRE_MASK_BITS) {
+                set->mask |= UINT64_C(1) << id;
+            } else if (error->code == error_none) {
+                overflow++;
+            }
+        }
+
+        start += length;
+        if (*start == '|') {
+            start++;
+        }
+    }
+
+    if (overflow > 0 && error->code == error_none) {
+        /* Only datasets with many genres get here, so lists are walked again. */
+        set->overflow = arena_alloc(
+                arena,
+                sizeof(*set->overflow),
+                overflow,
+                error);
+
+        start = list;
+        while (*start != 0 && error->code == error_none) {
+            length = strcspn(start, "|");
+            id = find_bytes(dict, start, length);
+            if (length > 0 && id >= GENRE_MASK_BITS) {
+                set->overflow[set->overflow_length] = id;
+                set->overflow_length++;
+            }
+
+            start += length;
+            if (*start == '|') {
+                start++;
+            }
+        }
+
+        if (error->code == error_none) {
+            qsort(set->overflow,
+                    set->overflow_length,
+                    sizeof(*set->overflow),
+                    compare_ids);
+
+            /* Removes duplicated genres of the list. */
+            j = 0;
+            for (i = 0; i < set->overflow_length; i++) {
+                if (j == 0 || set->overflow[j - 1] != set->overflow[i]) {
+                    set->overflow[j] = set->overflow[i];
+                    j++;
+                }
+            }
+            set->overflow_length = j;
+        }
+    }
+}
+
+extern inline bool genre_set_has(
+        struct genre_set const *restrict set,
+        unsigned id);
+
+void genre_set_destroy(
+        struct genre_set *restrict set,
+        struct arena const *arena)
+{
+    arena_free(arena, set->overflow);
+    set->overflow = NULL;
+    set->overflow_length = 0;
+}
+
+static unsigned find_bytes(
+        struct genre_dict const *restrict dict,
+        char const *restrict name,
+        size_t length)
+{
+    size_t i = 0;
+    unsigned id = GENRE_NONE;
+
+    while (id == GENRE_NONE && i < dict->length) {
+        if (strncmp(dict->names[i], name, length) == 0
+                && dict->names[i][length] == 0) {
+            id = i;
+        }
+        i++;
+    }
+
+    return id;
+}
+
+static int compare_ids(void const *left_ptr, void const *right_ptr)
+{
+    unsigned left = *(unsigned const *) left_ptr;
+    unsigned right = *(unsigned const *) right_ptr;
+
+    return (left > right) - (left < right);
+}
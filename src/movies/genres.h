@@ -0,0 +1,154 @@
+#ifndef MOVIEDB_MOVIES_GENRES_H
+#define MOVIEDB_MOVIES_GENRES_H 1
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+#include "../error.h"
+#include "../arena.h"
+
+/**
+ * This file provides utilities related to the genres of movies: a dictionary
+ * interning genre names into small integer IDs, and sets of genre IDs.
+ */
+
+/**
+ * How many genres a genre set holds in its bitmask. Genres with greater IDs go
+ * to the set's overflow list.
+ */
+#define GENRE_MASK_BITS 64
+
+/**
+ * ID returned when a genre is not in a dictionary.
+ */
+#define GENRE_NONE UINT_MAX
+
+/**
+ * A dictionary of genre names. There are only a few dozen genres, so they are
+ * kept in an array, indexed by ID, and searched linearly.
+ */
+struct genre_dict {
+    /**
+     * Array of names, indexed by genre ID. Allocated from the dictionary's
+     * arena. Only internal genre dictionary code is allowed to update this.
+     * Reading is fine.
+     */
+    char const **names;
+    /**
+     * How many genres there are. Only internal genre dictionary code is
+     * allowed to update this. Reading is fine.
+     */
+    size_t length;
+    /**
+     * How many names can be stored. Only internal genre dictionary code is
+     * allowed to touch this.
+     */
+    size_t capacity;
+    /**
+     * Arena from which names are allocated, or NULL for the heap. Only
+     * internal genre dictionary code is allowed to touch this.
+     */
+    struct arena *arena;
+};
+
+/**
+ * A set of genre IDs: a bitmask of the first GENRE_MASK_BITS IDs, so most
+ * tests are a single AND, and a list of the other IDs.
+ */
+struct genre_set {
+    /**
+     * Bit i tells whether genre ID i is in the set. Only internal genre set
+     * code is allowed to update this. Reading is fine.
+     */
+    uint64_t mask;
+    /**
+     * Sorted array of the IDs not fitting the mask, NULL if there is none.
+     * Only internal genre set code is allowed to update this. Reading is fine.
+     */
+    unsigned *overflow;
+    /**
+     * How many IDs are in the overflow array. Only internal genre set code is
+     * allowed to update this. Reading is fine.
+     */
+    unsigned overflow_length;
+};
+
+/**
+ * Initializes an empty dictionary. Names are allocated from the given arena,
+ * which must outlive the dictionary, or from the heap if it is NULL.
+ */
+void genre_dict_init(struct genre_dict *restrict dict, struct arena *arena);
+
+/**
+ * Returns the ID of the genre named by the given bytes, adding the genre if
+ * it is not in the dictionary yet. Returns GENRE_NONE on error.
+ */
+unsigned genre_dict_intern(
+        struct genre_dict *restrict dict,
+        char const *restrict name,
+        size_t length,
+        struct error *restrict error);
+
+/**
+ * Returns the ID of the genre with the given name, or GENRE_NONE if it is not
+ * in the dictionary.
+ */
+unsigned genre_dict_find(
+        struct genre_dict const *restrict dict,
+        char const *restrict name);
+
+/**
+ * Destroys the given dictionary, freeing the names unless the arena owns
+ * them.
+ */
+void genre_dict_destroy(struct genre_dict *restrict dict);
+
+/**
+ * Initializes the set with the genres of the given '|'-separated list,
+ * interning their names into the dictionary. The overflow array is allocated
+ * from the given arena, or from the heap if it is NULL.
+ */
+void genre_set_init(
+        struct genre_set *restrict set,
+        struct genre_dict *restrict dict,
+        char const *restrict list,
+        struct arena *arena,
+        struct error *restrict error);
+
+/**
+ * Tests whether the given genre ID is in the set.
+ */
+inline bool genre_set_has(struct genre_set const *restrict set, unsigned id)
+{
+    unsigned low = 0, high, mid;
+    bool found = false;
+
+    if (id < GENRE_MASK_BITS) {
+        found = (set->mask >> id) & 1;
+    } else {
+        /* Binary search through the overflow list. */
+        high = set->overflow_length;
+        while (low < high && !found) {
+            mid = low + (high - low) / 2;
+            if (set->overflow[mid] < id) {
+                low = mid + 1;
+            } else if (set->overflow[mid] > id) {
+                high = mid;
+            } else {
+                found = true;
+            }
+        }
+    }
+
+    return found;
+}
+
+/**
+ * Destroys the given set, freeing the overflow array unless the given arena
+ * owns it.
+ */
+void genre_set_destroy(
+        struct genre_set *restrict set,
+        struct arena const *arena);
+
+#endif
@@ -5,5 +5,7 @@
 #include "query/user.h"
 #include "query/topn.h"
 #include "query/tags.h"
+#include "query/complete.h"
+#include "query/raters.h"
 
 #endif
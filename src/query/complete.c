@@ -0,0 +1,88 @@
+#include "complete.h"
+#include "movie.h"
+
+/**
+ * Inserts a row in the query buffer, in order, unless it already has
+ * TRIE_COMPLETIONS better rows.
+ */
+static void buf_insert(
+        struct complete_query_buf *restrict buf,
+        struct movie const *row);
+
+void complete_query(
+        struct database const *restrict database,
+        char const *restrict prefix,
+        struct complete_query_buf *restrict query_buf)
+{
+    moviedb_id_t const *completions;
+    struct titles_range range;
+    struct movie const *movie;
+    size_t length;
+    size_t i;
+
+    query_buf->length = 0;
+
+    if (database->title_index == database_title_trie) {
+        /* The completions are ranked already. */
+        length = trie_complete(&database->trie_root, prefix, &completions);
+        for (i = 0; i < length; i++) {
+            movie = movies_search(&database->movies, completions[i]);
+            if (movie != NULL) {
+                query_buf->rows[query_buf->length] = movie;
+                query_buf->length++;
+            }
+        }
+    } else {
+        titles_search_prefix(&database->titles, prefix, &range);
+        for (i = range.start; i < range.end; i++) {
+            movie = movies_search(
+                    &database->movies,
+                    titles_movie(&database->titles, i));
+            if (movie != NULL) {
+                buf_insert(query_buf, movie);
+            }
+        }
+    }
+}
+
+void complete_query_print(struct complete_query_buf const *restrict query_buf)
+{
+    size_t i;
+
+    movie_query_print_header();
+
+    putchar('\n');
+
+    for (i = 0; i < query_buf->length; i++) {
+        movie_query_print_row(query_buf->rows[i]);
+    }
+
+    printf("\nFound %zu results\n", query_buf->length);
+}
+
+static void buf_insert(
+        struct complete_query_buf *restrict buf,
+        struct movie const *row)
+{
+    size_t position = buf->length;
+    size_t i;
+
+    /* Most rated first, and then lowest IDs. */
+    while (position > 0
+            && (row->ratings > buf->rows[position - 1]->ratings
+                || (row->ratings == buf->rows[position - 1]->ratings
+                    && row->id < buf->rows[position - 1]->id))) {
+        position--;
+    }
+
+    if (position < TRIE_COMPLETIONS) {
+        if (buf->length < TRIE_COMPLETIONS) {
+            buf->length++;
+        }
+        /* Shifts the worse rows, dropping the last one if it was full. */
+        for (i = buf->length - 1; i > position; i--) {
+            buf->rows[i] = buf->rows[i - 1];
+        }
+        buf->rows[position] = row;
+    }
+}
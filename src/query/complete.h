@@ -0,0 +1,46 @@
+#ifndef MOVIEDB_QUERY_COMPLETE_H
+#define MOVIEDB_QUERY_COMPLETE_H 1
+
+#include "../database.h"
+
+/**
+ * This file declares utilities related to the 'complete' query.
+ */
+
+/**
+ * Buffer to store the result of a complete query.
+ */
+struct complete_query_buf {
+    /**
+     * Pointers to the rows, most rated first. Only internal database code is
+     * allowed to write to this. Reading is fine.
+     */
+    struct movie const *rows[TRIE_COMPLETIONS];
+    /**
+     * How many rows the query returned. Only internal database code is allowed
+     * to write to this. Reading is fine.
+     */
+    size_t length;
+};
+
+/**
+ * Executes a complete query. The complete query returns the TRIE_COMPLETIONS
+ * movies with the given prefix in their names that have the most ratings, and
+ * then the lowest IDs. query_buf might contain data, but it will be
+ * overwritten with the query result.
+ *
+ * With the trie, completions are ranked when the database is loaded, so the
+ * query costs the same however many titles have the prefix. With the title
+ * dictionary, the titles with the prefix are scanned.
+ */
+void complete_query(
+        struct database const *restrict database,
+        char const *restrict prefix,
+        struct complete_query_buf *restrict query_buf);
+
+/**
+ * Prints a header and the rows found in the complete query.
+ */
+void complete_query_print(struct complete_query_buf const *restrict query_buf);
+
+#endif
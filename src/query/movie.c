@@ -7,6 +7,27 @@
 #define COLOR_GENRES TERMINAL_YELLOW
 #define COLOR_MEAN_RATING TERMINAL_RED
 #define COLOR_RATINGS TERMINAL_BLUE
+#define COLOR_DISTRIBUTION TERMINAL_RED
+
+/**
+ * Appends the movies with the given prefix in their titles to the query buffer,
+ * walking the trie.
+ */
+static void collect_from_trie(
+        struct database const *restrict database,
+        char const *restrict prefix,
+        struct movie_query_buf *restrict query_buf,
+        struct error *restrict error);
+
+/**
+ * Appends the movies with the given prefix in their titles to the query buffer,
+ * streaming their range of the title dictionary.
+ */
+static void collect_from_titles(
+        struct database const *restrict database,
+        char const *restrict prefix,
+        struct movie_query_buf *restrict query_buf,
+        struct error *restrict error);
 
 /**
  * Appends a row to the query buffer.
@@ -57,31 +78,14 @@ void movie_query(
         struct movie_query_buf *restrict query_buf,
         struct error *restrict error)
 {
-    struct trie_iter iter;
-    moviedb_id_t movieid;
-    struct movie const *movie;
-    bool has_data;
-
     query_buf->length = 0;
 
-    /* Initializes the trie iterator over movies with given prefix. */
-    trie_search_prefix(&database->trie_root, prefix, &iter, error);
-
-    has_data = true;
-    while (has_data && error->code == error_none) {
-        has_data = trie_next_movie(&iter, &movieid, error);
-        if (has_data) {
-            /* Adds this movie to the buffer, if it exists. */
-            movie = movies_search(&database->movies, movieid);
-            if (movie != NULL) {
-                buf_append(query_buf, movie, error);
-            }
-        }
+    if (database->title_index == database_title_trie) {
+        collect_from_trie(database, prefix, query_buf, error);
+    } else {
+        collect_from_titles(database, prefix, query_buf, error);
     }
 
-    /* Destroys the iterator. */
-    trie_iter_destroy(&iter);
-
     if (error->code == error_none) {
         /* Sorts the resulting buffer by ID. */
         sort_buf(query_buf);
@@ -100,6 +104,12 @@ void movie_query_print_header(void)
             COLOR_MEAN_RATING "Mean Rating"
             TERMINAL_CLEAR ", "
             COLOR_RATINGS "Ratings Count"
+            TERMINAL_CLEAR ", "
+            COLOR_DISTRIBUTION "Median Rating"
+            TERMINAL_CLEAR ", "
+            COLOR_DISTRIBUTION "10th-90th Percentile"
+            TERMINAL_CLEAR ", "
+            COLOR_DISTRIBUTION "Rating Variance"
             TERMINAL_CLEAR);
 }
 
@@ -120,12 +130,22 @@ void movie_query_print_row(struct movie const *restrict row)
             COLOR_MEAN_RATING "%.1lf"
             TERMINAL_CLEAR ", "
             COLOR_RATINGS "%zu"
+            TERMINAL_CLEAR ", "
+            COLOR_DISTRIBUTION "%.1lf"
+            TERMINAL_CLEAR ", "
+            COLOR_DISTRIBUTION "%.1lf-%.1lf"
+            TERMINAL_CLEAR ", "
+            COLOR_DISTRIBUTION "%.2lf"
             TERMINAL_CLEAR "\n",
             id_buffer + id_start,
             row->title,
             row->genres,
             row->mean_rating,
-            row->ratings);
+            row->ratings,
+            rating_histogram_percentile(&row->histogram, 0.5),
+            rating_histogram_percentile(&row->histogram, 0.1),
+            rating_histogram_percentile(&row->histogram, 0.9),
+            row->rating_variance);
 }
 
 
@@ -146,6 +166,56 @@ void movie_query_print(struct movie_query_buf const *restrict query_buf)
 
 extern inline void movie_query_destroy(struct movie_query_buf *restrict buf);
 
+static void collect_from_trie(
+        struct database const *restrict database,
+        char const *restrict prefix,
+        struct movie_query_buf *restrict query_buf,
+        struct error *restrict error)
+{
+    moviedb_id_t movieid;
+    struct movie const *movie;
+    bool has_data;
+
+    /* Points the trie iterator to the movies with given prefix. */
+    trie_search_prefix(&database->trie_root, prefix, &query_buf->iter);
+
+    has_data = true;
+    while (has_data && error->code == error_none) {
+        has_data = trie_next_movie(&query_buf->iter, &movieid, error);
+        if (has_data) {
+            /* Adds this movie to the buffer, if it exists. */
+            movie = movies_search(&database->movies, movieid);
+            if (movie != NULL) {
+                buf_append(query_buf, movie, error);
+            }
+        }
+    }
+}
+
+static void collect_from_titles(
+        struct database const *restrict database,
+        char const *restrict prefix,
+        struct movie_query_buf *restrict query_buf,
+        struct error *restrict error)
+{
+    struct titles_range range;
+    struct movie const *movie;
+    size_t rank;
+
+    titles_search_prefix(&database->titles, prefix, &range);
+
+    for (rank = range.start; rank < range.end; rank++) {
+        if (error->code == error_none) {
+            movie = movies_search(
+                    &database->movies,
+                    titles_movie(&database->titles, rank));
+            if (movie != NULL) {
+                buf_append(query_buf, movie, error);
+            }
+        }
+    }
+}
+
 static void buf_append(
         struct movie_query_buf *restrict buf,
         struct movie const *row,
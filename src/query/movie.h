@@ -26,6 +26,11 @@ struct movie_query_buf {
      * touch this.
      */
     size_t capacity;
+    /**
+     * Iterator over the trie, kept so the next queries reuse its stack. Only
+     * internal database code is allowed to touch this.
+     */
+    struct trie_iter iter;
 };
 
 /**
@@ -36,6 +41,7 @@ inline void movie_query_init(struct movie_query_buf *restrict buf)
     buf->rows = NULL;
     buf->length = 0;
     buf->capacity = 0;
+    trie_iter_init(&buf->iter);
 }
 
 /**
@@ -71,6 +77,7 @@ void movie_query_print(struct movie_query_buf const *restrict query_buf);
 inline void movie_query_destroy(struct movie_query_buf *restrict buf)
 {
     moviedb_free(buf->rows);
+    trie_iter_destroy(&buf->iter);
 }
 
 #endif
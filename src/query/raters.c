@@ -0,0 +1,84 @@
+#include "raters.h"
+#include "../io.h"
+
+/* Colors for the columns */
+#define COLOR_ID TERMINAL_GREEN
+#define COLOR_RATING TERMINAL_MAGENTA
+
+void raters_query_init(
+        struct raters_query_iter *restrict iter_out,
+        struct database const *database,
+        moviedb_id_t movieid)
+{
+    moviedb_index_t movie;
+
+    iter_out->database = database;
+    iter_out->raters = NULL;
+    iter_out->length = 0;
+    iter_out->current = 0;
+
+    if (movies_index(&database->movies, movieid, &movie)) {
+        iter_out->raters = raters_index_movie(
+                &database->raters,
+                movie,
+                &iter_out->length);
+    }
+}
+
+bool raters_query_next(
+        struct raters_query_iter *restrict iter,
+        struct raters_query_row *restrict row_out)
+{
+    struct movie_rater const *rater;
+    bool found = iter->current < iter->length;
+
+    if (found) {
+        rater = &iter->raters[iter->current];
+        row_out->user = users_at(&iter->database->users, rater->user)->id;
+        row_out->rating = rating_decode(rater->code);
+        iter->current++;
+    }
+
+    return found;
+}
+
+void raters_query_print_header(void)
+{
+    /* Puts the header by concatenating string literals. */
+    puts(COLOR_ID "User ID"
+            TERMINAL_CLEAR ", "
+            COLOR_RATING "Rating"
+            TERMINAL_CLEAR);
+}
+
+void raters_query_print_row(struct raters_query_row const *restrict row)
+{
+    char id_buffer[MOVIEDB_ID_DIGITS + 1];
+    size_t id_start;
+
+    id_start = moviedb_id_to_str(row->user, id_buffer, MOVIEDB_ID_DIGITS + 1);
+
+    printf(COLOR_ID "%s"
+            TERMINAL_CLEAR ", "
+            COLOR_RATING "%.1lf"
+            TERMINAL_CLEAR "\n",
+            id_buffer + id_start,
+            row->rating);
+}
+
+void raters_query_print(struct raters_query_iter *restrict iter)
+{
+    struct raters_query_row row;
+    size_t count = 0;
+
+    raters_query_print_header();
+
+    putchar('\n');
+
+    while (raters_query_next(iter, &row)) {
+        raters_query_print_row(&row);
+        count++;
+    }
+
+    printf("\nFound %zu results\n", count);
+}
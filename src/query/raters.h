@@ -0,0 +1,82 @@
+#ifndef MOVIEDB_QUERY_RATERS_H
+#define MOVIEDB_QUERY_RATERS_H 1
+
+#include "../database.h"
+
+/**
+ * This file declares utilities related to the 'raters' query.
+ */
+
+/**
+ * A row of the "raters" query.
+ */
+struct raters_query_row {
+    /**
+     * ID of the user that rated the movie.
+     */
+    moviedb_id_t user;
+    /**
+     * The rating given by the user.
+     */
+    double rating;
+};
+
+/**
+ * Iterator over the rows of a "raters" query.
+ */
+struct raters_query_iter {
+    /**
+     * The database being looked at. Only internal database code is allowed to
+     * touch this.
+     */
+    struct database const *database;
+    /**
+     * The raters of the movie being iterated over, a range of the raters
+     * index. Only internal database code is allowed to touch this.
+     */
+    struct movie_rater const *raters;
+    /**
+     * How many raters the movie has, zero if the movie was not found. Only
+     * internal database code is allowed to touch this.
+     */
+    size_t length;
+    /**
+     * Current rater being iterated. Only internal database code is allowed to
+     * touch this.
+     */
+    size_t current;
+};
+
+/**
+ * Initializes the raters query's row iterator, over the users that rated the
+ * movie with the given ID, in the order they were loaded.
+ */
+void raters_query_init(
+        struct raters_query_iter *restrict iter_out,
+        struct database const *database,
+        moviedb_id_t movieid);
+
+/**
+ * Builds the next row and returns whether there is a next row. If there is a
+ * next row, it is placed at the row_out parameter.
+ */
+bool raters_query_next(
+        struct raters_query_iter *restrict iter,
+        struct raters_query_row *restrict row_out);
+
+/**
+ * Prints a raters query's header to the screen.
+ */
+void raters_query_print_header(void);
+
+/**
+ * Prints a raters query's row to the screen.
+ */
+void raters_query_print_row(struct raters_query_row const *restrict row);
+
+/**
+ * Iterates through the raters query rows and print them. Prints a header too.
+ */
+void raters_query_print(struct raters_query_iter *restrict iter);
+
+#endif
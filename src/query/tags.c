@@ -1,3 +1,4 @@
+#include <stdlib.h>
 #include "tags.h"
 #include "../io.h"
 
@@ -16,13 +17,10 @@ static void buf_append(
         struct error *restrict error);
 
 /**
- * Tests if the given movie is in the tags of the given query input, after
- * the first tag, i.e. first tag is not tested, since the movie is assumed to
- * come from the first tag.
+ * Compares two rows by the IDs of their movies, for qsort.
  */
-static bool movie_in_tags(
-        struct tags_query_input const *restrict input,
-        moviedb_id_t movieid);
+static int compare_ids(void const *left_ptr, void const *right_ptr);
+
 
 void tags_query_input_init(
         struct tags_query_input *restrict query_input,
@@ -46,7 +44,8 @@ void tags_query_input_add(
         struct error *restrict error)
 {
     size_t new_cap;
-    struct tag const *tag, *tmp;
+    size_t i;
+    struct tag const *tag;
     struct tag const **new_tags;
 
     tag = tags_search(&database->tags, name);
@@ -72,16 +71,19 @@ void tags_query_input_add(
         }
 
         if (error->code == error_none) {
-            /* Finally inserts the tag at the end. */
-            query_input->tags[query_input->length] = tag;
-            query_input->length++;
-
-            if (query_input->tags[0]->movies.length > tag->movies.length) {
-                /* The tag with less movies goes first. */ 
-                tmp = query_input->tags[0];
-                query_input->tags[0] = tag;
-                query_input->tags[query_input->length - 1] = tmp;
+            /*
+             * Finally inserts the tag, keeping tags ordered by how many movies
+             * they have, so intersections start from the smallest sets.
+             */
+            i = query_input->length;
+            while (i > 0
+                    && query_input->tags[i - 1]->movies.length
+                        > tag->movies.length) {
+                query_input->tags[i] = query_input->tags[i - 1];
+                i--;
             }
+            query_input->tags[i] = tag;
+            query_input->length++;
         }
     }
 }
@@ -98,29 +100,56 @@ void tags_query(
         struct tags_query_buf *restrict query_buf,
         struct error *restrict error)
 {
-    struct movie const *movie;
-    struct tag_movies_iter iter;
+    struct bitmap scratch[2];
+    struct bitmap const *movies = NULL;
+    struct bitmap_iter iter;
+    size_t first = query_buf->length;
     size_t i;
-    moviedb_id_t movieid;
+    /* Index of a movie, as the bitmaps store it. */
+    moviedb_id_t movie;
+
+    bitmap_init(&scratch[0]);
+    bitmap_init(&scratch[1]);
 
     if (query_input->length > 0) {
-        /* We will use the list of movies from the tag with less movies. */
-        tag_movies_iter(&query_input->tags[0]->movies, &iter);
-        
-        while (error->code == error_none && tag_movies_next(&iter, &movieid)) {
-            if (movie_in_tags(query_input, movieid)) {
-                /*
-                 * Inserts the movie into the query result buffer if present in
-                 * all tags.
-                 */
-                movie = movies_search(&database->movies, movieid);
-                if (movie != NULL) {
-                    buf_append(query_buf, movie, error);
-                }
-            }
-            i++;
+        /* We start from the movies of the tag with less movies. */
+        movies = &query_input->tags[0]->movies.bitmap;
+    }
+
+    /*
+     * Narrows the movies down with each tag, in order of size, alternating
+     * between the scratch bitmaps.
+     */
+    for (i = 1; i < query_input->length && error->code == error_none; i++) {
+        bitmap_and(
+                &scratch[i % 2],
+                movies,
+                &query_input->tags[i]->movies.bitmap,
+                error);
+        movies = &scratch[i % 2];
+    }
+
+    if (movies != NULL && error->code == error_none) {
+        /* The movies left are in all tags, and they come out in index order. */
+        bitmap_iter(movies, &iter);
+        while (error->code == error_none && bitmap_next(&iter, &movie)) {
+            buf_append(
+                    query_buf,
+                    movies_at(&database->movies, movie),
+                    error);
         }
     }
+
+    /* Indices follow the order movies were loaded in, not their IDs. */
+    if (error->code == error_none && query_buf->length - first > 1) {
+        qsort(query_buf->rows + first,
+                query_buf->length - first,
+                sizeof(*query_buf->rows),
+                compare_ids);
+    }
+
+    bitmap_destroy(&scratch[0]);
+    bitmap_destroy(&scratch[1]);
 }
 
 void tags_query_print_header(void)
@@ -207,18 +236,10 @@ static void buf_append(
     }
 }
 
-static bool movie_in_tags(
-        struct tags_query_input const *restrict input,
-        moviedb_id_t movieid)
+static int compare_ids(void const *left_ptr, void const *right_ptr)
 {
-    size_t tag = 1;
-    bool found = true;
-
-    /* For all tags, tests if they contain the given movie. */
-    while (tag < input->length && found) {
-        found = tag_movies_contain(&input->tags[tag]->movies, movieid);
-        tag++;
-    } 
+    moviedb_id_t left = (*(struct movie const *const *) left_ptr)->id;
+    moviedb_id_t right = (*(struct movie const *const *) right_ptr)->id;
 
-    return found;
+    return (left > right) - (left < right);
 }
@@ -13,7 +13,8 @@
 struct tags_query_input {
     /**
      * The array of pointer to tags. Only internal tags query code is allowed to
-     * touch this. A tag with the less amount of movies goes first.
+     * touch this. Tags are ordered by how many movies they have, the tag
+     * with the less amount of movies first.
      */
     struct tag const **tags;
     /**
@@ -87,9 +88,10 @@ inline void tags_query_init(struct tags_query_buf *restrict buf)
 }
 
 /**
- * Performs the tags query. Searches for the best rated movies of the given
- * genre and with at least min_ratings count of ratings. The buffer must be
- * initalized and might be reused before being destroyed.
+ * Performs the tags query. Searches for the movies associated with all tags of
+ * the given input, by intersecting the bitmaps of the sealed movie sets of the
+ * tags from the smallest to the largest. Movies are appended in order of ID.
+ * The buffer must be initalized and might be reused before being destroyed.
  */
 void tags_query(
         struct database const *restrict database,
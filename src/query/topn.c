@@ -1,3 +1,4 @@
+#include <stdlib.h>
 #include "topn.h"
 #include "../io.h"
 
@@ -6,13 +7,29 @@
 #define COLOR_GENRES TERMINAL_YELLOW
 #define COLOR_MEAN_RATING TERMINAL_RED
 #define COLOR_RATINGS TERMINAL_BLUE
+#define COLOR_DISTRIBUTION TERMINAL_RED
 
-static size_t buf_search(struct topn_query_buf *restrict buf, double rating);
+/**
+ * Compares rows of the topN query since a month, so the best mean comes first,
+ * and movies with the same mean are ordered by ID.
+ */
+static int compare_since_rows(void const *left_ptr, void const *right_ptr);
 
-static void buf_insert(
-        struct topn_query_buf *restrict buf,
-        struct movie const *row,
-        size_t pos);
+/**
+ * Keeps the given row if it is among the best found so far. The rows of the
+ * buffer are a heap with the worst row at the root while the query runs.
+ */
+static void since_keep(
+        struct topn_since_buf *restrict buf,
+        struct topn_since_row const *restrict row);
+
+/**
+ * Replaces the root of the heap of rows by the given row, sifting it down to
+ * its place.
+ */
+static void since_replace_root(
+        struct topn_since_buf *restrict buf,
+        struct topn_since_row const *restrict row);
 
 void topn_query_init(
         struct topn_query_buf *restrict buf,
@@ -35,44 +52,82 @@ void topn_query(
         struct database const *restrict database,
         char const *restrict genre,
         size_t min_ratings,
+        enum topn_ranking ranking,
         struct topn_query_buf *restrict query_buf)
 {
-    size_t pos;
-    struct movies_iter iter;
-    struct movie const *movie;
-    bool has_genre;
+    struct genre const *indexed;
+    struct genre_movie const *movies;
+    size_t i = 0;
 
     query_buf->length = 0;
 
-    if (query_buf->capacity > 0) {
-        movies_iter(&database->movies, &iter);
-
-        movie = movies_next(&iter);
-
-        /* While there is a movie yielded by the iterator. */
-        while (movie != NULL) {
-            has_genre = movie_has_genre(movie, genre);
-            if (has_genre && movie->ratings >= min_ratings) {
-                /*
-                 * Only inserts if movie has the given genre, and if it has a
-                 * minimum number of ratings.
-                 */
-                /*
-                 * Gets the position where it should be inserted, using binary
-                 * search.
-                 */
-                pos = buf_search(query_buf, movie->mean_rating);
-
-                if (pos < query_buf->capacity) {
-                    /* Only inserts if there is room. Ordered insert. */
-                    buf_insert(query_buf, movie, pos);
-                }
-            }
+    indexed = genres_index_search(&database->genres, genre);
+
+    if (indexed != NULL) {
+        movies = ranking == topn_most_controversial
+            ? indexed->controversial
+            : indexed->movies;
 
-            movie = movies_next(&iter);
+        /*
+         * Movies of the genre are sorted in the order of the ranking, so the
+         * first N with enough ratings are the result.
+         */
+        while (query_buf->length < query_buf->capacity
+                && i < indexed->length) {
+            if (movies[i].ratings >= min_ratings) {
+                query_buf->rows[query_buf->length] = movies[i].movie;
+                query_buf->length++;
+            }
+            i++;
         }
     }
+}
+
+void topn_since_init(
+        struct topn_since_buf *restrict buf,
+        size_t capacity,
+        struct error *restrict error)
+{
+    buf->capacity = capacity;
+    buf->length = 0;
+    buf->rows = moviedb_alloc(sizeof(*buf->rows), buf->capacity, error);
+}
+
+void topn_since_query(
+        struct database const *restrict database,
+        char const *restrict genre,
+        size_t min_ratings,
+        unsigned long month,
+        struct topn_since_buf *restrict buf)
+{
+    struct genre const *indexed;
+    struct timeline_month const *since;
+    struct topn_since_row row;
+    struct bitmap_iter iter;
+    /* Index of a movie, as the bitmaps store it. */
+    moviedb_id_t movie;
+
+    buf->length = 0;
+
+    indexed = genres_index_search(&database->genres, genre);
+
+    if (indexed != NULL && buf->capacity > 0) {
+        bitmap_iter(&indexed->movie_indices, &iter);
+        while (bitmap_next(&iter, &movie)) {
+            since = timeline_index_since(&database->timeline, movie, month);
+            if (since != NULL && since->ratings >= min_ratings) {
+                row.movie = movies_at(&database->movies, movie);
+                row.ratings = since->ratings;
+                row.mean_rating = since->steps
+                    / (double) RATING_STEPS
+                    / since->ratings;
+                since_keep(buf, &row);
+            }
+        }
 
+        /* The heap only has the best rows, sorted here in their ranking. */
+        qsort(buf->rows, buf->length, sizeof(*buf->rows), compare_since_rows);
+    }
 }
 
 void topn_query_print_header(void)
@@ -85,6 +140,12 @@ void topn_query_print_header(void)
             COLOR_MEAN_RATING "Mean Rating"
             TERMINAL_CLEAR ", "
             COLOR_RATINGS "Ratings Count"
+            TERMINAL_CLEAR ", "
+            COLOR_DISTRIBUTION "Median Rating"
+            TERMINAL_CLEAR ", "
+            COLOR_DISTRIBUTION "10th-90th Percentile"
+            TERMINAL_CLEAR ", "
+            COLOR_DISTRIBUTION "Rating Variance"
             TERMINAL_CLEAR);
 }
 
@@ -98,11 +159,21 @@ void topn_query_print_row(struct movie const *restrict row)
             COLOR_MEAN_RATING "%.1lf"
             TERMINAL_CLEAR ", "
             COLOR_RATINGS "%zu"
+            TERMINAL_CLEAR ", "
+            COLOR_DISTRIBUTION "%.1lf"
+            TERMINAL_CLEAR ", "
+            COLOR_DISTRIBUTION "%.1lf-%.1lf"
+            TERMINAL_CLEAR ", "
+            COLOR_DISTRIBUTION "%.2lf"
             TERMINAL_CLEAR "\n",
             row->title,
             row->genres,
             row->mean_rating,
-            row->ratings);
+            row->ratings,
+            rating_histogram_percentile(&row->histogram, 0.5),
+            rating_histogram_percentile(&row->histogram, 0.1),
+            rating_histogram_percentile(&row->histogram, 0.9),
+            row->rating_variance);
 }
 
 void topn_query_print(struct topn_query_buf const *restrict query_buf)
@@ -120,57 +191,116 @@ void topn_query_print(struct topn_query_buf const *restrict query_buf)
     printf("\nFound %zu results\n", query_buf->length);
 }
 
+void topn_since_print(struct topn_since_buf const *restrict buf)
+{
+    size_t i;
+
+    /* Puts the header by concatenating string literals. */
+    puts(COLOR_TITLE "Title"
+            TERMINAL_CLEAR ", "
+            COLOR_GENRES "Genres"
+            TERMINAL_CLEAR ", "
+            COLOR_MEAN_RATING "Mean Rating"
+            TERMINAL_CLEAR ", "
+            COLOR_RATINGS "Ratings Count"
+            TERMINAL_CLEAR);
+
+    putchar('\n');
+
+    for (i = 0; i < buf->length; i++) {
+        /* Puts the row by concatenating string literals. */
+        printf(COLOR_TITLE "%s"
+                TERMINAL_CLEAR ", "
+                COLOR_GENRES "%s"
+                TERMINAL_CLEAR ", "
+                COLOR_MEAN_RATING "%.1lf"
+                TERMINAL_CLEAR ", "
+                COLOR_RATINGS "%lu"
+                TERMINAL_CLEAR "\n",
+                buf->rows[i].movie->title,
+                buf->rows[i].movie->genres,
+                buf->rows[i].mean_rating,
+                buf->rows[i].ratings);
+    }
+
+    printf("\nFound %zu results\n", buf->length);
+}
+
 extern inline void topn_query_destroy(struct topn_query_buf *restrict buf);
 
-static size_t buf_search(struct topn_query_buf *restrict buf, double rating)
+extern inline void topn_since_destroy(struct topn_since_buf *restrict buf);
+
+static int compare_since_rows(void const *left_ptr, void const *right_ptr)
 {
-    size_t low, mid, high;
-    double stored_rating;
-    bool found;
-
-    found = false;
-    low = 0;
-    high = buf->length;
-
-    /* Loops while there is an element to search. */
-    while (low < high && !found) {
-        mid = low + (high - low) / 2;
-
-        stored_rating = buf->rows[mid]->mean_rating;
-
-        if (stored_rating > rating) {
-            /* mid and below is discarded. */
-            low = mid + 1;
-        } else if (stored_rating < rating) {
-            /* mid and above is discarded. */
-            high = mid;
-        } else {
-            low = mid;
-            found = true;
-        }
+    struct topn_since_row const *left = left_ptr;
+    struct topn_since_row const *right = right_ptr;
+    int order;
+
+    if (left->mean_rating > right->mean_rating) {
+        order = -1;
+    } else if (left->mean_rating < right->mean_rating) {
+        order = 1;
+    } else if (left->movie->id < right->movie->id) {
+        order = -1;
+    } else if (left->movie->id > right->movie->id) {
+        order = 1;
+    } else {
+        order = 0;
     }
 
-    /* The position where a movie with the given rating should be inserted. */
-    return low;
+    return order;
 }
 
-static void buf_insert(
-        struct topn_query_buf *restrict buf,
-        struct movie const *row,
-        size_t pos)
+static void since_keep(
+        struct topn_since_buf *restrict buf,
+        struct topn_since_row const *restrict row)
 {
     size_t i;
+    size_t parent;
+    bool placed = false;
 
-    /* Only increses length if length < N. */
     if (buf->length < buf->capacity) {
+        /* Sifts the new row up while it ranks after its parent. */
+        i = buf->length;
         buf->length++;
+        while (!placed && i > 0) {
+            parent = (i - 1) / 2;
+            placed = compare_since_rows(row, &buf->rows[parent]) <= 0;
+            if (!placed) {
+                buf->rows[i] = buf->rows[parent];
+                i = parent;
+            }
+        }
+        buf->rows[i] = *row;
+    } else if (compare_since_rows(row, &buf->rows[0]) < 0) {
+        /* Ranks before the worst row kept, which is dropped. */
+        since_replace_root(buf, row);
     }
+}
 
-    /* Move everything behind. */
-    for (i = buf->length - 1; i > pos; i--) {
-        buf->rows[i] = buf->rows[i - 1];
-    }
+static void since_replace_root(
+        struct topn_since_buf *restrict buf,
+        struct topn_since_row const *restrict row)
+{
+    size_t i = 0;
+    size_t child;
+    bool placed = false;
 
-    /* Finally puts the row in the correct position. */
-    buf->rows[pos] = row;
+    /* Sifts the row down while a child ranks after it. */
+    while (!placed && 2 * i + 1 < buf->length) {
+        child = 2 * i + 1;
+        if (child + 1 < buf->length
+                && compare_since_rows(
+                    &buf->rows[child + 1],
+                    &buf->rows[child]) > 0) {
+            child++;
+        }
+
+        placed = compare_since_rows(&buf->rows[child], row) <= 0;
+        if (!placed) {
+            buf->rows[i] = buf->rows[child];
+            i = child;
+        }
+    }
+    buf->rows[i] = *row;
 }
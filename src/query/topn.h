@@ -7,6 +7,20 @@
  * This file declares utilities related to the 'topN' query.
  */
 
+/**
+ * The order in which the topN query ranks movies.
+ */
+enum topn_ranking {
+    /**
+     * From the best rated, by mean rating.
+     */
+    topn_best_rated,
+    /**
+     * From the most controversial, by variance of the ratings.
+     */
+    topn_most_controversial
+};
+
 /**
  * Buffer used by the topN query.
  */
@@ -28,6 +42,46 @@ struct topn_query_buf {
     size_t capacity;
 };
 
+/**
+ * A movie found by the topN query since a month, with its ratings in the
+ * window.
+ */
+struct topn_since_row {
+    /**
+     * The movie itself.
+     */
+    struct movie const *movie;
+    /**
+     * Mean of the ratings made since the month.
+     */
+    double mean_rating;
+    /**
+     * How many ratings were made since the month.
+     */
+    unsigned long ratings;
+};
+
+/**
+ * Buffer used by the topN query since a month.
+ */
+struct topn_since_buf {
+    /**
+     * Array of rows. Only internal database code is allowed to write to this.
+     * Reading is fine.
+     */
+    struct topn_since_row *rows;
+    /**
+     * How many rows the query returned. Only internal database code is allowed
+     * to write to this. Reading is fine.
+     */
+    size_t length;
+    /**
+     * How many rows can be stored. This likely won't change. Only internal
+     * database code is allowed to touch this.
+     */
+    size_t capacity;
+};
+
 /**
  * Initializes the topN query buffer to the given capacity. The query will NOT
  * increase the capacity, it is intended to return only the N best.
@@ -38,16 +92,50 @@ void topn_query_init(
         struct error *restrict error);
 
 /**
- * Performs the topN query. Searches for the best rated movies of the given
- * genre and with at least min_ratings count of ratings. The buffer must be
- * initalized and might be reused before being destroyed.
+ * Performs the topN query. Searches for the first movies in the given ranking
+ * of the given genre, with at least min_ratings count of ratings. Movies
+ * ranked the same are ordered by ID, so results are the same in every run. The
+ * buffer must be initalized and might be reused before being destroyed.
+ *
+ * The genre's movies are already sorted in both rankings in the genres index,
+ * so the query stops as soon as the buffer is full, and costs at most one step
+ * per movie of the genre, whatever N is.
  */
 void topn_query(
         struct database const *restrict database,
         char const *restrict genre,
         size_t min_ratings,
+        enum topn_ranking ranking,
         struct topn_query_buf *restrict query_buf);
 
+/**
+ * Initializes the buffer of the topN query since a month to the given
+ * capacity. The query will NOT increase the capacity, it is intended to return
+ * only the N best.
+ */
+void topn_since_init(
+        struct topn_since_buf *restrict buf,
+        size_t capacity,
+        struct error *restrict error);
+
+/**
+ * Performs the topN query over the ratings made in the given month or after
+ * it, with months counted as in timeline_month. Searches for the movies of the
+ * given genre with the best mean of those ratings, with at least min_ratings
+ * count of them. Movies with the same mean are ordered by ID. The buffer must
+ * be initalized and might be reused before being destroyed.
+ *
+ * The timeline index holds the totals of every movie from each month on, so
+ * each movie of the genre costs a binary search over its months, and the best
+ * N are kept in a heap.
+ */
+void topn_since_query(
+        struct database const *restrict database,
+        char const *restrict genre,
+        size_t min_ratings,
+        unsigned long month,
+        struct topn_since_buf *restrict buf);
+
 /**
  * Prints a topN query's header to the screen.
  */
@@ -71,5 +159,18 @@ inline void topn_query_destroy(struct topn_query_buf *restrict buf)
     moviedb_free(buf->rows);
 }
 
+/**
+ * Prints a header and the rows found in the topN query since a month.
+ */
+void topn_since_print(struct topn_since_buf const *restrict buf);
+
+/**
+ * Destroys the buffer of a topN query since a month.
+ */
+inline void topn_since_destroy(struct topn_since_buf *restrict buf)
+{
+    moviedb_free(buf->rows);
+}
+
 
 #endif
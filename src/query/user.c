@@ -12,39 +12,41 @@ void user_query_init(
         struct database const *database,
         moviedb_id_t userid)
 {
+    struct user const *user = users_search(&database->users, userid);
+
     iter_out->database = database;
-    iter_out->user = users_search(&database->users, userid);
+    iter_out->ratings = NULL;
+    iter_out->length = 0;
     iter_out->current = 0;
+
+    if (user != NULL) {
+        iter_out->ratings = users_ratings(
+                &database->users,
+                user,
+                &iter_out->length);
+    }
 }
 
 bool user_query_next(
         struct user_query_iter *restrict iter,
         struct user_query_row *restrict row_out)
 {
-    struct movie const *movie = NULL;
-    struct user_rating const *rating = NULL;
-
-    /* user = NULL means the iteration ended. */
-    if (iter->user == NULL) {
-        return false;
-    }
-
-    /* Iterates while there are movies and we did not actually find a movie. */
-    while (iter->current < iter->user->ratings.length && movie == NULL) {
-        rating = &iter->user->ratings.entries[iter->current];
-        movie = movies_search(&iter->database->movies, rating->movie);
-
-        if (movie != NULL) {
-            row_out->user_rating = rating->value;
-            row_out->title = movie->title;
-            row_out->global_rating = movie->mean_rating;
-            row_out->ratings = movie->ratings;
-        }
+    struct movie const *movie;
+    struct user_rating const *rating;
+    /* Rated movies are always in the table, so each rating is a row. */
+    bool found = iter->current < iter->length;
 
+    if (found) {
+        rating = &iter->ratings[iter->current];
+        movie = movies_at(&iter->database->movies, rating->movie);
+        row_out->user_rating = rating_decode(rating->code);
+        row_out->title = movie->title;
+        row_out->global_rating = movie->mean_rating;
+        row_out->ratings = movie->ratings;
         iter->current++;
     }
 
-    return movie != NULL;
+    return found;
 }
 
 void user_query_print_header(void)
@@ -40,10 +40,16 @@ struct user_query_iter {
      */
     struct database const *database;
     /**
-     * The user whose ratings are being iterated over. Only internal database
-     * code is allowed to touch this.
+     * The ratings of the user being iterated over, a range of the packed
+     * ratings of the users table. Only internal database code is allowed to
+     * touch this.
+     */
+    struct user_rating const *ratings;
+    /**
+     * How many ratings the user has, zero if the user was not found. Only
+     * internal database code is allowed to touch this.
      */
-    struct user const *user;
+    size_t length;
     /**
      * Current rating being iterated. Only internal database code is allowed to
      * touch this.
@@ -0,0 +1,119 @@
+#include <string.h>
+#include "alloc.h"
+#include "raters.h"
+
+/**
+ * Frees the memory of the index and empties it.
+ */
+static void clear(struct raters_index *restrict index);
+
+extern inline struct movie_rater const *raters_index_movie(
+        struct raters_index const *restrict index,
+        moviedb_index_t movie,
+        size_t *restrict length_out);
+
+void raters_index_init(struct raters_index *restrict index)
+{
+    index->raters = NULL;
+    index->offsets = NULL;
+    index->length = 0;
+}
+
+void raters_index_build(
+        struct raters_index *restrict index,
+        struct users_table const *restrict users,
+        size_t movies,
+        struct error *restrict error)
+{
+    struct users_iter iter;
+    struct user const *user;
+    struct user_rating const *ratings;
+    size_t length;
+    size_t i;
+    size_t total;
+    size_t *offsets;
+    moviedb_index_t user_index;
+
+    clear(index);
+
+    index->offsets = moviedb_alloc(sizeof(*offsets), movies + 1, error);
+    offsets = index->offsets;
+
+    if (error->code == error_none) {
+        index->length = movies;
+        memset(offsets, 0, sizeof(*offsets) * (movies + 1));
+
+        /* Counts the ratings of each movie, one position ahead. */
+        users_iter(users, &iter);
+        while ((user = users_next(&iter)) != NULL) {
+            ratings = users_ratings(users, user, &length);
+            for (i = 0; i < length; i++) {
+                offsets[ratings[i].movie + 1]++;
+            }
+        }
+
+        /* Turns the counts into the offset where each movie starts. */
+        for (i = 0; i < movies; i++) {
+            offsets[i + 1] += offsets[i];
+        }
+        total = offsets[movies];
+
+        index->raters = moviedb_alloc(sizeof(*index->raters), total, error);
+    }
+
+    if (error->code == error_none) {
+        /*
+         * Places each rating at the next free position of its movie, using
+         * the start of the next movie as the cursor. Users are visited in
+         * index order, so the raters of a movie come out sorted.
+         */
+        user_index = 0;
+        users_iter(users, &iter);
+        while ((user = users_next(&iter)) != NULL) {
+            ratings = users_ratings(users, user, &length);
+            for (i = 0; i < length; i++) {
+                index->raters[offsets[ratings[i].movie]].user = user_index;
+                index->raters[offsets[ratings[i].movie]].code
+                    = ratings[i].code;
+                offsets[ratings[i].movie]++;
+            }
+            user_index++;
+        }
+
+        /* Each offset now is the end of its movie, so shifts them back. */
+        for (i = movies; i > 0; i--) {
+            offsets[i] = offsets[i - 1];
+        }
+        offsets[0] = 0;
+    }
+
+    if (error->code != error_none) {
+        clear(index);
+    }
+}
+
+size_t raters_index_bytes(struct raters_index const *restrict index)
+{
+    size_t bytes = 0;
+
+    if (index->offsets != NULL) {
+        bytes = (index->length + 1) * sizeof(*index->offsets)
+            + index->offsets[index->length] * sizeof(*index->raters);
+    }
+
+    return bytes;
+}
+
+void raters_index_destroy(struct raters_index *restrict index)
+{
+    clear(index);
+}
+
+static void clear(struct raters_index *restrict index)
+{
+    moviedb_free(index->raters);
+    moviedb_free(index->offsets);
+    index->raters = NULL;
+    index->offsets = NULL;
+    index->length = 0;
+}
@@ -0,0 +1,94 @@
+#ifndef MOVIEDB_RATERS_H
+#define MOVIEDB_RATERS_H 1
+
+#include "error.h"
+#include "id.h"
+#include "users.h"
+
+/**
+ * This file exports the index of raters, the reverse of the users' ratings:
+ * for every movie, the users that rated it and how. It is stored in compressed
+ * sparse row form, i.e. one packed array of ratings grouped by movie, and an
+ * array of offsets to the ratings of each movie.
+ */
+
+/**
+ * A rating given to a movie, as seen from the movie. It is packed into 5
+ * bytes, like the users' ratings.
+ */
+struct movie_rater {
+    /**
+     * Index of the user that gave the rating in the users table.
+     */
+    moviedb_index_t user;
+    /**
+     * Code of the rating given by the user to the movie, see rating_decode.
+     */
+    uint8_t code;
+} __attribute__((packed));
+
+/**
+ * The index of raters of every movie.
+ */
+struct raters_index {
+    /**
+     * Ratings of all movies, grouped by movie in index order, and sorted by
+     * user index within a movie. Only internal raters index code is allowed to
+     * touch this.
+     */
+    struct movie_rater *raters;
+    /**
+     * Offsets of the ratings of each movie into the packed ratings, plus the
+     * total number of ratings at the end, so the ratings of the movie with
+     * index i go from offsets[i] to offsets[i + 1]. Only internal raters index
+     * code is allowed to touch this.
+     */
+    size_t *offsets;
+    /**
+     * How many movies there are. Reading is fine, only internal raters index
+     * code is allowed to update this.
+     */
+    size_t length;
+};
+
+/**
+ * Initializes an empty index. No memory is allocated until it is built.
+ */
+void raters_index_init(struct raters_index *restrict index);
+
+/**
+ * Builds the index from the ratings of every user of the given table, for the
+ * given number of movies, replacing what the index held. Every movie index of
+ * the ratings must be below movies. Ratings are placed with a counting sort,
+ * so this takes two passes over them.
+ */
+void raters_index_build(
+        struct raters_index *restrict index,
+        struct users_table const *restrict users,
+        size_t movies,
+        struct error *restrict error);
+
+/**
+ * Returns the raters of the movie with the given index, placing how many there
+ * are in length_out. The movie must be below the index's length.
+ */
+inline struct movie_rater const *raters_index_movie(
+        struct raters_index const *restrict index,
+        moviedb_index_t movie,
+        size_t *restrict length_out)
+{
+    *length_out = index->offsets[movie + 1] - index->offsets[movie];
+    return index->raters + index->offsets[movie];
+}
+
+/**
+ * Returns how many bytes the index takes.
+ */
+size_t raters_index_bytes(struct raters_index const *restrict index);
+
+/**
+ * Destroys the index, freeing all memory.
+ */
+void raters_index_destroy(struct raters_index *restrict index);
+
+#endif
@@ -0,0 +1,107 @@
+#include "rating.h"
+
+extern inline bool rating_is_valid(double value);
+
+extern inline uint8_t rating_encode(double value);
+
+extern inline double rating_decode(uint8_t code);
+
+extern inline void rating_histogram_add(
+        struct rating_histogram *restrict histogram,
+        uint8_t code);
+
+void rating_histogram_init(struct rating_histogram *restrict histogram)
+{
+    unsigned code;
+
+    for (code = 0; code < RATING_CODES; code++) {
+        histogram->counts[code] = 0;
+    }
+}
+
+unsigned long rating_histogram_count(
+        struct rating_histogram const *restrict histogram)
+{
+    unsigned long count = 0;
+    unsigned code;
+
+    for (code = 0; code < RATING_CODES; code++) {
+        count += histogram->counts[code];
+    }
+
+    return count;
+}
+
+double rating_histogram_mean(
+        struct rating_histogram const *restrict histogram)
+{
+    unsigned long count = rating_histogram_count(histogram);
+    /* Sums whole steps, so the sum is exact whatever the count. */
+    uint64_t steps = 0;
+    double mean = 0.0;
+    unsigned code;
+
+    if (count > 0) {
+        for (code = 0; code < RATING_CODES; code++) {
+            steps += (uint64_t) (code + 1) * histogram->counts[code];
+        }
+        mean = steps / (double) RATING_STEPS / count;
+    }
+
+    return mean;
+}
+
+double rating_histogram_variance(
+        struct rating_histogram const *restrict histogram)
+{
+    unsigned long count = rating_histogram_count(histogram);
+    double mean = rating_histogram_mean(histogram);
+    double deviation;
+    double sum = 0.0;
+    double variance = 0.0;
+    unsigned code;
+
+    /* Sums squared deviations from the mean, which does not cancel out. */
+    if (count > 0) {
+        for (code = 0; code < RATING_CODES; code++) {
+            deviation = rating_decode(code) - mean;
+            sum += deviation * deviation * histogram->counts[code];
+        }
+        variance = sum / count;
+    }
+
+    return variance;
+}
+
+double rating_histogram_percentile(
+        struct rating_histogram const *restrict histogram,
+        double fraction)
+{
+    unsigned long count = rating_histogram_count(histogram);
+    unsigned long rank;
+    unsigned long seen = 0;
+    double percentile = 0.0;
+    unsigned code = 0;
+
+    if (count > 0) {
+        /* The rank is counted from 1, rounding up, and is at least 1. */
+        rank = fraction * count;
+        if (rank < fraction * count) {
+            rank++;
+        }
+        if (rank < 1) {
+            rank = 1;
+        } else if (rank > count) {
+            rank = count;
+        }
+
+        seen = histogram->counts[0];
+        while (seen < rank) {
+            code++;
+            seen += histogram->counts[code];
+        }
+        percentile = rating_decode(code);
+    }
+
+    return percentile;
+}
@@ -0,0 +1,107 @@
+#ifndef MOVIEDB_RATING_H
+#define MOVIEDB_RATING_H 1
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * This file provides the compact encoding of rating values, and histograms of
+ * them. Ratings go from half a star to 5 stars in steps of half a star, so a
+ * rating is stored as a small code in a byte, and only decoded to a double
+ * when it is printed or aggregated.
+ */
+
+/**
+ * How many steps a star is divided into.
+ */
+#define RATING_STEPS 2
+
+/**
+ * How many different ratings there are, i.e. how many codes.
+ */
+#define RATING_CODES (5 * RATING_STEPS)
+
+/**
+ * How many ratings of each value were given, e.g. to a movie. Statistics of
+ * the ratings are derived from the counts, without reading the ratings.
+ */
+struct rating_histogram {
+    /**
+     * How many ratings were given, by rating code.
+     */
+    uint32_t counts[RATING_CODES];
+};
+
+/**
+ * Tests whether the given value is a rating that can be encoded, i.e. a whole
+ * number of half stars from half a star to 5 stars.
+ */
+inline bool rating_is_valid(double value)
+{
+    double steps = value * RATING_STEPS;
+
+    /* Also false for NaN, since every comparison with it is. */
+    return steps >= 1 && steps <= RATING_CODES && steps == (int) steps;
+}
+
+/**
+ * Encodes the given value, which must be valid according to rating_is_valid,
+ * into a code below RATING_CODES.
+ */
+inline uint8_t rating_encode(double value)
+{
+    return (uint8_t) (value * RATING_STEPS) - 1;
+}
+
+/**
+ * Decodes a rating code back into its value, in stars.
+ */
+inline double rating_decode(uint8_t code)
+{
+    return (code + 1) / (double) RATING_STEPS;
+}
+
+/**
+ * Initializes an empty histogram.
+ */
+void rating_histogram_init(struct rating_histogram *restrict histogram);
+
+/**
+ * Counts a rating with the given code into the histogram.
+ */
+inline void rating_histogram_add(
+        struct rating_histogram *restrict histogram,
+        uint8_t code)
+{
+    histogram->counts[code]++;
+}
+
+/**
+ * Returns how many ratings the histogram has.
+ */
+unsigned long rating_histogram_count(
+        struct rating_histogram const *restrict histogram);
+
+/**
+ * Returns the mean of the ratings of the histogram, or 0 if it is empty.
+ */
+double rating_histogram_mean(
+        struct rating_histogram const *restrict histogram);
+
+/**
+ * Returns the (population) variance of the ratings of the histogram, in square
+ * stars, or 0 if it is empty.
+ */
+double rating_histogram_variance(
+        struct rating_histogram const *restrict histogram);
+
+/**
+ * Returns the rating at the given fraction of the sorted ratings of the
+ * histogram, from 0 to 1, using the nearest rank, e.g. the lower median for
+ * 0.5. Returns 0 if the histogram is empty.
+ */
+double rating_histogram_percentile(
+        struct rating_histogram const *restrict histogram,
+        double fraction);
+
+#endif
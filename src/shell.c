@@ -4,6 +4,8 @@
 #include "shell/user.h"
 #include "shell/topn.h"
 #include "shell/tags.h"
+#include "shell/complete.h"
+#include "shell/raters.h"
 #include <string.h>
 
 void shell_run(struct database const *restrict database,
@@ -62,8 +64,15 @@ bool shell_run_cmd(struct shell *restrict shell, struct error *restrict error)
         shell_run_user(shell, error);
     } else if (strcmp(shell->buf->ptr, "tags") == 0) {
         shell_run_tags(shell, error);
+    } else if (strcmp(shell->buf->ptr, "complete") == 0) {
+        shell_run_complete(shell, error);
+    } else if (strcmp(shell->buf->ptr, "raters") == 0) {
+        shell_run_raters(shell, error);
     } else if (strncmp(shell->buf->ptr, "top", sizeof("top") - 1) == 0) {
-        shell_run_topn(shell, error);
+        shell_run_topn(shell, topn_best_rated, error);
+    } else if (strncmp(shell->buf->ptr, "controversial",
+                sizeof("controversial") - 1) == 0) {
+        shell_run_topn(shell, topn_most_controversial, error);
     } else {
         /* Invalid operation name. Shows help. */
         shell_discard_line(shell, error);
@@ -251,19 +260,28 @@ void shell_discard_line(
 
 void shell_print_help(void)
 {
-    char const *head, *movie, *user, *topn, *tags, *exit;
+    char const *head, *movie, *user, *topn, *contr, *tags, *compl, *rater;
+    char const *since, *exit;
 
     head  = "Commands available:\n";
     movie = "    $ movie <prefix or title>       searches movies\n";
     user  = "    $ user <user ID>                finds user's ratings\n";
     topn  = "    $ top<N> '<genre>'              lists genre's N best movies\n";
+    since = "    $ top<N> '<genre>' since <date>  N best since date's month\n";
+    contr = "    $ controversial<N> '<genre>'    lists most divisive movies\n";
     tags  = "    $ tags <'list' 'of' 'tags'>     lists movies with all tags \n";
+    compl = "    $ complete <prefix>             lists most rated movies\n";
+    rater = "    $ raters <movie ID>             finds movie's ratings\n";
     exit  = "    $ exit                          exits\n";
 
     fputs(head, stderr);
     fputs(movie, stderr);
     fputs(user, stderr);
     fputs(topn, stderr);
+    fputs(since, stderr);
+    fputs(contr, stderr);
     fputs(tags, stderr);
+    fputs(compl, stderr);
+    fputs(rater, stderr);
     fputs(exit, stderr);
 }
@@ -0,0 +1,24 @@
+#include "complete.h"
+#include "../query.h"
+
+bool shell_run_complete(
+        struct shell *restrict shell,
+        struct error *restrict error)
+{
+    struct complete_query_buf query_buf;
+
+    /* Reads the argument that takes the whole rest of the line. */
+    shell_read_single_arg(shell, error);
+
+    if (error->code == error_none) {
+        strbuf_make_cstr(shell->buf, error);
+    }
+
+    if (error->code == error_none) {
+        /* Performs the query. */
+        complete_query(shell->database, shell->buf->ptr, &query_buf);
+        complete_query_print(&query_buf);
+    }
+
+    return error->code == error_none;
+}
@@ -0,0 +1,16 @@
+#ifndef MOVIEDB_SHELL_COMPLETE_H
+#define MOVIEDB_SHELL_COMPLETE_H 1
+
+#include "../shell.h"
+
+/**
+ * Reads a movie title prefix entered by the user and lists the most rated
+ * movies with that prefix in their names, for type-ahead search. Returns
+ * whether the shell should still execute. Only shell internal code is allowed
+ * to touch this.
+ */
+bool shell_run_complete(
+        struct shell *restrict shell,
+        struct error *restrict error);
+
+#endif
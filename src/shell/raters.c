@@ -0,0 +1,32 @@
+#include "raters.h"
+#include "../query.h"
+
+bool shell_run_raters(
+        struct shell *restrict shell,
+        struct error *restrict error)
+{
+    struct raters_query_iter query_iter;
+    moviedb_id_t movieid = 0;
+
+    /* Reads the argument that takes the whole rest of the line. */
+    shell_read_single_arg(shell, error);
+
+    if (error->code == error_none) {
+        strbuf_make_cstr(shell->buf, error);
+    }
+
+    if (error->code == error_none) {
+        movieid = moviedb_id_parse(shell->buf->ptr, error);
+    }
+
+    if (error->code == error_id) {
+        error_print(error);
+        error_set_code(error, error_none);
+    } else {
+        /* Performs the query. */
+        raters_query_init(&query_iter, shell->database, movieid);
+        raters_query_print(&query_iter);
+    }
+
+    return error->code == error_none;
+}
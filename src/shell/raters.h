@@ -0,0 +1,14 @@
+#ifndef MOVIEDB_SHELL_RATERS_H
+#define MOVIEDB_SHELL_RATERS_H 1
+
+#include "../shell.h"
+
+/**
+ * Runs the raters command. The command searches for the users that rated a
+ * movie, given its ID. Returns whether the shell should still execute.
+ */
+bool shell_run_raters(
+        struct shell *restrict shell,
+        struct error *restrict error);
+
+#endif
@@ -1,17 +1,40 @@
 #include "topn.h"
 #include "../query.h"
+#include "../timeline.h"
 #include <inttypes.h>
+#include <string.h>
 
 #define MIN_RATINGS 1000
 
-bool shell_run_topn(struct shell *restrict shell, struct error *restrict error)
+/**
+ * Parses a date of the form YYYY-MM-DD into the month it is in, counted as in
+ * timeline_month. Dates before TIMELINE_EPOCH_YEAR are in its first month,
+ * since no rating is older. Returns whether the date was valid.
+ */
+static bool parse_date(
+        char const *restrict string,
+        unsigned long *restrict month_out);
+
+bool shell_run_topn(
+        struct shell *restrict shell,
+        enum topn_ranking ranking,
+        struct error *restrict error)
 {
     uintmax_t converted;
     size_t count;
     char *start, *end;
+    char *genre = NULL;
+    unsigned long month = 0;
+    bool since = false;
     struct topn_query_buf query_buf;
+    struct topn_since_buf since_buf;
 
-    start = shell->buf->ptr + (sizeof("top") - 1);
+    /* Skips the operation name, before the "N". */
+    if (ranking == topn_most_controversial) {
+        start = shell->buf->ptr + (sizeof("controversial") - 1);
+    } else {
+        start = shell->buf->ptr + (sizeof("top") - 1);
+    }
 
     /* Converts the "N" string into the maximum unsigned integer. */
     converted = strtoumax(start, &end, 10);
@@ -24,17 +47,53 @@ bool shell_run_topn(struct shell *restrict shell, struct error *restrict error)
     }
 
     /*
-     * Reads the quoted argument, expects the end of the line, and turns it into
-     * string.
+     * Reads the quoted argument and turns it into string, kept aside since the
+     * buffer is reused for the optional window.
      */
     if (error->code == error_none) {
         shell_read_quoted_arg(shell, error);
     }
     if (error->code == error_none) {
-        shell_read_end(shell, error);
+        genre = strbuf_copy_cstr(shell->buf, error);
+    }
+
+    /* Reads the optional "since YYYY-MM-DD" window, only for best rated. */
+    if (error->code == error_none) {
+        shell_skip_whitespace(shell, error);
+        since = shell->curr_ch != '\n' && shell->curr_ch != EOF;
+    }
+    if (error->code == error_none && since) {
+        shell_read_op(shell, error);
+        if (error->code == error_none) {
+            strbuf_make_cstr(shell->buf, error);
+        }
+    }
+    if (error->code == error_none && since) {
+        if (ranking != topn_best_rated
+                || strcmp(shell->buf->ptr, "since") != 0) {
+            error_set_code(error, error_expected_end);
+        }
+    }
+    if (error->code == error_none && since) {
+        shell_read_op(shell, error);
+        if (error->code == error_none && shell->buf->length == 0) {
+            error_set_code(error, error_expected_arg);
+        }
     }
+
+    /* Expects the end of the line. */
     if (error->code == error_none) {
+        shell_read_end(shell, error);
+    }
+
+    if (error->code == error_none && since) {
         strbuf_make_cstr(shell->buf, error);
+        if (error->code == error_none
+                && !parse_date(shell->buf->ptr, &month)) {
+            error_set_code(error, error_date);
+            error->data.date.string = shell->buf->ptr;
+            error->data.date.free_string = false;
+        }
     }
 
     /* Initializes the query buffer with fixed capacity as N. */
@@ -45,25 +104,42 @@ bool shell_run_topn(struct shell *restrict shell, struct error *restrict error)
             count = converted;
         }
 
-        topn_query_init(&query_buf, count, error);
+        if (since) {
+            topn_since_init(&since_buf, count, error);
+        } else {
+            topn_query_init(&query_buf, count, error);
+        }
     }
 
     /* Checks the error code and if OK executes the query. */
     switch (error->code) {
         case error_none:
-            topn_query(shell->database,
-                    shell->buf->ptr,
-                    MIN_RATINGS,
-                    &query_buf);
+            if (since) {
+                topn_since_query(shell->database,
+                        genre,
+                        MIN_RATINGS,
+                        month,
+                        &since_buf);
+
+                topn_since_print(&since_buf);
+                topn_since_destroy(&since_buf);
+            } else {
+                topn_query(shell->database,
+                        genre,
+                        MIN_RATINGS,
+                        ranking,
+                        &query_buf);
 
-            topn_query_print(&query_buf);
-            topn_query_destroy(&query_buf);
+                topn_query_print(&query_buf);
+                topn_query_destroy(&query_buf);
+            }
             break;
 
         case error_open_quote:
         case error_expected_arg:
         case error_bad_quote:
         case error_topn_count:
+        case error_date:
             error_print(error);
             error_set_code(error, error_none);
             break;
@@ -72,6 +148,61 @@ bool shell_run_topn(struct shell *restrict shell, struct error *restrict error)
             break;
     }
 
+    moviedb_free(genre);
+
     return error->code == error_none;
 }
 
+static bool parse_date(
+        char const *restrict string,
+        unsigned long *restrict month_out)
+{
+    /* Days in each month of a common year. */
+    static unsigned char const month_days[12] = {
+        31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+    };
+    unsigned long year = 0;
+    unsigned long month = 0;
+    unsigned long day = 0;
+    unsigned long days;
+    size_t i;
+    bool valid = strlen(string) == sizeof("YYYY-MM-DD") - 1
+        && string[4] == '-'
+        && string[7] == '-';
+
+    for (i = 0; valid && i < sizeof("YYYY-MM-DD") - 1; i++) {
+        if (i < 4) {
+            valid = string[i] >= '0' && string[i] <= '9';
+            year = year * 10 + (string[i] - '0');
+        } else if (i > 4 && i < 7) {
+            valid = string[i] >= '0' && string[i] <= '9';
+            month = month * 10 + (string[i] - '0');
+        } else if (i > 7) {
+            valid = string[i] >= '0' && string[i] <= '9';
+            day = day * 10 + (string[i] - '0');
+        }
+    }
+
+    valid = valid && month >= 1 && month <= 12;
+
+    if (valid) {
+        days = month_days[month - 1];
+        /* February has a leap day in leap years of the Gregorian calendar. */
+        if (month == 2
+                && year % 4 == 0
+                && (year % 100 != 0 || year % 400 == 0)) {
+            days++;
+        }
+        valid = day >= 1 && day <= days;
+    }
+
+    if (valid) {
+        if (year < TIMELINE_EPOCH_YEAR) {
+            *month_out = 0;
+        } else {
+            *month_out = (year - TIMELINE_EPOCH_YEAR) * 12 + month - 1;
+        }
+    }
+
+    return valid;
+}
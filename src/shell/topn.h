@@ -2,12 +2,19 @@
 #define MOVIEDB_SHELL_TOPN_H 1
 
 #include "../shell.h"
+#include "../query/topn.h"
 
 /**
- * Runs the topN command. The command finds N movies with the best ratings of a
- * given genre. Returns whether the shell should still execute. Only shell
- * internal code is allowed to touch this.
+ * Runs the topN command, or the controversialN command, depending on the
+ * ranking. The command finds the first N movies of a given genre in the
+ * ranking: with the best ratings, or with the most controversial ones. The
+ * topN command can be followed by "since YYYY-MM-DD", which ranks the movies by
+ * their ratings from the month of the date on. Returns whether the shell should
+ * still execute. Only shell internal code is allowed to touch this.
  */
-bool shell_run_topn(struct shell *restrict shell, struct error *restrict error);
+bool shell_run_topn(
+        struct shell *restrict shell,
+        enum topn_ranking ranking,
+        struct error *restrict error);
 
 #endif
@@ -34,6 +34,29 @@ extern inline void strbuf_push(
         char ch,
         struct error *restrict error);
 
+void strbuf_append(
+        struct strbuf *restrict buf,
+        char const *restrict bytes,
+        size_t length,
+        struct error *restrict error)
+{
+    size_t available = buf->capacity - buf->length;
+
+    if (available < length) {
+        /* Grows geometrically so repeated appends are amortized. */
+        if (length - available > buf->capacity) {
+            strbuf_reserve(buf, length - available, error);
+        } else {
+            strbuf_reserve(buf, buf->capacity, error);
+        }
+    }
+
+    if (error->code == error_none) {
+        memcpy(buf->ptr + buf->length, bytes, length);
+        buf->length += length;
+    }
+}
+
 extern inline void strbuf_make_cstr(
         struct strbuf *restrict buf,
         struct error *restrict error);
@@ -69,6 +69,17 @@ inline void strbuf_push(
     }
 }
 
+/**
+ * Appends the given bytes onto the buffer, reserving necessary space, at least
+ * doubling the capacity when it grows. In case of error, the error parameter is
+ * set to allocation error, and nothing is appended.
+ */
+void strbuf_append(
+        struct strbuf *restrict buf,
+        char const *restrict bytes,
+        size_t length,
+        struct error *restrict error);
+
 /**
  * Ensures this buffer ends in a nul byte, appending it to the end if
  * necessary.
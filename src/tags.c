@@ -1,15 +1,26 @@
 #include "tags.h"
-#include "prime.h"
 #include "alloc.h"
 #include <string.h>
 
 #define MAX_LOAD 0.5
 
 /**
- * Initializes a tag by allocating a tag in the heap.
+ * Initializes a tag by allocating it and copying its name from the given arena
+ * (or the heap), with the given number of movies as the initial capacity of
+ * its movie set.
  */
 static struct tag *tag_init(
-        struct tag_csv_row *restrict tag_row,
+        struct arena *arena,
+        char const *restrict name,
+        size_t movies,
+        struct error *restrict error);
+
+/**
+ * Allocates the entries and fingerprints of the given table for its capacity,
+ * marking every entry as empty.
+ */
+static void alloc_entries(
+        struct tags_table *restrict table,
         struct error *restrict error);
 
 /**
@@ -31,33 +42,42 @@ static void resize(
 void tags_init(
         struct tags_table *restrict table,
         size_t initial_capacity,
+        struct arena *arena,
         struct error *restrict error)
 {
-    size_t i;
-
+    table->arena = arena;
     table->length = 0;
-    table->capacity = next_prime(initial_capacity);
-    table->entries = moviedb_alloc(
-            sizeof(*table->entries),
-            table->capacity,
+    table->capacity = moviedb_hash_capacity(initial_capacity);
+    alloc_entries(table, error);
+}
+
+void tags_insert(
+        struct tags_table *restrict table,
+        struct tag_csv_row const *restrict tag_row,
+        moviedb_index_t movie,
+        struct error *restrict error)
+{
+    struct tag_movie_set *movies = tags_insert_empty(
+            table,
+            tag_row->name,
+            1,
             error);
 
     if (error->code == error_none) {
-        /* Initializes all entries to NULL. */
-        for (i = 0; i < table->capacity; i++) {
-            table->entries[i] = NULL;
-        }
+        tag_movies_insert(movies, movie, error);
     }
 }
 
-void tags_insert(
+struct tag_movie_set *tags_insert_empty(
         struct tags_table *restrict table,
-        struct tag_csv_row *restrict tag_row,
+        char const *restrict name,
+        size_t movies,
         struct error *restrict error)
 {
     double load;
     moviedb_hash_t hash;
     size_t index;
+    struct tag *tag = NULL;
 
     load = (table->length + 1) / (double) table->capacity;
     if (load >= MAX_LOAD) {
@@ -66,82 +86,201 @@ void tags_insert(
     }
 
     if (error->code == error_none) {
-        hash = moviedb_hash_str(tag_row->name);
-        index = probe_index(table, tag_row->name, hash);
-
-        if (table->entries[index] == NULL) {
+        hash = moviedb_hash_str(name);
+        index = probe_index(table, name, hash);
+        if (table->fingerprints[index] != 0) {
+            tag = table->entries[index].tag;
+        } else {
             /* No previous insert with the given tag name. */
-            table->entries[index] = tag_init(tag_row, error);
+            tag = tag_init(table->arena, name, movies, error);
             if (error->code == error_none) {
+                table->entries[index].hash = hash;
+                table->entries[index].tag = tag;
+                table->fingerprints[index] = moviedb_hash_fingerprint(hash);
                 table->length++;
             }
+        }
+    }
+
+    return tag == NULL ? NULL : &tag->movies;
+}
+
+void tags_restore(
+        struct tags_table *restrict table,
+        size_t capacity,
+        struct error *restrict error)
+{
+    struct tags_table new_table;
+
+    new_table.capacity = capacity;
+    alloc_entries(&new_table, error);
+
+    if (error->code == error_none) {
+        moviedb_free(table->fingerprints);
+        moviedb_free(table->entries);
+        table->capacity = new_table.capacity;
+        table->entries = new_table.entries;
+        table->fingerprints = new_table.fingerprints;
+    }
+}
+
+struct tag_movie_set *tags_restore_tag(
+        struct tags_table *restrict table,
+        size_t index,
+        moviedb_hash_t hash,
+        char const *restrict name,
+        struct error *restrict error)
+{
+    struct tag *tag = arena_alloc(table->arena, sizeof(*tag), 1, error);
+
+    if (error->code == error_none) {
+        tag->name = arena_copy_str(table->arena, name, strlen(name), error);
+
+        if (error->code == error_none) {
+            /* The movies come sealed, so no hash set is needed for them. */
+            tag_movies_init_sealed(&tag->movies);
+            table->entries[index].hash = hash;
+            table->entries[index].tag = tag;
+            table->fingerprints[index] = moviedb_hash_fingerprint(hash);
+            table->length++;
         } else {
-            /* There was a previous insert with the given tag name. */
-            tag_movies_insert(
-                    &table->entries[index]->movies,
-                    tag_row->movieid,
-                    error);
-
-            /*
-             * We can destroy the row's data, since we don't need the tag name,
-             * which was heap-allocated.
-             */
-            tag_row_destroy(tag_row);
+            arena_free(table->arena, tag);
+            tag = NULL;
         }
     }
+
+    return tag == NULL ? NULL : &tag->movies;
 }
 
+extern inline struct tags_entry const *tags_entries(
+        struct tags_table const *restrict table,
+        unsigned char const **restrict fingerprints_out,
+        size_t *restrict capacity_out);
+
 struct tag const *tags_search(
         struct tags_table const *restrict table,
         char const *restrict name)
 {
     moviedb_hash_t hash = moviedb_hash_str(name);
     size_t index = probe_index(table, name, hash);
-    return table->entries[index];
+    struct tag const *tag = NULL;
+
+    if (table->fingerprints[index] != 0) {
+        tag = table->entries[index].tag;
+    }
+
+    return tag;
+}
+
+extern inline void tags_iter(
+        struct tags_table const *table,
+        struct tags_iter *restrict iter_out);
+
+struct tag const *tags_next(struct tags_iter *restrict iter)
+{
+    struct tag const *tag = NULL;
+
+    /*
+     * Moves the iterator to the next position while entries are empty and
+     * there are entries left.
+     */
+    while (iter->current < iter->table->capacity && tag == NULL) {
+        if (iter->table->fingerprints[iter->current] != 0) {
+            tag = iter->table->entries[iter->current].tag;
+        }
+        iter->current++;
+    }
+
+    return tag;
+}
+
+void tags_seal(
+        struct tags_table *restrict table,
+        struct error *restrict error)
+{
+    size_t i;
+
+    for (i = 0; i < table->capacity && error->code == error_none; i++) {
+        if (table->fingerprints[i] != 0) {
+            tag_movies_seal(&table->entries[i].tag->movies, error);
+        }
+    }
 }
 
 void tags_destroy(struct tags_table *restrict table)
 {
     size_t i;
+    struct tag *tag;
 
-    /* Iterates through all entries to free their user's memories. */
+    /* Iterates through all entries to free their tag's memories. */
     for (i = 0; i < table->capacity; i++) {
-        if (table->entries[i] != NULL) {
-            tag_movies_destroy(&table->entries[i]->movies);
-            moviedb_free((void *) (void const *) table->entries[i]->name);
-            moviedb_free(table->entries[i]);
+        if (table->fingerprints[i] != 0) {
+            tag = table->entries[i].tag;
+            tag_movies_destroy(&tag->movies);
+            arena_free(table->arena, tag->name);
+            arena_free(table->arena, tag);
         }
     }
 
+    moviedb_free(table->fingerprints);
     moviedb_free(table->entries);
 }
 
 static struct tag *tag_init(
-        struct tag_csv_row *restrict tag_row,
+        struct arena *arena,
+        char const *restrict name,
+        size_t movies,
         struct error *restrict error)
 {
-    struct tag *tag = moviedb_alloc(sizeof(*tag), 1, error);
+    struct tag *tag = arena_alloc(arena, sizeof(*tag), 1, error);
 
     if (error->code == error_none) {
         /* Initializes the tag. */
-        tag->name = tag_row->name;
-        tag_movies_init(&tag->movies, 2, error);
+        tag->name = arena_copy_str(arena, name, strlen(name), error);
+    }
 
-        if (error->code == error_none) {
-            /* Inserts the given movie ID into the tag's movie list. */
-            tag_movies_insert(&tag->movies, tag_row->movieid, error);
-        }
+    if (error->code == error_none) {
+        /* Keeps the set below maximum load with all the movies. */
+        tag_movies_init(&tag->movies, movies * 2 + 1, error);
 
         if (error->code != error_none) {
-            tag_movies_destroy(&tag->movies);
-            moviedb_free(tag);
-            tag = NULL;
+            arena_free(arena, tag->name);
         }
     }
 
+    if (error->code != error_none) {
+        arena_free(arena, tag);
+        tag = NULL;
+    }
+
     return tag;
 }
 
+static void alloc_entries(
+        struct tags_table *restrict table,
+        struct error *restrict error)
+{
+    table->entries = moviedb_alloc(
+            sizeof(*table->entries),
+            table->capacity,
+            error);
+
+    if (error->code == error_none) {
+        table->fingerprints = moviedb_alloc(
+                sizeof(*table->fingerprints),
+                table->capacity,
+                error);
+
+        if (error->code == error_none) {
+            /* Initializes all entries to empty. */
+            memset(table->fingerprints, 0, table->capacity);
+        } else {
+            moviedb_free(table->entries);
+            table->entries = NULL;
+        }
+    }
+}
+
 static size_t probe_index(
         struct tags_table const *restrict table,
         char const *restrict name,
@@ -149,21 +288,25 @@ static size_t probe_index(
 {
     moviedb_hash_t attempt;
     size_t index;
-    struct tag *tag;
+    unsigned char fingerprint = moviedb_hash_fingerprint(hash);
 
     attempt = 0;
     index = moviedb_hash_to_index(hash, attempt, table->capacity);
-    tag = table->entries[index];
 
-    /* Iterates while there is a tag and it is not our target. */
-    while (tag != NULL && strcmp(tag->name, name) != 0) {
+    /*
+     * Iterates while the entry is occupied and it is not our target. Names are
+     * only compared if the fingerprints and the whole hashes match.
+     */
+    while (table->fingerprints[index] != 0
+            && (table->fingerprints[index] != fingerprint
+                || table->entries[index].hash != hash
+                || strcmp(table->entries[index].tag->name, name) != 0)) {
         /*
          * If we reached here, the condition failed, and we need to get the
          * next attempt.
          */
         attempt++;
         index = moviedb_hash_to_index(hash, attempt, table->capacity);
-        tag = table->entries[index];
     }
 
     return index;
@@ -174,51 +317,50 @@ static void resize(
         struct error *restrict error)
 {
     size_t i;
-    moviedb_hash_t hash;
     size_t index;
     struct tags_table new_table;
 
     /*
-     * Checks if there is a next prime with at least double capacity, in first
-     * place.
+     * Checks if there is a next capacity with at least double capacity, in
+     * first place.
      */
     if (SIZE_MAX / 2 < table->capacity) {
         new_table.capacity = SIZE_MAX;
     } else {
-        new_table.capacity = next_prime(table->capacity * 2);
+        new_table.capacity = moviedb_hash_capacity(table->capacity * 2);
     }
 
-    /* Sets an error if no prime available. */
+    /* Sets an error if no capacity available. */
     if (new_table.capacity == SIZE_MAX) {
         error_set_code(error, error_max_capacity);
         error->data.max_capacity.capacity = table->capacity;
     }
 
     if (error->code == error_none) {
-        new_table.entries = moviedb_alloc(
-                sizeof(*new_table.entries),
-                new_table.capacity,
-                error);
+        alloc_entries(&new_table, error);
     }
 
     if (error->code == error_none) {
-        /* Initializes the new table's entries. */
-        for (i = 0; i < new_table.capacity; i++) {
-            new_table.entries[i] = NULL;
-        }
-
-        /* Reinserts entries from old table into the new table. */
+        /*
+         * Reinserts entries from old table into the new table. The hashes are
+         * stored, so names need not be hashed again.
+         */
         for (i = 0; i < table->capacity; i++) {
-            if (table->entries[i] != NULL) {
-                hash = moviedb_hash_str(table->entries[i]->name);
-                index = probe_index(&new_table, table->entries[i]->name, hash);
+            if (table->fingerprints[i] != 0) {
+                index = probe_index(
+                        &new_table,
+                        table->entries[i].tag->name,
+                        table->entries[i].hash);
                 new_table.entries[index] = table->entries[i];
+                new_table.fingerprints[index] = table->fingerprints[i];
             }
         }
 
         /* Frees the old table. */
+        moviedb_free(table->fingerprints);
         moviedb_free(table->entries);
         table->capacity = new_table.capacity;
         table->entries = new_table.entries;
+        table->fingerprints = new_table.fingerprints;
     }
 }
@@ -2,6 +2,7 @@
 #define MOVIEDB_TAGS_H 1
 
 #include "id.h"
+#include "arena.h"
 #include "csv/tag.h"
 #include "tags/movies.h"
 
@@ -25,15 +26,37 @@ struct tag {
     struct tag_movie_set movies;
 };
 
+/**
+ * An entry of the tags hash table, keeping the hash of the tag name inline so
+ * probing only reads the tag when the hashes match.
+ */
+struct tags_entry {
+    /**
+     * Hash of the tag name. Only internal tags hash table code is allowed to
+     * touch this value.
+     */
+    moviedb_hash_t hash;
+    /**
+     * The tag data. Only internal tags hash table code is allowed to touch
+     * this value.
+     */
+    struct tag *tag;
+};
+
 /**
  * A hash table mapping tag IDs to tags.
  */
 struct tags_table {
     /**
-     * Array of entries, more specifically array of pointers to tags. Only
+     * Array of entries. Only meaningful where the fingerprint is not zero. Only
      * internal tags hash table code is allowed to touch this value.
      */
-    struct tag **entries;
+    struct tags_entry *entries;
+    /**
+     * Array of fingerprints of the entries' hashes, zero for empty entries.
+     * Only internal tags hash table code is allowed to touch this value.
+     */
+    unsigned char *fingerprints;
     /**
      * How many elements are stored. Only internal tags hash table code is
      * allowed to write to this value. Reading is fine.
@@ -44,27 +67,104 @@ struct tags_table {
      * code is allowed to touch this value.
      */
     size_t capacity;
+    /**
+     * Arena the tags and their names are allocated from, or NULL for the heap.
+     * Only internal tags hash table code is allowed to touch this value.
+     */
+    struct arena *arena;
+};
+
+/**
+ * Iterator over the tags stored in a tags table.
+ */
+struct tags_iter {
+    /**
+     * The table being iterated over. Only internal tags hash table code is
+     * allowed to touch this.
+     */
+    struct tags_table const *table;
+    /**
+     * The current entry being checked. Only internal tags hash table code is
+     * allowed to touch this.
+     */
+    size_t current;
 };
 
 /**
  * Initializes the tag hash table to the given initial capacity. This capacity
- * is rounded up to next prime.
+ * is rounded up with moviedb_hash_capacity. Tags and their names are allocated
+ * from the given arena, which must outlive the table, or from the heap if it
+ * is NULL.
  */
 void tags_init(
         struct tags_table *restrict table,
         size_t initial_capacity,
+        struct arena *arena,
         struct error *restrict error);
 
 /**
  * Inserts the given tag-movie association, creating an entry for the tag in
- * the table if necessary. Name field should be heap-allocated, the given
- * tag_row should not be used after this function is called.
+ * the table if necessary. The movie is given by its index in the movies table,
+ * the row's movie ID is not read. The name is copied when a tag is created, so
+ * the row is only borrowed.
  */
 void tags_insert(
         struct tags_table *restrict table,
-        struct tag_csv_row *restrict tag_row,
+        struct tag_csv_row const *restrict tag_row,
+        moviedb_index_t movie,
+        struct error *restrict error);
+
+/**
+ * Returns the movie set of the tag with the given name, so that movies can be
+ * inserted with tag_movies_insert. If the tag is not in the table yet, it is
+ * created with a copy of the name and the expected number of movies as the
+ * initial capacity of its set. Returns NULL on error.
+ */
+struct tag_movie_set *tags_insert_empty(
+        struct tags_table *restrict table,
+        char const *restrict name,
+        size_t movies,
         struct error *restrict error);
 
+/**
+ * Empties the hash table of the given table, which must hold no tags, and
+ * resizes it to the given capacity, which must be one moviedb_hash_capacity
+ * returns, so that tags can be restored from a snapshot with tags_restore_tag.
+ */
+void tags_restore(
+        struct tags_table *restrict table,
+        size_t capacity,
+        struct error *restrict error);
+
+/**
+ * Puts a tag with a copy of the given name, whose hash is given, in the entry
+ * with the given index, without probing, e.g. when restoring a snapshot which
+ * recorded the entry of every tag. The entry must be empty, and the table must
+ * stay below its maximum load. Returns the tag's movie set, empty and sealed,
+ * to be filled with tag_movies_restore, or NULL on error.
+ */
+struct tag_movie_set *tags_restore_tag(
+        struct tags_table *restrict table,
+        size_t index,
+        moviedb_hash_t hash,
+        char const *restrict name,
+        struct error *restrict error);
+
+/**
+ * Returns the entries of the hash table, writing their fingerprints, zero for
+ * empty entries, into fingerprints_out, and how many entries there are into
+ * capacity_out, e.g. to write the table into a snapshot.
+ */
+inline struct tags_entry const *tags_entries(
+        struct tags_table const *restrict table,
+        unsigned char const **restrict fingerprints_out,
+        size_t *restrict capacity_out)
+{
+    *fingerprints_out = table->fingerprints;
+    *capacity_out = table->capacity;
+    return table->entries;
+}
+
 /**
  * Searches for a tag's entry in the table. Returns NULL if not found.
  */
@@ -72,6 +172,31 @@ struct tag const *tags_search(
         struct tags_table const *restrict table,
         char const *restrict name);
 
+/**
+ * Seals the movie set of every tag (see tag_movies_seal), so tags queries can
+ * intersect them. Must be called once all tags are inserted.
+ */
+void tags_seal(
+        struct tags_table *restrict table,
+        struct error *restrict error);
+
+/**
+ * Initializes an iterator over the given table.
+ */
+inline void tags_iter(
+        struct tags_table const *table,
+        struct tags_iter *restrict iter_out)
+{
+    iter_out->table = table;
+    iter_out->current = 0;
+}
+
+/**
+ * Finds the next entry in the tags table using the given iterator. Returns
+ * NULL if all tags have been returned by the iterator.
+ */
+struct tag const *tags_next(struct tags_iter *restrict iter);
+
 /**
  * Destroys the given tags table, freeing all memory.
  */
@@ -1,17 +1,22 @@
+#include <stdlib.h>
 #include "movies.h"
-#include "../prime.h"
 
 #define MAX_LOAD 0.5
 
 /**
- * Probes the given hash set until the place where the given movie ID should be
- * stored, given its hash. Returns the index of this place.
+ * Probes the given hash set until the place where the given movie index should
+ * be stored, given its hash. Returns the index of this place.
  */
 static size_t probe_index(
         struct tag_movie_set const *restrict set,
-        moviedb_id_t movieid,
+        moviedb_index_t movie,
         moviedb_hash_t hash);
 
+/**
+ * Compares two movie indices, for sorting.
+ */
+static int compare_indices(void const *left_ptr, void const *right_ptr);
+
 /**
  * Resizes the hash set to have at least double capacity.
  */
@@ -27,7 +32,8 @@ void tag_movies_init(
     size_t i;
 
     set->length = 0;
-    set->capacity = next_prime(initial_capacity);
+    set->capacity = moviedb_hash_capacity(initial_capacity);
+    bitmap_init(&set->bitmap);
     set->entries = moviedb_alloc(sizeof(*set->entries), set->capacity, error);
 
     if (error->code == error_none) {
@@ -50,9 +56,18 @@ void tag_movies_init(
     }
 }
 
+void tag_movies_init_sealed(struct tag_movie_set *restrict set)
+{
+    set->entries = NULL;
+    set->occupied = NULL;
+    set->length = 0;
+    set->capacity = 0;
+    bitmap_init(&set->bitmap);
+}
+
 void tag_movies_insert(
         struct tag_movie_set *restrict set,
-        moviedb_id_t movieid,
+        moviedb_index_t movie,
         struct error *restrict error)
 {
     double load;
@@ -67,16 +82,16 @@ void tag_movies_insert(
     }
 
     if (error->code == error_none) {
-        hash = moviedb_id_hash(movieid);
-        index = probe_index(set, movieid, hash);
+        hash = moviedb_id_hash(movie);
+        index = probe_index(set, movie, hash);
         if (set->occupied[index]) {
-            /* Duplicated movie ID is an error, but ignorable. */
+            /* Duplicated movie is an error, but ignorable. */
             error_set_code(error, error_dup_movie_id);
-            error->data.dup_movie_id.id = movieid;
+            error->data.dup_movie_id.id = movie;
         } else {
             /* Success case for the insert. */
             set->occupied[index] = true;
-            set->entries[index] = movieid;
+            set->entries[index] = movie;
             set->length++;
         }
     }
@@ -84,11 +99,78 @@ void tag_movies_insert(
 
 bool tag_movies_contain(
         struct tag_movie_set const *restrict set,
-        moviedb_id_t movieid)
+        moviedb_index_t movie)
 {
-    moviedb_hash_t hash = moviedb_id_hash(movieid);
-    size_t index = probe_index(set, movieid, hash);
-    return set->occupied[index];
+    moviedb_hash_t hash;
+    size_t index;
+    bool found;
+
+    if (set->occupied == NULL) {
+        found = bitmap_contains(&set->bitmap, movie);
+    } else {
+        hash = moviedb_id_hash(movie);
+        index = probe_index(set, movie, hash);
+        found = set->occupied[index];
+    }
+
+    return found;
+}
+
+void tag_movies_seal(
+        struct tag_movie_set *restrict set,
+        struct error *restrict error)
+{
+    size_t i;
+    size_t length = 0;
+    moviedb_index_t *sorted;
+
+    if (set->occupied != NULL) {
+        sorted = moviedb_alloc(sizeof(*sorted), set->length, error);
+
+        if (error->code == error_none) {
+            /* Compacts the occupied entries, and then sorts them. */
+            for (i = 0; i < set->capacity; i++) {
+                if (set->occupied[i]) {
+                    sorted[length] = set->entries[i];
+                    length++;
+                }
+            }
+
+            qsort(sorted, length, sizeof(*sorted), compare_indices);
+        }
+
+        /* Sorted indices are added to the end of the bitmap's containers. */
+        for (i = 0; i < length && error->code == error_none; i++) {
+            bitmap_add(&set->bitmap, sorted[i], error);
+        }
+
+        if (error->code == error_none) {
+            bitmap_optimize(&set->bitmap, error);
+        }
+
+        moviedb_free(sorted);
+    }
+
+    if (set->occupied != NULL && error->code == error_none) {
+        moviedb_free(set->entries);
+        moviedb_free(set->occupied);
+        set->entries = NULL;
+        set->occupied = NULL;
+        set->capacity = 0;
+    }
+}
+
+void tag_movies_restore(
+        struct tag_movie_set *restrict set,
+        struct bitmap_container const *restrict container,
+        void const *restrict data,
+        struct error *restrict error)
+{
+    bitmap_append(&set->bitmap, container, data, error);
+
+    if (error->code == error_none) {
+        set->length += container->cardinality;
+    }
 }
 
 extern inline void tag_movies_iter(
@@ -97,10 +179,18 @@ extern inline void tag_movies_iter(
 
 bool tag_movies_next(
         struct tag_movies_iter *restrict iter,
-        moviedb_id_t *restrict movieid_out)
+        moviedb_index_t *restrict movie_out)
 {
+    moviedb_id_t value;
     bool found = false;
 
+    if (iter->set->occupied == NULL) {
+        found = bitmap_next(&iter->bitmap, &value);
+        if (found) {
+            *movie_out = value;
+        }
+    }
+
     /*
      * Moves the iterator to the next position while entries are not occupied
      * and there are entries left.
@@ -108,7 +198,7 @@ bool tag_movies_next(
     while (iter->current < iter->set->capacity && !found) {
         found = iter->set->occupied[iter->current];
         if (found) {
-            *movieid_out = iter->set->entries[iter->current];
+            *movie_out = iter->set->entries[iter->current];
         }
         iter->current++;
     }
@@ -120,7 +210,7 @@ extern inline void tag_movies_destroy(struct tag_movie_set *restrict set);
 
 static size_t probe_index(
         struct tag_movie_set const *restrict set,
-        moviedb_id_t movieid,
+        moviedb_index_t movie,
         moviedb_hash_t hash)
 {
     moviedb_hash_t attempt;
@@ -130,7 +220,7 @@ static size_t probe_index(
     index = moviedb_hash_to_index(hash, attempt, set->capacity);
 
     /* Iterates while entry is occupied and it is not our target. */
-    while (set->occupied[index] && set->entries[index] != movieid) {
+    while (set->occupied[index] && set->entries[index] != movie) {
         /*
          * If we reached here, the condition failed, and we need to get the
          * next attempt.
@@ -142,6 +232,14 @@ static size_t probe_index(
     return index;
 }
 
+static int compare_indices(void const *left_ptr, void const *right_ptr)
+{
+    moviedb_index_t left = *(moviedb_index_t const *) left_ptr;
+    moviedb_index_t right = *(moviedb_index_t const *) right_ptr;
+
+    return (left > right) - (left < right);
+}
+
 static void resize(
         struct tag_movie_set *restrict set,
         struct error *restrict error)
@@ -152,16 +250,16 @@ static void resize(
     struct tag_movie_set new_set;
 
     /*
-     * Checks if there is a next prime with at least double capacity, in first
-     * place.
+     * Checks if there is a next capacity with at least double capacity, in
+     * first place.
      */
     if (SIZE_MAX / 2 < set->capacity) {
         new_set.capacity = SIZE_MAX;
     } else {
-        new_set.capacity = next_prime(set->capacity * 2);
+        new_set.capacity = moviedb_hash_capacity(set->capacity * 2);
     }
 
-    /* Sets an error if no prime available. */
+    /* Sets an error if no capacity available. */
     if (new_set.capacity == SIZE_MAX) {
         error_set_code(error, error_max_capacity);
         error->data.max_capacity.capacity = set->capacity;
@@ -3,24 +3,28 @@
 
 #include "../id.h"
 #include "../alloc.h"
+#include "../bitmap.h"
 
 /**
  * This file provides utilites related to movie lists of tags.
  */
 
 /**
- * The (hash) set of movies associated with a tag.
+ * The set of movies associated with a tag, given by their indices in the
+ * movies table. While loading, it is a hash set. Once sealed, it is a
+ * compressed bitmap of movie indices, so sets can be combined with bitwise
+ * operations.
  */
 struct tag_movie_set {
     /**
-     * Array of entries. Only internal tag movies hash set code is allowed to
-     * touch this value.
+     * Array of entries. NULL once the set is sealed. Only internal tag movies
+     * hash set code is allowed to touch this value.
      */
-    moviedb_id_t *entries;
+    moviedb_index_t *entries;
     /**
      * Array of occupied flags, telling whether an entry of the same index is
-     * occupied. Only internal tag movies hash set code is allowed to touch
-     * this value.
+     * occupied. NULL once the set is sealed. Only internal tag movies hash set
+     * code is allowed to touch this value.
      */
     bool *occupied;
     /**
@@ -33,6 +37,11 @@ struct tag_movie_set {
      * set code is allowed to touch this value.
      */
     size_t capacity;
+    /**
+     * The movies, once the set is sealed. Only internal tag movies hash set
+     * code is allowed to update this value. Reading is fine.
+     */
+    struct bitmap bitmap;
 };
 
 /**
@@ -49,11 +58,16 @@ struct tag_movies_iter {
      * is allowed to touch this.
      */
     size_t current;
+    /**
+     * Iterator over the bitmap of a sealed set. Only internal tag movies hash
+     * set code is allowed to touch this.
+     */
+    struct bitmap_iter bitmap;
 };
 
 /**
- * Initializes the hash set. Initial capacity is rounded to the smallest prime
- * such that actual_initial_capacity >= initial_capacity.
+ * Initializes the hash set. Initial capacity is rounded up with
+ * moviedb_hash_capacity (to a prime or a power of two).
  */
 void tag_movies_init(
         struct tag_movie_set *restrict set,
@@ -61,31 +75,50 @@ void tag_movies_init(
         struct error *restrict error);
 
 /**
- * Inserts a movie ID in the set. If movie ID is duplicated, an error is set
- * (error_dup_movie_id).
+ * Initializes an empty set that is sealed already, e.g. to be restored from a
+ * snapshot with tag_movies_restore.
+ */
+void tag_movies_init_sealed(struct tag_movie_set *restrict set);
+
+/**
+ * Inserts a movie index in the set. If the movie is duplicated, an error is set
+ * (error_dup_movie_id, with the index as the ID). The set must not be sealed.
  */
 void tag_movies_insert(
         struct tag_movie_set *restrict set,
-        moviedb_id_t movieid,
+        moviedb_index_t movie,
         struct error *restrict error);
 
 /**
- * Adds a rating for a movie. If not found, rating is not added.
+ * Search for the movie with the given index. Returns whether it was found.
+ */
+bool tag_movies_contain(
+        struct tag_movie_set const *restrict set,
+        moviedb_index_t movie);
+
+/**
+ * Seals the set: its movie indices are moved into the set's bitmap, and the
+ * hash set is freed. No more movies can be inserted after this. Does nothing if
+ * the set is already sealed.
  */
-void tag_movies_add_rating(
+void tag_movies_seal(
         struct tag_movie_set *restrict set,
-        moviedb_id_t movieid,
-        double rating);
+        struct error *restrict error);
 
 /**
- * Search for the movie with the given ID. Returns whether it was found.
+ * Appends a copy of a well formed bitmap container of movie indices, with the
+ * given storage, to a sealed set, e.g. when restoring it from a snapshot. Its
+ * key must be greater than the keys of the containers in the set.
  */
-bool tag_movies_contain(
-        struct tag_movie_set const *restrict set,
-        moviedb_id_t movieid);
+void tag_movies_restore(
+        struct tag_movie_set *restrict set,
+        struct bitmap_container const *restrict container,
+        void const *restrict data,
+        struct error *restrict error);
 
 /**
- * Initializes an iterator over the given set.
+ * Initializes an iterator over the given set. Sealed sets are iterated in
+ * ascending order.
  */
 inline void tag_movies_iter(
         struct tag_movie_set const *set,
@@ -93,16 +126,17 @@ inline void tag_movies_iter(
 {
     iter_out->set = set;
     iter_out->current = 0;
+    bitmap_iter(&set->bitmap, &iter_out->bitmap);
 }
 
 /**
  * Finds the next entry in the tag movies set, using the given iterator.
- * Returns whether there was an entry. If there was, it is placed in
- * movieid_out.
+ * Returns whether there was an entry. If there was, its movie index is placed
+ * in movie_out.
  */
 bool tag_movies_next(
         struct tag_movies_iter *restrict iter,
-        moviedb_id_t *restrict movieid_out);
+        moviedb_index_t *restrict movie_out);
 
 /**
  * Destroys everything in the set.
@@ -111,6 +145,7 @@ inline void tag_movies_destroy(struct tag_movie_set *restrict set)
 {
     moviedb_free(set->entries);
     moviedb_free(set->occupied);
+    bitmap_destroy(&set->bitmap);
 }
 
 #endif
@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <assert.h>
+#include "../arena.h"
+#include "../error.h"
+
+/**
+ * Tests the arena allocator.
+ */
+
+int main(int argc, char const *argv[])
+{
+    struct error error;
+    struct arena arena;
+    char *string;
+    char *big;
+    double *numbers;
+    size_t i;
+
+    error_init(&error);
+    arena_init(&arena);
+    assert(arena.chunk_count == 0);
+    assert(arena.reserved == 0);
+
+    string = arena_copy_str(&arena, "pineapple!", 9, &error);
+    assert(error.code == error_none);
+    assert(strcmp(string, "pineapple") == 0);
+    assert(arena.chunk_count == 1);
+
+    /* Allocations are aligned for any type, even after a string. */
+    numbers = arena_alloc(&arena, sizeof(*numbers), 100, &error);
+    assert(error.code == error_none);
+    assert((uintptr_t) numbers % _Alignof(max_align_t) == 0);
+    for (i = 0; i < 100; i++) {
+        numbers[i] = i;
+    }
+    assert(strcmp(string, "pineapple") == 0);
+
+    /* Strings are packed, with no alignment padding. */
+    string = arena_copy_str(&arena, "a", 1, &error);
+    assert(error.code == error_none);
+    assert(arena_copy_str(&arena, "b", 1, &error) == string + 2);
+    assert(arena.chunk_count == 1);
+
+    /* A request larger than a chunk gets its own. */
+    big = arena_alloc(&arena, 1, 0x400000, &error);
+    assert(error.code == error_none);
+    memset(big, 'x', 0x400000);
+    assert(arena.chunk_count == 2);
+    assert(arena.reserved >= 0x400000);
+    assert(arena.used <= arena.reserved);
+
+    /* Many small allocations fill new chunks. */
+    for (i = 0; i < 100000; i++) {
+        string = arena_copy_str(&arena, "banana", 6, &error);
+        assert(error.code == error_none);
+        assert(strcmp(string, "banana") == 0);
+    }
+    assert(arena.chunk_count > 2);
+
+    /* Too many elements cannot be allocated. */
+    assert(arena_alloc(&arena, 16, SIZE_MAX / 8, &error) == NULL);
+    assert(error.code == error_alloc);
+    error_destroy(&error);
+    error_init(&error);
+
+    for (i = 0; i < 100; i++) {
+        assert(numbers[i] == i);
+    }
+
+    arena_destroy(&arena);
+    assert(arena.chunk_count == 0);
+
+    /* A NULL arena allocates from the heap. */
+    string = arena_copy_str(NULL, "heap", 4, &error);
+    assert(error.code == error_none);
+    assert(strcmp(string, "heap") == 0);
+    arena_free(NULL, string);
+
+    puts("Ok");
+
+    return 0;
+}
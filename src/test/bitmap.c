@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "../bitmap.h"
+#include "../error.h"
+
+/**
+ * Tests compressed bitmaps.
+ */
+
+/**
+ * Tests that the bitmap has exactly the IDs for which the predicate is true,
+ * up to the given limit, and that they are iterated in order.
+ */
+void check(
+        struct bitmap const *restrict bitmap,
+        moviedb_id_t limit,
+        bool (*predicate)(moviedb_id_t id))
+{
+    struct bitmap_iter iter;
+    moviedb_id_t id;
+    moviedb_id_t expected = 0;
+    size_t cardinality = 0;
+
+    bitmap_iter(bitmap, &iter);
+
+    while (bitmap_next(&iter, &id)) {
+        while (!predicate(expected)) {
+            assert(!bitmap_contains(bitmap, expected));
+            expected++;
+        }
+        assert(id == expected);
+        assert(bitmap_contains(bitmap, id));
+        expected++;
+        cardinality++;
+    }
+
+    while (expected < limit) {
+        assert(!predicate(expected));
+        assert(!bitmap_contains(bitmap, expected));
+        expected++;
+    }
+
+    assert(bitmap_cardinality(bitmap) == cardinality);
+}
+
+bool is_sparse(moviedb_id_t id)
+{
+    return id % 97 == 0;
+}
+
+bool is_dense(moviedb_id_t id)
+{
+    return id % 3 != 0 && id < 200000;
+}
+
+bool is_run(moviedb_id_t id)
+{
+    return (id >= 1000 && id < 70000) || (id >= 140000 && id < 140010);
+}
+
+bool is_sparse_and_dense(moviedb_id_t id)
+{
+    return is_sparse(id) && is_dense(id);
+}
+
+bool is_dense_and_run(moviedb_id_t id)
+{
+    return is_dense(id) && is_run(id);
+}
+
+bool is_sparse_or_run(moviedb_id_t id)
+{
+    return is_sparse(id) || is_run(id);
+}
+
+bool is_dense_or_run(moviedb_id_t id)
+{
+    return is_dense(id) || is_run(id);
+}
+
+bool is_sparse_andnot_dense(moviedb_id_t id)
+{
+    return is_sparse(id) && !is_dense(id);
+}
+
+bool is_run_andnot_sparse(moviedb_id_t id)
+{
+    return is_run(id) && !is_sparse(id);
+}
+
+int main(int argc, char const *argv[])
+{
+    struct error error;
+    struct bitmap sparse, dense, run, out;
+    moviedb_id_t id;
+    moviedb_id_t limit = 300000;
+
+    error_init(&error);
+    bitmap_init(&sparse);
+    bitmap_init(&dense);
+    bitmap_init(&run);
+    bitmap_init(&out);
+
+    assert(bitmap_cardinality(&sparse) == 0);
+    assert(!bitmap_contains(&sparse, 0));
+
+    /* Sparse IDs are added in descending order, to insert in the middle. */
+    for (id = limit; id > 0; id--) {
+        if (is_sparse(id - 1)) {
+            bitmap_add(&sparse, id - 1, &error);
+            assert(error.code == error_none);
+        }
+    }
+    bitmap_add(&sparse, 97, &error);
+    assert(error.code == error_none);
+    check(&sparse, limit, is_sparse);
+
+    for (id = 0; id < limit; id++) {
+        if (is_dense(id)) {
+            bitmap_add(&dense, id, &error);
+            assert(error.code == error_none);
+        }
+        if (is_run(id)) {
+            bitmap_add(&run, id, &error);
+            assert(error.code == error_none);
+        }
+    }
+    check(&dense, limit, is_dense);
+    check(&run, limit, is_run);
+
+    bitmap_optimize(&sparse, &error);
+    assert(error.code == error_none);
+    bitmap_optimize(&dense, &error);
+    assert(error.code == error_none);
+    bitmap_optimize(&run, &error);
+    assert(error.code == error_none);
+
+    /* Each kind of container is chosen. */
+    assert(sparse.containers[0].kind == bitmap_array);
+    assert(dense.containers[0].kind == bitmap_bits);
+    assert(run.containers[0].kind == bitmap_runs);
+    assert(run.containers[2].kind == bitmap_runs);
+
+    check(&sparse, limit, is_sparse);
+    check(&dense, limit, is_dense);
+    check(&run, limit, is_run);
+
+    bitmap_and(&out, &sparse, &dense, &error);
+    assert(error.code == error_none);
+    check(&out, limit, is_sparse_and_dense);
+
+    bitmap_and(&out, &run, &dense, &error);
+    assert(error.code == error_none);
+    check(&out, limit, is_dense_and_run);
+
+    bitmap_or(&out, &sparse, &run, &error);
+    assert(error.code == error_none);
+    check(&out, limit, is_sparse_or_run);
+
+    bitmap_or(&out, &run, &dense, &error);
+    assert(error.code == error_none);
+    check(&out, limit, is_dense_or_run);
+
+    bitmap_andnot(&out, &sparse, &dense, &error);
+    assert(error.code == error_none);
+    check(&out, limit, is_sparse_andnot_dense);
+
+    bitmap_andnot(&out, &run, &sparse, &error);
+    assert(error.code == error_none);
+    check(&out, limit, is_run_andnot_sparse);
+
+    /* Adding to a run container still works. */
+    bitmap_add(&run, 500, &error);
+    assert(error.code == error_none);
+    assert(bitmap_contains(&run, 500));
+    assert(bitmap_cardinality(&run) == 69000 + 10 + 1);
+
+    /* Combining with an empty bitmap. */
+    bitmap_destroy(&sparse);
+    bitmap_and(&out, &sparse, &dense, &error);
+    assert(error.code == error_none);
+    assert(bitmap_cardinality(&out) == 0);
+    bitmap_or(&out, &sparse, &dense, &error);
+    assert(error.code == error_none);
+    check(&out, limit, is_dense);
+
+    bitmap_destroy(&out);
+    bitmap_destroy(&run);
+    bitmap_destroy(&dense);
+    bitmap_destroy(&sparse);
+    error_destroy(&error);
+
+    puts("Ok");
+
+    return 0;
+}
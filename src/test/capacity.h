@@ -0,0 +1,28 @@
+#ifndef MOVIEDB_TEST_CAPACITY_H
+#define MOVIEDB_TEST_CAPACITY_H 1
+
+#include <stddef.h>
+#include "../hash.h"
+
+/**
+ * Maximum load of the hash tables under test.
+ */
+#define TEST_MAX_LOAD 0.5
+
+/**
+ * Returns the capacity a hash table with the given capacity and number of
+ * entries is expected to have once a new key is inserted (or an insertion is
+ * attempted): the capacity doubled, as rounded by moviedb_hash_capacity for
+ * this build, if one more entry would reach the maximum load, or the same
+ * capacity otherwise.
+ */
+static inline size_t expected_capacity(size_t capacity, size_t length)
+{
+    if ((length + 1) / (double) capacity >= TEST_MAX_LOAD) {
+        capacity = moviedb_hash_capacity(capacity * 2);
+    }
+
+    return capacity;
+}
+
+#endif
@@ -5,6 +5,8 @@
 #include <assert.h>
 #include "../io.h"
 #include "../csv.h"
+#include "../csv/scan.h"
+#include "../csv/rating.h"
 #include "../strbuf.h"
 #include "../error.h"
 
@@ -14,12 +16,85 @@
 
 void test_file(char const *path);
 
+void test_memory(char const *path);
+
+void assert_slice(
+        struct csv_parser *restrict parser,
+        struct strbuf *restrict buf,
+        char const *expected);
+
+void test_scan(
+        char const *name,
+        size_t (*scan)(char const *, size_t),
+        char const *delimiters);
+
+void test_paths(char const *data);
+
+void test_parse_double(char const *string);
+
+void test_timestamp(char const *string, bool valid, uint32_t expected);
+
 int main(int argc, char const *argv[])
 {
     test_file("src/test/csv-lf.csv");
     test_file("src/test/csv-crlf.csv");
     test_file("src/test/csv-cr.csv");
 
+    test_memory("src/test/csv-lf.csv");
+    test_memory("src/test/csv-crlf.csv");
+    test_memory("src/test/csv-cr.csv");
+
+    printf("Scanner implementation: %s\n", csv_scan_impl);
+    test_scan("csv_scan_unquoted", csv_scan_unquoted, ",\"\r\n");
+    test_scan("csv_scan_quoted", csv_scan_quoted, "\"\\\r\n");
+    test_scan("csv_scan_unquoted_swar", csv_scan_unquoted_swar, ",\"\r\n");
+    test_scan("csv_scan_quoted_swar", csv_scan_quoted_swar, "\"\\\r\n");
+
+    test_paths("a field well over thirty-two bytes long for the scanner,"
+            "\"quoted, also longer than a single block, \"\"escaped\"\" "
+            "and with a \\backslash and a line\r\nbreak inside\",x\r\n"
+            "\"\",,\"short\"\n"
+            "tail without a line break at all, over 32 bytes");
+    test_paths("1,2,3\r4,5,6\n7,8,9\r\n");
+    test_paths("an unquoted field with a misplaced quote after a long \"run\n");
+    test_paths("\"a quoted field that never ends, across\nlines and lines");
+
+    test_parse_double("0.5");
+    test_parse_double("5.0");
+    test_parse_double("3");
+    test_parse_double("  4.5  ");
+    test_parse_double(".5");
+    test_parse_double("5.");
+    test_parse_double("0.1");
+    test_parse_double("2.675");
+    test_parse_double("123456789012345");
+    test_parse_double("1234567890123456789");
+    test_parse_double("0.000000000000001");
+    test_parse_double("1e3");
+    test_parse_double("-2.5");
+    test_parse_double("4.5.");
+    test_parse_double("4 5");
+    test_parse_double("abc");
+    test_parse_double(".");
+    test_parse_double("");
+
+    test_timestamp("0", true, 0);
+    test_timestamp("1262304000", true, 1262304000);
+    test_timestamp("4294967295", true, UINT32_MAX);
+    test_timestamp("4294967296", false, 0);
+    test_timestamp("1970-01-01 00:00:00", true, 0);
+    test_timestamp("2000-02-29 12:34:56", true, 951827696);
+    test_timestamp("2002-12-12 05:12:38", true, 1039669958);
+    test_timestamp("2009-12-31 23:59:59", true, 1262303999);
+    test_timestamp("2106-02-07 06:28:15", true, UINT32_MAX);
+    test_timestamp("2106-02-07 06:28:16", false, 0);
+    test_timestamp("1969-12-31 23:59:59", false, 0);
+    test_timestamp("2010-13-01 00:00:00", false, 0);
+    test_timestamp("2010-01-01 24:00:00", false, 0);
+    test_timestamp("2010-01-01T00:00:00", false, 0);
+    test_timestamp("-1", false, 0);
+    test_timestamp("", false, 0);
+
     puts("Ok");
 
     return 0;
@@ -150,3 +225,256 @@ void test_file(char const *path)
 
     strbuf_destroy(&buf);
 }
+
+void test_memory(char const *path)
+{
+    FILE *file;
+    char data[256];
+    size_t length;
+    struct strbuf buf;
+    struct error error;
+    struct csv_parser parser;
+    struct csv_field field;
+
+    error_init(&error);
+    strbuf_init(&buf);
+
+    printf("Testing %s in memory\n", path);
+    file = input_file_open(path, &error);
+    assert(error.code == error_none);
+    length = fread(data, 1, sizeof(data), file);
+    input_file_close(file);
+
+    csv_parser_init_mem(&parser, data, length);
+
+    assert(csv_is_row_boundary(&parser));
+    assert_slice(&parser, &buf, "abc");
+    assert(parser.line == 1);
+    assert(parser.column == 5);
+    assert(!csv_is_row_boundary(&parser));
+    assert_slice(&parser, &buf, "def");
+    assert_slice(&parser, &buf, " ghj");
+    assert(parser.line == 2);
+    assert(parser.column == 1);
+    assert(csv_is_row_boundary(&parser));
+
+    csv_parse_field_slice(&parser, &buf, &field, &error);
+    assert(error.code == error_none);
+    assert((field.length == 9 && memcmp(field.ptr, "test\nthis", 9) == 0)
+            || (field.length == 10 && memcmp(field.ptr, "test\r\nthis", 10) == 0)
+            || (field.length == 9 && memcmp(field.ptr, "test\rthis", 9) == 0));
+    assert(parser.line == 3);
+    assert(parser.column == 7);
+
+    assert_slice(&parser, &buf, "and \"this\"");
+    assert_slice(&parser, &buf, "3");
+    assert(csv_is_row_boundary(&parser));
+    assert_slice(&parser, &buf, "5");
+    csv_parse_field_slice(&parser, &buf, &field, &error);
+    assert(error.code == error_none);
+    assert(csv_field_equals(&field, "this too"));
+    /* Quoted field without escapes is not copied. */
+    assert(field.ptr > data && field.ptr < data + length);
+    assert_slice(&parser, &buf, "");
+    assert(csv_is_row_boundary(&parser));
+    assert_slice(&parser, &buf, "");
+    assert(csv_is_end_of_file(&parser));
+    assert(parser.line == 5);
+    assert(parser.column == 1);
+
+    /* Empty fields between commas. */
+    csv_parser_init_mem(&parser, "a,,b\n", 5);
+    assert_slice(&parser, &buf, "a");
+    assert_slice(&parser, &buf, "");
+    assert_slice(&parser, &buf, "b");
+    assert(csv_is_row_boundary(&parser));
+
+    /* A quote inside an unquoted field is an error at the exact column. */
+    csv_parser_init_mem(&parser, "ab\"c\n", 5);
+    csv_parse_field_slice(&parser, &buf, &field, &error);
+    assert(error.code == error_csv);
+    assert(error.data.csv.line == 1);
+    assert(error.data.csv.column == 4);
+
+    strbuf_destroy(&buf);
+    error_destroy(&error);
+}
+
+void assert_slice(
+        struct csv_parser *restrict parser,
+        struct strbuf *restrict buf,
+        char const *expected)
+{
+    struct error error;
+    struct csv_field field;
+
+    error_init(&error);
+
+    assert(!csv_is_error(parser));
+    assert(!csv_is_end_of_file(parser));
+    csv_parse_field_slice(parser, buf, &field, &error);
+    assert(error.code == error_none);
+    assert(csv_field_equals(&field, expected));
+}
+
+void test_scan(
+        char const *name,
+        size_t (*scan)(char const *, size_t),
+        char const *delimiters)
+{
+    /* Fillers include bytes that differ from delimiters in a single bit. */
+    char const fillers[] = { 'a', ',' ^ 0x40, '"' ^ 0x80, '\n' ^ 1, (char) 0xff };
+    char data[96];
+    size_t offset;
+    size_t length;
+    size_t position;
+    size_t delimiter;
+    size_t i;
+
+    printf("Testing %s\n", name);
+
+    for (offset = 0; offset < 8; offset++) {
+        for (length = 0; length + offset <= sizeof(data); length++) {
+            for (i = 0; i < length; i++) {
+                data[offset + i] = fillers[(i + length) % sizeof(fillers)];
+            }
+            /* No delimiter at all. */
+            assert(scan(data + offset, length) == length);
+
+            for (position = 0; position < length; position++) {
+                for (delimiter = 0; delimiters[delimiter] != 0; delimiter++) {
+                    data[offset + position] = delimiters[delimiter];
+                    /* A later delimiter must not be found first. */
+                    if (position + 1 < length) {
+                        data[offset + length - 1] = delimiters[0];
+                    }
+                    assert(scan(data + offset, length) == position);
+                    data[offset + length - 1] =
+                        fillers[(length - 1 + length) % sizeof(fillers)];
+                    data[offset + position] =
+                        fillers[(position + length) % sizeof(fillers)];
+                }
+            }
+        }
+    }
+}
+
+void test_paths(char const *data)
+{
+    size_t length = strlen(data);
+    FILE *file;
+    struct strbuf file_buf;
+    struct strbuf mem_buf;
+    struct error file_error;
+    struct error mem_error;
+    struct csv_parser file_parser;
+    struct csv_parser mem_parser;
+    struct csv_field field;
+    bool done = false;
+
+    printf("Testing state machine against fast path, %zu bytes\n", length);
+
+    error_init(&file_error);
+    error_init(&mem_error);
+    strbuf_init(&file_buf);
+    strbuf_init(&mem_buf);
+
+    /* The stdio parser goes through the automaton byte by byte. */
+    file = fmemopen((void *) data, length, "r");
+    assert(file != NULL);
+    csv_parser_init(&file_parser, file);
+    csv_parser_init_mem(&mem_parser, data, length);
+
+    while (!done) {
+        csv_parse_field(&file_parser, &file_buf, &file_error);
+        csv_parse_field_slice(&mem_parser, &mem_buf, &field, &mem_error);
+
+        assert(file_error.code == mem_error.code);
+        assert(file_parser.line == mem_parser.line);
+        assert(file_parser.column == mem_parser.column);
+        assert(file_parser.state == mem_parser.state);
+
+        if (file_error.code == error_none) {
+            assert(field.length == file_buf.length);
+            assert(field.length == 0
+                    || memcmp(field.ptr, file_buf.ptr, field.length) == 0);
+            done = csv_is_end_of_file(&file_parser);
+        } else {
+            assert(file_error.code == error_csv);
+            assert(file_error.data.csv.line == mem_error.data.csv.line);
+            assert(file_error.data.csv.column == mem_error.data.csv.column);
+            done = true;
+        }
+    }
+
+    input_file_close(file);
+    strbuf_destroy(&file_buf);
+    strbuf_destroy(&mem_buf);
+    error_destroy(&file_error);
+    error_destroy(&mem_error);
+}
+
+void test_parse_double(char const *string)
+{
+    struct strbuf buf;
+    struct error field_error;
+    struct error string_error;
+    struct csv_field field;
+    double field_value;
+    double string_value;
+
+    printf("Testing double \"%s\"\n", string);
+
+    strbuf_init(&buf);
+    error_init(&field_error);
+    error_init(&string_error);
+
+    field.ptr = string;
+    field.length = strlen(string);
+    field_value = csv_field_parse_double(&field, &buf, &field_error);
+    string_value = csv_parse_double(string, &string_error);
+
+    /* Must be exactly what strtod gives, or fail the same way. */
+    assert(field_error.code == string_error.code);
+    if (field_error.code == error_none) {
+        assert(memcmp(&field_value, &string_value, sizeof(field_value)) == 0);
+    }
+
+    strbuf_destroy(&buf);
+    error_destroy(&field_error);
+    error_destroy(&string_error);
+}
+
+void test_timestamp(char const *string, bool valid, uint32_t expected)
+{
+    struct strbuf buf;
+    struct error error;
+    struct csv_parser csv_parser;
+    struct rating_parser parser;
+    struct rating_csv_row row;
+    bool parsed;
+    char data[128];
+
+    printf("Testing timestamp \"%s\"\n", string);
+
+    strbuf_init(&buf);
+    error_init(&error);
+
+    sprintf(data, "userId,movieId,rating,timestamp\n1,2,3.5,%s\n", string);
+
+    csv_parser_init_mem(&csv_parser, data, strlen(data));
+    rating_parser_init(&parser, &csv_parser, &buf, &error);
+    assert(error.code == error_none);
+
+    parsed = rating_row_parse(&parser, &buf, &row, &error);
+    assert(parsed == valid);
+    if (valid) {
+        assert(row.timestamp == expected);
+    } else {
+        assert(error.code == error_rating);
+        assert(error.data.csv_rating.line == 2);
+    }
+
+    strbuf_destroy(&buf);
+    error_destroy(&error);
+}
@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../genres.h"
+#include "../movies.h"
+#include "../error.h"
+
+/**
+ * Tests the genres index.
+ */
+
+int main(int argc, char const *argv[])
+{
+    struct error error;
+    struct movie_csv_row row;
+    struct movies_table table;
+    struct genres_index index;
+    struct genre const *genre;
+    moviedb_id_t id;
+    size_t i;
+
+    error_init(&error);
+    movies_init(&table, 5, NULL, &error);
+    assert(error.code == error_none);
+
+    row.id = 10;
+    row.title = "Banana Movie";
+    row.genres = "Action|Comedy";
+    movies_insert(&table, &row, &error);
+    row.id = 20;
+    row.title = "Apple Film";
+    row.genres = "Comedy|Drama";
+    movies_insert(&table, &row, &error);
+    row.id = 30;
+    row.title = "Pelicula de la Naranja";
+    row.genres = "Action|Drama";
+    movies_insert(&table, &row, &error);
+    row.id = 40;
+    row.title = "Grape Story";
+    row.genres = "Drama";
+    movies_insert(&table, &row, &error);
+    row.id = 50;
+    row.title = "Nothing";
+    row.genres = "(no genres listed)";
+    movies_insert(&table, &row, &error);
+    assert(error.code == error_none);
+
+    /* Movies are rated by index, in the order they were inserted. */
+    movies_add_rating(&table, 0, rating_encode(4.0));
+    movies_add_rating(&table, 1, rating_encode(2.0));
+    movies_add_rating(&table, 1, rating_encode(3.0));
+    movies_add_rating(&table, 2, rating_encode(5.0));
+    movies_add_rating(&table, 3, rating_encode(3.0));
+    movies_add_rating(&table, 3, rating_encode(2.0));
+    movies_seal(&table);
+
+    genres_index_init(&index);
+    assert(genres_index_search(&index, "Drama") == NULL);
+
+    genres_index_build(&index, &table, &error);
+    assert(error.code == error_none);
+    assert(index.length == 4);
+
+    /* Best rated first. */
+    genre = genres_index_search(&index, "Action");
+    assert(genre != NULL);
+    assert(strcmp(genre->name, "Action") == 0);
+    assert(genre->length == 2);
+    assert(genre->movies[0].movie->id == 30);
+    assert(genre->movies[0].mean_rating == 5.0);
+    assert(genre->movies[0].ratings == 1);
+    assert(genre->movies[1].movie->id == 10);
+
+    /* Ties are ordered by ID. */
+    genre = genres_index_search(&index, "Drama");
+    assert(genre != NULL);
+    assert(genre->length == 3);
+    assert(genre->movies[0].movie->id == 30);
+    assert(genre->movies[1].movie->id == 20);
+    assert(genre->movies[1].ratings == 2);
+    assert(genre->movies[2].movie->id == 40);
+    /* The most controversial first, ties ordered by ID too. */
+    assert(genre->controversial[0].movie->id == 20);
+    assert(genre->controversial[0].rating_variance == 0.25);
+    assert(genre->controversial[1].movie->id == 40);
+    assert(genre->controversial[2].movie->id == 30);
+    assert(genre->controversial[2].rating_variance == 0.0);
+    /* The bitmap has the indices of the movies. */
+    assert(bitmap_cardinality(&genre->movie_indices) == 3);
+    assert(bitmap_contains(&genre->movie_indices, 1));
+    assert(!bitmap_contains(&genre->movie_indices, 0));
+
+    genre = genres_index_search(&index, "(no genres listed)");
+    assert(genre != NULL);
+    assert(genre->length == 1);
+    assert(genre->movies[0].ratings == 0);
+
+    /* Names must match whole genres. */
+    assert(genres_index_search(&index, "Dram") == NULL);
+    assert(genres_index_search(&index, "Drama|Action") == NULL);
+    assert(genres_index_search(&index, "") == NULL);
+
+    /* Rebuilding replaces the old genres. */
+    row.title = "Bulk";
+    for (id = 100; id < 1100; id++) {
+        row.id = id;
+        row.genres = id % 2 == 0 ? "Even" : "Odd|Comedy";
+        movies_insert(&table, &row, &error);
+        assert(error.code == error_none);
+        movies_add_rating(
+                &table,
+                table.length - 1,
+                rating_encode((id % 10 + 1) / 2.0));
+    }
+
+    movies_seal(&table);
+    genres_index_build(&index, &table, &error);
+    assert(error.code == error_none);
+    assert(index.length == 6);
+
+    genre = genres_index_search(&index, "Odd");
+    assert(genre != NULL);
+    assert(genre->length == 500);
+    for (i = 1; i < genre->length; i++) {
+        assert(genre->controversial[i].movie->id
+                > genre->controversial[i - 1].movie->id);
+        assert(genre->movies[i - 1].mean_rating
+                >= genre->movies[i].mean_rating);
+        if (genre->movies[i - 1].mean_rating == genre->movies[i].mean_rating) {
+            assert(genre->movies[i - 1].movie->id < genre->movies[i].movie->id);
+        }
+    }
+
+    genre = genres_index_search(&index, "Comedy");
+    assert(genre != NULL);
+    assert(genre->length == 502);
+    assert(bitmap_cardinality(&genre->movie_indices) == 502);
+
+    genres_index_destroy(&index);
+    movies_destroy(&table);
+    error_destroy(&error);
+
+    puts("Ok");
+
+    return 0;
+}
@@ -4,9 +4,9 @@
 #include <stdbool.h>
 #include <math.h>
 #include <assert.h>
-#include "../alloc.h"
 #include "../movies.h"
 #include "../error.h"
+#include "capacity.h"
 
 /** 
  * Tests movies hash table implementation.
@@ -21,30 +21,13 @@ void insert(
 {
     printf("Inserting %s\n", title);
 
-    char *heap_title, *heap_genres;
     struct movie_csv_row row;
 
     row.id = id;
-
-    heap_title = moviedb_alloc(sizeof(*heap_title), strlen(title) + 1, error);
-    assert(error->code == error_none);
-    strcpy(heap_title, title);
-    row.title = heap_title;
-
-    heap_genres = moviedb_alloc(
-            sizeof(*heap_genres),
-            strlen(genres) + 1,
-            error);
-    assert(error->code == error_none);
-    strcpy(heap_genres, genres);
-    row.genres = heap_genres;
+    row.title = title;
+    row.genres = genres;
 
     movies_insert(table, &row, error);
-
-    if (error->code != error_none) {
-        moviedb_free(heap_title);
-        moviedb_free(heap_genres);
-    }
 }
 
 int main(int argc, char const *argv[])
@@ -52,43 +35,75 @@ int main(int argc, char const *argv[])
     struct error error;
     struct movie const *movie;
     struct movies_table table;
+    struct movies_iter iter;
+    moviedb_id_t id;
+    moviedb_index_t index;
+    struct movie *movies;
+    size_t count;
+    size_t capacity;
+    size_t i;
+    char genres[512];
 
     error_init(&error);
 
-    movies_init(&table, 5, &error);
+    movies_init(&table, 5, NULL, &error);
     assert(error.code == error_none);
     assert(table.length == 0);
-    assert(table.capacity == 5);
+    capacity = moviedb_hash_capacity(5);
+    assert(table.capacity == capacity);
 
     insert(&table, 123, "Banana Movie", "action|comedy", &error);
     assert(error.code == error_none);
     assert(table.length == 1);
-    assert(table.capacity == 5);
+    capacity = expected_capacity(capacity, 0);
+    assert(table.capacity == capacity);
 
     insert(&table, 456, "Apple Film", "comedy|drama", &error);
     assert(error.code == error_none);
     assert(table.length == 2);
-    assert(table.capacity == 5);
+    capacity = expected_capacity(capacity, 1);
+    assert(table.capacity == capacity);
 
     insert(&table, 789, "Pelicula de la Naranja", "action|drama", &error);
     assert(table.length == 3);
-    assert(table.capacity == 11);
+    capacity = expected_capacity(capacity, 2);
+    assert(table.capacity == capacity);
 
     insert(&table, 456, "Bad Duplicate", "fiction", &error);
     assert(error.code == error_dup_movie_id);
     assert(table.length == 3);
-    assert(table.capacity == 11);
-
-    movies_add_rating(&table, 456, 2.0);
-    movies_add_rating(&table, 456, 3.0);
+    capacity = expected_capacity(capacity, 3);
+    assert(table.capacity == capacity);
+
+    /* Indices are given in insertion order. */
+    assert(movies_index(&table, 456, &index));
+    assert(index == 1);
+    assert(movies_at(&table, index)->id == 456);
+    assert(movies_index(&table, 789, &index));
+    assert(index == 2);
+    assert(!movies_index(&table, 124, &index));
+
+    movies_add_rating(&table, 1, rating_encode(2.0));
+    movies_add_rating(&table, 1, rating_encode(3.0));
+    movies_add_rating(&table, 1, rating_encode(3.0));
+    movies_add_rating(&table, 1, rating_encode(4.0));
+    movies_seal(&table);
 
     movie = movies_search(&table, 456);
     assert(movie != NULL);
     assert(movie->id == 456);
     assert(strcmp(movie->title, "Apple Film") == 0);
     assert(strcmp(movie->genres, "comedy|drama") == 0);
-    assert(fabs(movie->mean_rating - 2.5) < 0.000001);
-    assert(movie->ratings == 2);
+    assert(fabs(movie->mean_rating - 3.0) < 0.000001);
+    assert(fabs(movie->rating_variance - 0.5) < 0.000001);
+    assert(movie->ratings == 4);
+    /* Percentiles are read from the histogram, by nearest rank. */
+    assert(rating_histogram_percentile(&movie->histogram, 0.0) == 2.0);
+    assert(rating_histogram_percentile(&movie->histogram, 0.25) == 2.0);
+    assert(rating_histogram_percentile(&movie->histogram, 0.26) == 3.0);
+    assert(rating_histogram_percentile(&movie->histogram, 0.5) == 3.0);
+    assert(rating_histogram_percentile(&movie->histogram, 0.9) == 4.0);
+    assert(rating_histogram_percentile(&movie->histogram, 1.0) == 4.0);
 
     movie = movies_search(&table, 123);
     assert(movie != NULL);
@@ -96,7 +111,99 @@ int main(int argc, char const *argv[])
     assert(strcmp(movie->title, "Banana Movie") == 0);
     assert(strcmp(movie->genres, "action|comedy") == 0);
     assert(fabs(movie->mean_rating) < 0.000001);
+    assert(fabs(movie->rating_variance) < 0.000001);
     assert(movie->ratings == 0);
+    assert(rating_histogram_percentile(&movie->histogram, 0.5) == 0.0);
+
+    movie = movies_search(&table, 124);
+    assert(movie == NULL);
+
+    /* Genres are interned in order of first appearance. */
+    assert(table.genres.length == 3);
+    assert(movies_genre(&table, "action") == 0);
+    assert(movies_genre(&table, "comedy") == 1);
+    assert(movies_genre(&table, "drama") == 2);
+    assert(movies_genre(&table, "fiction") == GENRE_NONE);
+    assert(movies_genre(&table, "act") == GENRE_NONE);
+    assert(movie_has_genre(movies_search(&table, 123), 0));
+    assert(movie_has_genre(movies_search(&table, 123), 1));
+    assert(!movie_has_genre(movies_search(&table, 123), 2));
+    assert(movies_search(&table, 456)->genre_set.mask == 6);
+
+    error_destroy(&error);
+    error_init(&error);
+
+    /* Enough movies for fingerprints to collide, and a few resizes. */
+    for (id = 1000; id < 3000; id++) {
+        insert(&table, id, "Filler", "drama", &error);
+        assert(error.code == error_none);
+    }
+    assert(table.length == 2003);
+
+    for (id = 1000; id < 3000; id++) {
+        movie = movies_search(&table, id);
+        assert(movie != NULL);
+        assert(movie->id == id);
+        assert(movies_search(&table, id + 10000) == NULL);
+    }
+
+    /* Movies are iterated by index. */
+    count = 0;
+    movies_iter(&table, &iter);
+    while ((movie = movies_next(&iter)) != NULL) {
+        assert(movie == movies_at(&table, count));
+        count++;
+    }
+    assert(count == table.length);
+    assert(movies_at(&table, 3)->id == 1000);
+
+    /* Reserving keeps the movies, and avoids resizes up to that many. */
+    movies_reserve(&table, 3000, &error);
+    assert(error.code == error_none);
+    assert(table.length == 2003);
+    assert(table.capacity > 6000);
+    assert(table.movies_capacity >= 3000);
+    capacity = table.capacity;
+    movies = table.movies;
+    assert(movies_search(&table, 1000)->id == 1000);
+
+    for (id = 3000; id < 3997; id++) {
+        insert(&table, id, "Filler", "drama", &error);
+        assert(error.code == error_none);
+    }
+    assert(table.length == 3000);
+    assert(table.capacity == capacity);
+    assert(table.movies == movies);
+    assert(movies_search(&table, 3996)->id == 3996);
+
+    /* Reserving less than there is room for does nothing. */
+    movies_reserve(&table, 10, &error);
+    assert(error.code == error_none);
+    assert(table.capacity == capacity);
+    assert(table.movies == movies);
+
+    /* Genres beyond the bitmask go to the overflow list. */
+    strcpy(genres, "drama");
+    for (i = 0; i < 70; i++) {
+        sprintf(genres + strlen(genres), "|g%zu", 69 - i);
+    }
+    strcat(genres, "|g3|action");
+    insert(&table, 5000, "Many Genres", genres, &error);
+    assert(error.code == error_none);
+    assert(table.genres.length == 73);
+
+    movie = movies_search(&table, 5000);
+    assert(strcmp(movie->genres, genres) == 0);
+    assert(movie->genre_set.overflow_length == 73 - GENRE_MASK_BITS);
+    assert(movie_has_genre(movie, movies_genre(&table, "drama")));
+    assert(movie_has_genre(movie, movies_genre(&table, "action")));
+    assert(!movie_has_genre(movie, movies_genre(&table, "comedy")));
+    for (i = 0; i < 70; i++) {
+        sprintf(genres, "g%zu", i);
+        assert(movie_has_genre(movie, movies_genre(&table, genres)));
+    }
+    assert(!movie_has_genre(movie, 73));
+    assert(!movie_has_genre(movies_search(&table, 123), 70));
 
     movies_destroy(&table);
     error_destroy(&error);
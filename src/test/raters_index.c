@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "../raters.h"
+#include "../users.h"
+#include "../error.h"
+
+/**
+ * Tests the raters index.
+ */
+
+int main(int argc, char const *argv[])
+{
+    struct error error;
+    struct rating_csv_row row;
+    struct users_table table;
+    struct raters_index index;
+    struct movie_rater const *raters;
+    size_t length;
+    size_t total;
+    size_t i;
+    size_t j;
+
+    error_init(&error);
+    users_init(&table, 5, &error);
+    assert(error.code == error_none);
+    raters_index_init(&index);
+
+    /* Users get indices 0, 1 and 2. */
+    row.timestamp = 0;
+    row.userid = 30;
+    row.value = 4.5;
+    users_insert_rating(&table, &row, 2, &error);
+    row.value = 1.0;
+    users_insert_rating(&table, &row, 0, &error);
+    row.userid = 10;
+    row.value = 3.0;
+    users_insert_rating(&table, &row, 2, &error);
+    row.userid = 20;
+    row.value = 5.0;
+    users_insert_rating(&table, &row, 2, &error);
+    row.value = 2.5;
+    users_insert_rating(&table, &row, 0, &error);
+    assert(error.code == error_none);
+
+    /* Works before sealing the users too. */
+    raters_index_build(&index, &table, 4, &error);
+    assert(error.code == error_none);
+    assert(index.length == 4);
+    assert(raters_index_bytes(&index) > 0);
+
+    raters = raters_index_movie(&index, 0, &length);
+    assert(length == 2);
+    assert(raters[0].user == 0);
+    assert(rating_decode(raters[0].code) == 1.0);
+    assert(raters[1].user == 2);
+    assert(rating_decode(raters[1].code) == 2.5);
+
+    raters_index_movie(&index, 1, &length);
+    assert(length == 0);
+    raters_index_movie(&index, 3, &length);
+    assert(length == 0);
+
+    /* Raters of a movie are sorted by user index. */
+    raters = raters_index_movie(&index, 2, &length);
+    assert(length == 3);
+    assert(raters[0].user == 0);
+    assert(rating_decode(raters[0].code) == 4.5);
+    assert(raters[1].user == 1);
+    assert(raters[2].user == 2);
+    assert(rating_decode(raters[2].code) == 5.0);
+
+    /* Rebuilding from sealed users replaces the old index. */
+    for (row.userid = 100; row.userid < 1100; row.userid++) {
+        row.value = (row.userid % 10 + 1) / 2.0;
+        users_insert_rating(&table, &row, row.userid % 7, &error);
+    }
+    assert(error.code == error_none);
+    users_seal(&table, &error);
+    assert(error.code == error_none);
+
+    raters_index_build(&index, &table, 7, &error);
+    assert(error.code == error_none);
+    assert(index.length == 7);
+
+    total = 0;
+    for (i = 0; i < index.length; i++) {
+        raters = raters_index_movie(&index, i, &length);
+        total += length;
+        for (j = 1; j < length; j++) {
+            assert(raters[j - 1].user < raters[j].user);
+        }
+    }
+    assert(total == 1005);
+
+    raters = raters_index_movie(&index, 6, &length);
+    assert(length == 143);
+    assert(users_at(&table, raters[0].user)->id == 104);
+
+    raters_index_destroy(&index);
+    users_destroy(&table);
+    error_destroy(&error);
+
+    puts("Ok");
+
+    return 0;
+}
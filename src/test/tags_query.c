@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <assert.h>
+#include "../database.h"
+#include "../query/tags.h"
+#include "../error.h"
+
+/**
+ * Tests the tags query over a database whose movies file is not sorted by ID.
+ */
+
+/**
+ * Directory of the dataset, whose movie.csv lists movies out of ID order.
+ */
+#define DATASET_DIR "src/test/unsorted"
+
+int main(int argc, char const *argv[])
+{
+    struct error error;
+    struct strbuf buf;
+    struct database database;
+    struct database_options options;
+    struct database_stats stats;
+    struct tags_query_input input;
+    struct tags_query_buf query_buf;
+
+    error_init(&error);
+    strbuf_init(&buf);
+
+    /* The paths of the CSV files are relative to the dataset directory. */
+    assert(chdir(DATASET_DIR) == 0);
+
+    database_options_init(&options);
+    options.use_snapshot = false;
+    options.threads = 1;
+    database_load(&database, &options, &stats, &buf, &error);
+    assert(error.code == error_none);
+
+    /* Movies come out in ID order, although they were loaded 30, 10, 40, 20. */
+    tags_query_input_init(&input, 2, &error);
+    assert(error.code == error_none);
+    tags_query_input_add(&input, &database, "good", &error);
+    assert(error.code == error_none);
+
+    tags_query_init(&query_buf);
+    tags_query(&database, &input, &query_buf, &error);
+    assert(error.code == error_none);
+    assert(query_buf.length == 4);
+    assert(query_buf.rows[0]->id == 10);
+    assert(query_buf.rows[1]->id == 20);
+    assert(query_buf.rows[2]->id == 30);
+    assert(query_buf.rows[3]->id == 40);
+    tags_query_destroy(&query_buf);
+
+    /* So do the movies of intersections. */
+    tags_query_input_add(&input, &database, "old", &error);
+    assert(error.code == error_none);
+
+    tags_query_init(&query_buf);
+    tags_query(&database, &input, &query_buf, &error);
+    assert(error.code == error_none);
+    assert(query_buf.length == 2);
+    assert(query_buf.rows[0]->id == 10);
+    assert(query_buf.rows[1]->id == 30);
+    tags_query_destroy(&query_buf);
+
+    tags_query_input_destroy(&input);
+    database_destroy(&database);
+    strbuf_destroy(&buf);
+    error_destroy(&error);
+
+    puts("Ok");
+
+    return 0;
+}
@@ -4,9 +4,9 @@
 #include <stdbool.h>
 #include <math.h>
 #include <assert.h>
-#include "../alloc.h"
 #include "../tags.h"
 #include "../error.h"
+#include "capacity.h"
 
 /** 
  * Tests tags hash table implementation.
@@ -15,26 +15,17 @@
 void insert(
         struct tags_table *restrict table,
         char const *restrict name,
-        moviedb_id_t movie,
+        moviedb_index_t movie,
         struct error *restrict error)
 {
     printf("Inserting %s\n", name);
 
-    char *heap_name;
     struct tag_csv_row row;
 
     row.movieid = movie;
+    row.name = name;
 
-    heap_name = moviedb_alloc(sizeof(*heap_name), strlen(name) + 1, error);
-    assert(error->code == error_none);
-    strcpy(heap_name, name);
-    row.name = heap_name;
-
-    tags_insert(table, &row, error);
-
-    if (error->code != error_none) {
-        moviedb_free(heap_name);
-    }
+    tags_insert(table, &row, movie, error);
 }
 
 int main(int argc, char const *argv[])
@@ -43,20 +34,25 @@ int main(int argc, char const *argv[])
     struct tag const *tag;
     struct tags_table table;
     struct tag_movies_iter iter;
-    moviedb_id_t movieid;
+    moviedb_index_t movieid;
+    moviedb_index_t movieids[1000];
+    size_t length;
+    size_t capacity;
     bool found88 = false, found90 = false, found92 = false;
 
     error_init(&error);
 
-    tags_init(&table, 5, &error);
+    tags_init(&table, 5, NULL, &error);
     assert(error.code == error_none);
     assert(table.length == 0);
-    assert(table.capacity == 5);
+    capacity = moviedb_hash_capacity(5);
+    assert(table.capacity == capacity);
 
     insert(&table, "good", 90, &error);
     assert(error.code == error_none);
     assert(table.length == 1);
-    assert(table.capacity == 5);
+    capacity = expected_capacity(capacity, 0);
+    assert(table.capacity == capacity);
 
     tag = tags_search(&table, "good");
     assert(tag != NULL);
@@ -65,12 +61,14 @@ int main(int argc, char const *argv[])
     insert(&table, "bad", 92, &error);
     assert(error.code == error_none);
     assert(table.length == 2);
-    assert(table.capacity == 5);
+    capacity = expected_capacity(capacity, 1);
+    assert(table.capacity == capacity);
 
     insert(&table, "average", 88, &error);
     assert(error.code == error_none);
     assert(table.length == 3);
-    assert(table.capacity == 11);
+    capacity = expected_capacity(capacity, 2);
+    assert(table.capacity == capacity);
 
     tag = tags_search(&table, "good");
     assert(tag != NULL);
@@ -83,12 +81,13 @@ int main(int argc, char const *argv[])
     insert(&table, "good", 92, &error);
     assert(error.code == error_none);
     assert(table.length == 3);
-    assert(table.capacity == 11);
+    capacity = expected_capacity(capacity, 3);
+    assert(table.capacity == capacity);
 
     insert(&table, "good", 88, &error);
     assert(error.code == error_none);
     assert(table.length == 3);
-    assert(table.capacity == 11);
+    assert(table.capacity == capacity);
 
     tag = tags_search(&table, "bad");
     assert(tag != NULL);
@@ -126,6 +125,44 @@ int main(int argc, char const *argv[])
 
     assert(found88 && found90 && found92);
 
+    /* Sealed sets are sorted. */
+    for (movieid = 2000; movieid > 100; movieid -= 3) {
+        insert(&table, "many", movieid, &error);
+        assert(error.code == error_none);
+    }
+
+    tags_seal(&table, &error);
+    assert(error.code == error_none);
+
+    tag = tags_search(&table, "good");
+    assert(tag->movies.length == 3);
+    assert(tag_movies_contain(&tag->movies, 90));
+    assert(!tag_movies_contain(&tag->movies, 91));
+
+    tag_movies_iter(&tag->movies, &iter);
+    assert(tag_movies_next(&iter, &movieid) && movieid == 88);
+    assert(tag_movies_next(&iter, &movieid) && movieid == 90);
+    assert(tag_movies_next(&iter, &movieid) && movieid == 92);
+    assert(!tag_movies_next(&iter, &movieid));
+
+    /* Sealed sets are bitmaps. */
+    tag = tags_search(&table, "many");
+    assert(tag->movies.length == 634);
+    assert(bitmap_cardinality(&tag->movies.bitmap) == 634);
+    assert(tag_movies_contain(&tag->movies, 101 + 3));
+    assert(!tag_movies_contain(&tag->movies, 101 + 4));
+
+    length = 0;
+    tag_movies_iter(&tag->movies, &iter);
+    while (tag_movies_next(&iter, &movieid)) {
+        assert(length == 0 || movieids[length - 1] < movieid);
+        movieids[length] = movieid;
+        length++;
+    }
+    assert(length == 634);
+    assert(movieids[0] == 101);
+    assert(movieids[633] == 2000);
+
     tags_destroy(&table);
     error_destroy(&error);
 
@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "../timeline.h"
+#include "../users.h"
+#include "../error.h"
+
+/**
+ * Tests the timeline index.
+ */
+
+int main(int argc, char const *argv[])
+{
+    struct error error;
+    struct rating_csv_row row;
+    struct users_table table;
+    struct timeline_index index;
+    struct timeline_month const *months;
+    struct timeline_month const *since;
+    size_t length;
+    moviedb_index_t movie;
+
+    error_init(&error);
+
+    /* Months of timestamps, in UTC. */
+    assert(timeline_month(0) == 0);
+    /* 1970-01-31 23:59:59 and 1970-02-01. */
+    assert(timeline_month(2678399) == 0);
+    assert(timeline_month(2678400) == 1);
+    /* 1999-12-31 23:59:59 and 2000-01-01. */
+    assert(timeline_month(946684799) == 359);
+    assert(timeline_month(946684800) == 360);
+    /* 2000-02-29, a leap day, and 2000-03-01. */
+    assert(timeline_month(951782400) == 361);
+    assert(timeline_month(951868800) == 362);
+    /* 2009-12-31 23:59:59 and 2010-01-01. */
+    assert(timeline_month(1262303999) == 479);
+    assert(timeline_month(1262304000) == 480);
+    /* 2106-02-07, the last 32-bit timestamp. */
+    assert(timeline_month(UINT32_MAX) == 1633);
+
+    users_init(&table, 5, &error);
+    assert(error.code == error_none);
+
+    /* Without ratings, no movie has months. */
+    timeline_index_init(&index);
+    timeline_index_build(&index, &table, 3, &error);
+    assert(error.code == error_none);
+    assert(index.length == 3);
+    timeline_index_movie(&index, 2, &length);
+    assert(length == 0);
+    assert(timeline_index_since(&index, 2, 0) == NULL);
+
+    /* Ratings of a movie come out of order, from several users. */
+    row.userid = 10;
+    row.timestamp = 1262304000;
+    row.value = 5.0;
+    users_insert_rating(&table, &row, 1, &error);
+    row.userid = 20;
+    row.timestamp = 946684800;
+    row.value = 1.0;
+    users_insert_rating(&table, &row, 1, &error);
+    row.userid = 10;
+    row.timestamp = 951782400;
+    row.value = 3.5;
+    users_insert_rating(&table, &row, 1, &error);
+    row.userid = 30;
+    row.timestamp = 1262303999;
+    row.value = 2.0;
+    users_insert_rating(&table, &row, 1, &error);
+    row.timestamp = 946684800;
+    row.value = 3.0;
+    users_insert_rating(&table, &row, 1, &error);
+    row.userid = 20;
+    row.timestamp = 0;
+    row.value = 0.5;
+    users_insert_rating(&table, &row, 3, &error);
+    assert(error.code == error_none);
+
+    /* Movies 0 and 2 have no ratings, movie 4 none past the inserted ones. */
+    timeline_index_build(&index, &table, 5, &error);
+    assert(error.code == error_none);
+    assert(index.length == 5);
+    assert(timeline_index_bytes(&index) > 0);
+
+    /* Each month holds the totals from it on. */
+    months = timeline_index_movie(&index, 1, &length);
+    assert(length == 4);
+    assert(months[0].month == 360);
+    assert(months[0].ratings == 5);
+    assert(months[0].steps == 29);
+    assert(months[1].month == 361);
+    assert(months[1].ratings == 3);
+    assert(months[1].steps == 21);
+    assert(months[2].month == 479);
+    assert(months[2].ratings == 2);
+    assert(months[2].steps == 14);
+    assert(months[3].month == 480);
+    assert(months[3].ratings == 1);
+    assert(months[3].steps == 10);
+
+    /* Windows starting in a month, between months, and after every month. */
+    since = timeline_index_since(&index, 1, 0);
+    assert(since != NULL && since->ratings == 5);
+    since = timeline_index_since(&index, 1, 361);
+    assert(since != NULL && since->ratings == 3);
+    since = timeline_index_since(&index, 1, 400);
+    assert(since != NULL && since->month == 479 && since->steps == 14);
+    since = timeline_index_since(&index, 1, 480);
+    assert(since != NULL && since->ratings == 1);
+    assert(timeline_index_since(&index, 1, 481) == NULL);
+
+    since = timeline_index_since(&index, 3, 0);
+    assert(since != NULL && since->ratings == 1 && since->steps == 1);
+    assert(timeline_index_since(&index, 3, 1) == NULL);
+
+    for (movie = 0; movie < 5; movie += 2) {
+        timeline_index_movie(&index, movie, &length);
+        assert(length == 0);
+        assert(timeline_index_since(&index, movie, 0) == NULL);
+    }
+
+    /* Works after sealing the users too. */
+    users_seal(&table, &error);
+    assert(error.code == error_none);
+    timeline_index_build(&index, &table, 5, &error);
+    assert(error.code == error_none);
+    months = timeline_index_movie(&index, 1, &length);
+    assert(length == 4);
+    assert(months[0].ratings == 5);
+    assert(months[0].steps == 29);
+
+    timeline_index_destroy(&index);
+    users_destroy(&table);
+    error_destroy(&error);
+
+    puts("Ok");
+
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../titles.h"
+#include "../movies.h"
+#include "../error.h"
+
+/**
+ * Tests the title dictionary.
+ */
+
+/**
+ * Inserts a movie with the given ID and title into the table, and adds it to
+ * the dictionary.
+ */
+static void insert(
+        struct movies_table *restrict table,
+        struct titles_dict *restrict dict,
+        moviedb_id_t id,
+        char const *restrict title,
+        struct error *restrict error)
+{
+    struct movie_csv_row row;
+
+    row.id = id;
+    row.title = title;
+    row.genres = "Drama";
+
+    movies_insert(table, &row, error);
+    assert(error->code == error_none);
+    titles_add(dict, id, error);
+    assert(error->code == error_none);
+}
+
+/**
+ * Tests that the range of a prefix has exactly the titles starting with it, in
+ * order.
+ */
+static void check_prefix(
+        struct movies_table const *restrict table,
+        struct titles_dict const *restrict dict,
+        char const *restrict prefix,
+        size_t expected)
+{
+    struct titles_range range;
+    struct movie const *movie;
+    char const *previous = NULL;
+    size_t rank;
+
+    titles_search_prefix(dict, prefix, &range);
+    assert(range.end - range.start == expected);
+
+    for (rank = range.start; rank < range.end; rank++) {
+        movie = movies_search(table, titles_movie(dict, rank));
+        assert(movie != NULL);
+        assert(strncmp(movie->title, prefix, strlen(prefix)) == 0);
+        assert(previous == NULL || strcmp(previous, movie->title) < 0);
+        previous = movie->title;
+    }
+}
+
+int main(int argc, char const *argv[])
+{
+    struct error error;
+    struct movies_table table;
+    struct titles_dict dict;
+    char title[64];
+    moviedb_id_t id;
+    moviedb_id_t movieid;
+
+    error_init(&error);
+    movies_init(&table, 5, NULL, &error);
+    assert(error.code == error_none);
+    titles_init(&dict);
+
+    /* An empty dictionary has no titles. */
+    titles_seal(&dict, &table, &error);
+    assert(error.code == error_none);
+    assert(!titles_search(&dict, "pine", &movieid));
+    check_prefix(&table, &dict, "", 0);
+
+    insert(&table, &dict, 1, "pineapple", &error);
+    insert(&table, &dict, 2, "pinetree", &error);
+    insert(&table, &dict, 3, "pine", &error);
+    insert(&table, &dict, 4, "banana", &error);
+    insert(&table, &dict, 5, "pin", &error);
+    /* Only the first movie with a title is kept. */
+    insert(&table, &dict, 6, "pine", &error);
+
+    /* Enough titles for many buckets, sharing long prefixes. */
+    for (id = 100; id < 1100; id++) {
+        sprintf(title, "The Movie %lu (%lu)",
+                (unsigned long) id % 37,
+                (unsigned long) id);
+        insert(&table, &dict, id, title, &error);
+    }
+
+    titles_seal(&dict, &table, &error);
+    assert(error.code == error_none);
+    assert(dict.length == 1005);
+
+    assert(titles_search(&dict, "pineapple", &movieid));
+    assert(movieid == 1);
+    assert(titles_search(&dict, "pine", &movieid));
+    assert(movieid == 3);
+    assert(titles_search(&dict, "pin", &movieid));
+    assert(movieid == 5);
+    assert(titles_search(&dict, "The Movie 19 (500)", &movieid));
+    assert(movieid == 500);
+    assert(!titles_search(&dict, "pi", &movieid));
+    assert(!titles_search(&dict, "pineapples", &movieid));
+    assert(!titles_search(&dict, "The Movie 19 (501)", &movieid));
+    assert(!titles_search(&dict, "zzz", &movieid));
+    assert(!titles_search(&dict, "", &movieid));
+
+    check_prefix(&table, &dict, "", 1005);
+    check_prefix(&table, &dict, "pin", 4);
+    check_prefix(&table, &dict, "pine", 3);
+    check_prefix(&table, &dict, "pinet", 1);
+    check_prefix(&table, &dict, "pineb", 0);
+    check_prefix(&table, &dict, "b", 1);
+    check_prefix(&table, &dict, "a", 0);
+    check_prefix(&table, &dict, "zzz", 0);
+    check_prefix(&table, &dict, "The Movie ", 1000);
+    /* 1 and 10 to 19. */
+    check_prefix(&table, &dict, "The Movie 1", 297);
+    check_prefix(&table, &dict, "The Movie 1 (", 27);
+    check_prefix(&table, &dict, "The Movie 36 (1", 5);
+
+    titles_destroy(&dict);
+    movies_destroy(&table);
+    error_destroy(&error);
+
+    puts("Ok");
+
+    return 0;
+}
@@ -10,10 +10,24 @@
  * Tests trie implementation.
  */
 
+/**
+ * Scores a movie by the remainder of its ID and the given modulo.
+ */
+size_t score_modulo(void const *context, moviedb_id_t movie)
+{
+    return movie % *(size_t const *) context;
+}
+
 int main(int argc, char const *argv[])
 {
     struct error error;
     struct trie_node root;
+    struct trie_iter iter;
+    struct trie_stats stats;
+    moviedb_id_t const *completions;
+    size_t modulo = 100;
+    size_t length;
+    char title[32];
     unsigned long movieid;
 
     error_init(&error);
@@ -22,14 +36,14 @@ int main(int argc, char const *argv[])
 
     assert(!trie_search(&root, "pineapple", &movieid));
 
-    trie_insert(&root, "pineapple", 123, &error);
+    trie_insert(&root, "pineapple", 123, NULL, &error);
     assert(error.code == error_none);
     assert(trie_search(&root, "pineapple", &movieid));
     assert(movieid == 123);
     assert(!trie_search(&root, "pinetree", &movieid));
     assert(!trie_search(&root, "pine", &movieid));
 
-    trie_insert(&root, "pinetree", 456, &error);
+    trie_insert(&root, "pinetree", 456, NULL, &error);
     assert(error.code == error_none);
     assert(trie_search(&root, "pineapple", &movieid));
     assert(movieid == 123);
@@ -37,7 +51,7 @@ int main(int argc, char const *argv[])
     assert(movieid == 456);
     assert(!trie_search(&root, "pine", &movieid));
 
-    trie_insert(&root, "pine", 789, &error);
+    trie_insert(&root, "pine", 789, NULL, &error);
     assert(error.code == error_none);
     assert(trie_search(&root, "pineapple", &movieid));
     assert(movieid == 123);
@@ -48,13 +62,133 @@ int main(int argc, char const *argv[])
 
     assert(!trie_search(&root, "banana", &movieid));
     assert(error.code == error_none);
-    trie_insert(&root, "banana", 104, &error);
+    trie_insert(&root, "banana", 104, NULL, &error);
     assert(trie_search(&root, "banana", &movieid));
     assert(movieid == 104);
     assert(trie_search(&root, "pineapple", &movieid));
     assert(movieid == 123);
 
-    trie_destroy(&root);
+    /* Prefix searches come in the order of the titles. */
+    trie_insert(&root, "pin", 5, NULL, &error);
+    trie_insert(&root, "pineapples", 6, NULL, &error);
+    assert(error.code == error_none);
+
+    trie_iter_init(&iter);
+    trie_search_prefix(&root, "pin", &iter);
+    assert(trie_next_movie(&iter, &movieid, &error) && movieid == 5);
+    assert(trie_next_movie(&iter, &movieid, &error) && movieid == 789);
+    assert(trie_next_movie(&iter, &movieid, &error) && movieid == 123);
+    assert(trie_next_movie(&iter, &movieid, &error) && movieid == 6);
+    assert(trie_next_movie(&iter, &movieid, &error) && movieid == 456);
+    assert(!trie_next_movie(&iter, &movieid, &error));
+    assert(error.code == error_none);
+
+    /* The iterator is reused. */
+    trie_search_prefix(&root, "", &iter);
+    assert(trie_next_movie(&iter, &movieid, &error) && movieid == 104);
+    assert(trie_next_movie(&iter, &movieid, &error) && movieid == 5);
+
+    trie_search_prefix(&root, "pinetree", &iter);
+    assert(trie_next_movie(&iter, &movieid, &error) && movieid == 456);
+    assert(!trie_next_movie(&iter, &movieid, &error));
+
+    trie_search_prefix(&root, "pineb", &iter);
+    assert(!trie_next_movie(&iter, &movieid, &error));
+    assert(error.code == error_none);
+
+    /* Prefixes may end in the middle of a compressed edge. */
+    trie_search_prefix(&root, "pinet", &iter);
+    assert(trie_next_movie(&iter, &movieid, &error) && movieid == 456);
+    assert(!trie_next_movie(&iter, &movieid, &error));
+
+    trie_search_prefix(&root, "ban", &iter);
+    assert(trie_next_movie(&iter, &movieid, &error) && movieid == 104);
+    assert(!trie_next_movie(&iter, &movieid, &error));
+
+    trie_search_prefix(&root, "bananas", &iter);
+    assert(!trie_next_movie(&iter, &movieid, &error));
+    assert(error.code == error_none);
+    trie_iter_destroy(&iter);
+
+    /* Only forks and ends of titles make nodes. */
+    assert(!trie_search(&root, "pi", &movieid));
+    assert(!trie_search(&root, "pinea", &movieid));
+    assert(!trie_search(&root, "bananas", &movieid));
+    trie_stats(&root, &stats, &error);
+    assert(error.code == error_none);
+    assert(stats.nodes == 7);
+
+    /* Completions come best scored first, whatever their titles. */
+    trie_rank(&root, score_modulo, &modulo, NULL, &error);
+    assert(error.code == error_none);
+
+    length = trie_complete(&root, "pin", &completions);
+    assert(length == 5);
+    assert(completions[0] == 789);
+    assert(completions[1] == 456);
+    assert(completions[2] == 123);
+    assert(completions[3] == 6);
+    assert(completions[4] == 5);
+
+    length = trie_complete(&root, "", &completions);
+    assert(length == 6);
+    assert(completions[5] == 104);
+
+    length = trie_complete(&root, "pinet", &completions);
+    assert(length == 1 && completions[0] == 456);
+    assert(trie_complete(&root, "pinex", &completions) == 0);
+
+    /* Only the best ones are kept, and ties are ordered by ID. */
+    for (movieid = 1000; movieid < 1030; movieid++) {
+        sprintf(title, "bulk %lu", movieid);
+        trie_insert(&root, title, movieid, NULL, &error);
+        assert(error.code == error_none);
+    }
+    trie_insert(&root, "bulk tie b", 2000, NULL, &error);
+    trie_insert(&root, "bulk tie a", 3000, NULL, &error);
+    assert(error.code == error_none);
+
+    /* Ranking again replaces the old completions. */
+    trie_rank(&root, score_modulo, &modulo, NULL, &error);
+    assert(error.code == error_none);
+
+    length = trie_complete(&root, "bu", &completions);
+    assert(length == TRIE_COMPLETIONS);
+    for (movieid = 0; movieid < TRIE_COMPLETIONS; movieid++) {
+        assert(completions[movieid] == 1029 - movieid);
+    }
+
+    length = trie_complete(&root, "", &completions);
+    assert(length == TRIE_COMPLETIONS);
+    assert(completions[0] == 789);
+    assert(completions[1] == 456);
+    assert(completions[2] == 1029);
+
+    length = trie_complete(&root, "bulk t", &completions);
+    assert(length == 2);
+    assert(completions[0] == 2000);
+    assert(completions[1] == 3000);
+
+    trie_destroy(&root, NULL);
+
+    /* Keys are unsigned bytes, so UTF-8 comes after ASCII, as in strcmp. */
+    trie_root_init(&root);
+    trie_insert(&root, "Am\xc3\xa9lie", 1, NULL, &error);
+    trie_insert(&root, "Amz", 2, NULL, &error);
+    trie_insert(&root, "Ama", 3, NULL, &error);
+    assert(error.code == error_none);
+    assert(strcmp("Amz", "Am\xc3\xa9lie") < 0);
+
+    trie_search_prefix(&root, "Am", &iter);
+    assert(trie_next_movie(&iter, &movieid, &error) && movieid == 3);
+    assert(trie_next_movie(&iter, &movieid, &error) && movieid == 2);
+    assert(trie_next_movie(&iter, &movieid, &error) && movieid == 1);
+    assert(!trie_next_movie(&iter, &movieid, &error));
+    assert(error.code == error_none);
+    assert(trie_search(&root, "Am\xc3\xa9lie", &movieid) && movieid == 1);
+    trie_iter_destroy(&iter);
+
+    trie_destroy(&root, NULL);
     error_destroy(&error);
 
     puts("Ok");
@@ -7,6 +7,7 @@
 #include "../alloc.h"
 #include "../users.h"
 #include "../error.h"
+#include "capacity.h"
 
 /** 
  * Tests users hash table implementation.
@@ -18,21 +19,29 @@ int main(int argc, char const *argv[])
     struct rating_csv_row rating;
     struct user const *user;
     struct users_table table;
+    struct users_iter iter;
+    struct user_rating const *ratings;
+    size_t length;
+    size_t capacity;
 
     error_init(&error);
 
     users_init(&table, 5, &error);
     assert(error.code == error_none);
     assert(table.length == 0);
-    assert(table.capacity == 5);
+    capacity = moviedb_hash_capacity(5);
+    assert(table.capacity == capacity);
 
     rating.userid = 123;
     rating.value = 3.5;
     rating.movieid = 101;
-    users_insert_rating(&table, &rating, &error);
+    /* 2000-01-01, i.e. month 360. */
+    rating.timestamp = 946684800;
+    users_insert_rating(&table, &rating, rating.movieid, &error);
     assert(error.code == error_none);
     assert(table.length == 1);
-    assert(table.capacity == 5);
+    capacity = expected_capacity(capacity, 0);
+    assert(table.capacity == capacity);
 
     user = users_search(&table, 123);
     assert(user != NULL);
@@ -41,18 +50,20 @@ int main(int argc, char const *argv[])
     rating.userid = 456;
     rating.value = 4.0;
     rating.movieid = 201;
-    users_insert_rating(&table, &rating, &error);
+    users_insert_rating(&table, &rating, rating.movieid, &error);
     assert(error.code == error_none);
     assert(table.length == 2);
-    assert(table.capacity == 5);
+    capacity = expected_capacity(capacity, 1);
+    assert(table.capacity == capacity);
 
     rating.userid = 789;
     rating.value = 5.0;
     rating.movieid = 101;
-    users_insert_rating(&table, &rating, &error);
+    users_insert_rating(&table, &rating, rating.movieid, &error);
     assert(error.code == error_none);
     assert(table.length == 3);
-    assert(table.capacity == 11);
+    capacity = expected_capacity(capacity, 2);
+    assert(table.capacity == capacity);
 
     user = users_search(&table, 123);
     assert(user != NULL);
@@ -62,39 +73,123 @@ int main(int argc, char const *argv[])
     assert(user != NULL);
     assert(user->id == 456);
 
+    /* Ratings of users already in the table never resize it. */
     rating.userid = 123;
     rating.value = 4.0;
     rating.movieid = 201;
-    users_insert_rating(&table, &rating, &error);
+    users_insert_rating(&table, &rating, rating.movieid, &error);
     assert(error.code == error_none);
     assert(table.length == 3);
-    assert(table.capacity == 11);
+    assert(table.capacity == capacity);
 
     rating.userid = 123;
     rating.value = 2.5;
     rating.movieid = 301;
-    users_insert_rating(&table, &rating, &error);
+    /* 2010-01-01, i.e. month 480. */
+    rating.timestamp = 1262304000;
+    users_insert_rating(&table, &rating, rating.movieid, &error);
     assert(error.code == error_none);
     assert(table.length == 3);
-    assert(table.capacity == 11);
+    assert(table.capacity == capacity);
 
     user = users_search(&table, 456);
     assert(user != NULL);
     assert(user->id == 456);
     assert(user->ratings.length == 1);
     assert(user->ratings.entries[0].movie == 201);
-    assert(fabs(user->ratings.entries[0].value - 4.0) < 0.000001);
+    assert(rating_decode(user->ratings.entries[0].code) == 4.0);
 
     user = users_search(&table, 123);
     assert(user != NULL);
     assert(user->id == 123);
     assert(user->ratings.length == 3);
     assert(user->ratings.entries[0].movie == 101);
-    assert(fabs(user->ratings.entries[0].value - 3.5) < 0.000001);
+    assert(rating_decode(user->ratings.entries[0].code) == 3.5);
+    assert(user->ratings.entries[0].month == 360);
     assert(user->ratings.entries[1].movie == 201);
-    assert(fabs(user->ratings.entries[1].value - 4.0) < 0.000001);
+    assert(rating_decode(user->ratings.entries[1].code) == 4.0);
     assert(user->ratings.entries[2].movie == 301);
-    assert(fabs(user->ratings.entries[2].value - 2.5) < 0.000001);
+    assert(rating_decode(user->ratings.entries[2].code) == 2.5);
+    assert(user->ratings.entries[2].month == 480);
+
+    /* Users are iterated in the order they were inserted. */
+    users_iter(&table, &iter);
+    assert(users_next(&iter)->id == 123);
+    assert(users_next(&iter)->id == 456);
+    assert(users_next(&iter)->id == 789);
+    assert(users_next(&iter) == NULL);
+
+    /* Reserving keeps the entries, and avoids resizes up to that many. */
+    users_reserve(&table, 100, &error);
+    assert(error.code == error_none);
+    assert(table.length == 3);
+    assert(table.capacity > 200);
+    capacity = table.capacity;
+
+    user = users_search(&table, 123);
+    assert(user != NULL);
+    assert(user->ratings.length == 3);
+
+    rating.movieid = 101;
+    for (rating.userid = 1000; rating.userid < 1097; rating.userid++) {
+        users_insert_rating(&table, &rating, rating.movieid, &error);
+        assert(error.code == error_none);
+    }
+    assert(table.length == 100);
+    assert(table.capacity == capacity);
+
+    /* Reserving less than there is room for does nothing. */
+    users_reserve(&table, 10, &error);
+    assert(error.code == error_none);
+    assert(table.capacity == capacity);
+
+    /* Sealing packs the ratings, sorted by movie within each user. */
+    rating.userid = 456;
+    rating.value = 1.0;
+    users_insert_rating(&table, &rating, 7, &error);
+    rating.value = 2.0;
+    users_insert_rating(&table, &rating, 300, &error);
+    assert(error.code == error_none);
+
+    users_seal(&table, &error);
+    assert(error.code == error_none);
+    assert(table.offsets[table.length] == 3 + 3 + 1 + 97);
+
+    user = users_search(&table, 456);
+    ratings = users_ratings(&table, user, &length);
+    assert(length == 3);
+    assert(ratings[0].movie == 7);
+    assert(rating_decode(ratings[0].code) == 1.0);
+    assert(ratings[1].movie == 201);
+    assert(ratings[2].movie == 300);
+
+    user = users_search(&table, 123);
+    ratings = users_ratings(&table, user, &length);
+    assert(length == 3);
+    assert(ratings == table.ratings);
+    assert(ratings[0].movie == 101);
+    assert(ratings[2].movie == 301);
+    assert(user->ratings.entries == NULL);
+
+    /* Sealing again does nothing. */
+    users_seal(&table, &error);
+    assert(error.code == error_none);
+    user = users_search(&table, 1096);
+    ratings = users_ratings(&table, user, &length);
+    assert(length == 1);
+    assert(ratings[0].movie == 101);
+
+    /* Ratings are packed, and whole half stars survive their encoding. */
+    assert(sizeof(struct user_rating) == 7);
+    assert(!rating_is_valid(0.0));
+    assert(rating_is_valid(0.5));
+    assert(rating_is_valid(5.0));
+    assert(!rating_is_valid(-0.5));
+    assert(!rating_is_valid(3.25));
+    assert(!rating_is_valid(5.5));
+    assert(!rating_is_valid(NAN));
+    assert(rating_decode(rating_encode(3.5)) == 3.5);
+    assert(rating_encode(5.0) == RATING_CODES - 1);
 
     users_destroy(&table);
     error_destroy(&error);
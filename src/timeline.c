@@ -0,0 +1,300 @@
+#include <string.h>
+#include "alloc.h"
+#include "timeline.h"
+
+/**
+ * Seconds in a day.
+ */
+#define DAY_SECONDS 86400
+
+/**
+ * How many months there can be, i.e. the size of the buffer months are summed
+ * in.
+ */
+#define MONTHS (UINT16_MAX + 1)
+
+/**
+ * A rating grouped by movie while building the index.
+ */
+struct timeline_rating {
+    /**
+     * Month the rating was made in.
+     */
+    uint16_t month;
+    /**
+     * The rating, counted in steps of RATING_STEPS per star.
+     */
+    uint8_t steps;
+} __attribute__((packed));
+
+/**
+ * Sums the given ratings of a movie by month into the given buffer, which must
+ * be all zeros, and leaves it all zeros again. Returns how many months have
+ * ratings. If months_out is not NULL, these months are written into it in
+ * order, each holding the totals from it on.
+ */
+static size_t sum_months(
+        struct timeline_rating const *restrict ratings,
+        size_t length,
+        struct timeline_month *restrict totals,
+        struct timeline_month *restrict months_out);
+
+/**
+ * Frees the memory of the index and empties it.
+ */
+static void clear(struct timeline_index *restrict index);
+
+extern inline struct timeline_month const *timeline_index_movie(
+        struct timeline_index const *restrict index,
+        moviedb_index_t movie,
+        size_t *restrict length_out);
+
+uint16_t timeline_month(uint32_t timestamp)
+{
+    /*
+     * Converts days since the epoch to a civil date, in a calendar whose years
+     * start in March, so leap days are at the end of a year. Eras are the 400
+     * years after which the Gregorian calendar repeats.
+     */
+    unsigned long days = timestamp / DAY_SECONDS + 719468;
+    unsigned long era = days / 146097;
+    unsigned long day_of_era = days - era * 146097;
+    unsigned long year_of_era = (day_of_era
+            - day_of_era / 1460
+            + day_of_era / 36524
+            - day_of_era / 146096) / 365;
+    unsigned long day_of_year = day_of_era
+        - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    /* Month from March, and then from January, counted from 0. */
+    unsigned long month = (5 * day_of_year + 2) / 153;
+    unsigned long year = era * 400 + year_of_era;
+
+    if (month < 10) {
+        month += 2;
+    } else {
+        month -= 10;
+        year++;
+    }
+
+    return (year - TIMELINE_EPOCH_YEAR) * 12 + month;
+}
+
+void timeline_index_init(struct timeline_index *restrict index)
+{
+    index->months = NULL;
+    index->offsets = NULL;
+    index->length = 0;
+}
+
+void timeline_index_build(
+        struct timeline_index *restrict index,
+        struct users_table const *restrict users,
+        size_t movies,
+        struct error *restrict error)
+{
+    struct users_iter iter;
+    struct user const *user;
+    struct user_rating const *ratings;
+    struct timeline_rating *grouped = NULL;
+    struct timeline_month *totals = NULL;
+    size_t *starts;
+    size_t length;
+    size_t i;
+    size_t total;
+
+    clear(index);
+
+    starts = moviedb_alloc(sizeof(*starts), movies + 1, error);
+
+    if (error->code == error_none) {
+        memset(starts, 0, sizeof(*starts) * (movies + 1));
+
+        /* Counts the ratings of each movie, one position ahead. */
+        users_iter(users, &iter);
+        while ((user = users_next(&iter)) != NULL) {
+            ratings = users_ratings(users, user, &length);
+            for (i = 0; i < length; i++) {
+                starts[ratings[i].movie + 1]++;
+            }
+        }
+
+        /* Turns the counts into the position where each movie starts. */
+        for (i = 0; i < movies; i++) {
+            starts[i + 1] += starts[i];
+        }
+
+        grouped = moviedb_alloc(sizeof(*grouped), starts[movies], error);
+    }
+
+    if (error->code == error_none) {
+        /*
+         * Places each rating at the next free position of its movie, using
+         * the start of the next movie as the cursor. A code is one step less
+         * than the rating in steps.
+         */
+        users_iter(users, &iter);
+        while ((user = users_next(&iter)) != NULL) {
+            ratings = users_ratings(users, user, &length);
+            for (i = 0; i < length; i++) {
+                grouped[starts[ratings[i].movie]].month = ratings[i].month;
+                grouped[starts[ratings[i].movie]].steps = ratings[i].code + 1;
+                starts[ratings[i].movie]++;
+            }
+        }
+
+        /* Each start now is the end of its movie, so shifts them back. */
+        for (i = movies; i > 0; i--) {
+            starts[i] = starts[i - 1];
+        }
+        starts[0] = 0;
+
+        totals = moviedb_alloc(sizeof(*totals), MONTHS, error);
+    }
+
+    if (error->code == error_none) {
+        memset(totals, 0, sizeof(*totals) * MONTHS);
+        index->offsets = moviedb_alloc(
+                sizeof(*index->offsets),
+                movies + 1,
+                error);
+    }
+
+    if (error->code == error_none) {
+        /* Counts the months of each movie before placing them. */
+        total = 0;
+        for (i = 0; i < movies; i++) {
+            index->offsets[i] = total;
+            total += sum_months(
+                    grouped + starts[i],
+                    starts[i + 1] - starts[i],
+                    totals,
+                    NULL);
+        }
+        index->offsets[movies] = total;
+        index->length = movies;
+
+        index->months = moviedb_alloc(sizeof(*index->months), total, error);
+    }
+
+    if (error->code == error_none) {
+        for (i = 0; i < movies; i++) {
+            sum_months(
+                    grouped + starts[i],
+                    starts[i + 1] - starts[i],
+                    totals,
+                    index->months + index->offsets[i]);
+        }
+    }
+
+    moviedb_free(starts);
+    moviedb_free(grouped);
+    moviedb_free(totals);
+
+    if (error->code != error_none) {
+        clear(index);
+    }
+}
+
+struct timeline_month const *timeline_index_since(
+        struct timeline_index const *restrict index,
+        moviedb_index_t movie,
+        unsigned long month)
+{
+    struct timeline_month const *months;
+    struct timeline_month const *found = NULL;
+    size_t length;
+    size_t low = 0;
+    size_t high;
+    size_t middle;
+
+    months = timeline_index_movie(index, movie, &length);
+    high = length;
+
+    /* Binary searches the first month not before the given one. */
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        if (months[middle].month < month) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    if (low < length) {
+        found = &months[low];
+    }
+
+    return found;
+}
+
+size_t timeline_index_bytes(struct timeline_index const *restrict index)
+{
+    size_t bytes = 0;
+
+    if (index->offsets != NULL) {
+        bytes = (index->length + 1) * sizeof(*index->offsets)
+            + index->offsets[index->length] * sizeof(*index->months);
+    }
+
+    return bytes;
+}
+
+void timeline_index_destroy(struct timeline_index *restrict index)
+{
+    clear(index);
+}
+
+static size_t sum_months(
+        struct timeline_rating const *restrict ratings,
+        size_t length,
+        struct timeline_month *restrict totals,
+        struct timeline_month *restrict months_out)
+{
+    size_t count = 0;
+    size_t first = MONTHS;
+    size_t last = 0;
+    size_t i;
+
+    for (i = 0; i < length; i++) {
+        totals[ratings[i].month].ratings++;
+        totals[ratings[i].month].steps += ratings[i].steps;
+        if (ratings[i].month < first) {
+            first = ratings[i].month;
+        }
+        if (ratings[i].month > last) {
+            last = ratings[i].month;
+        }
+    }
+
+    /* Only the span of months the movie was rated in needs a visit. */
+    for (i = first; i <= last; i++) {
+        if (totals[i].ratings > 0) {
+            if (months_out != NULL) {
+                months_out[count] = totals[i];
+                months_out[count].month = i;
+            }
+            count++;
+            totals[i].ratings = 0;
+            totals[i].steps = 0;
+        }
+    }
+
+    /* Each month accumulates the months after it. */
+    if (months_out != NULL) {
+        for (i = count; i > 1; i--) {
+            months_out[i - 2].ratings += months_out[i - 1].ratings;
+            months_out[i - 2].steps += months_out[i - 1].steps;
+        }
+    }
+
+    return count;
+}
+
+static void clear(struct timeline_index *restrict index)
+{
+    moviedb_free(index->months);
+    moviedb_free(index->offsets);
+    index->months = NULL;
+    index->offsets = NULL;
+    index->length = 0;
+}
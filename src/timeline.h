@@ -0,0 +1,122 @@
+#ifndef MOVIEDB_TIMELINE_H
+#define MOVIEDB_TIMELINE_H 1
+
+#include <stdint.h>
+#include "error.h"
+#include "id.h"
+#include "users.h"
+
+/**
+ * This file exports the timeline index, which aggregates the ratings of every
+ * movie by the month they were made in, so queries over a window of time do
+ * not need to read the ratings. Only the months with ratings are kept, packed
+ * in compressed sparse row form, and each month holds the totals from that
+ * month on, so the ratings since any month are found with a binary search.
+ */
+
+/**
+ * Year months are counted from, i.e. the year of the Unix epoch.
+ */
+#define TIMELINE_EPOCH_YEAR 1970
+
+/**
+ * Ratings of a movie from a month on.
+ */
+struct timeline_month {
+    /**
+     * How many ratings were made.
+     */
+    uint32_t ratings;
+    /**
+     * Sum of the ratings, counted in steps of RATING_STEPS per star.
+     */
+    uint32_t steps;
+    /**
+     * The month, counted from January of TIMELINE_EPOCH_YEAR.
+     */
+    uint16_t month;
+};
+
+/**
+ * The timeline index of every movie.
+ */
+struct timeline_index {
+    /**
+     * Months of all movies, grouped by movie in index order, and sorted by
+     * month within a movie. Only internal timeline index code is allowed to
+     * touch this.
+     */
+    struct timeline_month *months;
+    /**
+     * Offsets of the months of each movie into the packed months, plus the
+     * total number of months at the end, so the months of the movie with
+     * index i go from offsets[i] to offsets[i + 1]. Only internal timeline
+     * index code is allowed to touch this.
+     */
+    size_t *offsets;
+    /**
+     * How many movies there are. Reading is fine, only internal timeline index
+     * code is allowed to update this.
+     */
+    size_t length;
+};
+
+/**
+ * Returns the month of the given Unix timestamp, in UTC, counted from January
+ * of TIMELINE_EPOCH_YEAR. Every 32-bit timestamp has a month that fits.
+ */
+uint16_t timeline_month(uint32_t timestamp);
+
+/**
+ * Initializes an empty index. No memory is allocated until it is built.
+ */
+void timeline_index_init(struct timeline_index *restrict index);
+
+/**
+ * Builds the index from the ratings of the given users table, for the given
+ * number of movies, which must be more than the index of every rated movie.
+ * Any previous contents of the index are freed. The ratings are first grouped
+ * by movie with a counting sort, so the months of each movie are then summed
+ * in a small buffer rather than all over memory.
+ */
+void timeline_index_build(
+        struct timeline_index *restrict index,
+        struct users_table const *restrict users,
+        size_t movies,
+        struct error *restrict error);
+
+/**
+ * Returns the months of the movie with the given index, placing how many there
+ * are in length_out. Each month holds the totals from that month on. The index
+ * must be built, and the movie must be below its length.
+ */
+inline struct timeline_month const *timeline_index_movie(
+        struct timeline_index const *restrict index,
+        moviedb_index_t movie,
+        size_t *restrict length_out)
+{
+    *length_out = index->offsets[movie + 1] - index->offsets[movie];
+    return index->months + index->offsets[movie];
+}
+
+/**
+ * Finds the totals of the ratings of the movie with the given index made in
+ * the given month or after it. Returns NULL if there is none. The index must
+ * be built, and the movie must be below its length.
+ */
+struct timeline_month const *timeline_index_since(
+        struct timeline_index const *restrict index,
+        moviedb_index_t movie,
+        unsigned long month);
+
+/**
+ * Returns how many bytes the index takes.
+ */
+size_t timeline_index_bytes(struct timeline_index const *restrict index);
+
+/**
+ * Destroys the index, freeing all memory.
+ */
+void timeline_index_destroy(struct timeline_index *restrict index);
+
+#endif
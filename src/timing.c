@@ -0,0 +1,3 @@
+#include "timing.h"
+
+extern inline double timing_now(void);
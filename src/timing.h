@@ -0,0 +1,23 @@
+#ifndef MOVIEDB_TIMING_H
+#define MOVIEDB_TIMING_H 1
+
+#include <time.h>
+
+/**
+ * This file provides utilities to measure elapsed (wall-clock) time.
+ */
+
+/**
+ * Returns the current time of a monotonic clock, in seconds. Only the
+ * difference between two returned values is meaningful.
+ */
+inline double timing_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+#endif
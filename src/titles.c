@@ -0,0 +1,501 @@
+#include <stdlib.h>
+#include <string.h>
+#include "alloc.h"
+#include "titles.h"
+
+/**
+ * A title being sealed.
+ */
+struct titles_entry {
+    /**
+     * The title, owned by the movies table.
+     */
+    char const *title;
+    /**
+     * The movie ID.
+     */
+    moviedb_id_t movie;
+    /**
+     * Position in which the movie was added, to keep the first one of a title.
+     */
+    size_t order;
+};
+
+/**
+ * Frees the sealed titles and empties the dictionary, keeping the movies added
+ * but not sealed.
+ */
+static void clear(struct titles_dict *restrict dict);
+
+/**
+ * Compares two entries: by title, and then by the order they were added.
+ */
+static int compare_entries(void const *left_ptr, void const *right_ptr);
+
+/**
+ * Length of the prefix shared by two strings, capped to TITLES_SHARED_MAX.
+ */
+static size_t shared_prefix(char const *left, char const *right);
+
+/**
+ * Front-codes the given sorted entries, skipping duplicated titles.
+ */
+static void encode(
+        struct titles_dict *restrict dict,
+        struct titles_entry const *restrict entries,
+        size_t length,
+        struct error *restrict error);
+
+/**
+ * Finds the first rank whose title, truncated to the given length, compares
+ * greater than the key (if after is true), or greater or equal to it (if after
+ * is false).
+ */
+static size_t find_rank(
+        struct titles_dict const *restrict dict,
+        char const *restrict key,
+        size_t length,
+        bool after);
+
+/**
+ * Compares a title, truncated to the given length, with the key. The title is
+ * given as the suffix following the first shared bytes, known to be equal to
+ * the key's as long as shared <= *matched. matched is updated to how many bytes
+ * of the title match the key.
+ */
+static int compare_title(
+        char const *restrict suffix,
+        size_t shared,
+        char const *restrict key,
+        size_t length,
+        size_t *restrict matched);
+
+/**
+ * Tests whether the given comparison result is past the searched rank.
+ */
+static inline bool is_past(int order, bool after);
+
+extern inline moviedb_id_t titles_movie(
+        struct titles_dict const *restrict dict,
+        size_t rank);
+
+void titles_init(struct titles_dict *restrict dict)
+{
+    dict->pending = NULL;
+    dict->pending_length = 0;
+    dict->pending_capacity = 0;
+    dict->bytes = NULL;
+    dict->bytes_length = 0;
+    dict->buckets = NULL;
+    dict->buckets_length = 0;
+    dict->movies = NULL;
+    dict->length = 0;
+}
+
+void titles_add(
+        struct titles_dict *restrict dict,
+        moviedb_id_t movie,
+        struct error *restrict error)
+{
+    size_t new_cap;
+    moviedb_id_t *new_pending;
+
+    if (dict->pending_length == dict->pending_capacity) {
+        /* Doubles capacity, handles the case where capacity == 0. */
+        new_cap = dict->pending_capacity * 2;
+        if (new_cap == 0) {
+            new_cap = 64;
+        }
+
+        new_pending = moviedb_realloc(
+                dict->pending,
+                sizeof(*new_pending),
+                new_cap,
+                error);
+
+        if (error->code == error_none) {
+            dict->pending = new_pending;
+            dict->pending_capacity = new_cap;
+        }
+    }
+
+    if (error->code == error_none) {
+        dict->pending[dict->pending_length] = movie;
+        dict->pending_length++;
+    }
+}
+
+void titles_seal(
+        struct titles_dict *restrict dict,
+        struct movies_table const *restrict movies,
+        struct error *restrict error)
+{
+    struct titles_entry *entries;
+    struct movie const *movie;
+    size_t length = 0;
+    size_t i;
+
+    clear(dict);
+
+    entries = moviedb_alloc(sizeof(*entries), dict->pending_length, error);
+
+    if (error->code == error_none) {
+        for (i = 0; i < dict->pending_length; i++) {
+            movie = movies_search(movies, dict->pending[i]);
+            if (movie != NULL) {
+                entries[length].title = movie->title;
+                entries[length].movie = movie->id;
+                entries[length].order = i;
+                length++;
+            }
+        }
+
+        qsort(entries, length, sizeof(*entries), compare_entries);
+        encode(dict, entries, length, error);
+    }
+
+    if (error->code == error_none) {
+        /* The titles are only added while loading. */
+        moviedb_free(dict->pending);
+        dict->pending = NULL;
+        dict->pending_length = 0;
+        dict->pending_capacity = 0;
+    }
+
+    moviedb_free(entries);
+}
+
+void titles_flat(
+        struct titles_dict const *restrict dict,
+        struct titles_flat *restrict flat_out)
+{
+    flat_out->bytes = dict->bytes;
+    flat_out->bytes_length = dict->bytes_length;
+    flat_out->buckets = dict->buckets;
+    flat_out->movies = dict->movies;
+    flat_out->length = dict->length;
+}
+
+bool titles_flat_valid(struct titles_flat const *restrict flat)
+{
+    size_t rank;
+    size_t position = 0;
+    char const *end;
+    bool valid = true;
+
+    /* Walks every title as find_rank would, within the bytes. */
+    for (rank = 0; valid && rank < flat->length; rank++) {
+        if (rank % TITLES_BUCKET == 0) {
+            valid = flat->buckets[rank / TITLES_BUCKET] == position;
+        } else {
+            /* The byte with the length of the shared prefix. */
+            valid = position < flat->bytes_length;
+            position++;
+        }
+
+        if (valid) {
+            end = memchr(
+                    flat->bytes + position,
+                    0,
+                    flat->bytes_length - position);
+            valid = end != NULL;
+        }
+
+        if (valid) {
+            position = end - flat->bytes + 1;
+        }
+    }
+
+    return valid && position == flat->bytes_length;
+}
+
+void titles_restore(
+        struct titles_dict *restrict dict,
+        struct titles_flat const *restrict flat,
+        struct error *restrict error)
+{
+    size_t buckets_length = (flat->length + TITLES_BUCKET - 1) / TITLES_BUCKET;
+
+    clear(dict);
+
+    dict->movies = moviedb_alloc(sizeof(*dict->movies), flat->length, error);
+    if (error->code == error_none) {
+        dict->buckets = moviedb_alloc(
+                sizeof(*dict->buckets),
+                buckets_length,
+                error);
+    }
+    if (error->code == error_none) {
+        dict->bytes = moviedb_alloc(
+                sizeof(*dict->bytes),
+                flat->bytes_length,
+                error);
+    }
+
+    if (error->code == error_none) {
+        memcpy(dict->movies,
+                flat->movies,
+                sizeof(*flat->movies) * flat->length);
+        memcpy(dict->buckets,
+                flat->buckets,
+                sizeof(*flat->buckets) * buckets_length);
+        memcpy(dict->bytes, flat->bytes, flat->bytes_length);
+        dict->length = flat->length;
+        dict->buckets_length = buckets_length;
+        dict->bytes_length = flat->bytes_length;
+    } else {
+        clear(dict);
+    }
+}
+
+bool titles_search(
+        struct titles_dict const *restrict dict,
+        char const *restrict title,
+        moviedb_id_t *restrict movie_out)
+{
+    /* Including the NUL byte, so only the whole title matches. */
+    size_t length = strlen(title) + 1;
+    size_t rank = find_rank(dict, title, length, false);
+    bool found = rank < find_rank(dict, title, length, true);
+
+    if (found && movie_out != NULL) {
+        *movie_out = dict->movies[rank];
+    }
+
+    return found;
+}
+
+void titles_search_prefix(
+        struct titles_dict const *restrict dict,
+        char const *restrict prefix,
+        struct titles_range *restrict range_out)
+{
+    size_t length = strlen(prefix);
+
+    range_out->start = find_rank(dict, prefix, length, false);
+    range_out->end = find_rank(dict, prefix, length, true);
+}
+
+size_t titles_bytes(struct titles_dict const *restrict dict)
+{
+    return dict->bytes_length
+        + dict->buckets_length * sizeof(*dict->buckets)
+        + dict->length * sizeof(*dict->movies);
+}
+
+void titles_destroy(struct titles_dict *restrict dict)
+{
+    clear(dict);
+    moviedb_free(dict->pending);
+    dict->pending = NULL;
+    dict->pending_length = 0;
+    dict->pending_capacity = 0;
+}
+
+static void clear(struct titles_dict *restrict dict)
+{
+    moviedb_free(dict->bytes);
+    moviedb_free(dict->buckets);
+    moviedb_free(dict->movies);
+    dict->bytes = NULL;
+    dict->bytes_length = 0;
+    dict->buckets = NULL;
+    dict->buckets_length = 0;
+    dict->movies = NULL;
+    dict->length = 0;
+}
+
+static int compare_entries(void const *left_ptr, void const *right_ptr)
+{
+    struct titles_entry const *left = left_ptr;
+    struct titles_entry const *right = right_ptr;
+    int order = strcmp(left->title, right->title);
+
+    if (order == 0) {
+        order = (left->order > right->order) - (left->order < right->order);
+    }
+
+    return order;
+}
+
+static size_t shared_prefix(char const *left, char const *right)
+{
+    size_t shared = 0;
+
+    while (shared < TITLES_SHARED_MAX
+            && left[shared] != 0
+            && left[shared] == right[shared]) {
+        shared++;
+    }
+
+    return shared;
+}
+
+static void encode(
+        struct titles_dict *restrict dict,
+        struct titles_entry const *restrict entries,
+        size_t length,
+        struct error *restrict error)
+{
+    size_t i;
+    size_t kept = 0;
+    size_t bytes_length = 0;
+    size_t shared;
+    size_t suffix_length;
+    char const *previous = NULL;
+
+    /* Counts the titles kept and their bytes first, to allocate once. */
+    for (i = 0; i < length; i++) {
+        if (previous == NULL || strcmp(previous, entries[i].title) != 0) {
+            shared = 0;
+            if (kept % TITLES_BUCKET != 0) {
+                /* The byte with the length of the shared prefix. */
+                shared = shared_prefix(previous, entries[i].title);
+                bytes_length++;
+            }
+            bytes_length += strlen(entries[i].title + shared) + 1;
+            previous = entries[i].title;
+            kept++;
+        }
+    }
+
+    dict->movies = moviedb_alloc(sizeof(*dict->movies), kept, error);
+    if (error->code == error_none) {
+        dict->buckets = moviedb_alloc(
+                sizeof(*dict->buckets),
+                (kept + TITLES_BUCKET - 1) / TITLES_BUCKET,
+                error);
+    }
+    if (error->code == error_none) {
+        dict->bytes = moviedb_alloc(sizeof(*dict->bytes), bytes_length, error);
+    }
+
+    previous = NULL;
+    for (i = 0; i < length && error->code == error_none; i++) {
+        if (previous == NULL || strcmp(previous, entries[i].title) != 0) {
+            shared = 0;
+            if (dict->length % TITLES_BUCKET == 0) {
+                dict->buckets[dict->buckets_length] = dict->bytes_length;
+                dict->buckets_length++;
+            } else {
+                shared = shared_prefix(previous, entries[i].title);
+                dict->bytes[dict->bytes_length] = shared;
+                dict->bytes_length++;
+            }
+
+            suffix_length = strlen(entries[i].title + shared) + 1;
+            memcpy(dict->bytes + dict->bytes_length,
+                    entries[i].title + shared,
+                    suffix_length);
+            dict->bytes_length += suffix_length;
+
+            dict->movies[dict->length] = entries[i].movie;
+            dict->length++;
+            previous = entries[i].title;
+        }
+    }
+
+    if (error->code != error_none) {
+        clear(dict);
+    }
+}
+
+static size_t find_rank(
+        struct titles_dict const *restrict dict,
+        char const *restrict key,
+        size_t length,
+        bool after)
+{
+    size_t low = 0;
+    size_t high = dict->buckets_length;
+    size_t middle;
+    size_t rank = 0;
+    size_t end;
+    size_t matched = 0;
+    size_t shared = 0;
+    char const *cursor;
+    int order = 0;
+    bool past = false;
+
+    /* Binary searches the first bucket whose first title is past the rank. */
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        matched = 0;
+        order = compare_title(
+                dict->bytes + dict->buckets[middle],
+                0,
+                key,
+                length,
+                &matched);
+        if (is_past(order, after)) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+
+    if (low > 0) {
+        /* The rank is in the previous bucket, or it is the first of this. */
+        rank = (low - 1) * TITLES_BUCKET;
+        end = rank + TITLES_BUCKET;
+        if (end > dict->length) {
+            end = dict->length;
+        }
+        cursor = dict->bytes + dict->buckets[low - 1];
+        matched = 0;
+
+        while (rank < end && !past) {
+            if (rank % TITLES_BUCKET != 0) {
+                shared = (unsigned char) *cursor;
+                cursor++;
+            }
+
+            /*
+             * A title sharing more than what the previous one matched differs
+             * from the key where the previous one did.
+             */
+            if (shared <= matched) {
+                order = compare_title(cursor, shared, key, length, &matched);
+            }
+
+            past = is_past(order, after);
+            if (!past) {
+                cursor += strlen(cursor) + 1;
+                rank++;
+            }
+        }
+    }
+
+    return rank;
+}
+
+static int compare_title(
+        char const *restrict suffix,
+        size_t shared,
+        char const *restrict key,
+        size_t length,
+        size_t *restrict matched)
+{
+    size_t i = shared;
+    int order = 0;
+
+    /* The key has no NUL byte before length - 1, so this stops at the end. */
+    while (i < length && suffix[i - shared] == key[i]) {
+        i++;
+    }
+
+    if (i < length) {
+        order = (unsigned char) suffix[i - shared] < (unsigned char) key[i]
+            ? -1
+            : 1;
+    }
+
+    *matched = i;
+
+    return order;
+}
+
+static inline bool is_past(int order, bool after)
+{
+    return after ? order > 0 : order >= 0;
+}
@@ -0,0 +1,208 @@
+#ifndef MOVIEDB_TITLES_H
+#define MOVIEDB_TITLES_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "error.h"
+#include "movies.h"
+
+/**
+ * This file exports a read-only dictionary of movie titles, an alternative to
+ * the title trie. Titles are sorted and front-coded in buckets: the first title
+ * of a bucket is stored whole, and each of the others as the length of the
+ * prefix shared with the previous title, followed by the rest of it. The first
+ * titles of the buckets are a sampled index, binary searched before a bucket is
+ * scanned, so titles with a prefix make a contiguous range of ranks.
+ */
+
+/**
+ * How many titles a bucket has.
+ */
+#define TITLES_BUCKET 16
+
+/**
+ * Longest prefix shared with the previous title that is stored, so the length
+ * fits in a byte.
+ */
+#define TITLES_SHARED_MAX 255
+
+/**
+ * A dictionary mapping titles to movie IDs.
+ */
+struct titles_dict {
+    /**
+     * IDs of the movies added, but not sealed yet. Only internal titles code
+     * is allowed to touch this.
+     */
+    moviedb_id_t *pending;
+    /**
+     * How many movies were added. Only internal titles code is allowed to
+     * touch this.
+     */
+    size_t pending_length;
+    /**
+     * How many added movies can be stored. Only internal titles code is
+     * allowed to touch this.
+     */
+    size_t pending_capacity;
+    /**
+     * The front-coded buckets. Only internal titles code is allowed to touch
+     * this.
+     */
+    char *bytes;
+    /**
+     * How many bytes the buckets take. Only internal titles code is allowed to
+     * touch this.
+     */
+    size_t bytes_length;
+    /**
+     * Offset of each bucket in the bytes. Only internal titles code is allowed
+     * to touch this.
+     */
+    size_t *buckets;
+    /**
+     * How many buckets there are. Only internal titles code is allowed to touch
+     * this.
+     */
+    size_t buckets_length;
+    /**
+     * Movie IDs, by rank of their titles. Only internal titles code is allowed
+     * to touch this.
+     */
+    moviedb_id_t *movies;
+    /**
+     * How many titles there are. Reading is fine, only internal titles code is
+     * allowed to update this.
+     */
+    size_t length;
+};
+
+/**
+ * A range of ranks of titles, from start (inclusive) to end (exclusive).
+ */
+struct titles_range {
+    /**
+     * Rank of the first title in the range.
+     */
+    size_t start;
+    /**
+     * Rank after the last title in the range.
+     */
+    size_t end;
+};
+
+/**
+ * The arrays of a sealed dictionary, e.g. to write them into a snapshot and to
+ * restore them from it.
+ */
+struct titles_flat {
+    /**
+     * The front-coded buckets.
+     */
+    char const *bytes;
+    /**
+     * How many bytes the buckets take.
+     */
+    size_t bytes_length;
+    /**
+     * Offset of each bucket in the bytes, one for every TITLES_BUCKET titles.
+     */
+    size_t const *buckets;
+    /**
+     * Movie IDs, by rank of their titles.
+     */
+    moviedb_id_t const *movies;
+    /**
+     * How many titles there are.
+     */
+    size_t length;
+};
+
+/**
+ * Initializes an empty dictionary. No memory is allocated until a movie is
+ * added.
+ */
+void titles_init(struct titles_dict *restrict dict);
+
+/**
+ * Adds the movie with the given ID to the dictionary. It can only be found once
+ * the dictionary is sealed.
+ */
+void titles_add(
+        struct titles_dict *restrict dict,
+        moviedb_id_t movie,
+        struct error *restrict error);
+
+/**
+ * Sorts and front-codes the titles of the added movies, read from the given
+ * table, replacing any titles sealed before. If movies share a title, only the
+ * first one added is kept, as in the trie. The only possible error is an
+ * allocation error.
+ */
+void titles_seal(
+        struct titles_dict *restrict dict,
+        struct movies_table const *restrict movies,
+        struct error *restrict error);
+
+/**
+ * Points the given flat dictionary at the arrays of the given sealed one, which
+ * keeps owning them.
+ */
+void titles_flat(
+        struct titles_dict const *restrict dict,
+        struct titles_flat *restrict flat_out);
+
+/**
+ * Tests whether the given flat dictionary, read back e.g. from a snapshot, can
+ * be searched safely: every bucket starts where the one before it ends, and
+ * every title is NUL-terminated within the bytes.
+ */
+bool titles_flat_valid(struct titles_flat const *restrict flat);
+
+/**
+ * Replaces the sealed titles of the dictionary with copies of the arrays of the
+ * given valid flat dictionary. The only possible error is an allocation error.
+ */
+void titles_restore(
+        struct titles_dict *restrict dict,
+        struct titles_flat const *restrict flat,
+        struct error *restrict error);
+
+/**
+ * Searches for a title. Returns whether it was found, and if so, writes the
+ * movie ID in movie_out, unless it is NULL.
+ */
+bool titles_search(
+        struct titles_dict const *restrict dict,
+        char const *restrict title,
+        moviedb_id_t *restrict movie_out);
+
+/**
+ * Finds the ranks of the titles starting with the given prefix.
+ */
+void titles_search_prefix(
+        struct titles_dict const *restrict dict,
+        char const *restrict prefix,
+        struct titles_range *restrict range_out);
+
+/**
+ * Returns the movie ID of the title with the given rank.
+ */
+inline moviedb_id_t titles_movie(
+        struct titles_dict const *restrict dict,
+        size_t rank)
+{
+    return dict->movies[rank];
+}
+
+/**
+ * Returns how many bytes the sealed dictionary takes.
+ */
+size_t titles_bytes(struct titles_dict const *restrict dict);
+
+/**
+ * Destroys the dictionary, freeing all memory.
+ */
+void titles_destroy(struct titles_dict *restrict dict);
+
+#endif
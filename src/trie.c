@@ -1,48 +1,126 @@
+#include <string.h>
 #include "trie.h"
 #include "alloc.h"
 
 /**
- * Makes path for a node. Starts by creating a child in the given node, in the
- * given branch_pos (branch position), advancing current_key to the end of the
- * string. Returns a heap-allocated node where a moviedb_id_t with the given
- * title should be inserted as leaf. The only possible error is an allocation
- * error.
+ * Completions of a node being ranked, best first.
  */
-static struct trie_node *make_path(
+struct trie_ranking {
+    /**
+     * The movie IDs.
+     */
+    moviedb_id_t movies[TRIE_COMPLETIONS];
+    /**
+     * The scores of the movies.
+     */
+    size_t scores[TRIE_COMPLETIONS];
+    /**
+     * Where each movie came from: the index of a branch, or the number of
+     * branches for the node's own leaf.
+     */
+    size_t sources[TRIE_COMPLETIONS];
+    /**
+     * How many movies there are.
+     */
+    size_t length;
+};
+
+/**
+ * Creates a leaf-to-be child in the given node, in the given branch_pos (branch
+ * position), labeled by the rest of the title from current_key, and advances
+ * current_key to the end of the string. Returns the child, allocated from the
+ * given arena (or the heap), where a moviedb_id_t with the given title should
+ * be inserted as leaf. The only possible error is an allocation error.
+ */
+static struct trie_node *make_leaf_node(
         struct trie_node *node,
         size_t branch_pos,
         char const *restrict title,
         size_t *restrict current_key,
+        struct arena *arena,
+        struct error *restrict error);
+
+/**
+ * Splits the edge to the child of the given branch after the given length of
+ * its label, by inserting a node there. Returns the new node, allocated from
+ * the given arena (or the heap). The only possible error is an allocation
+ * error, in which case the trie is left unchanged.
+ */
+static struct trie_node *split_edge(
+        struct trie_branch *restrict branch,
+        unsigned length,
+        struct arena *arena,
         struct error *restrict error);
 
+/**
+ * Finds the node where the given key ends. If partial is true, a key ending in
+ * the middle of a label ends at the node the label leads to, as all titles
+ * starting with the key are below it. Returns NULL if there is no such node.
+ */
+static struct trie_node const *find_node(
+        struct trie_node const *root,
+        char const *restrict key,
+        bool partial);
 
 /**
- * Destroys the given branches recursively (last resort, in case
- * heap-allocation of the queue fails).
+ * Counts how many bytes of the label match the start of the key.
  */
-static inline void destroy_branches_recursive(
-        struct trie_branch_list *restrict branches);
+static inline unsigned match_label(
+        struct trie_node const *restrict node,
+        char const *restrict key);
 
 /**
- * Enqueues all children of all branches in the curr_level into the next_level.
- * The only possible error is an allocation error.
+ * Computes the completions of a node whose children were ranked already.
  */
-static inline void destroy_enqueue_next_level(
-        struct trie_iter_queue *restrict curr_level,
-        struct trie_iter_queue *restrict next_level,
+static void rank_node(
+        struct trie_node *node,
+        size_t (*score)(void const *context, moviedb_id_t movie),
+        void const *context,
+        struct arena *arena,
         struct error *restrict error);
 
+/**
+ * Inserts a movie in the ranking, in order, unless it already has
+ * TRIE_COMPLETIONS better movies. Returns whether it was inserted.
+ */
+static bool ranking_insert(
+        struct trie_ranking *restrict ranking,
+        moviedb_id_t movie,
+        size_t score,
+        size_t source);
+
+/**
+ * Frees a node and, if it owns them, its label and completions. The branch list
+ * is not freed.
+ */
+static inline void free_node(
+        struct trie_node *restrict node,
+        struct arena const *arena);
+
 /**
  * Definitely frees memory of the given branch list. Destroys also pointers to
  * children, **but not the children themselves**.
  */
-static inline void destroy_branch_list(struct trie_branch_list *branches);
+static inline void destroy_branch_list(
+        struct trie_branch_list const *branches,
+        struct arena const *arena);
+
+/**
+ * Destroys what is left of the trie when the stack of trie_destroy cannot
+ * grow, recursively, from the top frame down. The top frame's current branch
+ * is the child that could not be pushed.
+ */
+static void destroy_frames_recursive(
+        struct trie_iter *restrict iter,
+        struct arena const *arena);
 
 /**
  * Destroys a tree recursively. Should be a last resource, used only if
- * heap-allocation of the queue fails.
+ * the stack of the iterator cannot grow.
  */
-static void destroy_recursive(struct trie_node *restrict root);
+static void destroy_recursive(
+        struct trie_node *restrict root,
+        struct arena const *arena);
 
 extern inline void trie_root_init(struct trie_node *restrict root);
 
@@ -50,11 +128,14 @@ void trie_insert(
         struct trie_node *root,
         char const *restrict title,
         moviedb_id_t movie,
+        struct arena *arena,
         struct error *restrict error)
 {
     struct trie_node *node;
+    struct trie_branch *branch;
     size_t branch_pos;
     size_t current_key;
+    unsigned matched;
     bool found;
 
     current_key = 0;
@@ -68,17 +149,30 @@ void trie_insert(
                 &branch_pos);
 
         if (found) {
-            /* Binary search found a place. */
-            node = node->branches.entries[branch_pos].child;
-            current_key++;
+            /* Binary search found a place, the label must match as well. */
+            branch = &node->branches.entries[branch_pos];
+            matched = match_label(branch->child, title + current_key);
+            if (matched < branch->child->label_length) {
+                /* The title leaves the edge midway, so it is split there. */
+                node = split_edge(branch, matched, arena, error);
+            } else {
+                node = branch->child;
+            }
+            current_key += matched;
         } else {
             /*
              * In this case there won't be any nodes and we need to make a
-             * path. Since we are passing current_key as a pointer, it will
+             * leaf. Since we are passing current_key as a pointer, it will
              * change this cursor to a character which ends the string ('\0'),
              * and so, this will end the loop.
              */
-            node = make_path(node, branch_pos, title, &current_key, error);
+            node = make_leaf_node(
+                    node,
+                    branch_pos,
+                    title,
+                    &current_key,
+                    arena,
+                    error);
         }
     }
 
@@ -105,29 +199,10 @@ bool trie_search(
         char const *restrict title,
         moviedb_id_t *restrict movie_out)
 {
-    size_t current_key = 0;
-    size_t branch_pos;
-    struct trie_node const *node = root;
-    bool branch_found = true;
+    struct trie_node const *node = find_node(root, title, false);
+    bool found = node != NULL && node->has_leaf;
 
-    /*
-     * Loops until we reached the right place of the title, or until we find out
-     * there is no path to this title.
-     */
-    while (title[current_key] != 0 && branch_found) {
-        branch_found = trie_branches_search(
-                &node->branches,
-                title[current_key],
-                &branch_pos);
-
-        if (branch_found) {
-            /* Binary search found the branch position. */
-            node = node->branches.entries[branch_pos].child;
-            current_key++;
-        }
-    }
-
-    if (branch_found && node->has_leaf && movie_out != NULL) {
+    if (found && movie_out != NULL) {
         /*
          * If there is a path, a leaf at the end of the path, we found. Put
          * the movie ID in the output paramter.
@@ -135,179 +210,694 @@ bool trie_search(
         *movie_out = node->movie;
     }
 
-    return branch_found && node->has_leaf;
+    return found;
 }
 
 void trie_search_prefix(
         struct trie_node const *root,
         char const *restrict prefix,
-        struct trie_iter *restrict iter_out,
-        struct error *restrict error)
+        struct trie_iter *restrict iter_out)
 {
-    size_t current_key = 0;
-    size_t branch_pos;
-    struct trie_node const *node = root;
-    bool branch_found = true;
-
+    /* Resets the iterator, keeping the memory of its stack. */
+    iter_out->length = 0;
     /*
-     * Loops until we reached the right node, where the titles with the given
-     * prefix are, or until we find out there is no path to titles with this
-     * prefix.
+     * If there are no titles with this prefix, this makes the iterator stop at
+     * the first attempt.
      */
-    while (prefix[current_key] != 0 && branch_found) {
-        branch_found = trie_branches_search(
-                &node->branches,
-                prefix[current_key],
-                &branch_pos);
+    iter_out->current = find_node(root, prefix, true);
+}
+
+void trie_rank(
+        struct trie_node *root,
+        size_t (*score)(void const *context, moviedb_id_t movie),
+        void const *context,
+        struct arena *arena,
+        struct error *restrict error)
+{
+    struct trie_iter iter;
+    struct trie_iter_frame *top;
+    struct trie_iter_frame const *below;
+    struct trie_node *node;
+
+    trie_iter_init(&iter);
+    trie_iter_push(&iter, &root->branches, error);
 
-        if (branch_found) {
-            node = node->branches.entries[branch_pos].child;
-            current_key++;
+    /* Walks the trie depth-first, ranking nodes after their children. */
+    while (iter.length > 0 && error->code == error_none) {
+        top = &iter.stack[iter.length - 1];
+        if (top->branch < top->branches->length) {
+            node = top->branches->entries[top->branch].child;
+            top->branch++;
+            trie_iter_push(&iter, &node->branches, error);
+        } else {
+            /* The node of the top frame is the child the frame below is at. */
+            if (iter.length == 1) {
+                node = root;
+            } else {
+                below = &iter.stack[iter.length - 2];
+                node = below->branches->entries[below->branch - 1].child;
+            }
+            rank_node(node, score, context, arena, error);
+            iter.length--;
         }
     }
 
-    /* Initializes the iterator. */
-    trie_iter_queue_init(&iter_out->queue);
-    iter_out->branch = 0;
-    if (branch_found) {
-        iter_out->current = node;
-        trie_iter_enqueue(&iter_out->queue, &node->branches, error);
+    trie_iter_destroy(&iter);
+}
+
+size_t trie_complete(
+        struct trie_node const *root,
+        char const *restrict prefix,
+        moviedb_id_t const **completions_out)
+{
+    struct trie_node const *node = find_node(root, prefix, true);
+    size_t length = 0;
+
+    *completions_out = NULL;
+    if (node != NULL) {
+        *completions_out = node->completions;
+        length = node->completions_length;
+    }
+
+    return length;
+}
+
+void trie_stats(
+        struct trie_node const *root,
+        struct trie_stats *restrict stats_out,
+        struct error *restrict error)
+{
+    struct trie_iter iter;
+    struct trie_iter_frame *top;
+    struct trie_node const *child;
+
+    stats_out->nodes = 1;
+    stats_out->bytes = root->branches.capacity * sizeof(struct trie_branch);
+    if (root->owns_completions) {
+        stats_out->bytes += root->completions_length * sizeof(moviedb_id_t);
+    }
+
+    trie_iter_init(&iter);
+    trie_iter_push(&iter, &root->branches, error);
+
+    while (iter.length > 0 && error->code == error_none) {
+        top = &iter.stack[iter.length - 1];
+        if (top->branch < top->branches->length) {
+            child = top->branches->entries[top->branch].child;
+            top->branch++;
+
+            stats_out->nodes++;
+            stats_out->bytes += sizeof(*child) + child->label_length
+                + child->branches.capacity * sizeof(struct trie_branch);
+            if (child->owns_label) {
+                /* The NUL terminator of the copied bytes. */
+                stats_out->bytes++;
+            }
+            if (child->owns_completions) {
+                stats_out->bytes +=
+                    child->completions_length * sizeof(moviedb_id_t);
+            }
+
+            trie_iter_push(&iter, &child->branches, error);
+        } else {
+            iter.length--;
+        }
+    }
+
+    trie_iter_destroy(&iter);
+}
+
+void trie_flatten(
+        struct trie_node const *root,
+        struct trie_flat *restrict flat_out,
+        struct error *restrict error)
+{
+    struct trie_stats stats;
+    struct trie_node const **queue = NULL;
+    struct trie_node const *node;
+    struct trie_flat_node *nodes = NULL;
+    char *labels = NULL;
+    moviedb_id_t *completions = NULL;
+    size_t length = 1;
+    size_t labels_length = 0;
+    size_t completions_length = 0;
+    size_t first_child = 1;
+    size_t i, j;
+
+    trie_stats(root, &stats, error);
+
+    if (error->code == error_none) {
+        queue = moviedb_alloc(sizeof(*queue), stats.nodes, error);
+    }
+
+    if (error->code == error_none) {
+        /* Lists the nodes breadth-first, the list being the queue itself. */
+        queue[0] = root;
+        for (i = 0; i < length; i++) {
+            node = queue[i];
+            for (j = 0; j < node->branches.length; j++) {
+                queue[length] = node->branches.entries[j].child;
+                length++;
+            }
+            labels_length += node->label_length;
+            completions_length += node->completions_length;
+        }
+
+        nodes = moviedb_alloc(sizeof(*nodes), length, error);
+    }
+
+    if (error->code == error_none) {
+        labels = moviedb_alloc(sizeof(*labels), labels_length, error);
+    }
+
+    if (error->code == error_none) {
+        completions = moviedb_alloc(
+                sizeof(*completions),
+                completions_length,
+                error);
+    }
+
+    if (error->code == error_none) {
+        labels_length = 0;
+        completions_length = 0;
+
+        for (i = 0; i < length; i++) {
+            node = queue[i];
+            nodes[i].movie = node->has_leaf ? node->movie : 0;
+            /* The children of a node follow the ones of the nodes before. */
+            nodes[i].first_child = first_child;
+            nodes[i].label_length = node->label_length;
+            nodes[i].branches = node->branches.length;
+            nodes[i].has_leaf = node->has_leaf;
+            nodes[i].completions_length = node->completions_length;
+            first_child += node->branches.length;
+
+            if (node->label_length > 0) {
+                memcpy(labels + labels_length, node->label, node->label_length);
+                labels_length += node->label_length;
+            }
+            if (node->completions_length > 0) {
+                memcpy(completions + completions_length,
+                        node->completions,
+                        sizeof(*completions) * node->completions_length);
+                completions_length += node->completions_length;
+            }
+        }
+
+        flat_out->nodes = nodes;
+        flat_out->length = length;
+        flat_out->labels = labels;
+        flat_out->labels_length = labels_length;
+        flat_out->completions = completions;
+        flat_out->completions_length = completions_length;
     } else {
-        /* If we did not found simply make this iterator stop at the first
-         * attempt.
-         */
-        iter_out->current = NULL;
+        moviedb_free(completions);
+        moviedb_free(labels);
+        moviedb_free(nodes);
+    }
+
+    moviedb_free(queue);
+}
+
+bool trie_flat_valid(struct trie_flat const *restrict flat)
+{
+    struct trie_flat_node const *node;
+    struct trie_flat_node const *child;
+    size_t labels_length = 0;
+    size_t completions_length = 0;
+    /* The next node to be a child, and where its label starts. */
+    size_t next = 1;
+    size_t next_label = 0;
+    size_t i, j;
+    unsigned char key;
+    unsigned char previous = 0;
+    bool valid = flat->length > 0;
+
+    for (i = 0; valid && i < flat->length; i++) {
+        node = &flat->nodes[i];
+        /* Only the root has an empty label, and it is nobody's child. */
+        valid = (i == 0 || i < next)
+            && (i == 0) == (node->label_length == 0)
+            && node->label_length <= flat->labels_length - labels_length
+            && node->completions_length <= TRIE_COMPLETIONS
+            && node->completions_length
+                <= flat->completions_length - completions_length;
+
+        if (valid) {
+            /* Labels are matched byte by byte against NUL-terminated keys. */
+            valid = memchr(
+                    flat->labels + labels_length,
+                    0,
+                    node->label_length) == NULL;
+            labels_length += node->label_length;
+            completions_length += node->completions_length;
+        }
+
+        if (valid && node->branches > 0) {
+            valid = node->first_child == next
+                && node->branches <= flat->length - next;
+        }
+
+        /* Branches are searched by key, the first byte of a child's label. */
+        for (j = 0; valid && j < node->branches; j++) {
+            child = &flat->nodes[next];
+            valid = child->label_length > 0
+                && child->label_length <= flat->labels_length - next_label;
+
+            if (valid) {
+                key = flat->labels[next_label];
+                valid = j == 0 || previous < key;
+                previous = key;
+                next_label += child->label_length;
+                next++;
+            }
+        }
     }
+
+    return valid
+        && next == flat->length
+        && labels_length == flat->labels_length
+        && completions_length == flat->completions_length;
 }
 
-void trie_destroy(struct trie_node *root)
+void trie_restore(
+        struct trie_node *root,
+        struct trie_flat const *restrict flat,
+        struct arena *arena,
+        struct error *restrict error)
+{
+    struct trie_node **made;
+    struct trie_node *node;
+    struct trie_node *child;
+    struct trie_flat_node const *record;
+    moviedb_id_t *completions;
+    size_t completions_length = 0;
+    size_t next_label = 0;
+    size_t length;
+    size_t i, j;
+
+    /* Nodes by index, each made while its parent is restored. */
+    made = moviedb_alloc(sizeof(*made), flat->length, error);
+    if (error->code == error_none) {
+        made[0] = root;
+    }
+
+    for (i = 0; error->code == error_none && i < flat->length; i++) {
+        node = made[i];
+        record = &flat->nodes[i];
+        node->has_leaf = record->has_leaf != 0;
+        if (node->has_leaf) {
+            node->movie = record->movie;
+        }
+
+        if (record->completions_length > 0) {
+            completions = arena_alloc(
+                    arena,
+                    sizeof(*completions),
+                    record->completions_length,
+                    error);
+            if (error->code == error_none) {
+                memcpy(completions,
+                        flat->completions + completions_length,
+                        sizeof(*completions) * record->completions_length);
+                node->completions = completions;
+                node->completions_length = record->completions_length;
+                node->owns_completions = true;
+                completions_length += record->completions_length;
+            }
+        }
+
+        if (error->code == error_none && record->branches > 0) {
+            node->branches.entries = moviedb_alloc(
+                    sizeof(*node->branches.entries),
+                    record->branches,
+                    error);
+            if (error->code == error_none) {
+                node->branches.capacity = record->branches;
+            }
+        }
+
+        /* Children are linked as soon as they are made, so none is lost. */
+        for (j = 0; error->code == error_none && j < record->branches; j++) {
+            child = arena_alloc(arena, sizeof(*child), 1, error);
+            if (error->code == error_none) {
+                trie_root_init(child);
+                length = flat->nodes[record->first_child + j].label_length;
+                child->label = arena_copy_str(
+                        arena,
+                        flat->labels + next_label,
+                        length,
+                        error);
+                if (error->code == error_none) {
+                    child->label_length = length;
+                    child->owns_label = true;
+                    node->branches.entries[j].key = child->label[0];
+                    node->branches.entries[j].child = child;
+                    node->branches.length++;
+                    made[record->first_child + j] = child;
+                    next_label += length;
+                } else {
+                    arena_free(arena, child);
+                }
+            }
+        }
+    }
+
+    moviedb_free(made);
+}
+
+void trie_flat_destroy(struct trie_flat *restrict flat)
+{
+    moviedb_free((void *) (void const *) flat->nodes);
+    moviedb_free((void *) (void const *) flat->labels);
+    moviedb_free((void *) (void const *) flat->completions);
+    flat->nodes = NULL;
+    flat->length = 0;
+    flat->labels = NULL;
+    flat->labels_length = 0;
+    flat->completions = NULL;
+    flat->completions_length = 0;
+}
+
+void trie_destroy(struct trie_node *root, struct arena const *arena)
 {
     /*
      * We'll be avoiding recursive destroy since it might result in stack
-     * overflow. The trie could be large enough to do so.
+     * overflow. The trie could be deep enough to do so.
      *
-     * So, we will use the iterator queue to iterate over branch lists
-     * iteratively. If any allocation on the iterator queue fails, we will use
-     * recursive destroy as a fallback.
+     * So, we will walk the trie depth-first with an iterator's stack, freeing
+     * the children of a node once all of them were visited. If the stack
+     * cannot grow, we will use recursive destroy as a fallback.
      */
 
     struct error error;
-    /* Current level/depth in the trie. */
-    struct trie_iter_queue curr_level;
-    /* Next level/depth in the trie. */
-    struct trie_iter_queue next_level;
+    struct trie_iter iter;
+    struct trie_iter_frame *top;
+    struct trie_node *child;
 
     error_init(&error);
+    trie_iter_init(&iter);
+
+    /* Initializes the stack with the root's branch list. */
+    trie_iter_push(&iter, &root->branches, &error);
+
+    while (iter.length > 0 && error.code == error_none) {
+        top = &iter.stack[iter.length - 1];
+        if (top->branch < top->branches->length) {
+            /* Descends into the next child. */
+            child = top->branches->entries[top->branch].child;
+            top->branch++;
+            trie_iter_push(&iter, &child->branches, &error);
+        } else {
+            /* All children were visited, so they can be freed. */
+            destroy_branch_list(top->branches, arena);
+            iter.length--;
+        }
+    }
 
-    trie_iter_queue_init(&curr_level);
-    trie_iter_queue_init(&next_level);
-
-    /* Initializes the current level queue with the root's branch list. */
-    trie_iter_enqueue(&curr_level, &root->branches, &error);
-
-    if (error.code == error_none) {
-        while (!trie_iter_queue_is_empty(&curr_level)) {
-            /*
-             * Adds branch lists to the next level, based on the children of
-             * the current level, and destroys current level.
-             */
-            destroy_enqueue_next_level(&curr_level, &next_level, &error);
-            if (error.code == error_none) {
-                /* Accounts that we are going to pass to the next level. */
-                curr_level = next_level;
-                trie_iter_queue_init(&next_level);
-            }
+    if (error.code != error_none) {
+        if (iter.length == 0) {
+            /* Not even the root's list could be pushed. */
+            destroy_recursive(root, arena);
+            trie_branches_destroy(&root->branches);
+        } else {
+            destroy_frames_recursive(&iter, arena);
         }
-    } else {
-        /* Uses a recursive destroy as a fallback if allocation error. */
-        destroy_recursive(root);
     }
+
+    /* The root itself is not freed, but its completions are. */
+    if (root->owns_completions) {
+        arena_free(arena, root->completions);
+    }
+
+    trie_iter_destroy(&iter);
+    error_destroy(&error);
 }
 
-static struct trie_node *make_path(
+static struct trie_node *make_leaf_node(
         struct trie_node *node,
         size_t branch_pos,
         char const *restrict title,
         size_t *restrict current_key,
+        struct arena *arena,
         struct error *restrict error)
 {
     struct trie_node *child;
-    
-    /* Loops while we did not reach the end of the string (and no error). */
-    while (title[*current_key] != 0 && error->code == error_none) {
-        /* Allocates a child node. */
-        child = moviedb_alloc(sizeof(*child), 1, error);
-        if (error->code == error_none) {
-            child->has_leaf = false;
-            child->branches.entries = NULL;
-            child->branches.length = 0;
-            child->branches.capacity = 0;
+    size_t length = strlen(title + *current_key);
 
-            /* Inserts the new child into the branch list. */
+    child = arena_alloc(arena, sizeof(*child), 1, error);
+    if (error->code == error_none) {
+        trie_root_init(child);
+        child->label = arena_copy_str(
+                arena,
+                title + *current_key,
+                length,
+                error);
+        if (error->code == error_none) {
+            child->label_length = length;
+            child->owns_label = true;
             trie_branches_insert(
                     &node->branches,
                     title[*current_key],
                     child,
                     branch_pos,
                     error);
+        }
+        if (error->code != error_none) {
+            free_node(child, arena);
+        }
+    }
+
+    if (error->code == error_none) {
+        *current_key += length;
+    } else {
+        child = node;
+    }
+
+    return child;
+}
+
+static struct trie_node *split_edge(
+        struct trie_branch *restrict branch,
+        unsigned length,
+        struct arena *arena,
+        struct error *restrict error)
+{
+    struct trie_node *child = branch->child;
+    struct trie_node *middle;
 
-            /* Prepares for the next iteration. */
-            node = child;
-            (*current_key)++;
-            branch_pos = 0;
+    middle = arena_alloc(arena, sizeof(*middle), 1, error);
+    if (error->code == error_none) {
+        trie_root_init(middle);
+        trie_branches_insert(
+                &middle->branches,
+                child->label[length],
+                child,
+                0,
+                error);
+        if (error->code != error_none) {
+            arena_free(arena, middle);
         }
     }
 
-    return node;
+    if (error->code == error_none) {
+        /* The start of the label, and so its bytes, go to the new node. */
+        middle->label = child->label;
+        middle->label_length = length;
+        middle->owns_label = child->owns_label;
+        child->label += length;
+        child->label_length -= length;
+        child->owns_label = false;
+        branch->child = middle;
+    } else {
+        middle = NULL;
+    }
+
+    return middle;
 }
 
-static inline void destroy_branches_recursive(
-        struct trie_branch_list *restrict branches)
+static struct trie_node const *find_node(
+        struct trie_node const *root,
+        char const *restrict key,
+        bool partial)
 {
-    size_t i;
+    size_t current_key = 0;
+    size_t branch_pos;
+    unsigned matched;
+    struct trie_node const *node = root;
+    struct trie_node const *child;
 
     /*
-     * Recursive destruction of the branch list, with deep destruction. Iterates
-     * just at the top-level.
+     * Loops until we reached the end of the key, or until we find out there is
+     * no path to it.
      */
-    for (i = 0; i < branches->length; i++) {
-        /* Delegates destruction of children to recursive function. */
-        destroy_recursive(branches->entries[i].child);
-        moviedb_free(branches->entries[i].child);
+    while (node != NULL && key[current_key] != 0) {
+        child = NULL;
+        if (trie_branches_search(&node->branches, key[current_key],
+                    &branch_pos)) {
+            child = node->branches.entries[branch_pos].child;
+            matched = match_label(child, key + current_key);
+            current_key += matched;
+            if (matched < child->label_length
+                    && !(partial && key[current_key] == 0)) {
+                /* The key leaves the edge midway. */
+                child = NULL;
+            }
+        }
+        node = child;
     }
 
-    /* Just destroys the branch allocation. */
-    trie_branches_destroy(branches);
+    return node;
+}
+
+static inline unsigned match_label(
+        struct trie_node const *restrict node,
+        char const *restrict key)
+{
+    unsigned matched = 0;
+
+    /* Labels have no NUL bytes, so this stops at the end of the key too. */
+    while (matched < node->label_length
+            && node->label[matched] == key[matched]) {
+        matched++;
+    }
+
+    return matched;
 }
 
-static inline void destroy_enqueue_next_level(
-        struct trie_iter_queue *restrict curr_level,
-        struct trie_iter_queue *restrict next_level,
+static inline void free_node(
+        struct trie_node *restrict node,
+        struct arena const *arena)
+{
+    if (node->owns_label) {
+        arena_free(arena, node->label);
+    }
+    if (node->owns_completions) {
+        arena_free(arena, node->completions);
+    }
+    arena_free(arena, node);
+}
+
+static void rank_node(
+        struct trie_node *node,
+        size_t (*score)(void const *context, moviedb_id_t movie),
+        void const *context,
+        struct arena *arena,
         struct error *restrict error)
 {
-    struct trie_branch_list branches;
-    
-    while (trie_iter_dequeue(curr_level, &branches)) {
-        /* Eneuques the children of the current level into the next level. */
-        trie_iter_enqueue_children(next_level, &branches, error);
+    struct trie_ranking ranking;
+    struct trie_node const *child;
+    moviedb_id_t *completions;
+    size_t own = node->branches.length;
+    size_t source = own;
+    size_t i, j;
+    bool inserted;
+
+    if (node->owns_completions) {
+        arena_free(arena, node->completions);
+    }
+    node->owns_completions = false;
+    node->completions = NULL;
+    node->completions_length = 0;
+
+    ranking.length = 0;
+    if (node->has_leaf) {
+        ranking_insert(&ranking, node->movie, score(context, node->movie), own);
+    }
+
+    for (i = 0; i < node->branches.length; i++) {
+        child = node->branches.entries[i].child;
+        inserted = true;
+        /* Lists are sorted, so once a movie is left out, so are the next. */
+        for (j = 0; j < child->completions_length && inserted; j++) {
+            inserted = ranking_insert(
+                    &ranking,
+                    child->completions[j],
+                    score(context, child->completions[j]),
+                    i);
+        }
+    }
+
+    /* Finds out whether every movie came from the same branch. */
+    if (ranking.length > 0) {
+        source = ranking.sources[0];
+    }
+    for (i = 1; i < ranking.length; i++) {
+        if (ranking.sources[i] != source) {
+            source = own;
+        }
+    }
+
+    if (source < own) {
+        child = node->branches.entries[source].child;
+    }
 
+    if (ranking.length > 0 && own == 0) {
+        /* A lone leaf completes to its own movie. */
+        node->completions = &node->movie;
+    } else if (source < own && ranking.length == child->completions_length) {
+        /* The same completions as a child's, which are shared. */
+        node->completions = child->completions;
+    } else if (ranking.length > 0) {
+        completions = arena_alloc(
+                arena,
+                sizeof(*completions),
+                ranking.length,
+                error);
         if (error->code == error_none) {
-            /*
-             * If no error, destroys the allocation of the branch list's array.
-             */
-            destroy_branch_list(&branches);
-        } else {
-            /* If an error happened, do emergency cleanup. */
-            destroy_branches_recursive(&branches);
-            while (trie_iter_dequeue(curr_level, &branches)) {
-                destroy_branches_recursive(&branches);
+            for (i = 0; i < ranking.length; i++) {
+                completions[i] = ranking.movies[i];
             }
-            while (trie_iter_dequeue(next_level, &branches)) {}
+            node->completions = completions;
+            node->owns_completions = true;
+        }
+    }
+
+    if (node->completions != NULL) {
+        node->completions_length = ranking.length;
+    }
+}
+
+static bool ranking_insert(
+        struct trie_ranking *restrict ranking,
+        moviedb_id_t movie,
+        size_t score,
+        size_t source)
+{
+    size_t position = ranking->length;
+    size_t i;
+    bool inserted;
+
+    /* Best scores first, and then lowest IDs. */
+    while (position > 0
+            && (score > ranking->scores[position - 1]
+                || (score == ranking->scores[position - 1]
+                    && movie < ranking->movies[position - 1]))) {
+        position--;
+    }
+
+    inserted = position < TRIE_COMPLETIONS;
+    if (inserted) {
+        if (ranking->length < TRIE_COMPLETIONS) {
+            ranking->length++;
         }
+        /* Shifts the worse movies, dropping the last one if it was full. */
+        for (i = ranking->length - 1; i > position; i--) {
+            ranking->movies[i] = ranking->movies[i - 1];
+            ranking->scores[i] = ranking->scores[i - 1];
+            ranking->sources[i] = ranking->sources[i - 1];
+        }
+        ranking->movies[position] = movie;
+        ranking->scores[position] = score;
+        ranking->sources[position] = source;
     }
+
+    return inserted;
 }
 
-static inline void destroy_branch_list(struct trie_branch_list *branches)
+static inline void destroy_branch_list(
+        struct trie_branch_list const *branches,
+        struct arena const *arena)
 {
     size_t i;
 
@@ -316,14 +906,45 @@ static inline void destroy_branch_list(struct trie_branch_list *branches)
      * performed by this.
      */
     for (i = 0; i < branches->length; i++) {
-        moviedb_free(branches->entries[i].child);
+        free_node(branches->entries[i].child, arena);
     }
 
     trie_branches_destroy(branches);
 }
 
+static void destroy_frames_recursive(
+        struct trie_iter *restrict iter,
+        struct arena const *arena)
+{
+    size_t i;
+    /* The top frame's last child was not pushed, so it is not visited yet. */
+    size_t start = iter->stack[iter->length - 1].branch - 1;
+    struct trie_iter_frame const *frame;
+    struct trie_node *child;
+
+    while (iter->length > 0) {
+        frame = &iter->stack[iter->length - 1];
+
+        /* Destroys the descendants of the children not visited yet. */
+        for (i = start; i < frame->branches->length; i++) {
+            child = frame->branches->entries[i].child;
+            destroy_recursive(child, arena);
+            trie_branches_destroy(&child->branches);
+        }
+
+        destroy_branch_list(frame->branches, arena);
+        iter->length--;
+
+        /* The child being visited by the frame below is the frame above. */
+        if (iter->length > 0) {
+            start = iter->stack[iter->length - 1].branch;
+        }
+    }
+}
 
-static void destroy_recursive(struct trie_node *restrict root)
+static void destroy_recursive(
+        struct trie_node *restrict root,
+        struct arena const *arena)
 {
     size_t i;
 
@@ -332,12 +953,12 @@ static void destroy_recursive(struct trie_node *restrict root)
      * can be stack-allocated.
      * */
     for (i = 0; i < root->branches.length; i++) {
-        destroy_recursive(root->branches.entries[i].child);
+        destroy_recursive(root->branches.entries[i].child, arena);
         trie_branches_destroy(&root->branches.entries[i].child->branches);
         /*
          * Deallocates the child; it won't dellocate for itself, since it
          * thinks it is root when the recursive call happens.
          */
-        moviedb_free(root->branches.entries[i].child);
+        free_node(root->branches.entries[i].child, arena);
     }
 }
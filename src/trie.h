@@ -6,13 +6,22 @@
 #include "trie/branch.h"
 #include "trie/iter.h"
 #include "id.h"
+#include "arena.h"
 
 /**
  * This file provides an interface to a trie tree's implementation.
  */
 
 /**
- * A node of a trie tree.
+ * How many completions, i.e. movies with the best scores below a node, each
+ * node keeps once the trie is ranked.
+ */
+#define TRIE_COMPLETIONS 10
+
+/**
+ * A node of a trie tree. This is a radix trie: the edge from a node's parent to
+ * the node is labeled by a whole substring, not by a single character, so only
+ * nodes where titles fork or end are stored.
  */
 struct trie_node {
     /**
@@ -20,11 +29,45 @@ struct trie_node {
      * touch this.
      */
     bool has_leaf;
+    /**
+     * Whether the label's bytes were allocated for this node, and so must be
+     * freed with it. Labels of split edges point into the bytes of the edge
+     * they came from. Only trie internal code is allowed to touch this.
+     */
+    bool owns_label;
+    /**
+     * Whether the completions were allocated for this node, and so must be
+     * freed with it. Only trie internal code is allowed to touch this.
+     */
+    bool owns_completions;
+    /**
+     * How many completions there are, at most TRIE_COMPLETIONS. Only trie
+     * internal code is allowed to touch this.
+     */
+    unsigned char completions_length;
+    /**
+     * How many bytes the label has. Zero only for the root. Only trie internal
+     * code is allowed to touch this.
+     */
+    unsigned label_length;
+    /**
+     * The label of the edge from the parent to this node, not NUL-terminated.
+     * Its first byte is the key of the branch leading here. Only trie internal
+     * code is allowed to touch this.
+     */
+    char const *label;
     /**
      * The leaf data, in this case, the ID of a movie. Only initialized if this
      * node contains a leaf. Only trie internal code is allowed to touch this.
      */
     moviedb_id_t movie;
+    /**
+     * IDs of the movies with the best scores at or below this node, best
+     * first, as computed by trie_rank. They may be shared with a child that
+     * has the same ones, or point to movie if this node is a lone leaf. Only
+     * trie internal code is allowed to touch this.
+     */
+    moviedb_id_t const *completions;
     /**
      * The branches of this node. Only trie internal code is allowed to touch
      * this.
@@ -32,23 +75,110 @@ struct trie_node {
     struct trie_branch_list branches;
 };
 
+/**
+ * Statistics of the memory taken by a trie.
+ */
+struct trie_stats {
+    /**
+     * How many nodes there are, including the root.
+     */
+    size_t nodes;
+    /**
+     * How many bytes the nodes (except the root), their branch lists, their
+     * labels and their completions take.
+     */
+    size_t bytes;
+};
+
+/**
+ * A node of a trie flattened into an array, e.g. to be written into a snapshot.
+ * Nodes are listed breadth-first from the root, so the children of a node are
+ * contiguous, in the order of their branches, and the first byte of a child's
+ * label is the key of its branch.
+ */
+struct trie_flat_node {
+    /**
+     * The ID of the leaf's movie, if the node has a leaf, zero otherwise.
+     */
+    moviedb_id_t movie;
+    /**
+     * Index of the first child of the node, if it has any.
+     */
+    uint64_t first_child;
+    /**
+     * How many bytes the label has.
+     */
+    uint32_t label_length;
+    /**
+     * How many children the node has.
+     */
+    uint16_t branches;
+    /**
+     * Whether the node has a leaf.
+     */
+    uint8_t has_leaf;
+    /**
+     * How many completions the node has.
+     */
+    uint8_t completions_length;
+};
+
+/**
+ * A trie flattened into arrays. The labels and the completions of the nodes
+ * follow each other in the order of the nodes.
+ */
+struct trie_flat {
+    /**
+     * The nodes, the root first.
+     */
+    struct trie_flat_node const *nodes;
+    /**
+     * How many nodes there are.
+     */
+    size_t length;
+    /**
+     * The bytes of the labels.
+     */
+    char const *labels;
+    /**
+     * How many bytes the labels take.
+     */
+    size_t labels_length;
+    /**
+     * The completions, best first within a node.
+     */
+    moviedb_id_t const *completions;
+    /**
+     * How many completions there are.
+     */
+    size_t completions_length;
+};
+
 /**
  * Initializes the root of the trie tree.
  */
 inline void trie_root_init(struct trie_node *restrict root)
 {
     root->has_leaf = false;
+    root->owns_label = false;
+    root->owns_completions = false;
+    root->completions_length = 0;
+    root->label_length = 0;
+    root->label = NULL;
+    root->completions = NULL;
     trie_branches_init(&root->branches);
 }
 
 /**
- * Inserts a movie ID into the three, given the title of the movie. The only
- * possible error is an allocation error.
+ * Inserts a movie ID into the three, given the title of the movie. New nodes
+ * and copies of the bytes labeling them are allocated from the given arena, or
+ * from the heap if it is NULL. The only possible error is an allocation error.
  */
 void trie_insert(
         struct trie_node *root,
         char const *restrict title,
         moviedb_id_t movie,
+        struct arena *arena,
         struct error *restrict error);
 
 /**
@@ -65,19 +195,90 @@ bool trie_search(
 /**
  * Searches for the movies in the trie tree with the given title prefix.
  *
- * Initializes the output iterator parameter iter_out so it is iterable.
+ * Resets the output iterator parameter iter_out so it iterates over the movies
+ * found, in the order of their titles. The iterator must be initialized with
+ * trie_iter_init, and can be reused for many searches before being destroyed.
  */
 void trie_search_prefix(
         struct trie_node const *root,
         char const *restrict prefix,
-        struct trie_iter *restrict iter_out,
+        struct trie_iter *restrict iter_out);
+
+/**
+ * Computes the completions of every node of the trie, once all titles were
+ * inserted: the movies below the node with the highest scores, as returned by
+ * the score function given the context, and then with the lowest IDs. Lists are
+ * allocated from the given arena, or from the heap if it is NULL, and replace
+ * the ones of a previous ranking. The only possible error is an allocation
+ * error.
+ */
+void trie_rank(
+        struct trie_node *root,
+        size_t (*score)(void const *context, moviedb_id_t movie),
+        void const *context,
+        struct arena *arena,
         struct error *restrict error);
 
+/**
+ * Finds the completions of the given prefix, best first, as computed by
+ * trie_rank. Returns how many there are, and points completions_out to them.
+ * No memory is allocated, whatever the number of titles with the prefix.
+ */
+size_t trie_complete(
+        struct trie_node const *root,
+        char const *restrict prefix,
+        moviedb_id_t const **completions_out);
+
+/**
+ * Computes statistics of the memory taken by the given trie. The only possible
+ * error is an allocation error.
+ */
+void trie_stats(
+        struct trie_node const *root,
+        struct trie_stats *restrict stats_out,
+        struct error *restrict error);
+
+/**
+ * Flattens the given trie into arrays allocated from the heap, which must be
+ * freed with trie_flat_destroy. The only possible error is an allocation error.
+ */
+void trie_flatten(
+        struct trie_node const *root,
+        struct trie_flat *restrict flat_out,
+        struct error *restrict error);
+
+/**
+ * Tests whether the given flat trie, read back e.g. from a snapshot, makes a
+ * trie that can be searched safely: a tree whose labels are not empty (but for
+ * the root's) and have no NUL bytes, whose branches are sorted by key, and
+ * whose nodes have at most TRIE_COMPLETIONS completions, all within the arrays.
+ */
+bool trie_flat_valid(struct trie_flat const *restrict flat);
+
+/**
+ * Builds the trie of the given valid flat trie under the given root, which must
+ * have no branches, ranked as the flattened trie was. Nodes and copies of
+ * their labels and completions are allocated from the given arena, or from the
+ * heap if it is NULL. The only possible error is an allocation error, in which
+ * case the nodes built so far are left in the trie.
+ */
+void trie_restore(
+        struct trie_node *root,
+        struct trie_flat const *restrict flat,
+        struct arena *arena,
+        struct error *restrict error);
+
+/**
+ * Frees the arrays of a flat trie made by trie_flatten.
+ */
+void trie_flat_destroy(struct trie_flat *restrict flat);
+
 /**
  * Destroys the given trie tree, freeing all the heap-allocated memory. Note
  * that the given pointer to the root node is not assumed to be heap-allocated.
- * One can (and should) allocate the root node in the stack.
+ * One can (and should) allocate the root node in the stack. The arena must be
+ * the one given to trie_insert; nodes are only freed if it is NULL.
  */
-void trie_destroy(struct trie_node *root);
+void trie_destroy(struct trie_node *root, struct arena const *arena);
 
 #endif
@@ -16,13 +16,18 @@ bool trie_branches_search(
     low = 0;
     high = list->length;
 
+    /*
+     * Keys are compared as unsigned bytes, as strcmp does, so UTF-8 bytes sort
+     * after ASCII ones.
+     */
     while (low < high && !found) {
         mid = low + (high - low) / 2;
 
-        if (list->entries[mid].key < key) {
+        if ((unsigned char) list->entries[mid].key < (unsigned char) key) {
             /* mid and below is discarded. */
             low = mid + 1;
-        } else if (list->entries[mid].key > key) {
+        } else if ((unsigned char) list->entries[mid].key
+                > (unsigned char) key) {
             /* mid and above is discarded. */
             high = mid;
         } else {
@@ -15,8 +15,9 @@ struct trie_node;
  */
 struct trie_branch {
     /**
-     * The key of the branch (i.e. the character that leads to this path). Only
-     * trie internal code is allowed to touch this.
+     * The key of the branch (i.e. the character that leads to this path).
+     * Branches are sorted by their keys as unsigned bytes. Only trie internal
+     * code is allowed to touch this.
      */
     char key;
     /**
@@ -5,66 +5,72 @@
 #include "../id.h"
 
 /**
- * This file defines items related to branches of a trie. Some items are
+ * This file defines items related to iteration over a trie. Some items are
  * private. 
  */
 
 /**
- * An iterator queue's node. Only trie internal code is allowed to touch this.
+ * A frame of the iterator's stack: a branch list being visited, and the next
+ * branch to descend into. Only trie internal code is allowed to touch this.
  */
-struct trie_iter_node {
+struct trie_iter_frame {
     /**
      * Branch list currently being iterated. Only trie internal code is allowed
      * to touch this.
      */
-    struct trie_branch_list branches;
+    struct trie_branch_list const *branches;
     /**
-     * The next node in the queue. Only trie internal code is allowed to touch
+     * Index of the next branch. Only trie internal code is allowed to touch
      * this.
      */
-    struct trie_iter_node *next;
+    size_t branch;
 };
 
 /**
- * An iterator queue. Only trie internal code is allowed to touch this.
+ * Depth-first iterator over a trie's node and its descendants. Movies are
+ * produced in the order of their titles, since branches are sorted by key. The
+ * stack only grows with the depth of the trie, and it is kept between
+ * searches, so a reused iterator does not allocate.
  */
-struct trie_iter_queue {
-    /**
-     * Front of the queue (i.e. the output side). Only trie internal code is
-     * allowed to touch this.
-     */
-    struct trie_iter_node *front;
+struct trie_iter {
     /**
-     * Back of the queue (i.e. the input side). Only trie internal code is
-     * allowed to touch this.
+     * Stack of the branch lists from the searched node down to the current
+     * node. Only trie internal code is allowed to touch this.
      */
-    struct trie_iter_node *back;
-};
-
-/**
- * Iterator over a trie's node and the children.
- */
-struct trie_iter {
+    struct trie_iter_frame *stack;
     /**
-     * The queue used to store the children of iterated nodes. Do not touch this
-     * field.
+     * How many frames are in the stack. Only trie internal code is allowed to
+     * touch this.
      */
-    struct trie_iter_queue queue;
+    size_t length;
     /**
-     * Index of the current branch. Only trie internal code is allowed to touch
-     * this.
+     * How many frames the stack can hold. Only trie internal code is allowed
+     * to touch this.
      */
-    size_t branch;
+    size_t capacity;
     /**
-     * The current value produced by the iterator. Only trie internal code is
-     * allowed to touch this.
+     * Node to be visited next, before descending into its branches, or NULL.
+     * Only trie internal code is allowed to touch this.
      */
     struct trie_node const *current;
 };
 
+/**
+ * Initializes an iterator with an empty stack, which produces nothing until
+ * it is given to trie_search_prefix.
+ */
+inline void trie_iter_init(struct trie_iter *restrict iter)
+{
+    iter->stack = NULL;
+    iter->length = 0;
+    iter->capacity = 0;
+    iter->current = NULL;
+}
+
 /**
  * Advances the iterator and puts the current movie ID in the out paramter
- * movie_out.
+ * movie_out. Returns whether there was a movie. The only possible error is an
+ * allocation error, when the stack grows.
  */
 bool trie_next_movie(
     struct trie_iter *restrict iter,
@@ -77,57 +83,12 @@ bool trie_next_movie(
 void trie_iter_destroy(struct trie_iter *restrict iter);
 
 /**
- * Initializes the iteration queue.
- */
-inline void trie_iter_queue_init(struct trie_iter_queue *restrict queue)
-{
-    queue->front = NULL;
-    queue->back = NULL;
-}
-
-/**
- * Enqueues a branch list on the iteration queue. The only possible error is an
- * allocation error. Only trie internal code is allowed to touch this.
- */
-void trie_iter_enqueue(
-        struct trie_iter_queue *restrict queue,
-        struct trie_branch_list const *restrict branches,
-        struct error *restrict error);
-
-/**
- * Dequeues a branch list from the iteration queue. Returns whether the dequeue
- * actually happened (i.e. the queue was not empty), and fills the branches_out
- * parameter with the queue if successful. Only trie internal code is allowed
- * to touch this.
- */
-bool trie_iter_dequeue(
-        struct trie_iter_queue *restrict queue,
-        struct trie_branch_list *restrict branches_out);
-
-/**
- * Tests if the iteration queue is empty. Only trie internal code is allowed
- * to touch this.
- */
-inline bool trie_iter_queue_is_empty(
-        struct trie_iter_queue const *restrict queue)
-{
-    return queue->front == NULL;
-}
-
-/**
- * Advances the iterator. Only allocation errors are possible. Only trie
- * internal code is allowed to touch this.
- */
-void trie_next(struct trie_iter *restrict iter, struct error *restrict error);
-
-/**
- * Enqueues all children of of the given branch list into the given queue. The
- * only possible error is an allocation error. Only trie internal code is
- * allowed to touch this.
+ * Pushes a branch list onto the iterator's stack. The only possible error is
+ * an allocation error. Only trie internal code is allowed to touch this.
  */
-void trie_iter_enqueue_children(
-        struct trie_iter_queue *restrict queue,
-        struct trie_branch_list const *restrict branches,
+void trie_iter_push(
+        struct trie_iter *restrict iter,
+        struct trie_branch_list const *branches,
         struct error *restrict error);
 
 #endif
@@ -1,14 +1,20 @@
+#include <stdlib.h>
+#include <string.h>
 #include "users.h"
-#include "prime.h"
+#include "timeline.h"
 #include "alloc.h"
 
 #define MAX_LOAD 0.5
 
 /**
- * Initializes a user by allocating a user in the heap.
+ * Appends a user with room for the given number of ratings to the array of
+ * users, and maps its ID to its index. The user must not be in the table yet.
+ * Returns the user, or NULL on error.
  */
-static struct user *user_init(
-        struct rating_csv_row *restrict rating_row,
+static struct user *user_append(
+        struct users_table *restrict table,
+        moviedb_id_t userid,
+        size_t ratings,
         struct error *restrict error);
 
 /**
@@ -19,6 +25,33 @@ static void ratings_insert(
         struct user_rating const *restrict rating,
         struct error *restrict error);
 
+/**
+ * Sorts the given ratings by movie index, unless they are sorted already, as
+ * they usually are in the ratings file.
+ */
+static void sort_ratings(struct user_rating *ratings, size_t length);
+
+/**
+ * Compares two ratings: by movie index, and then by value.
+ */
+static int compare_ratings(void const *left_ptr, void const *right_ptr);
+
+/**
+ * Makes room in the array of users for at least the given number of users.
+ */
+static void reserve_users(
+        struct users_table *restrict table,
+        size_t min_capacity,
+        struct error *restrict error);
+
+/**
+ * Allocates the entries and fingerprints of the given table for its capacity,
+ * marking every entry as empty.
+ */
+static void alloc_entries(
+        struct users_table *restrict table,
+        struct error *restrict error);
+
 /**
  * Probes the given table until the place where the given user ID should be
  * stored, given its hash. Returns the index of this place.
@@ -35,111 +68,322 @@ static void resize(
         struct users_table *restrict table,
         struct error *restrict error);
 
+/**
+ * Moves the entries of the table into new arrays with at least the given
+ * capacity.
+ */
+static void rehash(
+        struct users_table *restrict table,
+        size_t min_capacity,
+        struct error *restrict error);
+
 void users_init(
         struct users_table *restrict table,
         size_t initial_capacity,
         struct error *restrict error)
 {
-    size_t i;
-
+    table->users = NULL;
+    table->users_capacity = 0;
+    table->ratings = NULL;
+    table->offsets = NULL;
     table->length = 0;
-    table->capacity = next_prime(initial_capacity);
-    table->entries = moviedb_alloc(
-            sizeof(*table->entries),
-            table->capacity,
-            error);
+    table->capacity = moviedb_hash_capacity(initial_capacity);
+    alloc_entries(table, error);
+}
 
-    if (error->code == error_none) {
-        /* Initializes all entries to NULL. */
-        for (i = 0; i < table->capacity; i++) {
-            table->entries[i] = NULL;
-        }
+void users_reserve(
+        struct users_table *restrict table,
+        size_t entries,
+        struct error *restrict error)
+{
+    /* Capacity needed to keep that many entries below maximum load. */
+    size_t min_capacity = SIZE_MAX;
+
+    if (entries < SIZE_MAX / 4) {
+        min_capacity = (size_t) (entries / MAX_LOAD) + 1;
+    }
+
+    if (min_capacity > table->capacity) {
+        rehash(table, min_capacity, error);
+    }
+
+    if (error->code == error_none && entries > table->users_capacity) {
+        reserve_users(table, entries, error);
     }
 }
 
 void users_insert_rating(
         struct users_table *restrict table,
-        struct rating_csv_row *restrict rating_row,
+        struct rating_csv_row const *restrict rating_row,
+        moviedb_index_t movie,
         struct error *restrict error)
 {
     struct user_rating rating;
-    double load;
     moviedb_hash_t hash;
     size_t index;
+    struct user *user;
 
-    load = (table->length + 1) / (double) table->capacity;
-    if (load >= MAX_LOAD) {
-        /* Resize if it would be above maximum load. */
-        resize(table, error);
+    hash = moviedb_id_hash(rating_row->userid);
+    index = probe_index(table, rating_row->userid, hash);
+
+    if (table->fingerprints[index] == 0) {
+        /* No previous insert with the given ID. */
+        user = user_append(table, rating_row->userid, 1, error);
+        if (error->code == error_none) {
+            user->ratings.entries[0].movie = movie;
+            user->ratings.entries[0].code = rating_encode(rating_row->value);
+            user->ratings.entries[0].month
+                = timeline_month(rating_row->timestamp);
+        }
+    } else {
+        /* There was a previous insert with the given ID. */
+        rating.movie = movie;
+        rating.code = rating_encode(rating_row->value);
+        rating.month = timeline_month(rating_row->timestamp);
+        user = &table->users[table->entries[index].index];
+        ratings_insert(&user->ratings, &rating, error);
     }
+}
 
-    if (error->code == error_none) {
-        hash = moviedb_id_hash(rating_row->userid);
-        index = probe_index(table, rating_row->userid, hash);
-
-        if (table->entries[index] == NULL) {
-            /* No previous insert with the given ID. */
-            table->entries[index] = user_init(rating_row, error);
-            if (error->code == error_none) {
-                table->length++;
+void users_seal(
+        struct users_table *restrict table,
+        struct error *restrict error)
+{
+    size_t i;
+    size_t total = 0;
+    struct user_rating_list *list;
+
+    if (table->offsets == NULL) {
+        for (i = 0; i < table->length; i++) {
+            total += table->users[i].ratings.length;
+        }
+
+        table->ratings = moviedb_alloc(sizeof(*table->ratings), total, error);
+    }
+
+    if (table->offsets == NULL && error->code == error_none) {
+        table->offsets = moviedb_alloc(
+                sizeof(*table->offsets),
+                table->length + 1,
+                error);
+
+        if (error->code == error_none) {
+            /* Packs the lists in user order, freeing each one once copied. */
+            total = 0;
+            for (i = 0; i < table->length; i++) {
+                list = &table->users[i].ratings;
+                table->offsets[i] = total;
+                memcpy(table->ratings + total,
+                        list->entries,
+                        list->length * sizeof(*list->entries));
+                sort_ratings(table->ratings + total, list->length);
+                total += list->length;
+
+                moviedb_free(list->entries);
+                list->entries = NULL;
+                list->length = 0;
+                list->capacity = 0;
             }
+            table->offsets[table->length] = total;
         } else {
-            /* There was a previous insert with the given ID. */
-            rating.movie = rating_row->movieid;
-            rating.value = rating_row->value;
-            ratings_insert(&table->entries[index]->ratings, &rating, error);
+            moviedb_free(table->ratings);
+            table->ratings = NULL;
+        }
+    }
+}
+
+extern inline struct user const *users_at(
+        struct users_table const *restrict table,
+        moviedb_index_t index);
+
+extern inline struct user_rating const *users_ratings(
+        struct users_table const *restrict table,
+        struct user const *restrict user,
+        size_t *restrict length_out);
+
+void users_restore(
+        struct users_table *restrict table,
+        moviedb_id_t const *restrict ids,
+        size_t length,
+        size_t const *restrict offsets,
+        struct user_rating const *restrict ratings,
+        struct users_entry const *restrict entries,
+        unsigned char const *restrict fingerprints,
+        size_t capacity,
+        struct error *restrict error)
+{
+    size_t i;
+    struct users_table new_table;
+
+    /* Allocates everything first, so the table is left as is on error. */
+    new_table.capacity = capacity;
+    new_table.users = moviedb_alloc(sizeof(*new_table.users), length, error);
+    new_table.offsets = NULL;
+    new_table.ratings = NULL;
+    new_table.entries = NULL;
+    new_table.fingerprints = NULL;
+
+    if (error->code == error_none) {
+        new_table.offsets = moviedb_alloc(
+                sizeof(*new_table.offsets),
+                length + 1,
+                error);
+    }
+
+    if (error->code == error_none) {
+        new_table.ratings = moviedb_alloc(
+                sizeof(*new_table.ratings),
+                offsets[length],
+                error);
+    }
+
+    if (error->code == error_none) {
+        alloc_entries(&new_table, error);
+    }
+
+    if (error->code == error_none) {
+        /* The ratings are packed already, so the lists stay empty. */
+        for (i = 0; i < length; i++) {
+            new_table.users[i].id = ids[i];
+            new_table.users[i].ratings.entries = NULL;
+            new_table.users[i].ratings.length = 0;
+            new_table.users[i].ratings.capacity = 0;
         }
+        memcpy(new_table.offsets,
+                offsets,
+                sizeof(*offsets) * (length + 1));
+        memcpy(new_table.ratings,
+                ratings,
+                sizeof(*ratings) * offsets[length]);
+        memcpy(new_table.entries, entries, sizeof(*entries) * capacity);
+        memcpy(new_table.fingerprints,
+                fingerprints,
+                sizeof(*fingerprints) * capacity);
+
+        moviedb_free(table->users);
+        moviedb_free(table->fingerprints);
+        moviedb_free(table->entries);
+        table->users = new_table.users;
+        table->users_capacity = length;
+        table->length = length;
+        table->offsets = new_table.offsets;
+        table->ratings = new_table.ratings;
+        table->capacity = new_table.capacity;
+        table->entries = new_table.entries;
+        table->fingerprints = new_table.fingerprints;
+    } else {
+        moviedb_free(new_table.ratings);
+        moviedb_free(new_table.offsets);
+        moviedb_free(new_table.users);
     }
 }
 
+extern inline struct users_entry const *users_entries(
+        struct users_table const *restrict table,
+        unsigned char const **restrict fingerprints_out,
+        size_t *restrict capacity_out);
+
 struct user const *users_search(
         struct users_table const *restrict table,
         moviedb_id_t userid)
 {
     moviedb_hash_t hash = moviedb_id_hash(userid);
     size_t index = probe_index(table, userid, hash);
-    return table->entries[index];
+    struct user const *user = NULL;
+
+    if (table->fingerprints[index] != 0) {
+        user = &table->users[table->entries[index].index];
+    }
+
+    return user;
+}
+
+extern inline void users_iter(
+        struct users_table const *table,
+        struct users_iter *restrict iter_out);
+
+struct user const *users_next(struct users_iter *restrict iter)
+{
+    struct user const *user = NULL;
+
+    if (iter->current < iter->table->length) {
+        user = &iter->table->users[iter->current];
+        iter->current++;
+    }
+
+    return user;
 }
 
 void users_destroy(struct users_table *restrict table)
 {
     size_t i;
 
-    /* Iterates through all entries to free their user's memories. */
-    for (i = 0; i < table->capacity; i++) {
-        if (table->entries[i] != NULL) {
-            moviedb_free(table->entries[i]->ratings.entries);
-            moviedb_free(table->entries[i]);
-        }
+    /* Iterates through all users to free their rating lists, if any left. */
+    for (i = 0; i < table->length; i++) {
+        moviedb_free(table->users[i].ratings.entries);
     }
 
+    moviedb_free(table->offsets);
+    moviedb_free(table->ratings);
+    moviedb_free(table->users);
+    moviedb_free(table->fingerprints);
     moviedb_free(table->entries);
 }
 
-static struct user *user_init(
-        struct rating_csv_row *restrict rating_row,
+static struct user *user_append(
+        struct users_table *restrict table,
+        moviedb_id_t userid,
+        size_t ratings,
         struct error *restrict error)
 {
-    struct user *user = moviedb_alloc(sizeof(*user), 1, error);
+    double load;
+    moviedb_hash_t hash;
+    size_t index;
+    size_t new_cap;
+    struct user *user = NULL;
+
+    load = (table->length + 1) / (double) table->capacity;
+    if (load >= MAX_LOAD) {
+        /* Resize if it would be above maximum load. */
+        resize(table, error);
+    }
+
+    if (error->code == error_none && table->length >= MOVIEDB_INDEX_MAX) {
+        /* The index of the user would not fit. */
+        error_set_code(error, error_max_capacity);
+        error->data.max_capacity.capacity = table->length;
+    }
+
+    if (error->code == error_none
+            && table->length == table->users_capacity) {
+        /* Doubles capacity, handles the case where capacity == 0. */
+        new_cap = table->users_capacity * 2;
+        if (new_cap == 0) {
+            new_cap = 16;
+        }
+        reserve_users(table, new_cap, error);
+    }
 
     if (error->code == error_none) {
-        /* Initializes the user. */
-        user->id = rating_row->userid;
-        user->ratings.length = 1;
-        user->ratings.capacity = 1;
+        user = &table->users[table->length];
+        user->id = userid;
+        user->ratings.length = ratings;
+        user->ratings.capacity = ratings;
         user->ratings.entries = moviedb_alloc(
                 sizeof(*user->ratings.entries),
-                user->ratings.capacity,
+                ratings,
                 error);
+    }
 
-        /* Initializes the user's rating list with the given rating. */
-        if (error->code == error_none) {
-            user->ratings.entries[0].value = rating_row->value;
-            user->ratings.entries[0].movie = rating_row->movieid;
-        } else {
-            moviedb_free(user);
-            user = NULL;
-        }
+    if (error->code == error_none) {
+        hash = moviedb_id_hash(userid);
+        index = probe_index(table, userid, hash);
+        table->entries[index].id = userid;
+        table->entries[index].index = table->length;
+        table->fingerprints[index] = moviedb_hash_fingerprint(hash);
+        table->length++;
+    } else {
+        user = NULL;
     }
 
     return user;
@@ -154,8 +398,11 @@ static void ratings_insert(
     size_t new_cap;
 
     if (ratings->length == ratings->capacity) {
-        /* Doubles capacity. 0 capacity never happens. */
+        /* Doubles capacity, handles the case where capacity == 0. */
         new_cap = ratings->capacity * 2;
+        if (new_cap == 0) {
+            new_cap = 1;
+        }
         new_entries = moviedb_realloc(
                 ratings->entries,
                 sizeof(*new_entries),
@@ -175,6 +422,74 @@ static void ratings_insert(
     }
 }
 
+static void sort_ratings(struct user_rating *ratings, size_t length)
+{
+    size_t i = 1;
+
+    while (i < length && ratings[i - 1].movie <= ratings[i].movie) {
+        i++;
+    }
+
+    if (i < length) {
+        qsort(ratings, length, sizeof(*ratings), compare_ratings);
+    }
+}
+
+static int compare_ratings(void const *left_ptr, void const *right_ptr)
+{
+    struct user_rating const *left = left_ptr;
+    struct user_rating const *right = right_ptr;
+    int order = (left->movie > right->movie) - (left->movie < right->movie);
+
+    if (order == 0) {
+        order = (left->code > right->code) - (left->code < right->code);
+    }
+
+    return order;
+}
+
+static void reserve_users(
+        struct users_table *restrict table,
+        size_t min_capacity,
+        struct error *restrict error)
+{
+    struct user *new_users = moviedb_realloc(
+            table->users,
+            sizeof(*new_users),
+            min_capacity,
+            error);
+
+    if (error->code == error_none) {
+        table->users = new_users;
+        table->users_capacity = min_capacity;
+    }
+}
+
+static void alloc_entries(
+        struct users_table *restrict table,
+        struct error *restrict error)
+{
+    table->entries = moviedb_alloc(
+            sizeof(*table->entries),
+            table->capacity,
+            error);
+
+    if (error->code == error_none) {
+        table->fingerprints = moviedb_alloc(
+                sizeof(*table->fingerprints),
+                table->capacity,
+                error);
+
+        if (error->code == error_none) {
+            /* Initializes all entries to empty. */
+            memset(table->fingerprints, 0, table->capacity);
+        } else {
+            moviedb_free(table->entries);
+            table->entries = NULL;
+        }
+    }
+}
+
 static size_t probe_index(
         struct users_table const *restrict table,
         moviedb_id_t userid,
@@ -182,21 +497,24 @@ static size_t probe_index(
 {
     moviedb_hash_t attempt;
     size_t index;
-    struct user *user;
+    unsigned char fingerprint = moviedb_hash_fingerprint(hash);
 
     attempt = 0;
     index = moviedb_hash_to_index(hash, attempt, table->capacity);
-    user = table->entries[index];
 
-    /* Iterates while there is an user and it is not our target. */
-    while (user != NULL && user->id != userid) {
+    /*
+     * Iterates while the entry is occupied and it is not our target. The ID is
+     * only compared if the fingerprint matches.
+     */
+    while (table->fingerprints[index] != 0
+            && (table->fingerprints[index] != fingerprint
+                || table->entries[index].id != userid)) {
         /*
          * If we reached here, the condition failed, and we need to get the
          * next attempt.
          */
         attempt++;
         index = moviedb_hash_to_index(hash, attempt, table->capacity);
-        user = table->entries[index];
     }
 
     return index;
@@ -205,53 +523,55 @@ static size_t probe_index(
 static void resize(
         struct users_table *restrict table,
         struct error *restrict error)
+{
+    size_t min_capacity = SIZE_MAX;
+
+    /* Asks for double capacity, unless it would overflow. */
+    if (table->capacity <= SIZE_MAX / 2) {
+        min_capacity = table->capacity * 2;
+    }
+
+    rehash(table, min_capacity, error);
+}
+
+static void rehash(
+        struct users_table *restrict table,
+        size_t min_capacity,
+        struct error *restrict error)
 {
     size_t i;
     moviedb_hash_t hash;
     size_t index;
     struct users_table new_table;
 
-    /*
-     * Checks if there is a next prime with at least double capacity, in first
-     * place.
-     */
-    if (SIZE_MAX / 2 < table->capacity) {
-        new_table.capacity = SIZE_MAX;
-    } else {
-        new_table.capacity = next_prime(table->capacity * 2);
-    }
+    new_table.capacity = moviedb_hash_capacity(min_capacity);
 
-    /* Sets an error if no prime available. */
+    /* Sets an error if no capacity available. */
     if (new_table.capacity == SIZE_MAX) {
         error_set_code(error, error_max_capacity);
         error->data.max_capacity.capacity = table->capacity;
     }
 
     if (error->code == error_none) {
-        new_table.entries = moviedb_alloc(
-                sizeof(*new_table.entries),
-                new_table.capacity,
-                error);
+        alloc_entries(&new_table, error);
     }
 
     if (error->code == error_none) {
-        /* Initializes the new table's entries. */
-        for (i = 0; i < new_table.capacity; i++) {
-            new_table.entries[i] = NULL;
-        }
-
         /* Reinserts entries from old table into the new table. */
         for (i = 0; i < table->capacity; i++) {
-            if (table->entries[i] != NULL) {
-                hash = moviedb_id_hash(table->entries[i]->id);
-                index = probe_index(&new_table, table->entries[i]->id, hash);
+            if (table->fingerprints[i] != 0) {
+                hash = moviedb_id_hash(table->entries[i].id);
+                index = probe_index(&new_table, table->entries[i].id, hash);
                 new_table.entries[index] = table->entries[i];
+                new_table.fingerprints[index] = table->fingerprints[i];
             }
         }
 
         /* Frees the old table. */
+        moviedb_free(table->fingerprints);
         moviedb_free(table->entries);
         table->capacity = new_table.capacity;
         table->entries = new_table.entries;
+        table->fingerprints = new_table.fingerprints;
     }
 }
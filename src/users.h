@@ -2,27 +2,38 @@
 #define MOVIEDB_USERS_H 1
 
 #include "id.h"
+#include "rating.h"
 #include "csv/rating.h"
 
 /**
- * This file exports items related to users.
+ * This file exports items related to users. Users are stored in an array, in
+ * the order they are inserted, with a hash table mapping their IDs to their
+ * indices in the array. Once loaded, the table is sealed: the ratings of all
+ * users are packed into a single array, in compressed sparse row form.
  */
 
 /**
- * Rating given by a user.
+ * Rating given by a user. It is packed into 7 bytes, since there is one for
+ * every row of the ratings file.
  */
 struct user_rating {
     /**
-     * Value of the rating given by the user to a movie. Only internal users
-     * hash table code is allowed to update this value. Reading is fine.
+     * Index of the movie that was rated in the movies table. Only internal
+     * users hash table code is allowed to update this value. Reading is fine.
      */
-    double value;
+    moviedb_index_t movie;
     /**
-     * The movie that was rated. Only internal users hash table code is allowed
-     * to update this value. Reading is fine.
+     * Code of the rating given by the user to the movie, see rating_decode.
+     * Only internal users hash table code is allowed to update this value.
+     * Reading is fine.
      */
-    moviedb_id_t movie;
-};
+    uint8_t code;
+    /**
+     * Month the rating was made in, see timeline_month. Only internal users
+     * hash table code is allowed to update this value. Reading is fine.
+     */
+    uint16_t month;
+} __attribute__((packed));
 
 /**
  * The ratings given by a user.
@@ -55,51 +66,171 @@ struct user {
      */
     moviedb_id_t id;
     /**
-     * List of the ratings made by this user. Only internal users hash table
-     * code is allowed to update this value. Reading is fine.
+     * List of the ratings made by this user while loading, empty once the
+     * table is sealed. Use users_ratings to read them. Only internal users hash
+     * table code is allowed to touch this value.
      */
     struct user_rating_list ratings;
 };
 
 /**
- * A hash table mapping user IDs to users.
+ * An entry of the users hash table, keeping the user ID inline so probing does
+ * not need to read the user.
+ */
+struct users_entry {
+    /**
+     * ID of the user. Only internal users hash table code is allowed to touch
+     * this value.
+     */
+    moviedb_id_t id;
+    /**
+     * Index of the user in the array of users. Only internal users hash table
+     * code is allowed to touch this value.
+     */
+    moviedb_index_t index;
+};
+
+/**
+ * An array of users, with a hash table mapping user IDs to their indices.
  */
 struct users_table {
     /**
-     * Array of entries, more specifically array of pointers to users. Only
+     * Array of users, by index. Only internal users hash table code is allowed
+     * to touch this value.
+     */
+    struct user *users;
+    /**
+     * Array of entries. Only meaningful where the fingerprint is not zero. Only
      * internal users hash table code is allowed to touch this value.
      */
-    struct user **entries;
+    struct users_entry *entries;
+    /**
+     * Array of fingerprints of the entries' hashes, zero for empty entries.
+     * Only internal users hash table code is allowed to touch this value.
+     */
+    unsigned char *fingerprints;
     /**
-     * How many elements are stored. Only internal users hash table code is
+     * How many users are stored. Only internal users hash table code is
      * allowed to touch this value.
      */
     size_t length;
     /**
-     * How many elements we can currently store. Only internal users hash table
-     * code is allowed to touch this value.
+     * How many entries the hash table has. Only internal users hash table code
+     * is allowed to touch this value.
      */
     size_t capacity;
+    /**
+     * How many users the array can store. Only internal users hash table code
+     * is allowed to touch this value.
+     */
+    size_t users_capacity;
+    /**
+     * Ratings of all users once the table is sealed, grouped by user in index
+     * order, and sorted by movie index within a user. NULL until sealed. Only
+     * internal users hash table code is allowed to touch this value.
+     */
+    struct user_rating *ratings;
+    /**
+     * Offsets of the ratings of each user into the packed ratings, plus the
+     * total number of ratings at the end, so the ratings of the user with
+     * index i go from offsets[i] to offsets[i + 1]. NULL until sealed. Only
+     * internal users hash table code is allowed to touch this value.
+     */
+    size_t *offsets;
+};
+
+/**
+ * Iterator over the users stored in a users table.
+ */
+struct users_iter {
+    /**
+     * The table being iterated over. Only internal users hash table code is
+     * allowed to touch this.
+     */
+    struct users_table const *table;
+    /**
+     * Index of the next user. Only internal users hash table code is allowed
+     * to touch this.
+     */
+    size_t current;
 };
 
 /**
  * Initializes the user hash table to the given initial capacity. This capacity
- * is rounded up to next prime.
+ * is rounded up with moviedb_hash_capacity. Users and their rating lists are
+ * allocated from the heap, since they grow while loading.
  */
 void users_init(
         struct users_table *restrict table,
         size_t initial_capacity,
         struct error *restrict error);
 
+/**
+ * Makes room for the given total number of users, so the table is not resized
+ * until it holds more than that. Does nothing if there is room already.
+ */
+void users_reserve(
+        struct users_table *restrict table,
+        size_t entries,
+        struct error *restrict error);
+
 /**
  * Inserts the given rating made by the given user, creating an entry for the
- * user in the table if necessary.
+ * user in the table if necessary. The rated movie is given by its index in the
+ * movies table, the row's movie ID is not read, and the row's value must be
+ * valid according to rating_is_valid. Only the month of the row's timestamp
+ * is kept. If a new user would not fit an index, error_max_capacity is set.
+ * The table must not be sealed.
  */
 void users_insert_rating(
         struct users_table *restrict table,
-        struct rating_csv_row *restrict rating_row,
+        struct rating_csv_row const *restrict rating_row,
+        moviedb_index_t movie,
+        struct error *restrict error);
+
+/**
+ * Seals the table: the ratings of every user are moved into one packed array,
+ * sorted by movie index within each user, and the users' lists are freed. No
+ * more ratings can be inserted after this. Does nothing if the table is
+ * already sealed.
+ */
+void users_seal(
+        struct users_table *restrict table,
         struct error *restrict error);
 
+/**
+ * Restores the table, which must hold no users, sealed, e.g. from a snapshot:
+ * copies the given IDs of the users, by index, the offsets and packed ratings
+ * as described for the offsets and ratings fields, and the entries and
+ * fingerprints of a hash table with the given capacity, which must be one
+ * moviedb_hash_capacity returns, mapping the IDs to their indices.
+ */
+void users_restore(
+        struct users_table *restrict table,
+        moviedb_id_t const *restrict ids,
+        size_t length,
+        size_t const *restrict offsets,
+        struct user_rating const *restrict ratings,
+        struct users_entry const *restrict entries,
+        unsigned char const *restrict fingerprints,
+        size_t capacity,
+        struct error *restrict error);
+
+/**
+ * Returns the entries of the hash table, writing their fingerprints, zero for
+ * empty entries, into fingerprints_out, and how many entries there are into
+ * capacity_out, e.g. to write the table into a snapshot.
+ */
+inline struct users_entry const *users_entries(
+        struct users_table const *restrict table,
+        unsigned char const **restrict fingerprints_out,
+        size_t *restrict capacity_out)
+{
+    *fingerprints_out = table->fingerprints;
+    *capacity_out = table->capacity;
+    return table->entries;
+}
+
 /**
  * Searches for a user's entry in the table. Returns NULL if not found.
  */
@@ -107,6 +238,56 @@ struct user const *users_search(
         struct users_table const *restrict table,
         moviedb_id_t userid);
 
+/**
+ * Returns the user with the given index, which must be in the table.
+ */
+inline struct user const *users_at(
+        struct users_table const *restrict table,
+        moviedb_index_t index)
+{
+    return &table->users[index];
+}
+
+/**
+ * Returns the ratings of the given user of the table, placing how many there
+ * are in length_out. Works whether the table is sealed or not.
+ */
+inline struct user_rating const *users_ratings(
+        struct users_table const *restrict table,
+        struct user const *restrict user,
+        size_t *restrict length_out)
+{
+    struct user_rating const *ratings = user->ratings.entries;
+    size_t index;
+
+    *length_out = user->ratings.length;
+
+    if (table->offsets != NULL) {
+        index = user - table->users;
+        ratings = table->ratings + table->offsets[index];
+        *length_out = table->offsets[index + 1] - table->offsets[index];
+    }
+
+    return ratings;
+}
+
+/**
+ * Initializes an iterator over the given table.
+ */
+inline void users_iter(
+        struct users_table const *table,
+        struct users_iter *restrict iter_out)
+{
+    iter_out->table = table;
+    iter_out->current = 0;
+}
+
+/**
+ * Finds the next user in the table using the given iterator, in index order.
+ * Returns NULL if all users have been returned by the iterator.
+ */
+struct user const *users_next(struct users_iter *restrict iter);
+
 /**
  * Destroys the given users table, freeing all memory.
  */
@@ -16,7 +16,7 @@ run_test() {
         && ./run.sh release "test/$@"
 }
 
-for TEST in csv trie prime movies_table users_table tags_table
+for TEST in csv trie prime movies_table users_table tags_table arena genres_index bitmap titles raters_index timeline_index tags_query
 do
     if ! run_test "$TEST"
     then